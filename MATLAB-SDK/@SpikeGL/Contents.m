@@ -79,7 +79,7 @@
 %                Retrieve a listing of files in the ith data directory.
 %                Get main data directory by setting i=0 or omitting it.
 %
-%    [daqData,headCt] = Fetch( myObj, streamID, start_scan, scan_ct, channel_subset, downsample_ratio )
+%    [daqData,headCt] = Fetch( myObj, streamID, start_scan, scan_ct, channel_subset, downsample_ratio, filter_spec )
 %
 %                Get MxN matrix of stream data.
 %                M = scan_ct = max samples to fetch.
@@ -89,9 +89,24 @@
 %                Fetching starts at index start_scan.
 %                Data are int16 type.
 %
-%                downsample_ratio is an integer (default = 1).
+%                downsample_ratio is an integer (default = 1). Downsampling
+%                always applies an anti-alias lowpass to neural and analog
+%                channels; sync and digital words are picked.
 %
-%                Also returns headCt = index of first timepoint in matrix.
+%                filter_spec is an optional string applied server-side before
+%                downsampling, e.g., 'hp=300,lp=6000,car'.
+%                hp/lp are corner frequencies (Hz), car = common average
+%                reference ('aa' is accepted as a no-op).
+%
+%                Filter and downsampling state persist across calls on a
+%                connection, so fetch contiguous spans (next start_scan =
+%                last start_scan + scan_ct) for seamless output. Downsampled
+%                output trails the request by 8*downsample_ratio scans,
+%                which arrive with the next contiguous fetch, so a reply
+%                can have zero rows. A skip or rewind restarts the state.
+%
+%                Also returns headCt = index of first timepoint in matrix
+%                (with downsampling, the scan row 1 is centered on).
 %
 %    [daqData,headCt] = FetchLatest( myObj, streamID, scan_ct, channel_subset, downsample_ratio )
 %
@@ -127,6 +142,26 @@
 %
 %                Returns count of enabled IMEC probes.
 %
+%    [daqData,headCt,bySync] = FetchMulti( myObj, srcStream, start_scan, scan_ct, streamIDs, downsample_ratio )
+%
+%                Get time-aligned data from several streams in one request.
+%                The window is start_scan..start_scan+scan_ct-1 in srcStream;
+%                start_scan must still be in srcStream's queue (else error).
+%                Each stream in vector streamIDs is mapped into that window
+%                using the sync edges, and all streams are clipped to the
+%                common duration currently available.
+%
+%                Returns cell arrays indexed like streamIDs:
+%                daqData{i} = MxN int16 matrix (N = save-channel subset).
+%                headCt(i)  = mapped index of first timepoint in daqData{i}.
+%                bySync(i)  = 1 if mapped using sync edges, else by wall time.
+%
+%                downsample_ratio is an integer (default = 1). As in Fetch,
+%                downsampling state persists per stream on the connection:
+%                output trails the window by 8*downsample_ratio scans (so a
+%                block can be empty), and headCt(i) is the scan row 1 is
+%                centered on.
+%
 %    [SN,type] = GetImProbeSN( myobj, streamID )
 %
 %                Returns serial number string (SN) and integer type
@@ -136,6 +171,14 @@
 %
 %                Returns votlage range of selected IMEC probe.
 %
+%    lines = GetMetrics( myobj )
+%
+%                Returns cell array of strings, one per hot-path metric,
+%                accumulated since run start. Histogram lines have form:
+%                '<name> n=.. mean=.. p50=.. p90=.. p99=.. p999=.. max=..'
+%                with times in microseconds. Gauge lines have form:
+%                '<name> last=.. max=..'.
+%
 %    params = GetParams( myobj )
 %
 %                Get the most recently used run parameters.
@@ -286,6 +329,21 @@
 %                file creation. hertz=0 disables the beep. Command has
 %                no effect if not currently running.
 %
+%    [daqData,headCt] = ShmFetch( myObj, streamID, start_scan, scan_ct )
+%
+%                Same-host alternative to Fetch() that copies directly from
+%                SpikeGLX shared memory, bypassing the network socket.
+%                Requires 'Export streams to shared memory' checked in the
+%                SpikeGLX Command Server Settings dialog.
+%
+%                Get MxN matrix of stream data.
+%                M = scan_ct = max samples to fetch.
+%                N = channel count = all acquired channels.
+%                Fetching starts at index start_scan; -1 gets newest scan_ct.
+%                Data are int16 type.
+%
+%                Also returns headCt = index of first timepoint in matrix.
+%
 %    myobj = StartRun( myobj )
 %    myobj = StartRun( myobj, params )
 %    myobj = StartRun( myobj, runName )
@@ -301,6 +359,35 @@
 %                Unconditionally stop current run, close data files
 %                and return to idle state.
 %
+%    myobj = Subscribe( myObj, streamID, start_scan, channel_subset, downsample_ratio, max_blocks )
+%
+%                Start a push session: SpikeGLX sends contiguous blocks of
+%                stream data as they arrive, until you call Unsubscribe().
+%                Read each block with SubscribeRead(). While subscribed,
+%                do not issue any other commands on this connection.
+%
+%                start_scan = -1 starts with the newest data.
+%                channel_subset defaults to the SpikeGLX save-channel subset.
+%                downsample_ratio is an integer (default = 1).
+%                max_blocks bounds the server-side queue (default = 64).
+%                If you read too slowly, the oldest blocks are discarded.
+%
+%    [daqData,headCt,nDropped] = SubscribeRead( myObj )
+%
+%                Get next MxN block of subscribed stream data.
+%                M = timepoint count of this block.
+%                N = channel count.
+%                Data are int16 type.
+%
+%                Also returns headCt = index of first timepoint in matrix,
+%                and nDropped = count of source timepoints discarded just
+%                before this block because the reader fell behind.
+%
+%    myobj = Unsubscribe( myobj )
+%
+%                End the push session begun by Subscribe().
+%                Any blocks still in flight are discarded.
+%
 %    res = VerifySha1( myobj, filename )
 %
 %                Verifies the SHA1 sum of the file specified by filename.
@@ -1,4 +1,4 @@
-% [daqData,headCt] = Fetch( myObj, streamID, start_scan, scan_ct, channel_subset, downsample_ratio )
+% [daqData,headCt] = Fetch( myObj, streamID, start_scan, scan_ct, channel_subset, downsample_ratio, filter_spec )
 %
 %     Get MxN matrix of stream data.
 %     M = scan_ct = max samples to fetch.
@@ -8,9 +8,24 @@
 %     Fetching starts at index start_scan.
 %     Data are int16 type.
 %
-%     downsample_ratio is an integer (default = 1).
+%     downsample_ratio is an integer (default = 1). Downsampling
+%     always applies an anti-alias lowpass to neural and analog
+%     channels; sync and digital words are picked.
 %
-%     Also returns headCt = index of first timepoint in matrix.
+%     filter_spec is an optional string applied server-side before
+%     downsampling, e.g., 'hp=300,lp=6000,car'.
+%     hp/lp are corner frequencies (Hz), car = common average
+%     reference ('aa' is accepted as a no-op).
+%
+%     Filter and downsampling state persist across calls on a
+%     connection, so fetch contiguous spans (next start_scan =
+%     last start_scan + scan_ct) for seamless output. Downsampled
+%     output trails the request by 8*downsample_ratio scans,
+%     which arrive with the next contiguous fetch, so a reply
+%     can have zero rows. A skip or rewind restarts the state.
+%
+%     Also returns headCt = index of first timepoint in matrix
+%     (with downsampling, the scan row 1 is centered on).
 %
 function [mat,headCt] = Fetch( s, streamID, start_scan, scan_ct, varargin )
 
@@ -46,9 +61,20 @@ function [mat,headCt] = Fetch( s, streamID, start_scan, scan_ct, varargin )
         end
     end
 
+    filter = '';
+
+    if( nargin >= 7 )
+
+        filter = varargin{3};
+
+        if( ~ischar( filter ) || any( isspace( filter ) ) )
+            error( 'Filter spec must be a string without spaces' );
+        end
+    end
+
     ok = CalinsNetMex( 'sendString', s.handle, ...
-            sprintf( 'FETCH %d %ld %d %s %d\n', ...
-            streamID, start_scan, scan_ct, subset, dwnsmp ) );
+            sprintf( 'FETCH %d %ld %d %s %d %s\n', ...
+            streamID, start_scan, scan_ct, subset, dwnsmp, filter ) );
 
     line = CalinsNetMex( 'readLine', s.handle );
 
@@ -66,7 +92,11 @@ function [mat,headCt] = Fetch( s, streamID, start_scan, scan_ct, varargin )
         error( 'Invalid matrix dimensions.' );
     end
 
-    mat = CalinsNetMex( 'readMatrix', s.handle, 'int16', mat_dims );
+    if( mat_dims(2) > 0 )
+        mat = CalinsNetMex( 'readMatrix', s.handle, 'int16', mat_dims );
+    else
+        mat = zeros( mat_dims, 'int16' );
+    end
 
     % transpose
     mat = mat';
@@ -0,0 +1,88 @@
+% [daqData,headCt,bySync] = FetchMulti( myObj, srcStream, start_scan, scan_ct, streamIDs, downsample_ratio )
+%
+%     Get time-aligned data from several streams in one request.
+%     The window is start_scan..start_scan+scan_ct-1 in srcStream;
+%     start_scan must still be in srcStream's queue (else error).
+%     Each stream in vector streamIDs is mapped into that window
+%     using the sync edges, and all streams are clipped to the
+%     common duration currently available.
+%
+%     Returns cell arrays indexed like streamIDs:
+%     daqData{i} = MxN int16 matrix (N = save-channel subset).
+%     headCt(i)  = mapped index of first timepoint in daqData{i}.
+%     bySync(i)  = 1 if mapped using sync edges, else by wall time.
+%
+%     downsample_ratio is an integer (default = 1). As in Fetch,
+%     downsampling state persists per stream on the connection:
+%     output trails the window by 8*downsample_ratio scans (so a
+%     block can be empty), and headCt(i) is the scan row 1 is
+%     centered on.
+%
+function [mat,headCt,bySync] = FetchMulti( s, srcStream, start_scan, scan_ct, streamIDs, varargin )
+
+    if( nargin < 5 )
+        error( 'FetchMulti requires at least 5 arguments' );
+    end
+
+    if( ~isnumeric( start_scan ) || ~size( start_scan, 1 ) )
+        error( 'Invalid scan_start parameter' );
+    end
+
+    if( ~isnumeric( scan_ct ) || ~size( scan_ct, 1 ) )
+        error( 'Invalid scan_ct parameter' );
+    end
+
+    if( ~isnumeric( streamIDs ) || ~length( streamIDs ) )
+        error( 'Invalid streamIDs parameter' );
+    end
+
+    ChkConn( s );
+
+    dwnsmp = 1;
+
+    if( nargin >= 6 )
+
+        dwnsmp = varargin{1};
+
+        if( ~isnumeric( dwnsmp ) || length( dwnsmp ) > 1 )
+            error( 'Downsample factor must be a single numeric value' );
+        end
+    end
+
+    ok = CalinsNetMex( 'sendString', s.handle, ...
+            sprintf( 'FETCHMULTI %d %ld %d %s %d\n', ...
+            srcStream, start_scan, scan_ct, ...
+            sprintf( '%d#', streamIDs ), dwnsmp ) );
+
+    ns      = length( streamIDs );
+    mat     = cell( 1, ns );
+    headCt  = zeros( 1, ns );
+    bySync  = zeros( 1, ns );
+
+    for i = 1:ns
+
+        line = CalinsNetMex( 'readLine', s.handle );
+
+        if( strfind( line, 'ERROR' ) == 1 )
+            error( line );
+            return;
+        end
+
+        cells       = strread( line, '%s' );
+        mat_dims    = [str2num(cells{2}) str2num(cells{3})];
+        headCt(i)   = str2num(cells{4});
+        bySync(i)   = str2num(cells{6});
+
+        if( ~isnumeric( mat_dims ) || ~size( mat_dims, 2 ) )
+            error( 'Invalid matrix dimensions.' );
+        end
+
+        if( mat_dims(2) > 0 )
+            mat{i} = CalinsNetMex( 'readMatrix', s.handle, 'int16', mat_dims )';
+        else
+            mat{i} = zeros( fliplr( mat_dims ), 'int16' );
+        end
+    end
+
+    ReceiveOK( s, 'FETCHMULTI' );
+end
@@ -0,0 +1,12 @@
+% lines = GetMetrics( myobj )
+%
+%     Returns cell array of strings, one per hot-path metric,
+%     accumulated since run start. Histogram lines have form:
+%     '<name> n=.. mean=.. p50=.. p90=.. p99=.. p999=.. max=..'
+%     with times in microseconds. Gauge lines have form:
+%     '<name> last=.. max=..'.
+%
+function ret = GetMetrics( s )
+
+    ret = DoGetResultsCmd( s, 'GETMETRICS' );
+end
@@ -0,0 +1,26 @@
+% [daqData,headCt] = ShmFetch( myObj, streamID, start_scan, scan_ct )
+%
+%     Same-host alternative to Fetch() that copies directly from
+%     SpikeGLX shared memory, bypassing the network socket.
+%     Requires 'Export streams to shared memory' checked in the
+%     SpikeGLX Command Server Settings dialog.
+%
+%     Get MxN matrix of stream data.
+%     M = scan_ct = max samples to fetch.
+%     N = channel count = all acquired channels.
+%     Fetching starts at index start_scan; -1 gets newest scan_ct.
+%     Data are int16 type.
+%
+%     Also returns headCt = index of first timepoint in matrix.
+%
+function [mat,headCt] = ShmFetch( s, streamID, start_scan, scan_ct )
+
+    if( nargin < 4 )
+        error( 'ShmFetch requires 4 arguments' );
+    end
+
+    [mat,headCt] = CalinsNetMex( 'shmFetch', streamID, start_scan, scan_ct );
+
+    % transpose
+    mat = mat';
+end
@@ -0,0 +1,57 @@
+% myobj = Subscribe( myObj, streamID, start_scan, channel_subset, downsample_ratio, max_blocks )
+%
+%     Start a push session: SpikeGLX sends contiguous blocks of
+%     stream data as they arrive, until you call Unsubscribe().
+%     Read each block with SubscribeRead(). While subscribed,
+%     do not issue any other commands on this connection.
+%
+%     start_scan = -1 starts with the newest data.
+%     channel_subset defaults to the SpikeGLX save-channel subset.
+%     downsample_ratio is an integer (default = 1).
+%     max_blocks bounds the server-side queue (default = 64).
+%     If you read too slowly, the oldest blocks are discarded.
+%
+function [s] = Subscribe( s, streamID, start_scan, varargin )
+
+    if( nargin < 3 )
+        error( 'Subscribe requires at least 3 arguments' );
+    end
+
+    if( ~isnumeric( start_scan ) || ~size( start_scan, 1 ) )
+        error( 'Invalid scan_start parameter' );
+    end
+
+    ChkConn( s );
+
+    % subset has pattern id1#id2#...
+    if( nargin >= 4 )
+        subset = sprintf( '%d#', varargin{1} );
+    else
+        subset = sprintf( '%d#', GetSaveChans( s, streamID ) );
+    end
+
+    dwnsmp = 1;
+
+    if( nargin >= 5 )
+
+        dwnsmp = varargin{2};
+
+        if( ~isnumeric( dwnsmp ) || length( dwnsmp ) > 1 )
+            error( 'Downsample factor must be a single numeric value' );
+        end
+    end
+
+    maxblk = 64;
+
+    if( nargin >= 6 )
+        maxblk = varargin{3};
+    end
+
+    ok = CalinsNetMex( 'sendString', s.handle, ...
+            sprintf( 'SUBSCRIBE %d %ld %s %d %d\n', ...
+            streamID, start_scan, subset, dwnsmp, maxblk ) );
+
+    if( isempty( ok ) )
+        error( 'Subscribe: probably disconnected.' );
+    end
+end
@@ -0,0 +1,34 @@
+% [daqData,headCt,nDropped] = SubscribeRead( myObj )
+%
+%     Get next MxN block of subscribed stream data.
+%     M = timepoint count of this block.
+%     N = channel count.
+%     Data are int16 type.
+%
+%     Also returns headCt = index of first timepoint in matrix,
+%     and nDropped = count of source timepoints discarded just
+%     before this block because the reader fell behind.
+%
+function [mat,headCt,nDropped] = SubscribeRead( s )
+
+    line = CalinsNetMex( 'readLine', s.handle );
+
+    if( strfind( line, 'ERROR' ) == 1 )
+        error( line );
+    end
+
+    cells = strread( line, '%s' );
+
+    if( ~strcmp( cells{1}, 'BINARY_DATA' ) )
+        error( 'SubscribeRead: unexpected [%s].', line );
+    end
+
+    mat_dims    = [str2num(cells{2}) str2num(cells{3})];
+    headCt      = str2num(cells{4});
+    nDropped    = str2num(cells{5});
+
+    mat = CalinsNetMex( 'readMatrix', s.handle, 'int16', mat_dims );
+
+    % transpose
+    mat = mat';
+end
@@ -0,0 +1,29 @@
+% myobj = Unsubscribe( myobj )
+%
+%     End the push session begun by Subscribe().
+%     Any blocks still in flight are discarded.
+%
+function [s] = Unsubscribe( s )
+
+    CalinsNetMex( 'sendString', s.handle, sprintf( 'UNSUBSCRIBE\n' ) );
+
+    while( 1 )
+
+        line = CalinsNetMex( 'readLine', s.handle );
+
+        if( isempty( line ) || strfind( line, 'OK' ) == 1 )
+            break;
+        end
+
+        if( strfind( line, 'ERROR' ) == 1 )
+            error( line );
+        end
+
+        cells = strread( line, '%s' );
+
+        if( strcmp( cells{1}, 'BINARY_DATA' ) )
+            CalinsNetMex( 'readMatrix', s.handle, 'int16', ...
+                [str2num(cells{2}) str2num(cells{3})] );
+        end
+    end
+end
@@ -1,5 +1,6 @@
 
 #include "NetClient.h"
+#include "ShmReader.h"
 
 #include <algorithm>
 #include <map>
@@ -112,6 +113,7 @@ public:
 /* ---------------------------------------------------------------- */
 
 typedef map<int,NetClient*> NetClientMap;
+typedef map<int,ShmReader*> ShmReaderMap;
 
 /* ---------------------------------------------------------------- */
 /* Macros --------------------------------------------------------- */
@@ -139,6 +141,7 @@ typedef map<int,NetClient*> NetClientMap;
 
 static SMF          smf;
 static NetClientMap clientMap;
+static ShmReaderMap shmMap;         // keyed by streamID
 static int          handleId = 0;   // keeps getting incremented..
 
 /* ---------------------------------------------------------------- */
@@ -661,6 +664,89 @@ void fastGetFilename(
     plhs[0] = mxCreateString( smf.getName().c_str() );
 }
 
+// Return attached reader for streamID, or NULL.
+// Stale (closed-by-SpikeGLX) mappings are replaced.
+//
+static ShmReader *ShmFind( int ip )
+{
+    ShmReader   *R;
+
+    ShmReaderMap::iterator  it = shmMap.find( ip );
+
+    if( it == shmMap.end() )
+        R = shmMap[ip] = new ShmReader;
+    else
+        R = it->second;
+
+    if( !R->isAlive() && !R->attach( ip ) ) {
+        mexWarnMsgTxt( R->error().c_str() );
+        return NULL;
+    }
+
+    return R;
+}
+
+
+// [matrix, headCt] = shmFetch( streamID, start_scan, scan_ct )
+//
+// Read directly from SpikeGLX shared-memory export (same host).
+// Matrix is int16 (nChans x nScans). start_scan < 0 gets newest.
+//
+void shmFetch(
+    int             nlhs,
+    mxArray         *plhs[],
+    int             nrhs,
+    const mxArray   *prhs[] )
+{
+    if( nlhs < 1 )
+        mexErrMsgTxt( "shmFetch returns matrix to LHS." );
+
+    if( nrhs < 3 ) {
+        mexErrMsgTxt(
+            "shmFetch needs arguments:\n"
+            " (1) streamID\n"
+            " (2) start_scan (-1 = newest)\n"
+            " (3) scan_ct" );
+    }
+
+    int     ip      = static_cast<int>(mxGetScalar( prhs[0] ));
+    double  start   = mxGetScalar( prhs[1] );
+    int     nMax    = static_cast<int>(mxGetScalar( prhs[2] ));
+
+    ShmReader   *R = ShmFind( ip );
+
+    if( !R || nMax <= 0 )
+        RETURN_NULL();
+
+    vector<int16_t> buf( (size_t)nMax * R->nChans() );
+    uint64_t        headCt;
+    int64_t         n;
+
+    if( start < 0 )
+        n = R->readLatest( &buf[0], headCt, nMax );
+    else {
+        headCt  = static_cast<uint64_t>(start);
+        n       = R->read( &buf[0], headCt, nMax );
+    }
+
+    if( n == -1 )
+        mexErrMsgTxt( "shmFetch: Too late; start_scan overwritten." );
+    else if( n == -2 ) {
+        R->detach();
+        mexErrMsgTxt( "shmFetch: SpikeGLX closed the stream." );
+    }
+
+    int dims[] = {R->nChans(), static_cast<int>(n)};
+
+    plhs[0] = mxCreateNumericArray( 2, dims, mxINT16_CLASS, mxREAL );
+
+    if( n )
+        memcpy( mxGetData( plhs[0] ), &buf[0], n * R->nChans() * sizeof(int16_t) );
+
+    if( nlhs >= 2 )
+        plhs[1] = mxCreateDoubleScalar( static_cast<double>(headCt) );
+}
+
 /* ---------------------------------------------------------------- */
 /* Dispatch - Entry point ----------------------------------------- */
 /* ---------------------------------------------------------------- */
@@ -693,6 +779,7 @@ void mexFunction(
         cmd2fun["readlines"]                    = readLines;
         cmd2fun["readmatrix"]                   = readMatrix;
         cmd2fun["getspikeglfilenamefromshm"]    = fastGetFilename;
+        cmd2fun["shmfetch"]                     = shmFetch;
     }
 
 // ------------------
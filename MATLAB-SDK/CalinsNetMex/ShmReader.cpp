@@ -0,0 +1,267 @@
+
+#include "ShmReader.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Return current ring generation for stream ip, or 0 if none.
+//
+static uint32_t currentGen( int ip )
+{
+    char        name[64];
+    void        *base   = 0;
+    uint32_t    gen     = 0;
+    int         slot    = shmDirSlot( ip );
+
+    if( slot < 0 )
+        return 0;
+
+    shmDirName( name );
+
+#ifdef _WIN32
+    HANDLE  h = OpenFileMappingA( FILE_MAP_READ, FALSE, name );
+
+    if( !h )
+        return 0;
+
+    base = MapViewOfFile( h, FILE_MAP_READ, 0, 0, sizeof(ShmRingDir) );
+
+    if( base ) {
+        gen = ((const ShmRingDir*)base)->gen[slot].load( std::memory_order_acquire );
+        UnmapViewOfFile( base );
+    }
+
+    CloseHandle( h );
+#else
+    int fd = shm_open( name, O_RDONLY, 0 );
+
+    if( fd < 0 )
+        return 0;
+
+    struct stat st;
+
+    if( !fstat( fd, &st ) && st.st_size >= (off_t)sizeof(ShmRingDir) ) {
+
+        base = mmap( 0, sizeof(ShmRingDir), PROT_READ, MAP_SHARED, fd, 0 );
+
+        if( base != MAP_FAILED ) {
+            gen = ((const ShmRingDir*)base)->gen[slot].load( std::memory_order_acquire );
+            munmap( base, sizeof(ShmRingDir) );
+        }
+    }
+
+    close( fd );
+#endif
+
+    return gen;
+}
+
+/* ---------------------------------------------------------------- */
+/* ShmReader ------------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+ShmReader::ShmReader()
+    :   hdr(0), ring(0), mapBytes(0),
+#ifdef _WIN32
+        hMap(0)
+#else
+        fd(-1)
+#endif
+{
+}
+
+
+bool ShmReader::attach( int ip )
+{
+    detach();
+
+    char        name[64];
+    void        *base   = 0;
+    uint32_t    gen     = currentGen( ip );
+
+    if( !gen ) {
+        err = "No exported stream -- export enabled and run started?";
+        return false;
+    }
+
+    shmRingName( name, ip, gen );
+
+#ifdef _WIN32
+    hMap = OpenFileMappingA( FILE_MAP_READ, FALSE, name );
+
+    if( !hMap ) {
+        err = std::string("Can't open ") + name + " -- export enabled?";
+        return false;
+    }
+
+    base = MapViewOfFile( hMap, FILE_MAP_READ, 0, 0, 0 );
+
+    if( base ) {
+        MEMORY_BASIC_INFORMATION    mbi;
+        VirtualQuery( base, &mbi, sizeof(mbi) );
+        mapBytes = mbi.RegionSize;
+    }
+#else
+    fd = shm_open( name, O_RDONLY, 0 );
+
+    if( fd < 0 ) {
+        err = std::string("Can't open ") + name + " -- export enabled?";
+        return false;
+    }
+
+    struct stat st;
+
+    if( !fstat( fd, &st ) && st.st_size >= (off_t)sizeof(ShmRingHdr) ) {
+
+        mapBytes    = st.st_size;
+        base        = mmap( 0, mapBytes, PROT_READ, MAP_SHARED, fd, 0 );
+
+        if( base == MAP_FAILED )
+            base = 0;
+    }
+#endif
+
+    if( !base ) {
+        err = std::string("Can't map ") + name + ".";
+        detach();
+        return false;
+    }
+
+    hdr = (const ShmRingHdr*)base;
+
+    // alive (acquire) orders all header reads after it
+
+    if( !hdr->alive.load( std::memory_order_acquire ) ) {
+        err = std::string("Stream closed: ") + name + ".";
+        detach();
+        return false;
+    }
+
+    if( memcmp( hdr->magic, SHMRING_MAGIC, sizeof(hdr->magic) )
+        || hdr->version != SHMRING_VERSION
+        || mapBytes < shmRingBytes( hdr->ringScans, hdr->nChans ) ) {
+
+        err = std::string("Unrecognized layout in ") + name + ".";
+        detach();
+        return false;
+    }
+
+    ring = (const int16_t*)((const char*)base + hdr->hdrBytes);
+    err.clear();
+
+    return true;
+}
+
+
+void ShmReader::detach()
+{
+    if( hdr ) {
+#ifdef _WIN32
+        UnmapViewOfFile( hdr );
+#else
+        munmap( (void*)hdr, mapBytes );
+#endif
+        hdr     = 0;
+        ring    = 0;
+    }
+
+#ifdef _WIN32
+    if( hMap ) {
+        CloseHandle( hMap );
+        hMap = 0;
+    }
+#else
+    if( fd >= 0 ) {
+        close( fd );
+        fd = -1;
+    }
+#endif
+}
+
+
+bool ShmReader::isAlive() const
+{
+    return hdr && hdr->alive.load( std::memory_order_acquire );
+}
+
+
+uint64_t ShmReader::endCount() const
+{
+    return hdr->endCt.load( std::memory_order_acquire );
+}
+
+
+int64_t ShmReader::read( int16_t *dst, uint64_t fromCt, int nMax ) const
+{
+    if( !isAlive() )
+        return -2;
+
+    uint64_t    R   = hdr->ringScans,
+                end = hdr->endCt.load( std::memory_order_acquire );
+    int         nC  = hdr->nChans;
+
+    if( fromCt >= end )
+        return 0;
+
+    if( end > R && fromCt < end - R )
+        return -1;
+
+    if( (uint64_t)nMax > end - fromCt )
+        nMax = int(end - fromCt);
+
+    int slot    = int(fromCt % R),
+        ncpy1   = (uint64_t)nMax < R - slot ? nMax : int(R - slot);
+
+    memcpy( dst, &ring[(uint64_t)slot * nC], ncpy1 * nC * sizeof(int16_t) );
+
+    if( nMax > ncpy1 ) {
+        memcpy( &dst[(uint64_t)ncpy1 * nC], &ring[0],
+            (nMax - ncpy1) * nC * sizeof(int16_t) );
+    }
+
+// Did the writer lap us during the copy?
+
+    std::atomic_thread_fence( std::memory_order_acquire );
+
+    uint64_t    wr = hdr->wrEndCt.load( std::memory_order_relaxed );
+
+    if( wr > R && fromCt < wr - R )
+        return -1;
+
+    return nMax;
+}
+
+
+int64_t ShmReader::readLatest( int16_t *dst, uint64_t &headCt, int n ) const
+{
+    for( int tries = 0; tries < 3; ++tries ) {
+
+        uint64_t    end = endCount();
+
+        if( (uint64_t)n > hdr->ringScans )
+            n = int(hdr->ringScans / 2);
+
+        headCt = (end > (uint64_t)n ? end - n : 0);
+
+        int64_t ret = read( dst, headCt, n );
+
+        if( ret != -1 )
+            return ret;
+    }
+
+    return -1;
+}
+
+
@@ -0,0 +1,66 @@
+#ifndef SHMREADER_H
+#define SHMREADER_H
+
+/* ---------------------------------------------------------------- */
+/* Includes ------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+#include "ShmRingFmt.h"
+
+#include <string>
+
+/* ---------------------------------------------------------------- */
+/* ShmReader ------------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+// Reference reader for SpikeGLX shared-memory stream export.
+// See Src-run/ShmRingFmt.h for the layout and protocol.
+//
+// Usable from any same-host C++ client; no Qt required.
+//
+class ShmReader
+{
+private:
+    const ShmRingHdr    *hdr;
+    const int16_t       *ring;
+    uint64_t            mapBytes;
+    std::string         err;
+#ifdef _WIN32
+    void                *hMap;
+#else
+    int                 fd;
+#endif
+
+public:
+    ShmReader();
+    virtual ~ShmReader()    {detach();}
+
+    bool attach( int ip );
+    void detach();
+
+    bool isAttached() const     {return hdr != 0;}
+    bool isAlive() const;
+    const std::string &error() const    {return err;}
+
+    int nChans() const          {return hdr->nChans;}
+    double sRate() const        {return hdr->srate;}
+    double tZero() const
+        {return hdr->tZero.load( std::memory_order_acquire );}
+    uint64_t ringScans() const  {return hdr->ringScans;}
+    uint64_t endCount() const;
+
+    // Copy up to nMax timepoints with count >= fromCt.
+    // Caller sizes dst for nMax * nChans() int16 words.
+    // Return count copied (0 if none yet), or,
+    // -1 if fromCt already overwritten,
+    // -2 if SpikeGLX closed the stream.
+    int64_t read( int16_t *dst, uint64_t fromCt, int nMax ) const;
+
+    // Copy newest n timepoints; headCt receives first count.
+    // Return as for read().
+    int64_t readLatest( int16_t *dst, uint64_t &headCt, int n ) const;
+};
+
+#endif  // SHMREADER_H
+
+
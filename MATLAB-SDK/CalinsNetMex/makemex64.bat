@@ -1,2 +1,2 @@
-"C:\Program Files\MATLAB\R2014b\bin\win64\mex" -DWIN32 -compatibleArrayDims -I. CalinsNetMex.cpp Socket.cpp NetClient.cpp wsock32.lib
+"C:\Program Files\MATLAB\R2014b\bin\win64\mex" -DWIN32 -compatibleArrayDims -I. -I../../Src-run CalinsNetMex.cpp Socket.cpp NetClient.cpp ShmReader.cpp wsock32.lib
 pause
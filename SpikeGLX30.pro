@@ -144,6 +144,7 @@ win32 {
 
 unix {
     CONFIG          += debug warn_on
+    LIBS            += -lrt
 #   QMAKE_CFLAGS    += -Wall -Wno-return-type
 #   QMAKE_CXXFLAGS  += -Wall -Wno-return-type
 # Enable these for profiling
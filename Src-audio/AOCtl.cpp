@@ -45,6 +45,7 @@ void AOCtl::User::loadSettings( int nImec, bool remote )
 
     settings.beginGroup( "AOCtl_All" );
     stream      = settings.value( "stream", "nidq" ).toString();
+    resampQ     = settings.value( "resampQ", 0 ).toInt();
     autoStart   = settings.value( "autoStart", false ).toBool();
 }
 
@@ -71,6 +72,7 @@ void AOCtl::User::saveSettings( bool remote ) const
 
     settings.beginGroup( "AOCtl_All" );
     settings.setValue( "stream", stream );
+    settings.setValue( "resampQ", resampQ );
     settings.setValue( "autoStart", autoStart );
 }
 
@@ -163,6 +165,12 @@ void AOCtl::Derived::usr2drv( AOCtl *aoC )
         }
     }
 
+// ---------
+// Resampler
+// ---------
+
+    resampQ = qBound( 0, usr.resampQ, 4 );
+
 // ------
 // Volume
 // ------
@@ -212,6 +220,7 @@ AOCtl::AOCtl( const DAQ::Params &p, QWidget *parent )
     ConnectUI( aoUI->loCB, SIGNAL(currentIndexChanged(QString)), this, SLOT(loCBChanged(QString)) );
     ConnectUI( aoUI->hiCB, SIGNAL(currentIndexChanged(QString)), this, SLOT(hiCBChanged(QString)) );
     ConnectUI( aoUI->volSB, SIGNAL(valueChanged(double)), this, SLOT(volSBChanged(double)) );
+    ConnectUI( aoUI->resampCB, SIGNAL(currentIndexChanged(int)), this, SLOT(resampCBChanged()) );
     ConnectUI( aoUI->helpBut, SIGNAL(clicked()), this, SLOT(help()) );
     ConnectUI( aoUI->resetBut, SIGNAL(clicked()), this, SLOT(reset()) );
     ConnectUI( aoUI->stopBut, SIGNAL(clicked()), this, SLOT(stop()) );
@@ -387,6 +396,12 @@ void AOCtl::reset( bool remote )
     FillExtantStreamCB( aoUI->streamCB, p.ni.enabled, p.im.get_nProbes() );
     SelStreamCBItem( aoUI->streamCB, usr.stream );
 
+// --------
+// Resample
+// --------
+
+    aoUI->resampCB->setCurrentIndex( qBound( 0, usr.resampQ, 4 ) );
+
 // ----
 // Auto
 // ----
@@ -598,6 +613,14 @@ void AOCtl::volSBChanged( double val )
 }
 
 
+void AOCtl::resampCBChanged()
+{
+    usr.resampQ = aoUI->resampCB->currentIndex();
+
+    liveChange();
+}
+
+
 void AOCtl::help()
 {
     showHelp( "Audio_Help" );
@@ -716,6 +739,7 @@ bool AOCtl::valid( QString &err )
         reset();
 
     usr.stream      = aoUI->streamCB->currentText();
+    usr.resampQ     = aoUI->resampCB->currentIndex();
     usr.autoStart   = aoUI->autoChk->isChecked();
 
 // Stream available?
@@ -37,6 +37,7 @@ private:
     struct User {
         std::vector<EachStream> each;
         QString                 stream;
+        int                     resampQ;    // see Derived
         bool                    autoStart;
 
         User() {loadSettings( 0, false );}
@@ -57,7 +58,8 @@ private:
                 rChan,
                 nNeural,
                 maxInt,
-                maxLatency;
+                maxLatency,
+                resampQ;    // {0=off,1=linear,2=sinc fast,3=med,4=best}
 
         void usr2drv( AOCtl *aoC );
 
@@ -114,6 +116,7 @@ private slots:
     void loCBChanged( const QString &str );
     void hiCBChanged( const QString &str );
     void volSBChanged( double val );
+    void resampCBChanged();
     void help();
     void stop();
     void apply();
@@ -2,21 +2,93 @@
 #include "AOCtl.h"
 #include "AODevRtAudio.h"
 #include "Util.h"
+#include "MainApp.h"
+#include "MetricsWindow.h"
 
 #include <QThread>
 
+#include <algorithm>
+#include <math.h>
+
+
+// FIFO depth: frames kept queued ahead of the device,
+// as a multiple of the device's samples-per-call.
+#define FIFO_TARGET_CALLS   3
+
+// Seconds without new stream data before restarting.
+#define NO_DATA_SECS        0.1
+
+// Seconds between underrun reports to Metrics.
+#define MX_REPORT_SECS      5.0
+
+// Resampler drift servo: backlog smoothing per chunk, chunks
+// before the target backlog is latched, seconds to null an
+// error, and largest fractional ratio correction.
+#define DRIFT_ALPHA         0.01
+#define DRIFT_SETTLE        200
+#define DRIFT_TAU_SECS      10.0
+#define DRIFT_MAXADJ        0.002
+
 /* ---------------------------------------------------------------- */
 /* Statics -------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
 static AODevRtAudio *ME;
 
+/* ---------------------------------------------------------------- */
+/* AOFeedWorker --------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+void AOFeedWorker::run()
+{
+    while( !isStopped() ) {
+
+        dev->feed();
+        QThread::usleep( 1000 );    // ~30 samples
+    }
+
+    emit finished();
+}
+
+/* ---------------------------------------------------------------- */
+/* AOFeeder ------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+AOFeeder::AOFeeder( AODevRtAudio *dev )
+{
+    thread  = new QThread;
+    worker  = new AOFeedWorker( dev );
+
+    worker->moveToThread( thread );
+
+    Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
+    Connect( worker, SIGNAL(finished()), worker, SLOT(deleteLater()) );
+    Connect( worker, SIGNAL(destroyed()), thread, SLOT(quit()), Qt::DirectConnection );
+
+    thread->start( QThread::HighPriority );
+}
+
+
+AOFeeder::~AOFeeder()
+{
+// worker object auto-deleted asynchronously
+// thread object manually deleted synchronously (so we can call wait())
+
+    if( thread->isRunning() ) {
+
+        worker->stop();
+        thread->wait();
+    }
+
+    delete thread;
+}
+
 /* ---------------------------------------------------------------- */
 /* AODevRtAudio --------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
 AODevRtAudio::AODevRtAudio( AOCtl *aoC, const DAQ::Params &p )
-    :   AODevBase( aoC, p ), rta(0), ready(false)
+    :   AODevBase( aoC, p ), rta(0), feeder(0), resamp(0), ready(false)
 {
 }
 
@@ -394,10 +466,16 @@ bool AODevRtAudio::devStart( const QVector<AIQ*> &imQ, const AIQ *niQ )
     drv.usr2drv( aoC );
 
     ME          = this;
+    snap        = drv;
     this->aiQ   = (drv.streamID >= 0 ? imQ[drv.streamID] : niQ);
     fromCt      = 0;
     latSum      = 0.0;
     latCt       = 0;
+    tLastFed    = getTime();
+    tLastMx     = tLastFed;
+    nFifoUnder.storeRelease( 0 );
+    nDevUnder.storeRelease( 0 );
+    primed.storeRelease( 0 );
 
     RtAudio::StreamParameters   prm;
 
@@ -405,15 +483,36 @@ bool AODevRtAudio::devStart( const QVector<AIQ*> &imQ, const AIQ *niQ )
     prm.nChannels       = aoC->nDevChans;
     prm.firstChannel    = 0;
 
-    uint sampPerCall    = 256;
+    sampPerCall         = 256;
+
+    uint    devRate     = devSampleRate( prm.deviceId );
 
-// Start audio stream
+// Open audio stream
 
     try {
+        uint    spc = sampPerCall;
+
         rta->openStream(
-                &prm, NULL, RTAUDIO_SINT16, drv.srate, &sampPerCall,
-                (prm.nChannels == 2 ? callbackStereo : callbackMono) );
+                &prm, NULL, RTAUDIO_SINT16, devRate, &spc, callback );
+
+        sampPerCall = spc;  // driver may adjust
+    }
+    catch( RtAudioError &e ) {
+        Warning() << "Audio error: " << e.what();
+        return false;
+    }
+
+// Start resampler, feeder, then stream
+
+    if( !resampStart( devRate ) )
+        return false;
 
+    fifo.init( FIFO_TARGET_CALLS * sampPerCall + outPerChunk, prm.nChannels );
+    chunk.resize( sampPerCall * prm.nChannels );
+
+    feeder = new AOFeeder( this );
+
+    try {
         rta->startStream();
     }
     catch( RtAudioError &e ) {
@@ -450,6 +549,15 @@ void AODevRtAudio::devStop()
         delete rta;
         rta = 0;
     }
+
+// Stop feeder after device: callback only reads FIFO
+
+    if( feeder ) {
+        delete feeder;
+        feeder = 0;
+    }
+
+    resampStop();
 }
 
 /* ---------------------------------------------------------------- */
@@ -465,211 +573,375 @@ void AODevRtAudio::filter(
     int     nChan,
     int     ichan )
 {
-    AOCtl::Derived  &drv = aoC->drv;
-
-    if( drv.loCut > -1 || drv.hiCut > -1 ) {
+    if( snap.loCut > -1 || snap.hiCut > -1 ) {
 
-        if( drv.loCut > -1 ) {
-            drv.hipass.apply1BlockwiseMem1(
-                data, drv.maxInt, ntpts, nChan, ichan );
+        if( snap.loCut > -1 ) {
+            snap.hipass.apply1BlockwiseMem1(
+                data, snap.maxInt, ntpts, nChan, ichan );
         }
 
-        if( drv.hiCut > -1 ) {
-            drv.lopass.apply1BlockwiseMem1(
-                data, drv.maxInt, ntpts, nChan, ichan );
+        if( snap.hiCut > -1 ) {
+            snap.lopass.apply1BlockwiseMem1(
+                data, snap.maxInt, ntpts, nChan, ichan );
         }
     }
 }
 
 
-void AODevRtAudio::latency()
+// Device rate: stream rate if not resampling; else the
+// card's preferred rate, or a standard rate it supports.
+//
+uint AODevRtAudio::devSampleRate( uint devID )
 {
-    const AOCtl::Derived    &drv = aoC->drv;
+    if( !snap.resampQ )
+        return snap.srate;
 
-    double L = qMax( 0.0, 1000 * (aiQ->endCount() - fromCt) / drv.srate );
+    RtAudio::DeviceInfo info;
 
-    latSum += L;
-    ++latCt;
+    try {
+        info = rta->getDeviceInfo( devID );
+    }
+    catch( RtAudioError &e ) {
+        Warning() << "Audio error: " << e.what();
+        return 48000;
+    }
 
-// Average about 2 sec worth: 2 sec = N*256/30000; N ~ 200
+    if( info.preferredSampleRate )
+        return info.preferredSampleRate;
 
-    if( latCt < 200 )
-        return;
+    const std::vector<uint> &R = info.sampleRates;
 
-    L       = latSum / latCt;
-    latSum  = 0.0;
-    latCt   = 0;
+    if( std::find( R.begin(), R.end(), 48000 ) != R.end() )
+        return 48000;
 
-    if( L >= drv.maxLatency )
-        aoC->restart();
+    if( std::find( R.begin(), R.end(), 44100 ) != R.end() )
+        return 44100;
 
-//    Log() << L;
+    return (R.size() ? R.back() : 48000);
 }
 
 
-int AODevRtAudio::callbackMono(
-    void                *outputBuffer,
-    void                *inputBuffer,
-    uint                nBufferFrames,
-    double              streamTime,
-    RtAudioStreamStatus status,
-    void                *userData )
+// The ratio uses the stream's measured (calibrated) rate,
+// not the nominal one, so the card plays at the rate the
+// samples were actually acquired. Residual clock drift is
+// trimmed by driftAdjust().
+//
+bool AODevRtAudio::resampStart( uint devRate )
 {
-    Q_UNUSED( inputBuffer )
-    Q_UNUSED( streamTime )
-    Q_UNUSED( userData )
+    resampStop();
 
-    if( status )
-        Debug() << "Audio stream underflow detected.";
+    outPerChunk = sampPerCall;
 
-    QMutexLocker    ml( &ME->aoC->aoMtx );
+    if( !snap.resampQ )
+        return true;
 
-    const AOCtl::Derived    &drv = ME->aoC->drv;
-    qint16                  *dst = (qint16*)outputBuffer;
-    qint64                  headCt;
+    static const int    qual2type[] = {
+                            SRC_LINEAR,
+                            SRC_LINEAR,
+                            SRC_SINC_FASTEST,
+                            SRC_SINC_MEDIUM_QUALITY,
+                            SRC_SINC_BEST_QUALITY};
 
-// Fetch data from stream
+    int nC  = aoC->nDevChans,
+        err = 0;
 
-    for( int tries = 0; tries < 100; ++tries ) {
+    resamp = src_new( qual2type[snap.resampQ], nC, &err );
 
-        // Fetch
+    if( !resamp ) {
+        Warning() << "Audio resampler error: " << src_strerror( err );
+        return false;
+    }
 
-        if( !ME->fromCt ) {
-            headCt = ME->aiQ->getNewestNScansMono(
-                        dst, nBufferFrames, drv.lChan );
-        }
-        else {
-            headCt = ME->aiQ->getNScansFromCtMono(
-                        dst, ME->fromCt, nBufferFrames, drv.lChan );
-        }
+    rsNominal   = devRate / aiQ->sRate();
+    rsRatio     = rsNominal;
+    rsLevel     = 0;
+    rsTarget    = 0;
+    rsN         = 0;
+    outPerChunk = int(ceil( sampPerCall * rsNominal * (1 + DRIFT_MAXADJ) )) + 8;
 
-        if( headCt >= 0 )
-            goto fetched;
+    rsIn.resize( sampPerCall * nC );
+    rsOut.resize( outPerChunk * nC );
+    rsOut16.resize( outPerChunk * nC );
 
-        QThread::usleep( 1000 );    // wait ~30 samples
-    }
+    Log() <<
+        QString("Audio resampling %1 -> %2 Hz.")
+        .arg( aiQ->sRate(), 0, 'f', 3 )
+        .arg( devRate );
+
+    return true;
+}
 
-// Fetch failed
 
-    Warning() << "Audio getting no samples.";
+// Servo the resampling ratio on our backlog: stream scans not
+// yet fetched plus FIFO frames not yet played, in seconds. If
+// the card consumes faster than the stream produces, backlog
+// shrinks and we stretch (raise ratio); if slower, it grows
+// and we shrink. The backlog is smoothed to ignore the saw-
+// tooth of chunked fetches, and its level after settling is
+// the target, so the servo holds whatever latency we started
+// with rather than forcing one.
+//
+void AODevRtAudio::driftAdjust()
+{
+    double  srate   = aiQ->sRate(),
+            q       = (qint64(aiQ->endCount()) - qint64(fromCt)
+                        + fifo.readable() / rsNominal) / srate;
 
-#if 0
-    // Stopping from within callback crashes sometimes...
-    return 1;
-#else
-    // Stop from outside instead.
-    memset( dst, 0, nBufferFrames*sizeof(qint16) );
-    ME->aoC->restart();
-#endif
+    if( !rsN )
+        rsLevel = q;
+    else
+        rsLevel += DRIFT_ALPHA * (q - rsLevel);
 
-// Mark next fetch point
+    if( rsN < DRIFT_SETTLE ) {
 
-fetched:
-    ME->fromCt = headCt + nBufferFrames;
+        if( ++rsN == DRIFT_SETTLE )
+            rsTarget = rsLevel;
 
-// Latency
+        return;
+    }
 
-    ME->latency();
+    double  adj = qBound(
+                    -DRIFT_MAXADJ,
+                    (rsLevel - rsTarget) / DRIFT_TAU_SECS,
+                    DRIFT_MAXADJ );
 
-// Filter channels
+    rsRatio = rsNominal * (1 - adj);
+}
 
-    if( drv.lChan < drv.nNeural )
-        ME->filter( dst, nBufferFrames, 1, 0 );
 
-// Apply volume
+// Resample chunk into rsOut16; return output frame count.
+// The converter may not take all input in one pass (it
+// reports input_frames_used), so we loop until it has.
+//
+int AODevRtAudio::resampChunk()
+{
+    SRC_DATA    D;
+    int         nC      = fifo.channels(),
+                nIn     = 0,
+                nOut    = 0;
+
+    src_short_to_float_array( &chunk[0], &rsIn[0], sampPerCall * nC );
+
+    D.end_of_input  = 0;
+    D.src_ratio     = rsRatio;
 
-    for( uint t = 0; t < nBufferFrames; ++t ) {
+    while( nIn < sampPerCall && nOut < outPerChunk ) {
 
-        dst[t] = drv.vol( dst[t], drv.lVol );
+        D.data_in       = &rsIn[nIn * nC];
+        D.data_out      = &rsOut[nOut * nC];
+        D.input_frames  = sampPerCall - nIn;
+        D.output_frames = outPerChunk - nOut;
+
+        if( src_process( resamp, &D ) )
+            break;
+
+        if( !D.input_frames_used && !D.output_frames_gen )
+            break;
+
+        nIn     += D.input_frames_used;
+        nOut    += D.output_frames_gen;
     }
 
-    return 0;
+    if( nOut )
+        src_float_to_short_array( &rsOut[0], &rsOut16[0], nOut * nC );
+
+    return nOut;
 }
 
 
-int AODevRtAudio::callbackStereo(
-    void                *outputBuffer,
-    void                *inputBuffer,
-    uint                nBufferFrames,
-    double              streamTime,
-    RtAudioStreamStatus status,
-    void                *userData )
+void AODevRtAudio::resampStop()
 {
-    Q_UNUSED( inputBuffer )
-    Q_UNUSED( streamTime )
-    Q_UNUSED( userData )
+    if( resamp ) {
+        src_delete( resamp );
+        resamp = 0;
+    }
+}
 
-    if( status )
-        Debug() << "Audio stream underflow detected.";
 
-    QMutexLocker    ml( &ME->aoC->aoMtx );
+// Feeder thread: top up FIFO to target depth.
+//
+void AODevRtAudio::feed()
+{
+    double  t = getTime();
 
-    const AOCtl::Derived    &drv = ME->aoC->drv;
-    qint16                  *dst = (qint16*)outputBuffer;
-    qint64                  headCt;
+    while( fifo.readable() < FIFO_TARGET_CALLS * sampPerCall
+            && fifo.writable() >= outPerChunk ) {
 
-// Fetch data from stream
+        if( !fetchChunk() )
+            break;
 
-    for( int tries = 0; tries < 100; ++tries ) {
+        tLastFed = t;
+    }
 
-        // Fetch
+    if( t - tLastFed > NO_DATA_SECS ) {
 
-        if( !ME->fromCt ) {
-            headCt = ME->aiQ->getNewestNScansStereo(
-                        dst, nBufferFrames,
-                        drv.lChan, drv.rChan );
-        }
-        else {
-            headCt = ME->aiQ->getNScansFromCtStereo(
-                        dst, ME->fromCt, nBufferFrames,
-                        drv.lChan, drv.rChan );
-        }
+        Warning() << "Audio getting no samples.";
+        aoC->restart();
+        tLastFed = t;
+    }
+
+    if( t - tLastMx >= MX_REPORT_SECS ) {
 
-        if( headCt >= 0 )
-            goto fetched;
+        QMetaObject::invokeMethod(
+            mainApp()->metrics(),
+            "prfUpdateAudio",
+            Qt::QueuedConnection,
+            Q_ARG(int, nFifoUnder.loadAcquire()),
+            Q_ARG(int, nDevUnder.loadAcquire()) );
 
-        QThread::usleep( 1000 );    // wait ~30 samples
+        tLastMx = t;
     }
+}
+
 
-// Fetch failed
+// Fetch, filter, scale and queue one device call's worth.
+//
+bool AODevRtAudio::fetchChunk()
+{
+    qint16  *dst = &chunk[0];
+    qint64  headCt;
+    bool    stereo = fifo.channels() == 2;
+
+// Fetch data from stream
+
+    if( stereo ) {
+
+        if( !fromCt ) {
+            headCt = aiQ->getNewestNScansStereo(
+                        dst, sampPerCall, snap.lChan, snap.rChan );
+        }
+        else {
+            headCt = aiQ->getNScansFromCtStereo(
+                        dst, fromCt, sampPerCall, snap.lChan, snap.rChan );
+        }
+    }
+    else {
 
-    Warning() << "Audio getting no samples.";
+        if( !fromCt ) {
+            headCt = aiQ->getNewestNScansMono(
+                        dst, sampPerCall, snap.lChan );
+        }
+        else {
+            headCt = aiQ->getNScansFromCtMono(
+                        dst, fromCt, sampPerCall, snap.lChan );
+        }
+    }
 
-#if 0
-    // Stopping from within callback crashes sometimes...
-    return 1;
-#else
-    // Stop from outside instead.
-    memset( dst, 0, 2*nBufferFrames*sizeof(qint16) );
-    ME->aoC->restart();
-#endif
+    if( headCt < 0 )
+        return false;
 
 // Mark next fetch point
 
-fetched:
-    ME->fromCt = headCt + nBufferFrames;
+    fromCt = headCt + sampPerCall;
 
 // Latency
 
-    ME->latency();
+    latency();
 
 // Filter channels
 
-    if( drv.lChan < drv.nNeural )
-        ME->filter( dst, nBufferFrames, 2, 0 );
+    if( stereo ) {
+
+        if( snap.lChan < snap.nNeural )
+            filter( dst, sampPerCall, 2, 0 );
 
-    if( drv.rChan < drv.nNeural )
-        ME->filter( dst, nBufferFrames, 2, 1 );
+        if( snap.rChan < snap.nNeural )
+            filter( dst, sampPerCall, 2, 1 );
+    }
+    else if( snap.lChan < snap.nNeural )
+        filter( dst, sampPerCall, 1, 0 );
 
 // Apply volume
 
-    for( uint t = 0; t < nBufferFrames; ++t ) {
+    if( stereo ) {
+
+        for( int t = 0; t < sampPerCall; ++t ) {
+
+            int j = 2*t;
+
+            dst[j]      = snap.vol( dst[j], snap.lVol );
+            dst[j+1]    = snap.vol( dst[j+1], snap.rVol );
+        }
+    }
+    else {
+
+        for( int t = 0; t < sampPerCall; ++t )
+            dst[t] = snap.vol( dst[t], snap.lVol );
+    }
+
+// Queue
+
+    if( resamp ) {
+
+        driftAdjust();
+
+        int n = resampChunk();
+
+        if( n )
+            fifo.push( &rsOut16[0], n );
+    }
+    else
+        fifo.push( dst, sampPerCall );
+
+    return true;
+}
+
+
+void AODevRtAudio::latency()
+{
+    double L = qMax( 0.0, 1000 * (aiQ->endCount() - fromCt) / snap.srate );
+
+    latSum += L;
+    ++latCt;
+
+// Average about 2 sec worth: 2 sec = N*256/30000; N ~ 200
+
+    if( latCt < 200 )
+        return;
+
+    L       = latSum / latCt;
+    latSum  = 0.0;
+    latCt   = 0;
+
+    if( L >= snap.maxLatency )
+        aoC->restart();
+
+//    Log() << L;
+}
+
+
+// Real-time device thread: never locks, logs or waits.
+// A short FIFO is padded with silence and tallied as an
+// underrun (once the FIFO has first been primed).
+//
+int AODevRtAudio::callback(
+    void                *outputBuffer,
+    void                *inputBuffer,
+    uint                nBufferFrames,
+    double              streamTime,
+    RtAudioStreamStatus status,
+    void                *userData )
+{
+    Q_UNUSED( inputBuffer )
+    Q_UNUSED( streamTime )
+    Q_UNUSED( userData )
+
+    if( status )
+        ME->nDevUnder.fetchAndAddRelaxed( 1 );
+
+    qint16  *dst    = (qint16*)outputBuffer;
+    int     nC      = ME->fifo.channels(),
+            n       = ME->fifo.pop( dst, nBufferFrames );
+
+    if( n < (int)nBufferFrames ) {
 
-        int j = 2*t;
+        memset( dst + n*nC, 0, (nBufferFrames - n)*nC*sizeof(qint16) );
 
-        dst[j]      = drv.vol( dst[j], drv.lVol );
-        dst[j+1]    = drv.vol( dst[j+1], drv.rVol );
+        if( ME->primed.loadAcquire() )
+            ME->nFifoUnder.fetchAndAddRelaxed( 1 );
     }
+    else
+        ME->primed.storeRelease( 1 );
 
     return 0;
 }
@@ -2,23 +2,100 @@
 #define AODEVRTAUDIO_H
 
 #include "AODevBase.h"
+#include "AOCtl.h"
+#include "AOFifo.h"
 #include "RtAudio.h"
+#include "samplerate.h"
 #include "AIQ.h"
 
+#include <QMutex>
+
+class AODevRtAudio;
+
 /* ---------------------------------------------------------------- */
 /* Types ---------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
+// Keeps the device FIFO topped up from the stream, off the
+// real-time audio thread.
+//
+class AOFeedWorker : public QObject
+{
+    Q_OBJECT
+
+private:
+    AODevRtAudio    *dev;
+    mutable QMutex  runMtx;
+    volatile bool   pleaseStop;
+
+public:
+    AOFeedWorker( AODevRtAudio *dev )
+    :   QObject(0), dev(dev), pleaseStop(false) {}
+    virtual ~AOFeedWorker()                     {}
+
+    void stop()             {QMutexLocker ml( &runMtx ); pleaseStop = true;}
+    bool isStopped() const  {QMutexLocker ml( &runMtx ); return pleaseStop;}
+
+signals:
+    void finished();
+
+public slots:
+    void run();
+};
+
+
+class AOFeeder
+{
+private:
+    QThread         *thread;
+    AOFeedWorker    *worker;
+
+public:
+    AOFeeder( AODevRtAudio *dev );
+    virtual ~AOFeeder();
+};
+
+
 // RtAudio-based audio output
 //
+// The device callback never blocks: it only pops frames from a
+// lock-free FIFO, padding with silence (and counting an underrun)
+// if the FIFO runs dry. An AOFeeder thread fetches, filters and
+// scales stream data into the FIFO, optionally resampling it to the
+// sound card's native rate. Parameters are snapshot from
+// AOCtl at devStart (changes restart the device), so neither
+// thread touches AOCtl state or its mutex while playing.
+//
 class AODevRtAudio : public AODevBase
 {
+    friend class AOFeedWorker;
+
 private:
-    RtAudio     *rta;
-    quint64     fromCt;
-    double      latSum;
-    int         latCt;
-    bool        ready;
+    RtAudio             *rta;
+    AOFeeder            *feeder;
+    AOCtl::Derived      snap;
+    AOFifo              fifo;
+    std::vector<qint16> chunk;
+    std::vector<float>  rsIn,
+                        rsOut;
+    std::vector<qint16> rsOut16;
+    SRC_STATE           *resamp;
+    QAtomicInt          nFifoUnder,
+                        nDevUnder,
+                        primed;
+    quint64             fromCt;
+    double              latSum,
+                        tLastFed,
+                        tLastMx,
+                        rsNominal,  // devRate / stream rate
+                        rsRatio,    // nominal, drift corrected
+                        rsLevel,    // smoothed backlog (s)
+                        rsTarget;   // settled backlog (s)
+    int                 latCt,
+                        sampPerCall,
+                        outPerChunk,
+                        rsN;
+    bool                ready;
 
 public:
     AODevRtAudio( AOCtl *aoC, const DAQ::Params &p );
@@ -43,17 +120,16 @@ private:
         int     nChan,
         int     ichan );
 
+    uint devSampleRate( uint devID );
+    bool resampStart( uint devRate );
+    void driftAdjust();
+    int resampChunk();
+    void resampStop();
+    void feed();
+    bool fetchChunk();
     void latency();
 
-    static int callbackMono(
-        void                *outputBuffer,
-        void                *inputBuffer,
-        uint                nBufferFrames,
-        double              streamTime,
-        RtAudioStreamStatus status,
-        void                *userData );
-
-    static int callbackStereo(
+    static int callback(
         void                *outputBuffer,
         void                *inputBuffer,
         uint                nBufferFrames,
@@ -0,0 +1,98 @@
+#ifndef AOFIFO_H
+#define AOFIFO_H
+
+#include <QAtomicInt>
+
+#include <string.h>
+#include <vector>
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Single-producer, single-consumer lock-free FIFO of interleaved
+// int16 audio frames.
+//
+// The audio feeder thread pushes, the device callback pops; neither
+// side ever waits on the other. Read/write positions are free-running
+// frame counts; their difference (as unsigned) is the fill level, so
+// wraparound of the counters is harmless.
+//
+// Call init() only while neither side is running.
+//
+class AOFifo
+{
+private:
+    std::vector<qint16> buf;
+    QAtomicInt          rdCt,
+                        wrCt;
+    int                 capFrames,  // power of 2
+                        nChans;
+
+public:
+    AOFifo() : capFrames(0), nChans(0)  {}
+
+    void init( int minFrames, int nChans )
+        {
+            capFrames = 1;
+            while( capFrames < minFrames )
+                capFrames *= 2;
+            this->nChans = nChans;
+            buf.assign( capFrames * nChans, 0 );
+            rdCt.storeRelease( 0 );
+            wrCt.storeRelease( 0 );
+        }
+
+    int channels() const    {return nChans;}
+
+    int readable() const
+        {return uint(wrCt.loadAcquire() - rdCt.loadAcquire());}
+    int writable() const
+        {return capFrames - readable();}
+
+    // Producer: caller guarantees n <= writable().
+    void push( const qint16 *src, int n )
+        {
+            int w = wrCt.load();
+            put( src, w, n );
+            wrCt.storeRelease( w + n );
+        }
+
+    // Consumer: return frames actually copied (may be < n).
+    int pop( qint16 *dst, int n )
+        {
+            int r = rdCt.load();
+            n = qMin( n, int(uint(wrCt.loadAcquire() - r)) );
+            if( n > 0 ) {
+                get( dst, r, n );
+                rdCt.storeRelease( r + n );
+            }
+            return qMax( n, 0 );
+        }
+
+private:
+    void put( const qint16 *src, int ct, int n )
+        {
+            int head = ct & (capFrames - 1),
+                nrhs = qMin( n, capFrames - head );
+            memcpy( &buf[head*nChans], src, nrhs*nChans*sizeof(qint16) );
+            if( n > nrhs ) {
+                memcpy( &buf[0], src + nrhs*nChans,
+                    (n - nrhs)*nChans*sizeof(qint16) );
+            }
+        }
+    void get( qint16 *dst, int ct, int n ) const
+        {
+            int head = ct & (capFrames - 1),
+                nrhs = qMin( n, capFrames - head );
+            memcpy( dst, &buf[head*nChans], nrhs*nChans*sizeof(qint16) );
+            if( n > nrhs ) {
+                memcpy( dst + nrhs*nChans, &buf[0],
+                    (n - nrhs)*nChans*sizeof(qint16) );
+            }
+        }
+};
+
+#endif  // AOFIFO_H
+
+
@@ -2,6 +2,7 @@
 HEADERS += \
     $$PWD/AOCtl.h \
     $$PWD/AODevBase.h \
+    $$PWD/AOFifo.h \
     $$PWD/AODevRtAudio.h \
     $$PWD/AODevSim.h
 
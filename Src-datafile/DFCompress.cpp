@@ -0,0 +1,541 @@
+
+#include "DFCompress.h"
+#include "Util.h"
+
+#include <QFile>
+
+#include <string.h>
+
+
+#define BLK_MAGIC   0x315A4753  // 'SGZ1'
+#define BLK_HDR     16
+#define FTR_MAGIC   "SGLXCIDX"
+#define FTR_BYTES   32
+#define GRP         32
+
+
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+static inline int bitWidth( quint32 v )
+{
+#ifdef __GNUC__
+    return (v ? 32 - __builtin_clz( v ) : 0);
+#else
+    int w = 0;
+
+    while( v ) {
+        ++w;
+        v >>= 1;
+    }
+
+    return w;
+#endif
+}
+
+
+static inline void putU32( char *dst, quint32 v )
+{
+    memcpy( dst, &v, 4 );
+}
+
+
+static inline quint32 getU32( const char *src )
+{
+    quint32 v;
+    memcpy( &v, src, 4 );
+    return v;
+}
+
+/* ---------------------------------------------------------------- */
+/* DFCompressor --------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+DFCompressor::DFCompressor( int nChans )
+    :   pos(0), nC(nChans)
+{
+    Z.resize( GRP * nC );
+    W.resize( nC );
+}
+
+
+void DFCompressor::put(
+    std::vector<char>   &out,
+    const qint16        *src,
+    int                 nScans )
+{
+    out.clear();
+
+// Top up partial block
+
+    if( pend.size() ) {
+
+        int nPend   = pend.size() / nC,
+            nTake   = qMin( nScans, DFCMP_BLOCKSCANS - nPend );
+
+        pend.insert( pend.end(), src, src + nTake * nC );
+        src     += nTake * nC;
+        nScans  -= nTake;
+
+        if( nPend + nTake < DFCMP_BLOCKSCANS )
+            return;
+
+        encodeBlock( out, &pend[0], DFCMP_BLOCKSCANS );
+        pend.clear();
+    }
+
+// Whole blocks straight from source
+
+    for( ; nScans >= DFCMP_BLOCKSCANS; nScans -= DFCMP_BLOCKSCANS ) {
+        encodeBlock( out, src, DFCMP_BLOCKSCANS );
+        src += DFCMP_BLOCKSCANS * nC;
+    }
+
+// Stash remainder
+
+    if( nScans )
+        pend.assign( src, src + nScans * nC );
+}
+
+
+void DFCompressor::finish( std::vector<char> &out )
+{
+    out.clear();
+
+    if( pend.size() ) {
+        encodeBlock( out, &pend[0], pend.size() / nC );
+        pend.clear();
+    }
+
+    quint64 nBlk    = index.size(),
+            idxOff  = pos;
+    size_t  o       = out.size();
+
+    out.resize( o + 8 * nBlk + FTR_BYTES );
+
+    char    *d = &out[o];
+
+    if( nBlk ) {
+        memcpy( d, &index[0], 8 * nBlk );
+        d += 8 * nBlk;
+    }
+
+    memcpy( d, FTR_MAGIC, 8 );
+    memcpy( d + 8, &nBlk, 8 );
+    memcpy( d + 16, &idxOff, 8 );
+    putU32( d + 24, DFCMP_BLOCKSCANS );
+    putU32( d + 28, nC );
+
+    pos += 8 * nBlk + FTR_BYTES;
+}
+
+
+// Deltas for 32 scans are formed row-wise (contiguous, so the
+// compiler vectorizes them), then each channel's column is packed
+// at the narrowest width that holds its largest zigzag value.
+//
+void DFCompressor::encodeBlock(
+    std::vector<char>   &out,
+    const qint16        *src,
+    int                 nScans )
+{
+    int     nGrp    = (nScans - 1 + GRP - 1) / GRP;
+    size_t  o0      = out.size();
+
+    out.resize( o0 + BLK_HDR + 2*nC + nGrp * (nC + 4*16*nC) );
+
+    char    *d = &out[o0] + BLK_HDR;
+
+    memcpy( d, src, 2*nC );
+    d += 2*nC;
+
+    for( int g0 = 1; g0 < nScans; g0 += GRP ) {
+
+        int             m       = qMin( GRP, nScans - g0 );
+        const qint16    *prev   = src + (g0 - 1) * nC;
+
+        // Zigzag deltas, zero-padded to GRP rows
+
+        for( int r = 0; r < GRP; ++r ) {
+
+            quint16 *z = &Z[r*nC];
+
+            if( r < m ) {
+
+                const qint16    *cur = prev + nC;
+
+                for( int c = 0; c < nC; ++c ) {
+                    qint16  dv = qint16(cur[c] - prev[c]);
+                    z[c] = quint16((dv << 1) ^ (dv >> 15));
+                }
+
+                prev = cur;
+            }
+            else
+                memset( z, 0, 2*nC );
+        }
+
+        // Widths
+
+        memcpy( &W[0], &Z[0], 2*nC );
+
+        for( int r = 1; r < GRP; ++r ) {
+
+            const quint16   *z = &Z[r*nC];
+
+            for( int c = 0; c < nC; ++c )
+                W[c] |= z[c];
+        }
+
+        for( int c = 0; c < nC; ++c )
+            d[c] = char(bitWidth( W[c] ));
+
+        const char  *wid = d;
+
+        d += nC;
+
+        // Pack
+
+        for( int c = 0; c < nC; ++c ) {
+
+            int w = wid[c];
+
+            if( !w )
+                continue;
+
+            const quint16   *z  = &Z[c];
+            quint64         acc = 0;
+            int             nb  = 0;
+
+            for( int r = 0; r < GRP; ++r, z += nC ) {
+
+                acc |= quint64(*z) << nb;
+
+                if( (nb += w) >= 32 ) {
+                    putU32( d, quint32(acc) );
+                    d   += 4;
+                    acc >>= 32;
+                    nb  -= 32;
+                }
+            }
+        }
+    }
+
+    int nPay = d - (&out[o0] + BLK_HDR);
+
+    d = &out[o0];
+    putU32( d, BLK_MAGIC );
+    putU32( d + 4, nScans );
+    putU32( d + 8, nPay );
+    putU32( d + 12, nC );
+
+    out.resize( o0 + BLK_HDR + nPay );
+
+    index.push_back( pos );
+    pos += BLK_HDR + nPay;
+}
+
+/* ---------------------------------------------------------------- */
+/* DFDecompressor ------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+bool DFDecompressor::open(
+    QFile       &f,
+    int         nChans,
+    quint64     nScans,
+    QString     &error )
+{
+    nC              = nChans;
+    this->nScans    = nScans;
+    cacheBlk        = -1;
+    blkScans        = DFCMP_BLOCKSCANS;
+    index.clear();
+
+    qint64  size = f.size();
+    char    ftr[FTR_BYTES];
+
+    if( size >= FTR_BYTES
+        && f.seek( size - FTR_BYTES )
+        && FTR_BYTES == f.read( ftr, FTR_BYTES )
+        && !memcmp( ftr, FTR_MAGIC, 8 ) ) {
+
+        quint64 nBlk, idxOff;
+
+        memcpy( &nBlk, ftr + 8, 8 );
+        memcpy( &idxOff, ftr + 16, 8 );
+        blkScans = getU32( ftr + 24 );
+
+        if( int(getU32( ftr + 28 )) == nC
+            && blkScans > 0
+            && idxOff + 8 * nBlk + FTR_BYTES == quint64(size) ) {
+
+            index.resize( nBlk + 1 );
+
+            if( !nBlk
+                || (f.seek( idxOff )
+                    && qint64(8 * nBlk) == f.read(
+                        (char*)&index[0], 8 * nBlk )) ) {
+
+                index[nBlk] = idxOff;
+            }
+            else
+                index.clear();
+        }
+    }
+
+    if( index.empty() && !rebuildIndex( f ) ) {
+        error = QString("Compressed file has no valid index '%1'.")
+                .arg( f.fileName() );
+        return false;
+    }
+
+    if( quint64(index.size() - 1) * blkScans < nScans ) {
+        error = QString("Compressed file is truncated '%1'.")
+                .arg( f.fileName() );
+        return false;
+    }
+
+    Z.resize( GRP * nC );
+
+    return true;
+}
+
+
+qint64 DFDecompressor::read(
+    QFile       &f,
+    qint16      *dst,
+    quint64     scan0,
+    quint64     n )
+{
+    if( scan0 >= nScans )
+        return -1;
+
+    n = qMin( n, nScans - scan0 );
+
+    for( quint64 done = 0; done < n; ) {
+
+        quint64 s   = scan0 + done;
+        qint64  blk = s / blkScans;
+
+        if( !loadBlock( f, blk ) )
+            return -1;
+
+        quint64 off     = s - quint64(blk) * blkScans,
+                take    = qMin( n - done, cache.size() / nC - off );
+
+        if( !take )
+            return -1;
+
+        memcpy( dst + done * nC, &cache[off * nC], take * nC * sizeof(qint16) );
+        done += take;
+    }
+
+    return n;
+}
+
+
+// src is block payload (after header).
+//
+bool DFDecompressor::decodeBlock(
+    qint16                  *dst,
+    std::vector<quint16>    &Z,
+    const char              *src,
+    int                     nBytes,
+    int                     nScans,
+    int                     nChans )
+{
+    const char  *end = src + nBytes;
+    int         nC   = nChans;
+
+    if( nBytes < 2*nC )
+        return false;
+
+    memcpy( dst, src, 2*nC );
+    src += 2*nC;
+
+    Z.resize( GRP * nC );
+
+    for( int g0 = 1; g0 < nScans; g0 += GRP ) {
+
+        int         m   = qMin( GRP, nScans - g0 );
+        const char  *wid;
+
+        if( src + nC > end )
+            return false;
+
+        wid  = src;
+        src += nC;
+
+        // Unpack
+
+        for( int c = 0; c < nC; ++c ) {
+
+            int     w   = wid[c];
+            quint16 *z  = &Z[c];
+
+            if( !w ) {
+                for( int r = 0; r < GRP; ++r, z += nC )
+                    *z = 0;
+                continue;
+            }
+
+            if( w > 16 || src + 4*w > end )
+                return false;
+
+            quint64 acc     = 0;
+            quint32 mask    = (1u << w) - 1;
+            int     nb      = 0;
+
+            for( int r = 0; r < GRP; ++r, z += nC ) {
+
+                if( nb < w ) {
+                    acc |= quint64(getU32( src )) << nb;
+                    src += 4;
+                    nb  += 32;
+                }
+
+                *z    = quint16(acc & mask);
+                acc >>= w;
+                nb   -= w;
+            }
+        }
+
+        // Integrate
+
+        for( int r = 0; r < m; ++r ) {
+
+            const quint16   *z      = &Z[r*nC];
+            qint16          *cur    = dst + (g0 + r) * nC;
+            const qint16    *prev   = cur - nC;
+
+            for( int c = 0; c < nC; ++c )
+                cur[c] = qint16(prev[c] + ((z[c] >> 1) ^ -(z[c] & 1)));
+        }
+    }
+
+    return src == end;
+}
+
+
+qint64 DFDecompressor::walkBlocks(
+    QFile   &f,
+    qint64  off,
+    int     nChans,
+    quint64 &nScans )
+{
+    qint64  size = f.size();
+    char    hdr[BLK_HDR];
+
+    while( off + BLK_HDR <= size
+        && f.seek( off )
+        && BLK_HDR == f.read( hdr, BLK_HDR )
+        && getU32( hdr ) == BLK_MAGIC
+        && int(getU32( hdr + 12 )) == nChans ) {
+
+        qint64  next = off + BLK_HDR + getU32( hdr + 8 );
+
+        if( next > size )
+            break;
+
+        nScans += getU32( hdr + 4 );
+        off     = next;
+    }
+
+    return off;
+}
+
+
+bool DFDecompressor::rebuildIndex( QFile &f )
+{
+    qint64  size    = f.size(),
+            off     = 0;
+    char    hdr[BLK_HDR];
+
+    index.clear();
+
+    while( off + BLK_HDR <= size
+        && f.seek( off )
+        && BLK_HDR == f.read( hdr, BLK_HDR )
+        && getU32( hdr ) == BLK_MAGIC
+        && int(getU32( hdr + 12 )) == nC ) {
+
+        qint64  next = off + BLK_HDR + getU32( hdr + 8 );
+
+        if( next > size )
+            break;
+
+        if( index.empty() )
+            blkScans = getU32( hdr + 4 );
+
+        index.push_back( off );
+        off = next;
+    }
+
+    if( index.empty() || blkScans <= 0 )
+        return false;
+
+    index.push_back( off );
+
+    Warning()
+        << "Rebuilt block index for '" << f.fileName()
+        << "' (" << index.size() - 1 << " blocks).";
+
+    return true;
+}
+
+
+bool DFDecompressor::loadBlock( QFile &f, qint64 blk )
+{
+    if( blk == cacheBlk )
+        return true;
+
+    if( blk < 0 || blk + 1 >= qint64(index.size()) )
+        return false;
+
+    qint64  nB = index[blk+1] - index[blk];
+
+    if( nB < BLK_HDR )
+        return false;
+
+    raw.resize( nB );
+
+    if( !f.seek( index[blk] ) || nB != f.read( &raw[0], nB ) ) {
+
+        Error()
+            << "DFDecompressor: Failed read of block " << blk
+            << " in '" << f.fileName() << "'.";
+        return false;
+    }
+
+    const char  *h  = &raw[0];
+    int         nS  = getU32( h + 4 );
+
+    if( getU32( h ) != BLK_MAGIC
+        || int(getU32( h + 12 )) != nC
+        || qint64(getU32( h + 8 )) != nB - BLK_HDR
+        || nS <= 0 || nS > blkScans ) {
+
+        Error()
+            << "DFDecompressor: Corrupt header in block " << blk
+            << " of '" << f.fileName() << "'.";
+        return false;
+    }
+
+    cache.resize( nS * nC );
+    cacheBlk = -1;
+
+    if( !decodeBlock( &cache[0], Z, h + BLK_HDR, nB - BLK_HDR, nS, nC ) ) {
+
+        Error()
+            << "DFDecompressor: Corrupt data in block " << blk
+            << " of '" << f.fileName() << "'.";
+        return false;
+    }
+
+    cacheBlk = blk;
+
+    return true;
+}
+
+
@@ -0,0 +1,113 @@
+#ifndef DFCOMPRESS_H
+#define DFCOMPRESS_H
+
+#include "SGLTypes.h"
+
+#include <QString>
+
+class QFile;
+
+/* ---------------------------------------------------------------- */
+/* Macros --------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+#define DFCMP_NAME          "dbp1"
+#define DFCMP_BLOCKSCANS    4096
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Lossless "dbp1" container for .bin data (meta fileCompression=dbp1).
+//
+// The file is a sequence of independently decodable blocks, each
+// DFCMP_BLOCKSCANS scans (last may be short), then a seek index
+// and a footer:
+//
+//     [block 0]...[block n-1][u64 offset x n][footer]
+//
+//     block:  u32 magic 'SGZ1', u32 nScans, u32 nPayload, u32 nChans
+//             int16 x nChans      first scan, verbatim
+//             per group of 32 following scans:
+//                 u8 x nChans     bit width w (0..16) per channel
+//                 per channel:    32 zigzag deltas packed in w u32s
+//
+//     footer: char[8] "SGLXCIDX", u64 nBlocks, u64 indexOffset,
+//             u32 blockScans, u32 nChans
+//
+// Deltas are taken modulo 2^16 so any int16 stream round-trips.
+// If the footer is missing (unclean close) the reader rebuilds
+// the index by walking block headers.
+//
+class DFCompressor
+{
+private:
+    vec_i16                 pend;   // partial block
+    std::vector<quint64>    index;
+    std::vector<quint16>    Z;      // group scratch
+    std::vector<quint16>    W;
+    quint64                 pos;
+    int                     nC;
+
+public:
+    DFCompressor( int nChans );
+
+    // Encoded bytes for any completed blocks are returned in out.
+    void put( std::vector<char> &out, const qint16 *src, int nScans );
+    // Flush partial block; append index and footer.
+    void finish( std::vector<char> &out );
+
+    int pendingScans() const    {return pend.size() / nC;}
+
+private:
+    void encodeBlock(
+        std::vector<char>   &out,
+        const qint16        *src,
+        int                 nScans );
+};
+
+
+class DFDecompressor
+{
+private:
+    std::vector<quint64>    index;  // nBlocks + 1 offsets
+    std::vector<char>       raw;
+    std::vector<quint16>    Z;
+    vec_i16                 cache;
+    qint64                  cacheBlk;
+    quint64                 nScans;
+    int                     nC,
+                            blkScans;
+
+public:
+    DFDecompressor() : cacheBlk(-1), nScans(0), nC(0), blkScans(0)  {}
+
+    bool open( QFile &f, int nChans, quint64 nScans, QString &error );
+
+    // Return number of scans read or -1 on failure.
+    qint64 read( QFile &f, qint16 *dst, quint64 scan0, quint64 n );
+
+    // Walk complete blocks from file offset off; return end
+    // offset of last complete block and add its scans to nScans.
+    static qint64 walkBlocks(
+        QFile   &f,
+        qint64  off,
+        int     nChans,
+        quint64 &nScans );
+
+    static bool decodeBlock(
+        qint16                  *dst,
+        std::vector<quint16>    &Z,
+        const char              *src,
+        int                     nBytes,
+        int                     nScans,
+        int                     nChans );
+
+private:
+    bool rebuildIndex( QFile &f );
+    bool loadBlock( QFile &f, qint64 blk );
+};
+
+#endif  // DFCOMPRESS_H
+
+
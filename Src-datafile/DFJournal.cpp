@@ -0,0 +1,330 @@
+
+#include "DFJournal.h"
+#include "Util.h"
+#include "DFCompress.h"
+#include "DFName.h"
+#include "KVParams.h"
+
+#include <string.h>
+
+
+#define JNL_MAGIC   "SGLXJNL1"
+#define JNL_SECS    5.0         // checkpoint interval
+#define SLOT_BYTES  256
+#define REC_BYTES   136
+#define CHK_OFFSET  132
+#define RD_BYTES    (4*1024*1024)
+
+
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Record layout (native endian):
+//
+//     0    char[8]     JNL_MAGIC
+//     8    u32         seq
+//     12   u32         reserved
+//     16   u64         bytes
+//     24   u64         scans
+//     32   u64         firstCt
+//     40   u32 x 5     SHA1 state
+//     60   u32 x 2     SHA1 count
+//     68   u8 x 64     SHA1 buffer
+//     132  u32         FNV-1a of bytes [0,132)
+//
+static quint32 fnv1a( const char *src, int n )
+{
+    quint32 h = 2166136261u;
+
+    for( int i = 0; i < n; ++i ) {
+        h ^= (quint8)src[i];
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+
+static void packRec( char *dst, quint32 seq, const DFJournal::Ckpt &C )
+{
+    quint32 z = 0, chk;
+
+    memset( dst, 0, SLOT_BYTES );
+    memcpy( dst,       JNL_MAGIC, 8 );
+    memcpy( dst + 8,   &seq, 4 );
+    memcpy( dst + 12,  &z, 4 );
+    memcpy( dst + 16,  &C.bytes, 8 );
+    memcpy( dst + 24,  &C.scans, 8 );
+    memcpy( dst + 32,  &C.firstCt, 8 );
+    memcpy( dst + 40,  C.sha.state, 20 );
+    memcpy( dst + 60,  C.sha.count, 8 );
+    memcpy( dst + 68,  C.sha.buffer, 64 );
+
+    chk = fnv1a( dst, CHK_OFFSET );
+    memcpy( dst + CHK_OFFSET, &chk, 4 );
+}
+
+/* ---------------------------------------------------------------- */
+/* DFJournal ------------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+QString DFJournal::nameFor( const QString &binName )
+{
+    return DFName::chopExtension( binName ) + ".jnl";
+}
+
+
+bool DFJournal::open( const QString &binName )
+{
+    close( false );
+
+    f.setFileName( nameFor( binName ) );
+
+    if( !f.open( QIODevice::ReadWrite | QIODevice::Truncate ) ) {
+
+        Warning()
+            << "Can't create recovery journal ["
+            << f.fileName() << "].";
+        return false;
+    }
+
+    seq     = 0;
+    tNext   = getTime() + JNL_SECS;
+
+    return true;
+}
+
+
+bool DFJournal::isDue() const
+{
+    return f.isOpen() && getTime() >= tNext;
+}
+
+
+// The .bin must reach the disk before the record that
+// vouches for it; the record itself is then synced.
+//
+bool DFJournal::checkpoint( QFile &bin, const Ckpt &C )
+{
+    tNext = getTime() + JNL_SECS;
+
+    if( !f.isOpen() || !syncFile( bin ) )
+        return false;
+
+    char    rec[SLOT_BYTES];
+
+    packRec( rec, ++seq, C );
+
+    return f.seek( (seq & 1) * SLOT_BYTES )
+        && SLOT_BYTES == f.write( rec, SLOT_BYTES )
+        && syncFile( f );
+}
+
+
+void DFJournal::close( bool remove )
+{
+    if( !f.isOpen() )
+        return;
+
+    f.close();
+
+    if( remove )
+        f.remove();
+}
+
+
+bool DFJournal::readSlot( Ckpt &C, quint32 &seq, QFile &f, int slot )
+{
+    char    rec[SLOT_BYTES];
+    quint32 chk;
+
+    if( !f.seek( slot * SLOT_BYTES )
+        || REC_BYTES > f.read( rec, SLOT_BYTES )
+        || memcmp( rec, JNL_MAGIC, 8 ) ) {
+
+        return false;
+    }
+
+    memcpy( &chk, rec + CHK_OFFSET, 4 );
+
+    if( chk != fnv1a( rec, CHK_OFFSET ) )
+        return false;
+
+    memcpy( &seq,           rec + 8, 4 );
+    memcpy( &C.bytes,       rec + 16, 8 );
+    memcpy( &C.scans,       rec + 24, 8 );
+    memcpy( &C.firstCt,     rec + 32, 8 );
+    memcpy( C.sha.state,    rec + 40, 20 );
+    memcpy( C.sha.count,    rec + 60, 8 );
+    memcpy( C.sha.buffer,   rec + 68, 64 );
+
+    return true;
+}
+
+/* ---------------------------------------------------------------- */
+/* recover -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Return true if meta file for binName is (now) complete.
+// On return, msg describes the outcome.
+//
+bool DFJournal::recover( const QString &binName, QString &msg )
+{
+    QString     metaName    = DFName::forceMetaSuffix( binName ),
+                jnlName     = nameFor( binName );
+    KVParams    kvp;
+
+    if( !kvp.fromMetaFile( metaName ) ) {
+        msg = "Missing or unreadable meta file.";
+        return false;
+    }
+
+    if( kvp.contains( "fileSHA1" ) ) {
+        QFile::remove( jnlName );
+        msg = "Meta file already complete.";
+        return true;
+    }
+
+// ------------------
+// Geometry from meta
+// ------------------
+
+    bool    isNI    = kvp["typeThis"].toString() == "nidq",
+            cmp     = kvp.contains( "fileCompression" );
+    double  sRate   = kvp[isNI ? "niSampRate" : "imSampRate"].toDouble();
+    int     nC      = kvp["nSavedChans"].toInt();
+
+    if( nC <= 0 || sRate <= 0 ) {
+        msg = "Meta file lacks channel count or sample rate.";
+        return false;
+    }
+
+    QFile   bin( binName );
+
+    if( !bin.open( QIODevice::ReadWrite ) ) {
+        msg = "Can't open binary file.";
+        return false;
+    }
+
+    quint64 size = bin.size();
+
+// ----------------------------------------
+// Newest checkpoint that .bin still covers
+// ----------------------------------------
+
+    Ckpt    C;
+    CSHA1   sha;
+    bool    have = false;
+
+    {
+        QFile   jnl( jnlName );
+
+        if( jnl.open( QIODevice::ReadOnly ) ) {
+
+            Ckpt    S[2];
+            quint32 q[2];
+            bool    ok[2];
+
+            for( int i = 0; i < 2; ++i )
+                ok[i] = readSlot( S[i], q[i], jnl, i ) && S[i].bytes <= size;
+
+            if( ok[0] && (!ok[1] || q[0] > q[1]) ) {
+                C       = S[0];
+                have    = true;
+            }
+            else if( ok[1] ) {
+                C       = S[1];
+                have    = true;
+            }
+        }
+    }
+
+    if( have )
+        sha.SetState( C.sha );
+
+// -----------------------------
+// Whole scans (or blocks) after
+// -----------------------------
+
+    quint64 end,
+            scans = C.scans;
+
+    if( cmp )
+        end = DFDecompressor::walkBlocks( bin, C.bytes, nC, scans );
+    else {
+        quint64 bpt = nC * sizeof(qint16);
+
+        scans  += (size - C.bytes) / bpt;
+        end     = C.bytes + (scans - C.scans) * bpt;
+    }
+
+// -------------
+// Hash the tail
+// -------------
+
+    std::vector<char>   buf( qMin( end - C.bytes, quint64(RD_BYTES) ) );
+
+    if( !bin.seek( C.bytes ) ) {
+        msg = "Binary file seek error.";
+        return false;
+    }
+
+    for( quint64 pos = C.bytes; pos < end; ) {
+
+        qint64  n = qMin( end - pos, quint64(RD_BYTES) );
+
+        if( n != bin.read( &buf[0], n ) ) {
+            msg = "Binary file read error.";
+            return false;
+        }
+
+        sha.Update( (const UINT_8*)&buf[0], n );
+        pos += n;
+    }
+
+    sha.Final();
+
+    if( end < size && !bin.resize( end ) ) {
+        msg = "Can't truncate partial data from binary file.";
+        return false;
+    }
+
+    bin.close();
+
+// ----------
+// Write meta
+// ----------
+
+    std::basic_string<char> hStr;
+    sha.ReportHashStl( hStr, CSHA1::REPORT_HEX_SHORT );
+
+    if( have )
+        kvp["firstSample"] = C.firstCt;
+
+    kvp["fileSHA1"]         = hStr.c_str();
+    kvp["fileTimeSecs"]     = scans / sRate;
+    kvp["fileSizeBytes"]    = end;
+
+    if( cmp )
+        kvp["fileSizeRawBytes"] = scans * sizeof(qint16) * nC;
+
+    if( !kvp.toMetaFile( metaName ) ) {
+        msg = "Can't write meta file.";
+        return false;
+    }
+
+    QFile::remove( jnlName );
+
+    msg = QString("Recovered %1 s; hashed %2 MB %3.")
+            .arg( scans / sRate, 0, 'f', 2 )
+            .arg( (end - C.bytes) / (1024.0*1024.0), 0, 'f', 1 )
+            .arg( have ? "after checkpoint" : "(no checkpoint)" );
+
+    if( end < size )
+        msg += QString(" Cut %1 partial bytes.").arg( size - end );
+
+    return true;
+}
+
+
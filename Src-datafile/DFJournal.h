@@ -0,0 +1,62 @@
+#ifndef DFJOURNAL_H
+#define DFJOURNAL_H
+
+#include "SHA1.h"
+#undef TCHAR
+
+#include <QFile>
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Crash-safe checkpoint of an open output file's tallies.
+//
+// While 'name.bin' is written, 'name.jnl' beside it holds the
+// {bytes, scans, firstSample, running SHA1} state, refreshed every
+// few seconds just after the .bin is synced to disk. Records go to
+// two alternating checksummed slots, so a torn journal write always
+// leaves the previous record intact. The journal is removed once
+// closeAndFinalize() has written the complete meta file.
+//
+// recover() rebuilds the {size, duration, SHA1} meta tallies of an
+// interrupted file. The hash resumes from the newest checkpoint the
+// .bin still covers, so only data written after that checkpoint is
+// read. A partial trailing scan (or compressed block) is cut off.
+//
+class DFJournal
+{
+public:
+    struct Ckpt {
+        quint64     bytes,      // .bin bytes covered
+                    scans,      // scans covered
+                    firstCt;    // meta firstSample
+        SHA1_STATE  sha;
+        Ckpt() : bytes(0), scans(0), firstCt(0) {}
+    };
+
+private:
+    QFile   f;
+    quint32 seq;
+    double  tNext;
+
+public:
+    DFJournal() : seq(0), tNext(0)  {}
+    virtual ~DFJournal()            {close( false );}
+
+    static QString nameFor( const QString &binName );
+
+    bool open( const QString &binName );
+    bool isDue() const;
+    bool checkpoint( QFile &bin, const Ckpt &C );
+    void close( bool remove );
+
+    static bool recover( const QString &binName, QString &msg );
+
+private:
+    static bool readSlot( Ckpt &C, quint32 &seq, QFile &f, int slot );
+};
+
+#endif  // DFJOURNAL_H
+
+
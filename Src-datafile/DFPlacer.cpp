@@ -0,0 +1,472 @@
+
+#include "DFPlacer.h"
+#include "Util.h"
+#include "MainApp.h"
+#include "Run.h"
+
+#include <QDir>
+#include <QFile>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+
+#include <algorithm>
+
+#if QT_VERSION >= 0x050400
+#include <QStorageInfo>
+#endif
+
+
+
+#define TEST_MB     64      // bandwidth probe size
+#define CHUNK_MB    4
+#define WARN_LOAD   0.80    // req/cap ratio that draws a warning
+#define WARN_QFULL  20.0    // file queue % that draws a warning
+#define WARN_SECS   10.0    // per-volume warning interval
+#define RETRY_SECS  30.0    // wait before remeasuring a failed volume
+
+
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+static QMutex                   plcMtx;
+static QMap<QString,double>     capCache;   // volume root -> MB/s
+static QSet<QString>            capPending; // being measured
+static QMap<QString,double>     capFailT;   // volume root -> fail time
+static QVector<int>             dir2vol,
+                                prb2dir;
+static QVector<DFPlacer::Drive> vol;
+static QVector<double>          tallyB,
+                                tallyR,
+                                tallyQ;
+static QVector<double>          tWarn;
+
+
+static QString volumeRoot( const QString &dir )
+{
+#if QT_VERSION >= 0x050400
+    QStorageInfo    si( dir );
+
+    if( si.isValid() )
+        return si.rootPath();
+#endif
+
+    return QDir( dir ).absolutePath();
+}
+
+
+static bool byRateDesc(
+    const QPair<double,int> &a,
+    const QPair<double,int> &b )
+{
+    return a.first > b.first;
+}
+
+
+// Sustained write rate of dir's volume in MB/s, or 0 on failure.
+// The file is synced so the page cache can't flatter the result.
+//
+static double measureMBps( const QString &dir )
+{
+    QFile   f( QString("%1/.sglx_bwtest.tmp").arg( dir ) );
+
+    if( !f.open( QIODevice::WriteOnly | QIODevice::Unbuffered ) )
+        return 0;
+
+    QByteArray  buf( CHUNK_MB * 1024 * 1024, 0x5A );
+    double      t0  = getTime();
+    bool        ok  = true;
+
+    for( int i = 0; ok && i < TEST_MB / CHUNK_MB; ++i )
+        ok = (buf.size() == f.write( buf ));
+
+    ok = ok && syncFile( f );
+
+    double  dt = getTime() - t0;
+
+    f.close();
+    f.remove();
+
+    return (ok && dt > 0 ? TEST_MB / dt : 0);
+}
+
+// Sequential probe placement; caller holds plcMtx.
+// Fills d2v (dir -> volume), p2d (probe -> dir), V (volumes
+// with capacity, file count and planned load).
+//
+static void assign(
+    const DAQ::Params           &p,
+    QVector<int>                &d2v,
+    QVector<int>                &p2d,
+    QVector<DFPlacer::Drive>    &V )
+{
+    MainApp *app    = mainApp();
+    int     ndir    = app->nDataDirs(),
+            np      = (p.im.enabled ? p.im.get_nProbes() : 0);
+
+    d2v.fill( 0, ndir );
+    p2d.fill( 0, np );
+    V.clear();
+
+    if( ndir <= 1 ) {
+        V.resize( 1 );
+        return;
+    }
+
+// -------------------
+// Volumes, capacities
+// -------------------
+
+    for( int idir = 0; idir < ndir; ++idir ) {
+
+        QString root = volumeRoot( app->dataDir( idir ) );
+        int     iv   = 0;
+
+        while( iv < V.size() && V[iv].root != root )
+            ++iv;
+
+        if( iv == V.size() ) {
+
+            DFPlacer::Drive D;
+
+            D.root      = root;
+            D.capMBps   = capCache.value( root, 0 );
+            V.push_back( D );
+        }
+
+        d2v[idir] = iv;
+    }
+
+// Unmeasured volumes take the mean of the others (or 1),
+// so placement falls back to balancing bytes.
+
+    double  sumCap  = 0;
+    int     nCap    = 0;
+
+    for( int iv = 0; iv < V.size(); ++iv ) {
+        if( V[iv].capMBps > 0 ) {
+            sumCap += V[iv].capMBps;
+            ++nCap;
+        }
+    }
+
+    for( int iv = 0; iv < V.size(); ++iv ) {
+        if( V[iv].capMBps <= 0 )
+            V[iv].capMBps = (nCap ? sumCap / nCap : 1);
+    }
+
+// -------------------
+// Fixed load: NI -> 0
+// -------------------
+
+    QVector<int>    nInDir( ndir, 0 );
+
+    if( p.ni.enabled ) {
+
+        double  MBps = p.ni.sns.saveBits.count( true )
+                        * p.ni.srate * 2 / (1024*1024);
+
+        V[d2v[0]].reqMBps += MBps;
+        ++V[d2v[0]].nFiles;
+    }
+
+// ---------------------------
+// Greedy: biggest probe first
+// ---------------------------
+
+    QVector<QPair<double,int> > order;
+
+    for( int ip = 0; ip < np; ++ip ) {
+
+        const CimCfg::AttrEach  &E = p.im.each[ip];
+
+        double  MBps = E.apSaveChanCount() * E.srate * 2;
+
+        if( E.lfIsSaving() )
+            MBps += E.lfSaveChanCount() * E.srate/12 * 2;
+
+        order.push_back( qMakePair( MBps / (1024*1024), ip ) );
+    }
+
+    std::stable_sort( order.begin(), order.end(), byRateDesc );
+
+    for( int io = 0; io < order.size(); ++io ) {
+
+        double  MBps    = order[io].first,
+                best    = 1e99;
+        int     ip      = order[io].second,
+                bestDir = 0;
+
+        for( int idir = 0; idir < ndir; ++idir ) {
+
+            int     iv = d2v[idir];
+            double  r  = (V[iv].reqMBps + MBps) / V[iv].capMBps;
+
+            // Tie: fewer files in dir, then lower dir
+
+            if( r < best - 1e-9
+                || (r < best + 1e-9 && nInDir[idir] < nInDir[bestDir]) ) {
+
+                best    = r;
+                bestDir = idir;
+            }
+        }
+
+        p2d[ip] = bestDir;
+        V[d2v[bestDir]].reqMBps += MBps;
+        ++nInDir[bestDir];
+        ++V[d2v[bestDir]].nFiles;
+    }
+}
+
+/* ---------------------------------------------------------------- */
+/* DFMeasureWorker ------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+void DFMeasureWorker::run()
+{
+    for( int i = 0, n = roots.size(); i < n; ++i ) {
+
+        double  MBps = measureMBps( dirs[i] );
+
+        // Failures aren't cached: a busy or briefly absent
+        // volume is retried after RETRY_SECS.
+
+        plcMtx.lock();
+
+        if( MBps > 0 ) {
+            capCache[roots[i]] = MBps;
+            capFailT.remove( roots[i] );
+        }
+        else
+            capFailT[roots[i]] = getTime();
+
+        capPending.remove( roots[i] );
+        plcMtx.unlock();
+
+        if( MBps > 0 ) {
+            Log() <<
+                QString("Drive '%1' write rate %2 MB/s.")
+                .arg( roots[i] )
+                .arg( MBps, 0, 'f', 0 );
+        }
+        else {
+            Warning() <<
+                QString("Drive '%1' write rate not measurable;"
+                        " will retry.")
+                .arg( roots[i] );
+        }
+    }
+
+    emit finished();
+}
+
+/* ---------------------------------------------------------------- */
+/* DFPlacer ------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Measure any multidrive volumes not yet measured, on a
+// worker thread. Skipped during a run so the test file
+// can't compete with recording. A volume that failed is
+// retried once RETRY_SECS have passed.
+//
+void DFPlacer::measureAsync()
+{
+    MainApp *app    = mainApp();
+    Run     *run    = app->getRun();
+    int     ndir    = app->nDataDirs();
+
+    if( ndir <= 1 || (run && run->isRunning()) )
+        return;
+
+    QStringList roots,
+                dirs;
+
+    for( int idir = 0; idir < ndir; ++idir ) {
+
+        QString dir  = app->dataDir( idir ),
+                root = volumeRoot( dir );
+
+        if( !roots.contains( root ) ) {
+            roots.push_back( root );
+            dirs.push_back( dir );
+        }
+    }
+
+    double  t = getTime();
+
+    plcMtx.lock();
+
+    for( int i = roots.size() - 1; i >= 0; --i ) {
+
+        if( capCache.contains( roots[i] )
+            || capPending.contains( roots[i] )
+            || (capFailT.contains( roots[i] )
+                && t - capFailT[roots[i]] < RETRY_SECS) ) {
+
+            roots.removeAt( i );
+            dirs.removeAt( i );
+        }
+        else
+            capPending.insert( roots[i] );
+    }
+
+    plcMtx.unlock();
+
+    if( roots.isEmpty() )
+        return;
+
+    QThread         *thread = new QThread;
+    DFMeasureWorker *worker = new DFMeasureWorker( roots, dirs );
+
+    worker->moveToThread( thread );
+
+    Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
+    Connect( worker, SIGNAL(finished()), worker, SLOT(deleteLater()) );
+    Connect( worker, SIGNAL(destroyed()), thread, SLOT(quit()), Qt::DirectConnection );
+    Connect( thread, SIGNAL(finished()), thread, SLOT(deleteLater()) );
+
+    thread->start( QThread::LowPriority );
+}
+
+
+// Probe -> directory assignment for p, using cached rates.
+// Does not touch the committed plan.
+//
+QVector<int> DFPlacer::place( const DAQ::Params &p )
+{
+    QVector<int>    d2v,
+                    p2d;
+    QVector<Drive>  V;
+
+    QMutexLocker    ml( &plcMtx );
+
+    assign( p, d2v, p2d, V );
+
+    return p2d;
+}
+
+
+void DFPlacer::plan( const DAQ::Params &p )
+{
+    QMutexLocker    ml( &plcMtx );
+
+    assign( p, dir2vol, prb2dir, vol );
+
+    tallyB.fill( 0, vol.size() );
+    tallyR.fill( 0, vol.size() );
+    tallyQ.fill( 0, vol.size() );
+    tWarn.fill( 0, vol.size() );
+
+    if( vol.size() <= 1 && dir2vol.size() <= 1 )
+        return;
+
+// ------
+// Report
+// ------
+
+    for( int iv = 0; iv < vol.size(); ++iv ) {
+
+        Drive   &D = vol[iv];
+
+        Log() <<
+            QString("Drive '%1': %2 units, %3 of %4 MB/s%5.")
+            .arg( D.root )
+            .arg( D.nFiles )
+            .arg( D.reqMBps, 0, 'f', 1 )
+            .arg( D.capMBps, 0, 'f', 0 )
+            .arg( capCache.contains( D.root ) ? "" : " (not measured)" );
+
+        if( D.reqMBps > WARN_LOAD * D.capMBps ) {
+            Warning() <<
+                QString("Drive '%1' planned at %2% of measured capacity;"
+                        " it may fall behind.")
+                .arg( D.root )
+                .arg( 100 * D.reqMBps / D.capMBps, 0, 'f', 0 );
+        }
+    }
+}
+
+
+int DFPlacer::dirFor( int ip )
+{
+    QMutexLocker    ml( &plcMtx );
+
+    int ndir = mainApp()->nDataDirs();
+
+    if( ndir <= 1 )
+        return 0;
+
+    if( ip >= 0 && ip < prb2dir.size() && prb2dir[ip] < ndir )
+        return prb2dir[ip];
+
+    return ip % ndir;
+}
+
+
+void DFPlacer::liveTally(
+    int     idir,
+    double  bytes,
+    double  reqBps,
+    double  qFull )
+{
+    QMutexLocker    ml( &plcMtx );
+
+    int iv = (idir >= 0 && idir < dir2vol.size() ? dir2vol[idir] : 0);
+
+    if( iv >= tallyB.size() )
+        return;
+
+    tallyB[iv] += bytes;
+    tallyR[iv] += reqBps;
+    tallyQ[iv]  = qMax( tallyQ[iv], qFull );
+}
+
+
+void DFPlacer::liveCommit( double dtSecs )
+{
+    QMutexLocker    ml( &plcMtx );
+
+    double  t = getTime();
+
+    for( int iv = 0; iv < vol.size() && iv < tallyB.size(); ++iv ) {
+
+        Drive   &D = vol[iv];
+
+        D.actMBps = tallyB[iv] / qMax( dtSecs, 1e-3 ) / (1024*1024);
+        D.reqMBps = tallyR[iv] / (1024*1024);
+        D.qFull   = tallyQ[iv];
+
+        tallyB[iv] = 0;
+        tallyR[iv] = 0;
+        tallyQ[iv] = 0;
+
+        if( vol.size() > 1
+            && (D.qFull >= WARN_QFULL
+                || D.reqMBps > WARN_LOAD * D.capMBps)
+            && t - tWarn[iv] >= WARN_SECS ) {
+
+            tWarn[iv] = t;
+
+            Warning() <<
+                QString("Drive '%1' nearing limit: req %2 (cap %3) MB/s,"
+                        " queue %4%.")
+                .arg( D.root )
+                .arg( D.reqMBps, 0, 'f', 1 )
+                .arg( D.capMBps, 0, 'f', 0 )
+                .arg( D.qFull, 0, 'f', 1 );
+        }
+    }
+}
+
+
+QVector<DFPlacer::Drive> DFPlacer::drives()
+{
+    QMutexLocker    ml( &plcMtx );
+
+    return vol;
+}
+
+
@@ -0,0 +1,92 @@
+#ifndef DFPLACER_H
+#define DFPLACER_H
+
+#include "DAQ.h"
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Measures volume write rates off the GUI thread.
+//
+class DFMeasureWorker : public QObject
+{
+    Q_OBJECT
+
+private:
+    QStringList roots,
+                dirs;
+
+public:
+    DFMeasureWorker( const QStringList &roots, const QStringList &dirs )
+    :   QObject(0), roots(roots), dirs(dirs)    {}
+
+signals:
+    void finished();
+
+public slots:
+    void run();
+};
+
+
+// Multidrive file placement and monitoring.
+//
+// Data directories are grouped by volume (directories on one
+// volume share its bandwidth). Each volume's sustained write rate
+// is measured once per session with a short fsync'd test file,
+// on a worker thread started by measureAsync() at startup and
+// whenever the data directories change (or the disk check button
+// is pressed). Failed measurements aren't cached and are retried
+// after a while. Nothing else measures: a volume not yet measured
+// is planned at the others' mean.
+//
+// place() assigns each imec probe (AP and LF together, so the pair
+// stays in one folder) to a data directory, largest data rate
+// first, choosing the directory whose volume would have the lowest
+// load/capacity ratio. NI stays in the main directory (dir 0), but
+// its rate counts toward that volume's load. place() has no side
+// effects (for validation and previews); plan() commits the result
+// for the run and logs it.
+//
+// During a run, TrigBase tallies each file's written bytes against
+// its directory; liveCommit() converts these to per-volume MB/s and
+// logs a warning when a volume nears its measured capacity or its
+// write queues start to fill.
+//
+class DFPlacer
+{
+public:
+    struct Drive {
+        QString root;
+        double  capMBps,    // measured
+                reqMBps,    // planned / live required
+                actMBps,    // live actual
+                qFull;      // worst file queue %
+        int     nFiles;
+        Drive()
+        :   capMBps(0), reqMBps(0), actMBps(0), qFull(0), nFiles(0) {}
+    };
+
+public:
+    static void measureAsync();
+    static QVector<int> place( const DAQ::Params &p );
+    static void plan( const DAQ::Params &p );
+    static int dirFor( int ip );
+
+    static void liveTally(
+        int     idir,
+        double  bytes,
+        double  reqBps,
+        double  qFull );
+    static void liveCommit( double dtSecs );
+
+    static QVector<Drive> drives();
+};
+
+#endif  // DFPLACER_H
+
+
@@ -1,23 +1,33 @@
 
 #include "DataFile.h"
 #include "DataFile_Helpers.h"
+#include "DFCompress.h"
+#include "DFJournal.h"
 #include "DFName.h"
+#include "DFPlacer.h"
 #include "Util.h"
 #include "MainApp.h"
+#include "MXStats.h"
+#include "MXTrace.h"
 #include "Subset.h"
 #include "Version.h"
 
 #include <QDir>
 
 
+// readChannel() reads whole scans this many bytes at a time.
+#define RDCHAN_CHUNK_BYTES  (1024*1024)
+
 /* ---------------------------------------------------------------- */
 /* DataFile ------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
 DataFile::DataFile( int iProbe )
     :   scanCt(0), mode(Undefined),
-        trgStream("nidq"), trgChan(-1),
-        dfw(0), wrAsync(true), sRate(0),
+        trgStream("nidq"), cmpR(0), trgChan(-1),
+        dfw(0), cmpW(0), jnl(0), wrScans(0), firstSamp(0),
+        cmpRawB(0), cmpEncB(0),
+        trcID(-1), iDir(0), wrAsync(true), sRate(0),
         iProbe(iProbe), nSavedChans(0)
 {
 }
@@ -29,6 +39,21 @@ DataFile::~DataFile()
         delete dfw;
         dfw = 0;
     }
+
+    if( cmpW ) {
+        delete cmpW;
+        cmpW = 0;
+    }
+
+    if( jnl ) {
+        delete jnl;
+        jnl = 0;
+    }
+
+    if( cmpR ) {
+        delete cmpR;
+        cmpR = 0;
+    }
 }
 
 /* ---------------------------------------------------------------- */
@@ -77,8 +102,31 @@ bool DataFile::openForRead( const QString &filename, QString &error )
 
     subclassParseMetaData();
 
-    scanCt = kvp["fileSizeBytes"].toULongLong()
-                / (sizeof(qint16) * nSavedChans);
+    if( kvp.contains( "fileCompression" ) ) {
+
+        if( kvp["fileCompression"].toString() != DFCMP_NAME ) {
+            error =
+            QString("openForRead error: Unknown fileCompression '%1'.")
+                .arg( kvp["fileCompression"].toString() );
+            Error() << error;
+            return false;
+        }
+
+        scanCt = kvp["fileSizeRawBytes"].toULongLong()
+                    / (sizeof(qint16) * nSavedChans);
+
+        cmpR = new DFDecompressor;
+
+        if( !cmpR->open( binFile, nSavedChans, scanCt, error ) ) {
+            error = "openForRead error: " + error;
+            Error() << error;
+            return false;
+        }
+    }
+    else {
+        scanCt = kvp["fileSizeBytes"].toULongLong()
+                    / (sizeof(qint16) * nSavedChans);
+    }
 
 // -----------
 // Channel ids
@@ -215,7 +263,9 @@ bool DataFile::openForWrite(
     bool    isNI    = subtypeFromObj() == "nidq";
 
     if( !isNI && ndir > 1 )
-        idir = iProbe % ndir;
+        idir = DFPlacer::dirFor( iProbe );
+
+    iDir = idir;
 
     if( !forceName.isEmpty() )
         bName = brevname;
@@ -357,6 +407,11 @@ bool DataFile::openForWrite(
     kvp["typeImEnabled"]    = p.im.get_nProbes();
     kvp["typeNiEnabled"]    = (p.ni.enabled ? 1 : 0);
 
+    if( p.sns.compress ) {
+        cmpW = new DFCompressor( nSavedChans );
+        kvp["fileCompression"] = DFCMP_NAME;
+    }
+
     // All metadata are single lines of text
     QString noReturns = p.sns.notes;
     noReturns.replace( QRegExp("[\r\n]"), "\\n" );
@@ -419,7 +474,17 @@ bool DataFile::openForWrite(
 
     kvp["appVersion"] = QString("%1").arg( VERSION, 0, 16 );
 
-    return kvp.toMetaFile( metaName );
+    if( !kvp.toMetaFile( metaName ) )
+        return false;
+
+// ----------------
+// Recovery journal
+// ----------------
+
+    jnl = new DFJournal;
+    jnl->open( bName );
+
+    return true;
 }
 
 /* ---------------------------------------------------------------- */
@@ -480,6 +545,11 @@ bool DataFile::openForExport(
     kvp["fileName"]     = bName;
     kvp["nSavedChans"]  = nSavedChans;
 
+    // Exports are always plain int16
+
+    kvp.remove( "fileCompression" );
+    kvp.remove( "fileSizeRawBytes" );
+
 // Build channel ID list
 
     chanIds.clear();
@@ -537,6 +607,16 @@ bool DataFile::closeAndFinalize()
             dfw = 0;
         }
 
+        if( cmpW ) {
+
+            std::vector<char>   out;
+
+            cmpW->finish( out );
+            ok = writeBytes( &out[0], out.size() );
+
+            kvp["fileSizeRawBytes"] = scanCt * sizeof(qint16) * nSavedChans;
+        }
+
         sha.Final();
 
         std::basic_string<char> hStr;
@@ -547,7 +627,12 @@ bool DataFile::closeAndFinalize()
         kvp["fileSizeBytes"]    = binFile.size();
         kvp["appVersion"]       = QString("%1").arg( VERSION, 0, 16 );
 
-        ok = kvp.toMetaFile( metaName );
+        ok = kvp.toMetaFile( metaName ) && ok;
+
+        // Journal no longer needed once meta is complete
+
+        if( jnl )
+            jnl->close( ok );
 
         Log() << ">> Completed " << binFile.fileName();
     }
@@ -559,16 +644,38 @@ bool DataFile::closeAndFinalize()
     binFile.close();
     metaName.clear();
 
+    if( cmpW ) {
+        delete cmpW;
+        cmpW = 0;
+    }
+
+    if( jnl ) {
+        delete jnl;
+        jnl = 0;
+    }
+
+    if( cmpR ) {
+        delete cmpR;
+        cmpR = 0;
+    }
+
     statsBytes.clear();
     kvp.clear();
     chanIds.clear();
+    wrPlan = SubsetPlan();
     sha.Reset();
 
     scanCt      = 0;
+    wrScans     = 0;
+    firstSamp   = 0;
+    cmpRawB     = 0;
+    cmpEncB     = 0;
     mode        = Undefined;
     trgStream   = "nidq";
     trgChan     = -1;
     dfw         = 0;
+    trcID       = -1;
+    iDir        = 0;
     wrAsync     = true;
     sRate       = 0;
     nSavedChans = 0;
@@ -635,7 +742,8 @@ bool DataFile::writeAndInvalScans( vec_i16 &scans )
         if( !dfw )
             dfw = new DFWriter( this, 4000 );
 
-        dfw->worker->enqueue( scans );
+        dfw->worker->enqueue( scans, trcID );
+        trcID = -1;
 
         if( dfw->worker->percentFull() >= 95.0 ) {
 
@@ -646,7 +754,12 @@ bool DataFile::writeAndInvalScans( vec_i16 &scans )
         return true;
     }
 
-    return doFileWrite( scans );
+    bool    ok = doFileWrite( scans );
+
+    MXTrace::mark( trcID, "df.write" );
+    trcID = -1;
+
+    return ok;
 }
 
 /* ---------------------------------------------------------------- */
@@ -655,14 +768,28 @@ bool DataFile::writeAndInvalScans( vec_i16 &scans )
 
 bool DataFile::writeAndInvalSubset( const DAQ::Params &p, vec_i16 &scans )
 {
-    int n16 = subclassGetAcqChanCount( p );
+    const SubsetPlan    &P = writePlan( p );
 
-    if( nSavedChans != n16 )
-        Subset::subset( scans, scans, chanIds, n16 );
+    if( !P.isAll() )
+        P.apply( scans, scans );
 
     return writeAndInvalScans( scans );
 }
 
+
+// Plan mapping acquired channels to saved chanIds[],
+// compiled on first use after open.
+//
+const SubsetPlan &DataFile::writePlan( const DAQ::Params &p )
+{
+    int n16 = subclassGetAcqChanCount( p );
+
+    if( wrPlan.nChans() != n16 || wrPlan.nKeep() != chanIds.size() )
+        wrPlan.compile( chanIds, n16 );
+
+    return wrPlan;
+}
+
 /* ---------------------------------------------------------------- */
 /* readScans ------------------------------------------------------ */
 /* ---------------------------------------------------------------- */
@@ -670,9 +797,8 @@ bool DataFile::writeAndInvalSubset( const DAQ::Params &p, vec_i16 &scans )
 // Read num2read scans starting from file offset scan0.
 // Note that (scan0 == 0) is the start of this file.
 //
-// To apply 'const' to this method, seek() and read()
-// have to strip constness from binFile, since they
-// move the file pointer.
+// The method is 'const' though seek() and read() move
+// the file pointer; binFile is mutable for that reason.
 //
 qint64 DataFile::readScans(
     vec_i16         &dst,
@@ -689,13 +815,61 @@ qint64 DataFile::readScans(
 
     num2read = qMin( num2read, scanCt - scan0 );
 
+// ----
+// Read
+// ----
+
+    if( cmpR ) {
+
+        dst.resize( num2read * nSavedChans );
+
+        if( cmpR->read( binFile, &dst[0], scan0, num2read )
+            != (qint64)num2read ) {
+
+            Error()
+                << "readScans error: Failed decompress at scan ["
+                << scan0
+                << "] file ["
+                << binFile.fileName()
+                << "].";
+
+            dst.clear();
+            return -1;
+        }
+    }
+    else if( !readRaw( dst, scan0, num2read ) )
+        return -1;
+
+// ------
+// Subset
+// ------
+
+    if( keepBits.size() && keepBits.count( true ) < nSavedChans ) {
+
+        QVector<uint>   iKeep;
+
+        Subset::bits2Vec( iKeep, keepBits );
+        Subset::subset( dst, dst, iKeep, nSavedChans );
+    }
+
+    return num2read;
+}
+
+
+// Plain int16 read of [scan0, scan0+num2read).
+//
+bool DataFile::readRaw(
+    vec_i16         &dst,
+    quint64         scan0,
+    quint64         num2read ) const
+{
 // ----
 // Seek
 // ----
 
     int bytesPerScan = nSavedChans * sizeof(qint16);
 
-    if( !((QFile*)&binFile)->seek( scan0 * bytesPerScan ) ) {
+    if( !binFile.seek( scan0 * bytesPerScan ) ) {
 
         Error()
             << "readScans error: Failed seek to pos ["
@@ -703,7 +877,7 @@ qint64 DataFile::readScans(
             << "] file size ["
             << binFile.size()
             << "].";
-        return -1;
+        return false;
     }
 
 // ----
@@ -742,7 +916,7 @@ qint64 DataFile::readScans(
 
 #else
 
-    qint64 nr = ((QFile*)&binFile)->read(
+    qint64 nr = binFile.read(
                     (char*)&dst[0], num2read * bytesPerScan );
 #endif
 
@@ -762,22 +936,64 @@ qint64 DataFile::readScans(
             << "].";
 
         dst.clear();
-        return -1;
+        return false;
     }
 
-// ------
-// Subset
-// ------
+    return true;
+}
 
-    if( keepBits.size() && keepBits.count( true ) < nSavedChans ) {
 
-        QVector<uint>   iKeep;
+// Gather a single channel, reading whole scans a bounded
+// chunk at a time. Every scan's bytes still come off disk
+// (a page holds several scans, so a strided read can't
+// skip any), but memory stays at one chunk rather than the
+// whole request, and the chunk stays cache resident while
+// we pick out the channel. Compressed files go through the
+// same path via readScans().
+//
+qint64 DataFile::readChannel(
+    vec_i16         &dst,
+    quint64         scan0,
+    quint64         num2read,
+    int             iChan ) const
+{
+    if( scan0 >= scanCt || iChan < 0 || iChan >= nSavedChans )
+        return -1;
 
-        Subset::bits2Vec( iKeep, keepBits );
-        Subset::subset( dst, dst, iKeep, nSavedChans );
+    num2read = qMin( num2read, scanCt - scan0 );
+
+    dst.resize( num2read );
+
+    vec_i16 buf;
+    quint64 nPer = qMax( 1, RDCHAN_CHUNK_BYTES / (nSavedChans * 2) ),
+            nDone = 0;
+
+    while( nDone < num2read ) {
+
+        qint64  nr = readScans(
+                        buf, scan0 + nDone,
+                        qMin( nPer, num2read - nDone ), QBitArray() );
+
+        if( nr <= 0 )
+            break;
+
+        const qint16    *s = &buf[iChan];
+        qint16          *d = &dst[nDone];
+
+        for( qint64 i = 0; i < nr; ++i, s += nSavedChans )
+            d[i] = *s;
+
+        nDone += nr;
     }
 
-    return num2read;
+    if( !nDone ) {
+        dst.clear();
+        return -1;
+    }
+
+    dst.resize( nDone );
+
+    return nDone;
 }
 
 /* ---------------------------------------------------------------- */
@@ -789,7 +1005,8 @@ qint64 DataFile::readScans(
 //
 void DataFile::setFirstSample( quint64 firstCt )
 {
-    kvp["firstSample"] = firstCt;
+    kvp["firstSample"]  = firstCt;
+    firstSamp           = firstCt;
 }
 
 /* ---------------------------------------------------------------- */
@@ -988,21 +1205,95 @@ double DataFile::writtenBytes() const
 
 bool DataFile::doFileWrite( const vec_i16 &scans )
 {
-    int n2Write = (int)scans.size() * sizeof(qint16);
+    int     n2Write = (int)scans.size() * sizeof(qint16);
+    bool    ok      = true;
 
-//    int nWrit = writeChunky( binFile, &scans[0], n2Write );
-    int nWrit = binFile.write( (char*)&scans[0], n2Write );
+    if( !cmpW )
+        ok = writeBytes( (const char*)&scans[0], n2Write );
+    else {
 
-    statsMtx.lock();
-        statsBytes.push_back( nWrit );
-    statsMtx.unlock();
+        // Compressed: stats still tally raw bytes so the
+        // disk-rate monitor compares like with like.
+
+        static MXHist   *mxCmp = MXStats::hist( "df.compress_us" );
+        static MXGauge  *mxPct = MXStats::gauge( "df.compress_pct" );
+
+        std::vector<char>   out;
+        double              t0 = getTime();
+
+        cmpW->put( out, &scans[0], scans.size() / nSavedChans );
+
+        mxCmp->recordSince( t0 );
+
+        statsMtx.lock();
+            statsBytes.push_back( n2Write );
+        statsMtx.unlock();
+
+        // Encoded output lags input by a block, so the
+        // ratio is taken over running totals.
+
+        cmpRawB += n2Write;
+        cmpEncB += out.size();
+
+        if( out.size() ) {
+            mxPct->set( 100 * cmpEncB / qMax( cmpRawB, quint64(1) ) );
+            ok = writeBytes( &out[0], out.size() );
+        }
+    }
+
+    wrScans += scans.size() / nSavedChans;
+
+    if( ok && jnl && jnl->isDue() )
+        jnlCheckpoint();
+
+    return ok;
+}
+
+
+// Record what is now safely on disk: written bytes, the scans
+// they hold (excluding any still pending in the compressor),
+// and the hash state over exactly those bytes.
+//
+void DataFile::jnlCheckpoint()
+{
+    static MXHist   *mxJnl = MXStats::hist( "df.journal_us" );
+
+    DFJournal::Ckpt C;
+    double          t0 = getTime();
+
+    C.bytes     = binFile.pos();
+    C.scans     = wrScans - (cmpW ? cmpW->pendingScans() : 0);
+    C.firstCt   = firstSamp;
+    sha.GetState( C.sha );
+
+    if( !jnl->checkpoint( binFile, C ) ) {
+        Warning()
+            << "Recovery journal checkpoint failed ["
+            << QFileInfo( binFile.fileName() ).completeBaseName()
+            << "].";
+    }
+
+    mxJnl->recordSince( t0 );
+}
+
+
+bool DataFile::writeBytes( const char *src, int n2Write )
+{
+//    int nWrit = writeChunky( binFile, src, n2Write );
+    int nWrit = binFile.write( src, n2Write );
+
+    if( !cmpW ) {
+        statsMtx.lock();
+            statsBytes.push_back( nWrit );
+        statsMtx.unlock();
+    }
 
     if( nWrit != n2Write ) {
         Error() << "File writing error: " << binFile.error();
         return false;
     }
 
-    sha.Update( (const UINT_8*)&scans[0], n2Write );
+    sha.Update( (const UINT_8*)src, n2Write );
 
     return true;
 }
@@ -3,6 +3,7 @@
 
 #include "DAQ.h"
 #include "KVParams.h"
+#include "Subset.h"
 
 #include "SHA1.h"
 #undef TCHAR
@@ -10,6 +11,9 @@
 #include <QFile>
 #include <QMutex>
 
+class DFCompressor;
+class DFDecompressor;
+class DFJournal;
 class DFWriter;
 
 /* ---------------------------------------------------------------- */
@@ -31,13 +35,15 @@ private:
     };
 
     // Input and Output mode
-    QFile                   binFile;
+    // (mutable: const reads still move the file pointer)
+    mutable QFile           binFile;
     QString                 metaName;
     quint64                 scanCt;
     IOMode                  mode;
 
     // Input mode
     QString                 trgStream;
+    DFDecompressor          *cmpR;      // if fileCompression
     int                     trgChan;    // neg if not using
 
     // Output mode only
@@ -45,7 +51,16 @@ private:
     mutable QVector<uint>   statsBytes;
     CSHA1                   sha;
     DFWriter                *dfw;
-    int                     nMeasMax;
+    DFCompressor            *cmpW;      // if sns.compress
+    DFJournal               *jnl;       // crash recovery
+    SubsetPlan              wrPlan;     // acq -> chanIds
+    quint64                 wrScans,    // scans hashed by writer
+                            firstSamp,
+                            cmpRawB,    // bytes into compressor
+                            cmpEncB;    // bytes out of compressor
+    int                     nMeasMax,
+                            trcID,      // MXTrace tag for next write
+                            iDir;       // data dir index
     bool                    wrAsync;
 
 protected:
@@ -91,6 +106,7 @@ public:
     virtual QString streamFromObj() const = 0;
     virtual QString fileLblFromObj() const = 0;
     int probeNum() const                {return iProbe;}
+    int dirIndex() const                {return iDir;}
 
     QString binFileName() const         {return binFile.fileName();}
     const QString &metaFileName() const {return metaName;}
@@ -104,9 +120,11 @@ public:
     // ------
 
     void setAsyncWriting( bool async )  {wrAsync = async;}
+    void setTraceID( int id )           {trcID = id;}
 
     bool writeAndInvalScans( vec_i16 &scans );
     bool writeAndInvalSubset( const DAQ::Params &p, vec_i16 &scans );
+    const SubsetPlan &writePlan( const DAQ::Params &p );
 
     // -----
     // Input
@@ -122,6 +140,17 @@ public:
         quint64         num2read,
         const QBitArray &keepBits ) const;
 
+    // Read one saved channel (index into channelIDs()), in
+    // bounded chunks of whole scans.
+    // Return number of scans actually read or -1 on failure.
+    // If num2read > available, available count is used.
+
+    qint64 readChannel(
+        vec_i16         &dst,
+        quint64         scan0,
+        quint64         num2read,
+        int             iChan ) const;
+
     // ---------
     // Meta data
     // ---------
@@ -184,7 +213,10 @@ protected:
         const QVector<uint> &idxOtherChans ) = 0;
 
 private:
+    bool readRaw( vec_i16 &dst, quint64 scan0, quint64 num2read ) const;
     bool doFileWrite( const vec_i16 &scans );
+    void jnlCheckpoint();
+    bool writeBytes( const char *src, int n2Write );
 };
 
 #endif  // DATAFILE_H
@@ -1,6 +1,7 @@
 
 #include "DataFile_Helpers.h"
 #include "DataFile.h"
+#include "MXTrace.h"
 #include "Util.h"
 
 #include <QThread>
@@ -17,9 +18,13 @@ void DFWriterWorker::run()
     for(;;) {
 
         vec_i16 buf;
+        int     trcID;
 
-        if( dequeue( buf, waitData() ) )
+        if( dequeue( buf, trcID, waitData() ) ) {
             write( buf );
+            MXTrace::mark( trcID, "df.write" );
+            recycle( buf );
+        }
         else if( isStopped() )
             break;
     }
@@ -45,7 +50,9 @@ bool DFWriterWorker::write( const vec_i16 &scans )
 DFWriter::DFWriter( DataFile *df, int maxQSize )
 {
     thread  = new QThread;
-    worker  = new DFWriterWorker( df, maxQSize );
+    worker  = new DFWriterWorker(
+                df, maxQSize,
+                QString("writer.%1.qdepth").arg( df->fileLblFromObj() ) );
 
     worker->moveToThread( thread );
 
@@ -27,8 +27,8 @@ private:
                     pleaseStop;
 
 public:
-    DFWriterWorker( DataFile *df, int maxQSize )
-    :   QObject(0), SampleBufQ(maxQSize),
+    DFWriterWorker( DataFile *df, int maxQSize, const QString &mxName )
+    :   QObject(0), SampleBufQ(maxQSize, mxName),
         d(df), _waitData(true),
         pleaseStop(false)           {}
     virtual ~DFWriterWorker()       {}
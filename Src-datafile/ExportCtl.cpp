@@ -9,6 +9,7 @@
 #include "DataFileIMLF.h"
 #include "DataFileNI.h"
 #include "DFName.h"
+#include "ExportEngine.h"
 #include "Subset.h"
 
 #include <QButtonGroup>
@@ -65,7 +66,7 @@ void ExportCtl::ExportParams::saveSettings( QSettings &S ) const
 /* ---------------------------------------------------------------- */
 
 ExportCtl::ExportCtl( QWidget *parent )
-    :   QObject(parent)
+    :   QObject(parent), eng(0), prgDlg(0)
 {
     dlg = new QDialog( parent );
 
@@ -128,6 +129,8 @@ ExportCtl::ExportCtl( QWidget *parent )
 
 ExportCtl::~ExportCtl()
 {
+    exportCleanup();
+
     if( expUI ) {
         delete expUI;
         expUI = 0;
@@ -179,6 +182,16 @@ void ExportCtl::initTimeRange( qint64 selFrom, qint64 selTo )
 
 bool ExportCtl::showExportDlg( FileViewerWindow *fvw )
 {
+    if( eng ) {
+
+        QMessageBox::information(
+            fvw,
+            "Export In Progress",
+            "Wait for the current export to finish,"
+            " or abort it, before starting another." );
+        return false;
+    }
+
     this->fvw = fvw;
 
     ExportParams    Esave = E;
@@ -640,184 +653,111 @@ bool ExportCtl::validateSettings()
 
 void ExportCtl::doExport()
 {
-    qint64  nscans  = E.scnTo - E.scnFrom,
-            step    = qMin( 1000LL, nscans );
+    ExportJob   J;
 
-    QProgressDialog progress(
-        QString("Exporting %1 scans...").arg( nscans ),
-        "Abort", 0, 100, dlg );
+    J.inFile    = df->binFileName();
+    J.outFile   = E.filename;
+    J.subtype   = df->subtypeFromObj();
+    J.grfBits   = E.grfBits;
+    J.scnFrom   = E.scnFrom;
+    J.scnTo     = E.scnTo;
+    J.ip        = df->probeNum();
+    J.asText    = E.fmtR != ExportParams::bin;
 
-    progress.setWindowFlags( progress.windowFlags()
-        & ~(Qt::WindowContextHelpButtonHint
-            | Qt::WindowCloseButtonHint) );
+    if( J.asText ) {
 
-    progress.setWindowModality( Qt::WindowModal );
-    progress.setMinimumDuration( 0 );
+        double  spnV = df->vRange().span(),
+                spnU;
 
-    if( E.fmtR == ExportParams::bin ) {
+        J.minV = df->vRange().rmin;
+        J.minS = double(df->streamFromObj() == "nidq" ?
+                    SHRT_MIN :
+                    // Handle 2.0 app opens 1.0 file
+                    -qMax(df->getParam("imMaxInt").toInt(), 512));
+        spnU   = double(-2 * J.minS);
+        J.sclV = spnV / spnU;
 
-        if( !exportAsBinary( progress, nscans, step ) )
-            return;
+        fvw->getInverseGains( J.invGain, E.grfBits );
     }
-    else if( !exportAsText( progress, nscans, step ) )
-        return;
-
-    progress.setValue( 100 );
-
-    QMessageBox::information(
-        dlg,
-        "Export Complete",
-        "Export completed successfully." );
-}
 
+    prgDlg = new QProgressDialog(
+        QString("Exporting %1 scans...").arg( J.scnTo - J.scnFrom ),
+        "Abort", 0, 100, fvw );
 
-bool ExportCtl::exportAsBinary(
-    QProgressDialog &progress,
-    qint64          nscans,
-    qint64          step )
-{
-    vec_i16         scan;
-    DataFile        *out;
-    QVector<uint>   idxOtherChans;
-    int             prevPerCent = -1;
-    bool            ok = false;
-
-    if( df->subtypeFromObj() == "imec.ap" )
-        out = new DataFileIMAP( df->probeNum() );
-    else if( df->subtypeFromObj() == "imec.lf" )
-        out = new DataFileIMLF( df->probeNum() );
-    else
-        out = new DataFileNI;
-
-    Subset::bits2Vec( idxOtherChans, E.grfBits );
-
-    if( !out->openForExport( *df, E.filename, idxOtherChans ) ) {
-
-        Error() << "Could not open export file for write.";
-        goto exit;
-    }
-
-    out->setAsyncWriting( false );
-    out->setFirstSample( df->firstCt() + E.scnFrom );
+    prgDlg->setWindowFlags( prgDlg->windowFlags()
+        & ~(Qt::WindowContextHelpButtonHint
+            | Qt::WindowCloseButtonHint) );
 
-    for( qint64 i = 0; ; ) {
+    prgDlg->setWindowModality( Qt::NonModal );
+    prgDlg->setAutoReset( false );
+    prgDlg->setAutoClose( false );
+    prgDlg->setMinimumDuration( 0 );
+    prgDlg->setValue( 0 );
 
-        qint64  nread;
-        nread = df->readScans( scan, E.scnFrom + i, step, E.grfBits );
+    ConnectUI( prgDlg, SIGNAL(canceled()), this, SLOT(exportCancel()) );
 
-        if( nread <= 0 )
-            break;
+    eng = new ExportEngine( J );
 
-        i += nread;
+    ConnectUI( eng->worker, SIGNAL(progress(int,double)), this, SLOT(exportProgress(int,double)) );
+    ConnectUI( eng->worker, SIGNAL(finished(bool,QString)), this, SLOT(exportFinished(bool,QString)) );
+}
 
-        out->writeAndInvalScans( scan );
 
-        int progPerCent = int( 100 * i / nscans );
+void ExportCtl::exportProgress( int pct, double MBps )
+{
+    if( prgDlg ) {
 
-        if( progPerCent > prevPerCent )
-            progress.setValue( prevPerCent = progPerCent );
+        prgDlg->setLabelText(
+            QString("Exporting %1 scans...  %2 MB/s")
+            .arg( E.scnTo - E.scnFrom )
+            .arg( MBps, 0, 'f', 1 ) );
+        prgDlg->setValue( pct );
+    }
+}
 
-        if( progress.wasCanceled() ) {
 
-            QString f = out->binFileName(),
-                    m = out->metaFileName();
+void ExportCtl::exportFinished( bool ok, QString err )
+{
+    exportCleanup();
 
-            out->closeAndFinalize();
-            QFile::remove( f );
-            QFile::remove( m );
-            goto exit;
-        }
+    if( ok ) {
 
-        qint64  rem = nscans - i;
+        QMessageBox::information(
+            fvw,
+            "Export Complete",
+            "Export completed successfully." );
+    }
+    else if( !err.isEmpty() ) {
 
-        if( rem <= 0 )
-            break;
+        Error() << err;
 
-        if( rem < step )
-            step = rem;
+        QMessageBox::warning(
+            fvw,
+            "Export Failed",
+            err );
     }
+}
 
-    out->closeAndFinalize();
-    ok = true;
 
-exit:
-    delete out;
-    return ok;
+void ExportCtl::exportCancel()
+{
+    if( eng )
+        eng->cancel();
 }
 
 
-bool ExportCtl::exportAsText(
-    QProgressDialog &progress,
-    qint64          nscans,
-    qint64          step )
+void ExportCtl::exportCleanup()
 {
-    QFile   out( E.filename );
-
-    if( !out.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
-        Error() << "Could not open export file for write.";
-        return false;
+    if( eng ) {
+        delete eng;
+        eng = 0;
     }
 
-    QTextStream         ts( &out );
-    vec_i16             scan;
-    std::vector<double> gain;
-
-    double  minV = df->vRange().rmin,
-            spnV = df->vRange().span(),
-            minS = double(df->streamFromObj() == "nidq" ?
-                    SHRT_MIN :
-                    // Handle 2.0 app opens 1.0 file
-                    -qMax(df->getParam("imMaxInt").toInt(), 512)),
-            spnU = double(-2 * minS),
-            sclV = spnV / spnU;
-    int     nOn  = E.grfBits.count( true ),
-            prevPerCent = -1;
-
-    fvw->getInverseGains( gain, E.grfBits );
-
-    for( qint64 i = 0; ; ) {
-
-        qint64  nread;
-        nread = df->readScans( scan, E.scnFrom + i, step, E.grfBits );
-
-        if( nread <= 0 )
-            break;
-
-        i += nread;
-
-        qint16  *S = &scan[0];
-
-        for( int is = 0; is < nread; ++is ) {
-
-            ts << gain[0] * (minV + sclV * (*S++ - minS));
-
-            for( int ic = 1; ic < nOn; ++ic )
-                ts << "," << gain[ic] * (minV + sclV * (*S++ - minS));
-
-            ts << "\n";
-        }
-
-        int progPerCent = int( 100 * i / nscans );
-
-        if( progPerCent > prevPerCent )
-            progress.setValue( prevPerCent = progPerCent );
-
-        if( progress.wasCanceled() ) {
-            out.close();
-            out.remove();
-            return false;
-        }
-
-        qint64  rem = nscans - i;
-
-        if( rem <= 0 )
-            break;
-
-        if( rem < step )
-            step = rem;
+    if( prgDlg ) {
+        prgDlg->hide();
+        prgDlg->deleteLater();
+        prgDlg = 0;
     }
-
-    return true;
 }
 
 
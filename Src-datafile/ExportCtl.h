@@ -10,6 +10,7 @@ class ExportDialog;
 }
 
 class DataFile;
+class ExportEngine;
 class FileViewerWindow;
 
 class QDialog;
@@ -66,6 +67,8 @@ private:
     ExportParams        E;
     const DataFile      *df;    // one stream at a time
     FileViewerWindow    *fvw;   // to get gains
+    ExportEngine        *eng;   // background export
+    QProgressDialog     *prgDlg;
 
 public:
     ExportCtl( QWidget *parent = 0 );
@@ -84,10 +87,9 @@ public:
     void initGrfRange( const QBitArray &visBits, int curSel );
     void initTimeRange( qint64 selFrom, qint64 selTo );
 
-    // Note that fvw is not const because doExport calls
-    // dataFile.readFile which does a seek on the file,
-    // hence, alters the file state. Otherwise, exporting
-    // <IS> effectively const.
+    // Export runs in the background on a private copy of
+    // the source file; the viewer stays responsive and may
+    // even switch files. Only one export at a time.
 
     bool showExportDlg( FileViewerWindow *fvw );
 
@@ -97,6 +99,9 @@ private slots:
     void graphsChanged();
     void scansChanged();
     void okBut();
+    void exportProgress( int pct, double MBps );
+    void exportFinished( bool ok, QString err );
+    void exportCancel();
 
 private:
     QString sglFilename( const QFileInfo &fi );
@@ -105,14 +110,7 @@ private:
     void estimateFileSize();
     bool validateSettings();
     void doExport();
-    bool exportAsBinary(
-        QProgressDialog &progress,
-        qint64          nscans,
-        qint64          step );
-    bool exportAsText(
-        QProgressDialog &progress,
-        qint64          nscans,
-        qint64          step );
+    void exportCleanup();
 };
 
 #endif  // EXPORTCTL_H
@@ -0,0 +1,502 @@
+
+#include "ExportEngine.h"
+#include "Util.h"
+#include "DataFileIMAP.h"
+#include "DataFileIMLF.h"
+#include "DataFileNI.h"
+#include "Subset.h"
+
+#include <QFile>
+#include <QThread>
+
+#include <locale.h>
+#include <stdio.h>
+
+
+#define CHUNK_BYTES     (4*1024*1024)
+#define TEXT_SCANS      4096
+#define MAX_FMT_THDS    8
+
+
+/* ---------------------------------------------------------------- */
+/* ExpFmtWorker --------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+void ExpFmtWorker::run()
+{
+    ExpWorker::Chunk    C;
+    qint64              seq;
+
+    while( owner->takeRaw( seq, C ) ) {
+
+        owner->formatText( C );
+        owner->putReady( seq, C );
+    }
+
+    owner->fmtDone();
+
+    emit finished();
+}
+
+/* ---------------------------------------------------------------- */
+/* ExpWrtWorker --------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+void ExpWrtWorker::run()
+{
+    ExpWorker::Chunk    C;
+
+    for( qint64 seq = 0; owner->takeReady( seq, C ); ++seq ) {
+
+        qint64  nB;
+        bool    ok;
+
+        if( owner->J.asText ) {
+            nB = C.text.size();
+            ok = (nB == owner->outTxt->write( C.text ));
+        }
+        else {
+            nB = C.data.size() * sizeof(qint16);
+            ok = owner->outBin->writeAndInvalScans( C.data );
+        }
+
+        owner->wrtDone( C.nScans, nB, ok );
+
+        if( !ok )
+            break;
+    }
+
+    emit finished();
+}
+
+/* ---------------------------------------------------------------- */
+/* ExpWorker ------------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+ExpWorker::ExpWorker( const ExportJob &J )
+    :   QObject(0), J(J), in(0), outBin(0), outTxt(0),
+        nRead(0), nWritten(0), bytesWritten(0),
+        tStart(0), tLastRpt(0), pctRpt(-1),
+        inFlight(0), maxInFlight(4), nFmtLive(0),
+        readDone(false), _cancel(false)
+{
+}
+
+
+ExpWorker::~ExpWorker()
+{
+    if( in )
+        delete in;
+
+    if( outBin )
+        delete outBin;
+
+    if( outTxt )
+        delete outTxt;
+}
+
+
+void ExpWorker::cancel()
+{
+    QMutexLocker    ml( &pipeMtx );
+
+    _cancel = true;
+
+    condRaw.wakeAll();
+    condReady.wakeAll();
+    condRoom.wakeAll();
+}
+
+
+void ExpWorker::run()
+{
+    std::vector<QThread*>   vT;
+    std::vector<QObject*>   vW;
+    qint64                  nTot    = J.scnTo - J.scnFrom,
+                            chunk;
+    int                     nOn     = J.grfBits.count( true ),
+                            nFmt    = 0;
+    bool                    ok      = false;
+
+    if( !openFiles() )
+        goto exit;
+
+// ---------------
+// Start consumers
+// ---------------
+
+    if( J.asText ) {
+        nFmt    = qBound( 1, QThread::idealThreadCount() - 1, MAX_FMT_THDS );
+        chunk   = TEXT_SCANS;
+    }
+    else
+        chunk = qMax( 1000, CHUNK_BYTES / int(sizeof(qint16) * qMax( nOn, 1 )) );
+
+    maxInFlight = 2 * nFmt + 4;
+    nFmtLive    = nFmt;
+    tStart      = getTime();
+    tLastRpt    = tStart;
+
+    for( int it = 0; it <= nFmt; ++it ) {
+
+        QThread *T = new QThread;
+        QObject *W;
+
+        if( it < nFmt )
+            W = new ExpFmtWorker( this );
+        else
+            W = new ExpWrtWorker( this );
+
+        W->moveToThread( T );
+
+        Connect( T, SIGNAL(started()), W, SLOT(run()) );
+        Connect( W, SIGNAL(finished()), T, SLOT(quit()), Qt::DirectConnection );
+
+        T->start();
+
+        vT.push_back( T );
+        vW.push_back( W );
+    }
+
+// ----
+// Read
+// ----
+
+    for( qint64 seq = 0; nRead < nTot; ++seq ) {
+
+        pipeMtx.lock();
+        while( inFlight >= maxInFlight && !_cancel )
+            condRoom.wait( &pipeMtx );
+        bool    stop = _cancel;
+        pipeMtx.unlock();
+
+        if( stop )
+            break;
+
+        Chunk   C;
+
+        C.nScans = in->readScans(
+                    C.data, J.scnFrom + nRead,
+                    qMin( chunk, nTot - nRead ), J.grfBits );
+
+        if( C.nScans <= 0 ) {
+
+            QMutexLocker    ml( &pipeMtx );
+
+            err = QString("Export read failed at scan %1.")
+                    .arg( J.scnFrom + nRead );
+            break;
+        }
+
+        nRead += C.nScans;
+
+        QMutexLocker    ml( &pipeMtx );
+
+        ++inFlight;
+
+        if( J.asText ) {
+            raw[seq].data.swap( C.data );
+            raw[seq].nScans = C.nScans;
+            condRaw.wakeOne();
+        }
+        else {
+            ready[seq].data.swap( C.data );
+            ready[seq].nScans = C.nScans;
+            condReady.wakeAll();
+        }
+    }
+
+    pipeMtx.lock();
+    readDone = true;
+    condRaw.wakeAll();
+    condReady.wakeAll();
+    pipeMtx.unlock();
+
+// ----
+// Join
+// ----
+
+    for( int it = 0, nt = vT.size(); it < nt; ++it ) {
+
+        vT[it]->wait();
+        delete vT[it];
+        delete vW[it];
+    }
+
+    ok = !isCanceled() && err.isEmpty() && nWritten == nTot;
+
+exit:
+    closeFiles( ok );
+
+    if( ok )
+        emit progress( 100, bytesWritten / (1e6 * qMax( getTime() - tStart, 1e-3 )) );
+
+    emit finished( ok, err );
+}
+
+
+DataFile *ExpWorker::newDataFile() const
+{
+    if( J.subtype == "imec.ap" )
+        return new DataFileIMAP( J.ip );
+    else if( J.subtype == "imec.lf" )
+        return new DataFileIMLF( J.ip );
+
+    return new DataFileNI;
+}
+
+
+// The source is opened privately so that the viewer's
+// own DataFile (and its file position) are untouched.
+//
+bool ExpWorker::openFiles()
+{
+    in = newDataFile();
+
+    if( !in->openForRead( J.inFile, err ) )
+        return false;
+
+    if( J.asText ) {
+
+        outTxt = new QFile( J.outFile );
+
+        if( !outTxt->open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+            err = "Could not open export file for write.";
+            return false;
+        }
+    }
+    else {
+
+        QVector<uint>   idxOtherChans;
+
+        Subset::bits2Vec( idxOtherChans, J.grfBits );
+
+        outBin = newDataFile();
+
+        if( !outBin->openForExport( *in, J.outFile, idxOtherChans ) ) {
+            err = "Could not open export file for write.";
+            return false;
+        }
+
+        outBin->setAsyncWriting( false );
+        outBin->setFirstSample( in->firstCt() + J.scnFrom );
+    }
+
+    return true;
+}
+
+
+// On failure or cancel, partial outputs are removed.
+//
+void ExpWorker::closeFiles( bool ok )
+{
+    if( outBin && outBin->isOpen() ) {
+
+        QString f = outBin->binFileName(),
+                m = outBin->metaFileName();
+
+        outBin->closeAndFinalize();
+
+        if( !ok ) {
+            QFile::remove( f );
+            QFile::remove( m );
+        }
+    }
+
+    if( outTxt && outTxt->isOpen() ) {
+
+        outTxt->close();
+
+        if( !ok )
+            outTxt->remove();
+    }
+}
+
+
+bool ExpWorker::takeRaw( qint64 &seq, Chunk &C )
+{
+    QMutexLocker    ml( &pipeMtx );
+
+    while( raw.empty() && !readDone && !_cancel )
+        condRaw.wait( &pipeMtx );
+
+    if( _cancel || raw.empty() )
+        return false;
+
+    std::map<qint64,Chunk>::iterator    it = raw.begin();
+
+    seq         = it->first;
+    C.nScans    = it->second.nScans;
+    C.data.swap( it->second.data );
+    raw.erase( it );
+
+    return true;
+}
+
+
+void ExpWorker::putReady( qint64 seq, Chunk &C )
+{
+    QMutexLocker    ml( &pipeMtx );
+
+    Chunk   &R = ready[seq];
+
+    R.nScans = C.nScans;
+    R.text.swap( C.text );
+    condReady.wakeAll();
+}
+
+
+void ExpWorker::fmtDone()
+{
+    QMutexLocker    ml( &pipeMtx );
+
+    --nFmtLive;
+    condReady.wakeAll();
+}
+
+
+// Return false when no chunk (seq) will ever arrive.
+//
+bool ExpWorker::takeReady( qint64 seq, Chunk &C )
+{
+    QMutexLocker    ml( &pipeMtx );
+
+    std::map<qint64,Chunk>::iterator    it;
+
+    while( (it = ready.find( seq )) == ready.end() ) {
+
+        if( _cancel || (readDone && !nFmtLive && raw.empty()) )
+            return false;
+
+        condReady.wait( &pipeMtx );
+    }
+
+    C.nScans = it->second.nScans;
+    C.data.swap( it->second.data );
+    C.text.swap( it->second.text );
+    ready.erase( it );
+
+    return true;
+}
+
+
+void ExpWorker::wrtDone( qint64 nScans, qint64 nBytes, bool ok )
+{
+    int     pct;
+    double  t = getTime(),
+            MBps;
+    bool    rpt;
+
+    {
+        QMutexLocker    ml( &pipeMtx );
+
+        if( !ok ) {
+            err     = "Export write failed (disk full?).";
+            _cancel = true;
+            condRaw.wakeAll();
+            condReady.wakeAll();
+        }
+
+        --inFlight;
+        nWritten     += nScans;
+        bytesWritten += nBytes;
+        condRoom.wakeAll();
+
+        pct     = 100 * nWritten / qMax( J.scnTo - J.scnFrom, qint64(1) );
+        MBps    = bytesWritten / (1e6 * qMax( t - tStart, 1e-3 ));
+        rpt     = pct > pctRpt || t - tLastRpt >= 0.5;
+
+        if( rpt ) {
+            pctRpt      = pct;
+            tLastRpt    = t;
+        }
+    }
+
+    if( rpt && pct < 100 )
+        emit progress( pct, MBps );
+}
+
+
+// Same values and "%g" rendering as QTextStream defaults.
+//
+// snprintf follows the C runtime's LC_NUMERIC, which Qt sets
+// from the environment on Unix, so a locale decimal comma
+// ("1,5") would corrupt the CSV. Output is kept in the C
+// locale by swapping the locale's decimal point for '.'.
+//
+void ExpWorker::formatText( Chunk &C ) const
+{
+    const double    *G      = &J.invGain[0];
+    const qint16    *S      = &C.data[0];
+    int             nOn     = J.invGain.size();
+    char            buf[32],
+                    dp      = *localeconv()->decimal_point;
+
+    C.text.clear();
+    C.text.reserve( C.nScans * nOn * 10 );
+
+    for( qint64 is = 0; is < C.nScans; ++is ) {
+
+        for( int ic = 0; ic < nOn; ++ic ) {
+
+            int n = snprintf(
+                        buf, sizeof(buf), "%g",
+                        G[ic] * (J.minV + J.sclV * (*S++ - J.minS)) );
+
+            if( dp != '.' ) {
+
+                for( int i = 0; i < n; ++i ) {
+
+                    if( buf[i] == dp ) {
+                        buf[i] = '.';
+                        break;
+                    }
+                }
+            }
+
+            if( ic )
+                C.text.append( ',' );
+
+            C.text.append( buf, n );
+        }
+
+        C.text.append( '\n' );
+    }
+
+    vec_i16().swap( C.data );
+}
+
+/* ---------------------------------------------------------------- */
+/* ExportEngine --------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+ExportEngine::ExportEngine( const ExportJob &J )
+{
+    thread  = new QThread;
+    worker  = new ExpWorker( J );
+
+    worker->moveToThread( thread );
+
+    Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
+    Connect( worker, SIGNAL(finished(bool,QString)), thread, SLOT(quit()), Qt::DirectConnection );
+
+    thread->start();
+}
+
+
+// Unlike GraphFetcher, the worker is not auto-deleted:
+// the owner may cancel it after it has finished.
+//
+ExportEngine::~ExportEngine()
+{
+    if( thread->isRunning() ) {
+
+        worker->cancel();
+        thread->wait();
+    }
+
+    delete thread;
+    delete worker;
+}
+
+
@@ -0,0 +1,173 @@
+#ifndef EXPORTENGINE_H
+#define EXPORTENGINE_H
+
+#include "SGLTypes.h"
+
+#include <QBitArray>
+#include <QMutex>
+#include <QObject>
+#include <QWaitCondition>
+
+#include <map>
+
+class DataFile;
+class QFile;
+class QThread;
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Everything the engine needs, copied from the dialog so
+// the viewer can change files or settings mid-export.
+//
+struct ExportJob {
+    QString             inFile,     // source bin
+                        outFile,
+                        subtype;    // {"imec.ap", "imec.lf", "nidq"}
+    QBitArray           grfBits;    // saved channels to export
+    std::vector<double> invGain;    // per exported channel (text)
+    qint64              scnFrom,
+                        scnTo;
+    double              minV,       // text scaling
+                        sclV,
+                        minS;
+    int                 ip;
+    bool                asText;
+
+    ExportJob()
+    :   scnFrom(0), scnTo(0), minV(0), sclV(0), minS(0),
+        ip(0), asText(false)    {}
+};
+
+
+// Pipeline:
+// - Reader (ExpWorker::run) pulls chunks from a private
+//   DataFile instance and applies the channel subset.
+// - Formatters (text only) convert chunks to CSV in parallel.
+// - Writer commits finished chunks in sequence order.
+//
+// At most maxInFlight chunks exist at once, which bounds memory
+// and lets the slowest stage set the pace.
+//
+class ExpWorker : public QObject
+{
+    Q_OBJECT
+
+    friend class ExpFmtWorker;
+    friend class ExpWrtWorker;
+
+private:
+    struct Chunk {
+        vec_i16     data;
+        QByteArray  text;
+        qint64      nScans;
+    };
+
+private:
+    const ExportJob         J;
+    DataFile                *in,
+                            *outBin;
+    QFile                   *outTxt;
+    std::map<qint64,Chunk>  raw,        // read, awaiting format
+                            ready;      // awaiting write
+    mutable QMutex          pipeMtx;
+    QWaitCondition          condRaw,
+                            condReady,
+                            condRoom;
+    QString                 err;
+    qint64                  nRead,
+                            nWritten,   // scans
+                            bytesWritten;
+    double                  tStart,
+                            tLastRpt;
+    int                     pctRpt,
+                            inFlight,
+                            maxInFlight,
+                            nFmtLive;
+    bool                    readDone,
+                            _cancel;
+
+public:
+    ExpWorker( const ExportJob &J );
+    virtual ~ExpWorker();
+
+    void cancel();
+
+signals:
+    void progress( int pct, double MBps );
+    void finished( bool ok, QString err );
+
+public slots:
+    void run();
+
+private:
+    bool isCanceled() const {QMutexLocker ml( &pipeMtx ); return _cancel;}
+    DataFile *newDataFile() const;
+    bool openFiles();
+    void closeFiles( bool ok );
+
+    bool takeRaw( qint64 &seq, Chunk &C );
+    void putReady( qint64 seq, Chunk &C );
+    void fmtDone();
+    bool takeReady( qint64 seq, Chunk &C );
+    void wrtDone( qint64 nScans, qint64 nBytes, bool ok );
+
+    void formatText( Chunk &C ) const;
+};
+
+
+class ExpFmtWorker : public QObject
+{
+    Q_OBJECT
+
+private:
+    ExpWorker   *owner;
+
+public:
+    ExpFmtWorker( ExpWorker *owner ) : QObject(0), owner(owner)    {}
+    virtual ~ExpFmtWorker()                                         {}
+
+signals:
+    void finished();
+
+public slots:
+    void run();
+};
+
+
+class ExpWrtWorker : public QObject
+{
+    Q_OBJECT
+
+private:
+    ExpWorker   *owner;
+
+public:
+    ExpWrtWorker( ExpWorker *owner ) : QObject(0), owner(owner)    {}
+    virtual ~ExpWrtWorker()                                         {}
+
+signals:
+    void finished();
+
+public slots:
+    void run();
+};
+
+
+class ExportEngine
+{
+public:
+    QThread     *thread;
+    ExpWorker   *worker;
+
+public:
+    ExportEngine( const ExportJob &J );
+    virtual ~ExportEngine();
+
+    void cancel()   {worker->cancel();}
+};
+
+#endif  // EXPORTENGINE_H
+
+
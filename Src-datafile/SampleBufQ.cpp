@@ -1,18 +1,37 @@
 
 #include "SampleBufQ.h"
 #include "Util.h"
+#include "MXStats.h"
 
 
+#define POOL_MAXBUFS    32
+#define POOL_MAXWORDS   (64*1024*1024)
 
 
-void SampleBufQ::enqueue( vec_i16 &src )
+static QMutex               poolMtx;
+static std::vector<vec_i16> pool;
+static quint64              poolWords   = 0;
+
+
+
+
+// mxName names this queue's depth gauge in MXStats.
+//
+SampleBufQ::SampleBufQ( int maxQSize, const QString &mxName )
+    :   mxDepth(MXStats::gauge( mxName )), maxQSize(maxQSize)
+{
+}
+
+
+void SampleBufQ::enqueue( vec_i16 &src, int trcID )
 {
     QMutexLocker    ml( &dataQMtx );
 
     if( dataQ.size() >= maxQSize )
         overflowWarning();
 
-    dataQ.push_back( SampleBuf( src ) );
+    dataQ.push_back( SampleBuf( src, trcID ) );
+    mxDepth->set( dataQ.size() );
 
 // Have an entry; wake a waiting dequeue caller
 
@@ -22,10 +41,12 @@ void SampleBufQ::enqueue( vec_i16 &src )
 
 // Returns true if data ready to be written...
 // ...if true, dst is swapped for a data buffer in the deque.
+// trcID gets the first MXTrace tag among joined buffers, or -1.
 //
-bool SampleBufQ::dequeue( vec_i16 &dst, bool wait )
+bool SampleBufQ::dequeue( vec_i16 &dst, int &trcID, bool wait )
 {
     dst.clear();
+    trcID = -1;
 
     if( !dataQMtx.tryLock( 2000 ) )
         return false;
@@ -45,6 +66,7 @@ bool SampleBufQ::dequeue( vec_i16 &dst, bool wait )
         // First, dequeue one block
 
         dst.swap( dataQ.front().data );
+        trcID = dataQ.front().trcID;
         dataQ.pop_front();
         --N;
 
@@ -70,6 +92,10 @@ bool SampleBufQ::dequeue( vec_i16 &dst, bool wait )
                     break;
                 }
 
+                if( trcID < 0 )
+                    trcID = dataQ.front().trcID;
+
+                recycle( src );
                 dataQ.pop_front();
                 --N;
             }
@@ -123,3 +149,56 @@ void SampleBufQ::overflowWarning()
 }
 
 
+// Keep buf's storage for a later reuse() if the pool has room.
+// On return buf is empty.
+//
+void SampleBufQ::recycle( vec_i16 &buf )
+{
+    quint64 cap = buf.capacity();
+
+    if( cap ) {
+
+        QMutexLocker    ml( &poolMtx );
+
+        if( pool.size() < POOL_MAXBUFS && poolWords + cap <= POOL_MAXWORDS ) {
+
+            buf.clear();
+            pool.push_back( vec_i16() );
+            pool.back().swap( buf );
+            poolWords += cap;
+            return;
+        }
+    }
+
+    vec_i16().swap( buf );
+}
+
+
+// Swap most recently recycled storage into dst, if any.
+// dst comes back empty; its old storage is dropped.
+//
+void SampleBufQ::reuse( vec_i16 &dst )
+{
+    vec_i16 old;
+
+    old.swap( dst );
+
+    QMutexLocker    ml( &poolMtx );
+
+    if( pool.size() ) {
+        dst.swap( pool.back() );
+        pool.pop_back();
+        poolWords -= dst.capacity();
+    }
+}
+
+
+void SampleBufQ::freePool()
+{
+    QMutexLocker    ml( &poolMtx );
+
+    pool.clear();
+    poolWords = 0;
+}
+
+
@@ -4,6 +4,7 @@
 #include "SGLTypes.h"
 
 #include <QMutex>
+#include <QString>
 #include <QWaitCondition>
 #include <deque>
 
@@ -11,6 +12,8 @@
 /* Types ---------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
+class MXGauge;
+
 class SampleBufQ
 {
 /* ----- */
@@ -20,7 +23,9 @@ class SampleBufQ
 private:
     struct SampleBuf {
         vec_i16 data;
-        SampleBuf( vec_i16 &src )   {data.swap( src );}
+        int     trcID;  // MXTrace tag or -1
+        SampleBuf( vec_i16 &src, int trcID )
+            :   trcID(trcID)    {data.swap( src );}
     };
 
 /* ---- */
@@ -32,6 +37,7 @@ private:
     mutable QMutex          dataQMtx;
     mutable QWaitCondition  condBufQIsEntry,
                             condBufQIsEmpty;
+    MXGauge                 *mxDepth;
     const uint              maxQSize;
 
 /* ------- */
@@ -39,7 +45,7 @@ private:
 /* ------- */
 
 public:
-    SampleBufQ( int maxQSize ) : maxQSize(maxQSize) {}
+    SampleBufQ( int maxQSize, const QString &mxName );
 
     void wake()
     {
@@ -53,10 +59,16 @@ public:
         return (100.0 * dataQ.size()) / maxQSize;
     }
 
-    void enqueue( vec_i16 &src );
-    bool dequeue( vec_i16 &dst, bool wait = false );
+    void enqueue( vec_i16 &src, int trcID = -1 );
+    bool dequeue( vec_i16 &dst, int &trcID, bool wait = false );
     bool waitForEmpty( int ms = -1 );
 
+    // Process-wide pool of written buffers, so producers
+    // can refill existing capacity instead of allocating.
+    static void recycle( vec_i16 &buf );
+    static void reuse( vec_i16 &dst );
+    static void freePool();
+
 protected:
     virtual void overflowWarning();
 };
@@ -5,8 +5,12 @@ HEADERS += \
     $$PWD/DataFileIMAP.h \
     $$PWD/DataFileIMLF.h \
     $$PWD/DataFileNI.h \
+    $$PWD/DFCompress.h \
+    $$PWD/DFJournal.h \
     $$PWD/DFName.h \
+    $$PWD/DFPlacer.h \
     $$PWD/ExportCtl.h \
+    $$PWD/ExportEngine.h \
     $$PWD/SampleBufQ.h
 
 SOURCES += \
@@ -15,8 +19,12 @@ SOURCES += \
     $$PWD/DataFileIMAP.cpp \
     $$PWD/DataFileIMLF.cpp \
     $$PWD/DataFileNI.cpp \
+    $$PWD/DFCompress.cpp \
+    $$PWD/DFJournal.cpp \
     $$PWD/DFName.cpp \
+    $$PWD/DFPlacer.cpp \
     $$PWD/ExportCtl.cpp \
+    $$PWD/ExportEngine.cpp \
     $$PWD/SampleBufQ.cpp
 
 
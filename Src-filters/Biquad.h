@@ -152,6 +152,11 @@ public:
 
     void clearMem()  {vz1.clear(); vz2.clear();}
 
+    // Coeffs {a0, a1, a2, b1, b2}, for callers running their
+    // own (e.g. fused) loop.
+    void getCoeffs( double *c ) const
+        {c[0] = a0; c[1] = a1; c[2] = a2; c[3] = b1; c[4] = b2;}
+
     // Apply filter in-place to (ntpts) worth of data, starting at
     // address (data). (nchans) includes (neural + aux) channels,
     // so is the array stride between timepoints. Filter will only
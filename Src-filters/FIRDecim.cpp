@@ -0,0 +1,271 @@
+
+#include "FIRDecim.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define FIRD_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI    3.14159265358979323846
+#endif
+
+
+#define TAPS_PER_M  8       // half-width in units of dnsmp
+#define CORNER      0.4     // x output rate
+#define CHUNK       4096    // one-shot feed size (timepoints)
+
+
+/* ---------------------------------------------------------------- */
+/* FIRDecim ------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+void FIRDecim::init( int nchans, int nanalog, int dnsmp )
+{
+    nC  = qMax( nchans, 1 );
+    nA  = qBound( 0, nanalog, nC );
+    M   = qMax( dnsmp, 1 );
+    D   = (M > 1 ? TAPS_PER_M * M : 0);
+
+// Hamming-windowed sinc, unity DC gain.
+
+    double  fc  = CORNER / M,
+            sum = 0;
+
+    h.resize( 2*D + 1 );
+
+    for( int k = -D; k <= D; ++k ) {
+
+        double  v = (k ? sin( 2*M_PI*fc*k ) / (M_PI*k) : 2*fc);
+
+        if( D )
+            v *= 0.54 + 0.46 * cos( M_PI*k / D );
+
+        h[k + D]    = v;
+        sum        += v;
+    }
+
+    for( int k = 0, n = h.size(); k < n; ++k )
+        h[k] /= sum;
+
+    acc.resize( (nA + 3) & ~3 );
+
+    reset();
+}
+
+
+// Decimate next block of ntpts timepoints starting at fromCt.
+//
+// dst receives the outputs released by this call, and dstCt
+// is the input ct on which dst[0] is centered.
+//
+// Return output count.
+//
+uint FIRDecim::feed(
+    vec_i16         &dst,
+    quint64         &dstCt,
+    const qint16    *src,
+    int             ntpts,
+    quint64         fromCt )
+{
+    dst.clear();
+    dstCt = fromCt;
+
+    if( ntpts <= 0 )
+        return 0;
+
+    if( M == 1 ) {
+        dst.assign( src, src + ntpts * nC );
+        return ntpts;
+    }
+
+    if( primed && qint64(fromCt) != inCt )
+        reset();
+
+    if( !primed ) {
+        histCt  = qint64(fromCt) - D;
+        outCt   = fromCt;
+        primed  = true;
+        appendRaw( src, 1 );
+        appendRep( D - 1 );
+    }
+
+    appendRaw( src, ntpts );
+    inCt = qint64(fromCt) + ntpts;
+
+    dstCt = outCt;
+    return produce( dst, inCt );
+}
+
+
+// Release the outputs still awaiting lookahead by extending
+// the last input, then restart the stream.
+//
+uint FIRDecim::flush( vec_i16 &dst, quint64 &dstCt )
+{
+    dst.clear();
+    dstCt = (primed ? outCt : 0);
+
+    if( !primed || M == 1 )
+        return 0;
+
+    appendRep( D );
+
+    uint    n = produce( dst, inCt + D );
+
+    reset();
+    return n;
+}
+
+
+// One-shot: decimate whole src; dst may be src.
+// Yields ceil(ntpts/dnsmp) outputs, the first
+// centered on src timepoint zero.
+//
+uint FIRDecim::decimate(
+    vec_i16         &dst,
+    vec_i16         &src,
+    int             nchans,
+    int             nanalog,
+    int             dnsmp )
+{
+    int ntpts = (nchans > 0 ? int(src.size()) / nchans : 0);
+
+    if( dnsmp <= 1 || ntpts <= 0 ) {
+
+        if( &dst != &src )
+            dst = src;
+
+        return qMax( ntpts, 0 );
+    }
+
+    FIRDecim    F;
+    vec_i16     out, part;
+    quint64     ct;
+
+    F.init( nchans, nanalog, dnsmp );
+    out.reserve( ((ntpts + dnsmp - 1) / dnsmp) * nchans );
+
+    for( int t = 0; t < ntpts; t += CHUNK ) {
+
+        F.feed( part, ct, &src[t*nchans], qMin( CHUNK, ntpts - t ), t );
+        out.insert( out.end(), part.begin(), part.end() );
+    }
+
+    F.flush( part, ct );
+    out.insert( out.end(), part.begin(), part.end() );
+
+    dst.swap( out );
+    return dst.size() / nchans;
+}
+
+
+void FIRDecim::appendRaw( const qint16 *src, int nrows )
+{
+    int     n0  = hist.size(),
+            n   = nrows * nC;
+
+    hist.resize( n0 + n );
+
+    float   *d = &hist[n0];
+
+    for( int i = 0; i < n; ++i )
+        d[i] = src[i];
+}
+
+
+// Replicate last row nrows times.
+//
+void FIRDecim::appendRep( int nrows )
+{
+    if( nrows <= 0 || hist.empty() )
+        return;
+
+    int n0 = hist.size();
+
+    hist.resize( n0 + nrows * nC );
+
+    const float *last = &hist[n0 - nC];
+
+    for( int r = 0; r < nrows; ++r )
+        memcpy( &hist[n0 + r*nC], last, nC * sizeof(float) );
+}
+
+
+// Emit every output whose window ends before limCt,
+// then drop history no later output needs.
+//
+uint FIRDecim::produce( vec_i16 &dst, qint64 limCt )
+{
+    uint    n = 0;
+
+    for( ; outCt + D < limCt; outCt += M, ++n ) {
+
+        int n0 = dst.size();
+
+        dst.resize( n0 + nC );
+        filterRow( &dst[n0], &hist[(outCt - histCt) * nC] );
+    }
+
+    qint64  drop = outCt - D - histCt;
+
+    if( drop > 0 ) {
+        hist.erase( hist.begin(), hist.begin() + drop * nC );
+        histCt += drop;
+    }
+
+    return n;
+}
+
+
+// Symmetric taps: fold mirrored rows, then one multiply.
+//
+void FIRDecim::filterRow( qint16 *dst, const float *center )
+{
+    float   *A  = (nA ? &acc[0] : 0);
+    int     c;
+
+    for( c = 0; c < nA; ++c )
+        A[c] = h[D] * center[c];
+
+    for( int k = 1; k <= D; ++k ) {
+
+        const float *L = center - k*nC,
+                    *R = center + k*nC;
+        float       w  = h[D + k];
+
+        c = 0;
+
+#ifdef FIRD_SSE2
+        __m128  W = _mm_set1_ps( w );
+
+        for( ; c + 4 <= nA; c += 4 ) {
+
+            __m128  s = _mm_add_ps( _mm_loadu_ps( L + c ), _mm_loadu_ps( R + c ) );
+
+            _mm_storeu_ps( A + c,
+                _mm_add_ps( _mm_loadu_ps( A + c ), _mm_mul_ps( s, W ) ) );
+        }
+#endif
+
+        for( ; c < nA; ++c )
+            A[c] += w * (L[c] + R[c]);
+    }
+
+    for( c = 0; c < nA; ++c ) {
+
+        float   v = floorf( A[c] + 0.5f );
+
+        dst[c] = (qint16)qBound( -32768.0f, v, 32767.0f );
+    }
+
+// Sync and digital words are picked
+
+    for( ; c < nC; ++c )
+        dst[c] = (qint16)center[c];
+}
+
+
@@ -0,0 +1,79 @@
+#ifndef FIRDECIM_H
+#define FIRDECIM_H
+
+#include "SGLTypes.h"
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Anti-aliased decimation of interleaved int16 timepoints.
+//
+// Channels [0,nanalog) pass through a linear-phase lowpass FIR
+// (Hamming-windowed sinc, corner 0.4 x output rate, 16*dnsmp+1
+// taps) evaluated only at the kept (polyphase) output points.
+// Remaining channels (sync, digital words) are picked, never
+// averaged. Output k is centered on input (fromCt + k*dnsmp),
+// so timing matches plain every-Nth decimation.
+//
+// Streaming: feed() keeps the last taps worth of input per
+// channel, so contiguous blocks decimate seamlessly. An output
+// is released once its lookahead half-window has arrived, so
+// feed() lags input by 8*dnsmp timepoints. A gap or rewind in
+// fromCt restarts the stream. Stream ends are edge-extended.
+//
+class FIRDecim
+{
+private:
+    std::vector<float>  h,          // taps
+                        hist,       // input rows, nC floats each
+                        acc;
+    qint64              histCt,     // ct of hist row 0
+                        inCt,       // next expected input ct
+                        outCt;      // center of next output
+    int                 nC,
+                        nA,
+                        M,
+                        D;          // half-width
+    bool                primed;
+
+public:
+    FIRDecim() : nC(0), nA(0), M(1), D(0), primed(false)    {}
+
+    void init( int nchans, int nanalog, int dnsmp );
+    void reset()    {hist.clear(); primed = false;}
+
+    int nChans() const  {return nC;}
+    int nAnalog() const {return nA;}
+    int dnsmp() const   {return M;}
+
+    // Input timepoints fed but not yet covered by an output
+    // (lost if the stream restarts).
+    qint64 pendingScans() const
+        {return (primed && M > 1 ? qMax( inCt - outCt, qint64(0) ) : 0);}
+
+    uint feed(
+        vec_i16         &dst,
+        quint64         &dstCt,
+        const qint16    *src,
+        int             ntpts,
+        quint64         fromCt );
+    uint flush( vec_i16 &dst, quint64 &dstCt );
+
+    static uint decimate(
+        vec_i16         &dst,
+        vec_i16         &src,
+        int             nchans,
+        int             nanalog,
+        int             dnsmp );
+
+private:
+    void appendRaw( const qint16 *src, int nrows );
+    void appendRep( int nrows );
+    uint produce( vec_i16 &dst, qint64 limCt );
+    void filterRow( qint16 *dst, const float *center );
+};
+
+#endif  // FIRDECIM_H
+
+
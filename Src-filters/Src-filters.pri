@@ -1,8 +1,10 @@
 
 HEADERS += \
-    $$PWD/Biquad.h
+    $$PWD/Biquad.h \
+    $$PWD/FIRDecim.h
 
 SOURCES += \
-    $$PWD/Biquad.cpp
+    $$PWD/Biquad.cpp \
+    $$PWD/FIRDecim.cpp
 
 
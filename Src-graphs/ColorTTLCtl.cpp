@@ -9,6 +9,7 @@
 #include "HelpButDialog.h"
 #include "SignalBlocker.h"
 #include "Subset.h"
+#include "TTLEvents.h"
 
 #include <QMessageBox>
 #include <QSettings>
@@ -534,7 +535,8 @@ void ColorTTLCtl::saveSettings() const
 
 void ColorTTLCtl::resetState()
 {
-    memset( state, 0, 4*sizeof(int) );
+    for( int i = 0; i < 4; ++i )
+        lastOn[i] = UNSET64;
 }
 
 
@@ -598,243 +600,13 @@ bool ColorTTLCtl::getChan(
 }
 
 
-bool ColorTTLCtl::findRisingEdge(
-    int         &outCt,
-    const short *data,
-    int         ntpts,
-    int         offset,
-    int         nchans,
-    int         chan,
-    qint16      T ) const
-{
-    const short *d      = &data[chan + offset*nchans],
-                *dlim   = &data[chan +  ntpts*nchans];
-    int         nok     = 0;
-
-// -------------------
-// Must start on a low
-// -------------------
-
-    if( *d >= T ) {
-
-        while( (d += nchans) < dlim ) {
-
-            if( *d < T )
-                goto seek_edge;
-        }
-
-        return false;
-    }
-
-// -------------------
-// Seek edge candidate
-// -------------------
-
-seek_edge:
-    while( (d += nchans) < dlim ) {
-
-        if( *d >= T ) {
-
-            // Mark edge start
-            outCt   = (d - &data[chan]) / nchans;
-            nok     = 1;
-
-            if( set.inarow == 1 )
-                return true;
-
-            // Check extended run length
-            while( (d += nchans) < dlim ) {
-
-                if( *d >= T ) {
-
-                    if( ++nok >= set.inarow )
-                        return true;
-                }
-                else
-                    break;
-            }
-        }
-    }
-
-// ----
-// Fail
-// ----
-
-    return false;
-}
-
-
-bool ColorTTLCtl::findBitRisingEdge(
-    int         &outCt,
-    const short *data,
-    int         ntpts,
-    int         offset,
-    int         nchans,
-    int         chan,
-    int         bit ) const
-{
-    const short *d      = &data[chan + offset*nchans],
-                *dlim   = &data[chan +  ntpts*nchans];
-    int         nok     = 0;
-
-// -------------------
-// Must start on a low
-// -------------------
-
-    if( (*d >> bit) & 1 ) {
-
-        while( (d += nchans) < dlim ) {
-
-            if( !((*d >> bit) & 1))
-                goto seek_edge;
-        }
-
-        return false;
-    }
-
-// -------------------
-// Seek edge candidate
-// -------------------
-
-seek_edge:
-    while( (d += nchans) < dlim ) {
-
-        if( (*d >> bit) & 1 ) {
-
-            // Mark edge start
-            outCt   = (d - &data[chan]) / nchans;
-            nok     = 1;
-
-            if( set.inarow == 1 )
-                return true;
-
-            // Check extended run length
-            while( (d += nchans) < dlim ) {
-
-                if( (*d >> bit) & 1 ) {
-
-                    if( ++nok >= set.inarow )
-                        return true;
-                }
-                else
-                    break;
-            }
-        }
-    }
-
-// ----
-// Fail
-// ----
-
-    return false;
-}
-
-
-bool ColorTTLCtl::findFallingEdge(
-    int         &outCt,
-    const short *data,
-    int         ntpts,
-    int         offset,
-    int         nchans,
-    int         chan,
-    qint16      T ) const
-{
-    const short *d      = &data[chan + offset*nchans],
-                *dlim   = &data[chan +  ntpts*nchans];
-    int         nok     = 0;
-
-// -------------------
-// Seek edge candidate
-// -------------------
-
-    while( (d += nchans) < dlim ) {
-
-        if( *d < T ) {
-
-            // Mark edge start
-            outCt   = (d - &data[chan]) / nchans;
-            nok     = 1;
-
-            if( set.inarow == 1 )
-                return true;
-
-            // Check extended run length
-            while( (d += nchans) < dlim ) {
-
-                if( *d < T ) {
-
-                    if( ++nok >= set.inarow )
-                        return true;
-                }
-                else
-                    break;
-            }
-        }
-    }
-
-// ----
-// Fail
-// ----
-
-    return false;
-}
-
-
-bool ColorTTLCtl::findBitFallingEdge(
-    int         &outCt,
-    const short *data,
-    int         ntpts,
-    int         offset,
-    int         nchans,
-    int         chan,
-    int         bit ) const
-{
-    const short *d      = &data[chan + offset*nchans],
-                *dlim   = &data[chan +  ntpts*nchans];
-    int         nok     = 0;
-
-// -------------------
-// Seek edge candidate
-// -------------------
-
-    while( (d += nchans) < dlim ) {
-
-        if( !((*d >> bit) & 1) ) {
-
-            // Mark edge start
-            outCt   = (d - &data[chan]) / nchans;
-            nok     = 1;
-
-            if( set.inarow == 1 )
-                return true;
-
-            // Check extended run length
-            while( (d += nchans) < dlim ) {
-
-                if( !((*d >> bit) & 1) ) {
-
-                    if( ++nok >= set.inarow )
-                        return true;
-                }
-                else
-                    break;
-            }
-        }
-    }
-
-// ----
-// Fail
-// ----
-
-    return false;
-}
-
-
 #define DST_TREL( ct )  (syncDstTAbs( ct, src, dst, p ) - dst->Q->tZero())
 
 
-// On each call whole data block is scanned.
-// The state[] variables bridge action across blocks.
+// Pulses come from the run's shared lists (TTLEvents), which
+// scan each sample once however many windows show the stream.
+// Here we only paint: a span per new pulse, extended each block
+// to the pulse's falling edge or the end of the block.
 //
 void ColorTTLCtl::processEvents(
     const vec_i16       &data,
@@ -859,74 +631,50 @@ void ColorTTLCtl::processEvents(
             dst = &A;
     }
 
+    std::vector<TTLEvt> vE;
+    quint64             endCt = headCt + ntpts;
+
     for( int i = 0, ni = vClr.size(); i < ni; ++i ) {
 
-        int     clr     = vClr[i],
-                nextCt  = 0,
+        int     clr = vClr[i],
                 chan, bit, thresh;
-        bool    isAnalog,
-                found;
+        bool    isAnalog;
 
         isAnalog = getChan( chan, bit, thresh, clr, ip );
 
-        while( nextCt < ntpts ) {
+        TTLEvtList  *L = TTLEvents::get(
+                            ip, chan, (isAnalog ? -1 : bit),
+                            thresh, set.inarow );
 
-            if( !state[clr] ) {
+        L->update( data, headCt, nC );
 
-                // Low, seeking high
+        for( int ie = 0, ne = L->query( vE, headCt, endCt ); ie < ne; ++ie ) {
 
-                if( isAnalog ) {
-                    found = findRisingEdge(
-                                nextCt, &data[0], ntpts,
-                                nextCt, nC, chan, thresh );
-                }
-                else {
-                    found = findBitRisingEdge(
-                                nextCt, &data[0], ntpts,
-                                nextCt, nC, chan, bit );
-                }
+            const TTLEvt    &E = vE[ie];
+
+            if( lastOn[clr] == (quint64)UNSET64 || E.on > lastOn[clr] ) {
 
-                if( found ) {
+                double  start = E.on / src->Q->sRate();
 
-                    quint64 ct      = headCt + nextCt;
-                    double  start   = ct / src->Q->sRate();
+                lastOn[clr] = E.on;
 
-                    state[clr]  = 1;
-                    nextCt     += set.inarow;
+                src->X->spanMtx.lock();
+                src->X->evQ[clr].push_back(
+                    EvtSpan( start, start + set.minSecs ) );
+                src->X->spanMtx.unlock();
 
-                    src->X->spanMtx.lock();
-                    src->X->evQ[clr].push_back(
+                if( dst ) {
+                    start = DST_TREL( E.on );
+                    dst->X->spanMtx.lock();
+                    dst->X->evQ[clr].push_back(
                         EvtSpan( start, start + set.minSecs ) );
-                    src->X->spanMtx.unlock();
-
-                    if( dst ) {
-                        start = DST_TREL( ct );
-                        dst->X->spanMtx.lock();
-                        dst->X->evQ[clr].push_back(
-                            EvtSpan( start, start + set.minSecs ) );
-                        dst->X->spanMtx.unlock();
-                    }
+                    dst->X->spanMtx.unlock();
                 }
-                else
-                    goto next_clr;
-            }
-
-            // high, seeking low
-
-            if( isAnalog ) {
-                found = findFallingEdge(
-                            nextCt, &data[0], ntpts,
-                            nextCt, nC, chan, thresh );
-            }
-            else {
-                found = findBitFallingEdge(
-                            nextCt, &data[0], ntpts,
-                            nextCt, nC, chan, bit );
             }
 
             // always update painting
 
-            quint64 ct  = headCt + (found ? nextCt : ntpts-1);
+            quint64 ct  = (E.off < endCt ? E.off : endCt - 1);
             double  end = ct / src->Q->sRate();
 
             src->X->spanMtx.lock();
@@ -939,15 +687,7 @@ void ColorTTLCtl::processEvents(
                 dst->X->evQExtendLast( end, set.minSecs, clr );
                 dst->X->spanMtx.unlock();
             }
-
-            if( found ) {
-                nextCt     += set.inarow;
-                state[clr]  = 0;
-            }
-            else
-                goto next_clr;
         }
-next_clr:;
     }
 }
 
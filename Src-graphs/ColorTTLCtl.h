@@ -87,7 +87,7 @@ private:
     TTLClrSet           set,
                         uiSet;
     mutable QMutex      setMtx;
-    int                 state[4];   // {0,1}=seek{high,low}
+    quint64             lastOn[4];  // newest pulse painted
 
 public:
     ColorTTLCtl( QObject *parent, const DAQ::Params &p );
@@ -141,42 +141,6 @@ private:
         int     clr,
         int     ip ) const;
 
-    bool findRisingEdge(
-        int         &outCt,
-        const short *data,
-        int         ntpts,
-        int         offset,
-        int         nchans,
-        int         chan,
-        qint16      T ) const;
-
-    bool findBitRisingEdge(
-        int         &outCt,
-        const short *data,
-        int         ntpts,
-        int         offset,
-        int         nchans,
-        int         chan,
-        int         bit ) const;
-
-    bool findFallingEdge(
-        int         &outCt,
-        const short *data,
-        int         ntpts,
-        int         offset,
-        int         nchans,
-        int         chan,
-        qint16      T ) const;
-
-    bool findBitFallingEdge(
-        int         &outCt,
-        const short *data,
-        int         ntpts,
-        int         offset,
-        int         nchans,
-        int         chan,
-        int         bit ) const;
-
     void processEvents(
         const vec_i16       &data,
         quint64             headCt,
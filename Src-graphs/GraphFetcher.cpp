@@ -2,6 +2,9 @@
 #include "GraphFetcher.h"
 #include "Util.h"
 #include "AIQ.h"
+#include "DAQ.h"
+#include "MXStats.h"
+#include "MXTrace.h"
 #include "SVGrafsM.h"
 
 #include <QThread>
@@ -68,6 +71,8 @@ void GFWorker::run()
 
 void GFWorker::fetch( GFStream &S )
 {
+    static MXHist   *mxGet = MXStats::hist( "graph.fetch_us" );
+
     quint64 endCt = S.aiQ->endCount();
 
 // Just wait if fetching too soon
@@ -96,6 +101,7 @@ void GFWorker::fetch( GFStream &S )
 // the drawing becomes saltatory.
 
     vec_i16 data;
+    double  t0   = getTime();
     int     nMax = 1.15 * S.setCts; // 1.15X-overfetch * loop_sec * rate
 
     try {
@@ -117,13 +123,20 @@ void GFWorker::fetch( GFStream &S )
             << " scans.";
     }
 
+    mxGet->recordSince( t0 );
+
     S.W->putScans( data, S.nextCt );
 
 // putScans() is allowed to resize the data block to make
 // downsampling smoother. The result of that tells us where
 // to fetch the next contiguous block.
 
-    S.nextCt += data.size() / S.aiQ->nChans();
+    quint64 nPut = data.size() / S.aiQ->nChans();
+
+    MXTrace::hit(
+        DAQ::Params::streamID( S.stream ), S.nextCt, nPut, "graph.put" );
+
+    S.nextCt += nPut;
 }
 
 /* ---------------------------------------------------------------- */
@@ -12,6 +12,13 @@
 #include <QAction>
 #include <QCloseEvent>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SHANK_SSE2
+#include <emmintrin.h>
+#endif
+
+#include <string.h>
+
 /* ---------------------------------------------------------------- */
 /* class Tally ---------------------------------------------------- */
 /* ---------------------------------------------------------------- */
@@ -25,6 +32,12 @@ void ShankCtl::Tally::init( double sUpdt, int ip )
     else
         nPads = p.ni.niCumTypCnt[CniCfg::niSumNeural];
 
+    zh1.assign( nPads, 0 );
+    zh2.assign( nPads, 0 );
+    zl1.assign( nPads, 0 );
+    zl2.assign( nPads, 0 );
+    T.clear();
+
     updtChanged( sUpdt );
 }
 
@@ -38,10 +51,33 @@ void ShankCtl::Tally::updtChanged( double s )
 }
 
 
+// Take coefficients; restart filter state and transient.
+//
+void ShankCtl::Tally::setFilter( const Biquad *hp, const Biquad *lp )
+{
+    hp->getCoeffs( ch );
+
+    if( (useLP = (lp != 0)) )
+        lp->getCoeffs( cl );
+
+    zh1.assign( nPads, 0 );
+    zh2.assign( nPads, 0 );
+    zl1.assign( nPads, 0 );
+    zl2.assign( nPads, 0 );
+
+    nzero = BIQUAD_TRANS_WIDE;
+}
+
+
+// Runs restart as if mid-run, so a channel already
+// below threshold isn't counted until it recovers.
+//
 void ShankCtl::Tally::zeroData()
 {
     vmin.assign( nPads,  99000 );
     vmax.assign( nPads, -99000 );
+    run.assign( nPads,  1e9 );
+    spk.assign( nPads,  0 );
     sums.assign( nPads,  0 );
     sumSamps    = 0;
     chunksDone  = 0;
@@ -53,40 +89,29 @@ bool ShankCtl::Tally::countSpikes(
     int         ntpts,
     int         nchans,
     int         c0,
-    int         cLim,
     int         thresh,
     int         inarow )
 {
     if( !ntpts )
         return false;
 
-    sumSamps += ntpts;
-
-    for( int c = c0; c < cLim; ++c ) {
-
-        const short *d      = &data[c],
-                    *dlim   = &data[c + ntpts*nchans];
-        int i       = c - c0,
-            T       = (ip >= 0 ?
-                        p.im.each[ip].vToInt( thresh*1e-6, i ) :
-                        p.ni.vToInt16( thresh*1e-6, i ));
-        int hiCnt   = (*d <= T ? inarow : 0),
-            spikes  = 0;
+    if( thresh != curThresh || (int)T.size() != nPads ) {
 
-        while( (d += nchans) < dlim ) {
+        T.resize( nPads );
 
-            if( *d <= T ) {
-
-                if( ++hiCnt == inarow )
-                    ++spikes;
-            }
-            else
-                hiCnt = 0;
+        for( int i = 0; i < nPads; ++i ) {
+            T[i] = (ip >= 0 ?
+                    p.im.each[ip].vToInt( thresh*1e-6, i ) :
+                    p.ni.vToInt16( thresh*1e-6, i ));
         }
 
-        sums[i] += spikes;
+        curThresh = thresh;
     }
 
+    pass( data, ntpts, nchans, c0, inarow, true );
+
+    sumSamps += ntpts;
+
     bool    done = ++chunksDone >= chunksReqd;
 
     if( done ) {
@@ -95,7 +120,7 @@ bool ShankCtl::Tally::countSpikes(
                 (ip >= 0 ? p.im.each[ip].srate : p.ni.srate) / sumSamps;
 
         for( int i = 0; i < nPads; ++i )
-            sums[i] *= count2Rate;
+            sums[i] = spk[i] * count2Rate;
     }
 
     return done;
@@ -106,26 +131,12 @@ bool ShankCtl::Tally::accumPkPk(
     const short *data,
     int         ntpts,
     int         nchans,
-    int         c0,
-    int         cLim )
+    int         c0 )
 {
     if( !ntpts )
         return false;
 
-    for( int it = 0; it < ntpts; ++it, data += nchans ) {
-
-        for( int c = c0; c < cLim; ++c ) {
-
-            int v = data[c],
-                i = c - c0;
-
-            if( v < vmin[i] )
-                vmin[i] = v;
-
-            if( v > vmax[i] )
-                vmax[i] = v;
-        }
-    }
+    pass( data, ntpts, nchans, c0, 0, false );
 
     bool    done = ++chunksDone >= chunksReqd;
 
@@ -138,6 +149,136 @@ bool ShankCtl::Tally::accumPkPk(
     return done;
 }
 
+
+// Channels [c0,c0+nPads) of raw interleaved (data) pass through
+// highpass, optional lowpass, transient blanking, and either the
+// spike run counter or min/max, all while the sample is in hand.
+//
+void ShankCtl::Tally::pass(
+    const short *data,
+    int         ntpts,
+    int         nchans,
+    int         c0,
+    int         inarow,
+    bool        spikes )
+{
+    double  I   = inarow,
+            I1  = inarow + 1;
+
+#ifdef SHANK_SSE2
+    const __m128d   H0 = _mm_set1_pd( ch[0] ), H1 = _mm_set1_pd( ch[1] ),
+                    H2 = _mm_set1_pd( ch[2] ), H3 = _mm_set1_pd( ch[3] ),
+                    H4 = _mm_set1_pd( ch[4] ),
+                    L0 = _mm_set1_pd( cl[0] ), L1 = _mm_set1_pd( cl[1] ),
+                    L2 = _mm_set1_pd( cl[2] ), L3 = _mm_set1_pd( cl[3] ),
+                    L4 = _mm_set1_pd( cl[4] ),
+                    VI = _mm_set1_pd( I ),
+                    VI1 = _mm_set1_pd( I1 ),
+                    ONE = _mm_set1_pd( 1.0 ),
+                    ZRO = _mm_setzero_pd();
+#endif
+
+    for( int it = 0; it < ntpts; ++it, data += nchans ) {
+
+        const short *d      = data + c0;
+        bool        zap     = nzero > 0;
+        int         c       = 0;
+
+        if( zap )
+            --nzero;
+
+#ifdef SHANK_SSE2
+        for( ; c + 2 <= nPads; c += 2 ) {
+
+            int     pair;
+            memcpy( &pair, d + c, 4 );
+
+            __m128i x   = _mm_cvtsi32_si128( pair );
+            __m128d in  = _mm_cvtepi32_pd(
+                            _mm_srai_epi32( _mm_unpacklo_epi16( x, x ), 16 ) ),
+                    out = _mm_add_pd( _mm_mul_pd( in, H0 ), _mm_loadu_pd( &zh1[c] ) );
+
+            _mm_storeu_pd( &zh1[c],
+                _mm_sub_pd(
+                    _mm_add_pd( _mm_mul_pd( in, H1 ), _mm_loadu_pd( &zh2[c] ) ),
+                    _mm_mul_pd( H3, out ) ) );
+            _mm_storeu_pd( &zh2[c],
+                _mm_sub_pd( _mm_mul_pd( in, H2 ), _mm_mul_pd( H4, out ) ) );
+
+            if( useLP ) {
+
+                in  = out;
+                out = _mm_add_pd( _mm_mul_pd( in, L0 ), _mm_loadu_pd( &zl1[c] ) );
+
+                _mm_storeu_pd( &zl1[c],
+                    _mm_sub_pd(
+                        _mm_add_pd( _mm_mul_pd( in, L1 ), _mm_loadu_pd( &zl2[c] ) ),
+                        _mm_mul_pd( L3, out ) ) );
+                _mm_storeu_pd( &zl2[c],
+                    _mm_sub_pd( _mm_mul_pd( in, L2 ), _mm_mul_pd( L4, out ) ) );
+            }
+
+            if( zap )
+                out = ZRO;
+
+            if( spikes ) {
+
+                __m128d lo  = _mm_cmple_pd( out, _mm_loadu_pd( &T[c] ) ),
+                        r   = _mm_and_pd( lo,
+                                _mm_min_pd(
+                                    _mm_add_pd( _mm_loadu_pd( &run[c] ), ONE ),
+                                    VI1 ) );
+
+                _mm_storeu_pd( &run[c], r );
+                _mm_storeu_pd( &spk[c],
+                    _mm_add_pd( _mm_loadu_pd( &spk[c] ),
+                        _mm_and_pd( _mm_cmpeq_pd( r, VI ), ONE ) ) );
+            }
+            else {
+                _mm_storeu_pd( &vmin[c], _mm_min_pd( _mm_loadu_pd( &vmin[c] ), out ) );
+                _mm_storeu_pd( &vmax[c], _mm_max_pd( _mm_loadu_pd( &vmax[c] ), out ) );
+            }
+        }
+#endif
+
+        for( ; c < nPads; ++c ) {
+
+            double  in  = d[c],
+                    out = in * ch[0] + zh1[c];
+
+            zh1[c] = in * ch[1] + zh2[c] - ch[3] * out;
+            zh2[c] = in * ch[2] - ch[4] * out;
+
+            if( useLP ) {
+
+                in  = out;
+                out = in * cl[0] + zl1[c];
+
+                zl1[c] = in * cl[1] + zl2[c] - cl[3] * out;
+                zl2[c] = in * cl[2] - cl[4] * out;
+            }
+
+            if( zap )
+                out = 0;
+
+            if( spikes ) {
+
+                if( out <= T[c] ) {
+
+                    if( (run[c] = qMin( run[c] + 1, I1 )) == I )
+                        ++spk[c];
+                }
+                else
+                    run[c] = 0;
+            }
+            else {
+                vmin[c] = qMin( vmin[c], out );
+                vmax[c] = qMax( vmax[c], out );
+            }
+        }
+    }
+}
+
 /* ---------------------------------------------------------------- */
 /* ShankCtl ------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
@@ -333,21 +474,6 @@ void ShankCtl::baseInit( int ip )
 }
 
 
-void ShankCtl::zeroFilterTransient( short *data, int ntpts, int nchans )
-{
-    if( nzero > 0 ) {
-
-        // overwrite with zeros
-
-        if( ntpts > nzero )
-            ntpts = nzero;
-
-        memset( data, 0, ntpts*nchans*sizeof(qint16) );
-        nzero -= ntpts;
-    }
-}
-
-
 void ShankCtl::dcAve(
     std::vector<int>    &ave,
     short               *data,
@@ -418,7 +544,9 @@ void ShankCtl::closeEvent( QCloseEvent *e )
         GraphsWindow::setShankGeom( saveGeometry(), jpanel );
 
         // reset for next showing of window
-        nzero = BIQUAD_TRANS_WIDE;
+        drawMtx.lock();
+            tly.setFilter( hipass, lopass );
+        drawMtx.unlock();
 
         emit closed( this );
     }
@@ -34,37 +34,63 @@ protected:
                 rng[3]; // {rate, uV, uV}
     };
 
+    // Filters and tallies in one pass over the interleaved block.
+    // Per-channel state (highpass, optional lowpass, below-thresh
+    // run length, min/max) lives in parallel arrays, so the inner
+    // loop steps across channels two at a time (SSE2 doubles).
+    // Run lengths persist across blocks within an update period,
+    // so a spike straddling a block boundary counts once.
+    //
     class Tally {
     private:
         const DAQ::Params   &p;
-        std::vector<int>    vmin,
-                            vmax;
-        double              sumSamps;
+        std::vector<double> zh1, zh2,   // highpass state
+                            zl1, zl2,   // lowpass state
+                            vmin,
+                            vmax,
+                            run,        // below-thresh run length
+                            spk,
+                            T;          // thresh per chan
+        double              ch[5],
+                            cl[5],
+                            sumSamps;
         int                 ip,
                             chunksDone,
                             chunksReqd,
-                            nPads;
+                            nPads,
+                            nzero,
+                            curThresh;
+        bool                useLP;
     public:
         std::vector<double> sums;
     public:
-        Tally( const DAQ::Params &p ) : p(p) {}
+        Tally( const DAQ::Params &p )
+        :   p(p), sumSamps(0), ip(0), chunksDone(0), chunksReqd(1),
+            nPads(0), nzero(0), curThresh(0), useLP(false)  {}
         void init( double sUpdt, int ip );
         void updtChanged( double s );
+        void setFilter( const Biquad *hp, const Biquad *lp );
         void zeroData();
         bool countSpikes(
             const short *data,
             int         ntpts,
             int         nchans,
             int         c0,
-            int         cLim,
             int         thresh,
             int         inarow );
         bool accumPkPk(
+            const short *data,
+            int         ntpts,
+            int         nchans,
+            int         c0 );
+    private:
+        void pass(
             const short *data,
             int         ntpts,
             int         nchans,
             int         c0,
-            int         cLim );
+            int         inarow,
+            bool        spikes );
     };
 
 protected:
@@ -74,8 +100,7 @@ protected:
     Tally               tly;
     Biquad              *hipass,
                         *lopass;
-    int                 nzero,
-                        jpanel;
+    int                 jpanel;
     mutable QMutex      drawMtx;
 
 public:
@@ -112,8 +137,6 @@ private slots:
 protected:
     void baseInit( int ip );
 
-    void zeroFilterTransient( short *data, int ntpts, int nchans );
-
     void dcAve(
         std::vector<int>    &ave,
         short               *data,
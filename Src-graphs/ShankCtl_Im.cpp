@@ -4,7 +4,6 @@
 #include "Util.h"
 #include "ShankCtl_Im.h"
 #include "DAQ.h"
-#include "Subset.h"
 #include "Biquad.h"
 
 #include <QSettings>
@@ -53,7 +52,6 @@ void ShankCtl_Im::putScans( const vec_i16 &_data )
 
     double      ysc;
     const int   nC      = E.imCumTypCnt[CimCfg::imSumAll],
-                nNu     = E.imCumTypCnt[CimCfg::imSumNeural],
                 nAP     = E.imCumTypCnt[CimCfg::imSumAP],
                 maxInt  = E.roTbl->maxInt(),
                 ntpts   = (int)_data.size() / nC;
@@ -62,42 +60,29 @@ void ShankCtl_Im::putScans( const vec_i16 &_data )
 
     drawMtx.lock();
 
-// -----------------------------
-// Make local copy we can filter
-// -----------------------------
-
-    vec_i16 data;
-
-    if( set.what < 2 || !E.roTbl->nLF() )
-        Subset::subsetBlock( data, *(vec_i16*)&_data, 0, nAP, nC );
-    else
-        Subset::subsetBlock( data, *(vec_i16*)&_data, nAP, nNu, nC );
-
-    hipass->applyBlockwiseMem( &data[0], maxInt, ntpts, nAP, 0, nAP );
-
-    if( lopass )
-        lopass->applyBlockwiseMem( &data[0], maxInt, ntpts, nAP, 0, nAP );
-
-    zeroFilterTransient( &data[0], ntpts, nAP );
-
 // --------------------------
 // Process current data chunk
 // --------------------------
 
-    bool    done = false;
+    // Filter and tally straight from the acquired block:
+    // AP chans, or for LF view, LF chans (if present).
+
+    const short *data   = &_data[0];
+    int         c0      = (set.what < 2 || !E.roTbl->nLF() ? 0 : nAP);
+    bool        done    = false;
 
     if( set.what == 0 ) {
 
         // Count spikes
 
-        done = tly.countSpikes( &data[0], ntpts, nAP, 0, nAP,
+        done = tly.countSpikes( data, ntpts, nC, c0,
                 set.thresh, set.inarow );
     }
     else {
 
         // Peak to peak
 
-        done = tly.accumPkPk( &data[0], ntpts, nAP, 0, nAP );
+        done = tly.accumPkPk( data, ntpts, nC, c0 );
 
         if( done ) {
 
@@ -208,7 +193,7 @@ void ShankCtl_Im::updateFilter( bool lock )
             lopass = new Biquad( bq_type_lowpass, 300/E.srate );
     }
 
-    nzero = BIQUAD_TRANS_WIDE;
+    tly.setFilter( hipass, lopass );
 
     if( lock )
         drawMtx.unlock();
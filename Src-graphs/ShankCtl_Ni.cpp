@@ -4,7 +4,6 @@
 #include "Util.h"
 #include "ShankCtl_Ni.h"
 #include "DAQ.h"
-#include "Subset.h"
 #include "Biquad.h"
 
 #include <QSettings>
@@ -55,38 +54,27 @@ void ShankCtl_Ni::putScans( const vec_i16 &_data )
 
     drawMtx.lock();
 
-// -----------------------------
-// Make local copy we can filter
-// -----------------------------
-
-    vec_i16 data;
-    Subset::subsetBlock( data, *(vec_i16*)&_data, 0, nNu, nC );
-
-    hipass->applyBlockwiseMem( &data[0], MAX16BIT, ntpts, nNu, 0, nNu );
-
-    if( lopass )
-        lopass->applyBlockwiseMem( &data[0], MAX16BIT, ntpts, nNu, 0, nNu );
-
-    zeroFilterTransient( &data[0], ntpts, nNu );
-
 // --------------------------
 // Process current data chunk
 // --------------------------
 
-    bool    done = false;
+    // Filter and tally straight from the acquired block.
+
+    const short *data   = &_data[0];
+    bool        done    = false;
 
     if( set.what == 0 ) {
 
         // Count spikes
 
-        done = tly.countSpikes( &data[0], ntpts, nNu, 0, nNu,
+        done = tly.countSpikes( data, ntpts, nC, 0,
                 set.thresh, set.inarow );
     }
     else {
 
         // Peak to peak
 
-        done = tly.accumPkPk( &data[0], ntpts, nNu, 0, nNu );
+        done = tly.accumPkPk( data, ntpts, nC, 0 );
 
         if( done ) {
 
@@ -170,7 +158,7 @@ void ShankCtl_Ni::updateFilter( bool lock )
         lopass = new Biquad( bq_type_lowpass,  300/p.ni.srate );
     }
 
-    nzero = BIQUAD_TRANS_WIDE;
+    tly.setFilter( hipass, lopass );
 
     if( lock )
         drawMtx.unlock();
@@ -23,6 +23,7 @@ HEADERS += \
     $$PWD/SVGrafsM_Ni.h \
     $$PWD/SView.h \
     $$PWD/SVToolsM.h \
+    $$PWD/TTLEvents.h \
     $$PWD/Vec2.h \
     $$PWD/WrapBuffer.h
 
@@ -50,6 +51,7 @@ SOURCES += \
     $$PWD/SVGrafsM_Ni.cpp \
     $$PWD/SView.cpp \
     $$PWD/SVToolsM.cpp \
+    $$PWD/TTLEvents.cpp \
     $$PWD/WrapBuffer.cpp
 
 
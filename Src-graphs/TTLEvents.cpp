@@ -0,0 +1,151 @@
+
+#include "TTLEvents.h"
+
+#include <QMap>
+
+#include <algorithm>
+
+
+#define MAX_EVTS    65536
+
+
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+static QMutex                       regMtx;
+static QMap<QString,TTLEvtList*>    regMap;
+
+
+static bool offBefore( const TTLEvt &E, quint64 ct )
+{
+    return E.off < ct;
+}
+
+/* ---------------------------------------------------------------- */
+/* TTLEvtList ----------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+void TTLEvtList::update( const vec_i16 &data, quint64 headCt, int nC )
+{
+    int ntpts = (int)data.size() / nC;
+
+    QMutexLocker    ml( &mtx );
+
+    if( !primed ) {
+        nextCt = headCt;
+        primed = true;
+    }
+
+    if( headCt + ntpts <= nextCt )
+        return;
+
+    int         it  = (headCt < nextCt ? nextCt - headCt : 0);
+    const short *d  = &data[chan + it*nC];
+
+    if( bit < 0 ) {
+
+        for( ; it < ntpts; ++it, d += nC )
+            detect( *d >= T, headCt + it );
+    }
+    else {
+
+        for( ; it < ntpts; ++it, d += nC )
+            detect( (*d >> bit) & 1, headCt + it );
+    }
+
+    nextCt = headCt + ntpts;
+
+    while( Q.size() > MAX_EVTS )
+        Q.pop_front();
+}
+
+
+// Fill vE with pulses overlapping [fromCt,toCt).
+// Return count.
+//
+int TTLEvtList::query(
+    std::vector<TTLEvt> &vE,
+    quint64             fromCt,
+    quint64             toCt ) const
+{
+    vE.clear();
+
+    QMutexLocker    ml( &mtx );
+
+    std::deque<TTLEvt>::const_iterator
+        it  = std::lower_bound( Q.begin(), Q.end(), fromCt, offBefore ),
+        end = Q.end();
+
+    for( ; it != end && it->on < toCt; ++it )
+        vE.push_back( *it );
+
+    return vE.size();
+}
+
+
+void TTLEvtList::detect( bool hi, quint64 ct )
+{
+    if( hi != high ) {
+
+        if( !high && !armed )
+            return;
+
+        if( !run++ )
+            markCt = ct;
+
+        if( run >= inarow ) {
+
+            if( high )
+                Q.back().off = markCt;
+            else
+                Q.push_back( TTLEvt( markCt ) );
+
+            high    = !high;
+            run     = 0;
+        }
+    }
+    else {
+
+        if( !high )
+            armed = true;
+
+        run = 0;
+    }
+}
+
+/* ---------------------------------------------------------------- */
+/* TTLEvents ------------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+TTLEvtList *TTLEvents::get(
+    int ip,
+    int chan,
+    int bit,
+    int T,
+    int inarow )
+{
+    QString key = QString("%1:%2:%3:%4:%5")
+                    .arg( ip ).arg( chan ).arg( bit )
+                    .arg( bit < 0 ? T : 0 ).arg( inarow );
+
+    QMutexLocker    ml( &regMtx );
+
+    TTLEvtList  *L = regMap.value( key, 0 );
+
+    if( !L )
+        regMap[key] = L = new TTLEvtList( chan, bit, T, inarow );
+
+    return L;
+}
+
+
+void TTLEvents::clearAll()
+{
+    QMutexLocker    ml( &regMtx );
+
+    qDeleteAll( regMap );
+    regMap.clear();
+}
+
+
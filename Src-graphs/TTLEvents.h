@@ -0,0 +1,88 @@
+#ifndef TTLEVENTS_H
+#define TTLEVENTS_H
+
+#include "SGLTypes.h"
+
+#include <QMutex>
+
+#include <deque>
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// One TTL pulse in stream sample counts.
+//
+struct TTLEvt {
+    quint64 on,
+            off;    // UNSET64 while still high
+
+    TTLEvt() : on(0), off(UNSET64)                  {}
+    TTLEvt( quint64 on ) : on(on), off(UNSET64)     {}
+};
+
+
+// Pulse list for one {stream, channel or bit, threshold, inarow}.
+//
+// update() scans only samples past those already seen, so when
+// several windows feed the same blocks, each sample is examined
+// once. An edge needs (inarow) consecutive samples past threshold;
+// its count is the first of them. Detection must first see a low
+// after list creation. Gaps between blocks are bridged as if
+// contiguous. Oldest pulses are dropped beyond a fixed cap, so
+// dense trains (camera frames) hold bounded memory. query() finds
+// pulses overlapping a count range by binary search.
+//
+class TTLEvtList
+{
+private:
+    std::deque<TTLEvt>  Q;
+    mutable QMutex      mtx;
+    quint64             nextCt,     // first unseen sample
+                        markCt;     // candidate edge
+    const int           chan,
+                        bit,        // -1 = analog
+                        T,
+                        inarow;
+    int                 run;
+    bool                primed,
+                        armed,
+                        high;
+
+public:
+    TTLEvtList( int chan, int bit, int T, int inarow )
+    :   nextCt(0), markCt(0), chan(chan), bit(bit), T(T),
+        inarow(qMax( inarow, 1 )), run(0),
+        primed(false), armed(false), high(false)    {}
+
+    void update( const vec_i16 &data, quint64 headCt, int nC );
+    int query(
+        std::vector<TTLEvt> &vE,
+        quint64             fromCt,
+        quint64             toCt ) const;
+
+private:
+    void detect( bool hi, quint64 ct );
+};
+
+
+// Per-run registry of shared pulse lists.
+//
+// Lists are created on first request and live until the
+// run stops; pointers are invalid after clearAll().
+//
+class TTLEvents
+{
+public:
+    static TTLEvtList *get(
+        int ip,
+        int chan,
+        int bit,
+        int T,
+        int inarow );
+    static void clearAll();
+};
+
+#endif  // TTLEVENTS_H
+
+
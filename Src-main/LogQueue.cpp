@@ -0,0 +1,509 @@
+
+#include "LogQueue.h"
+#include "Util.h"
+#include "MainApp.h"
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QThread>
+
+#include <iostream>
+#include <vector>
+
+
+#define SITE_WIN_MS     1000
+#define SITE_IDLE_MS    10000
+
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+struct LogRec {
+    QAtomicPointer<LogRec>  next;
+    QString                 str;
+    QColor                  color;
+    qint64                  msecs;
+    quint64                 thd;
+    int                     cpu,
+                            level;
+    bool                    doeco,
+                            dodsk;
+
+    LogRec()
+    :   next(0), msecs(0), thd(0), cpu(0),
+        level(0), doeco(false), dodsk(false)    {}
+};
+
+struct LogSite {
+    QString str;
+    QColor  color;
+    qint64  winStart;
+    int     n,
+            nSupp;
+    bool    doeco;
+
+    LogSite() : winStart(0), n(0), nSupp(0), doeco(false)   {}
+};
+
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Vyukov intrusive MPSC list: producers swing (head) with one
+// atomic exchange, then link the predecessor; the consumer walks
+// from (tail). The stub node keeps the list non-empty.
+
+static LogRec                   stub;
+static QAtomicPointer<LogRec>   head( &stub );
+static LogRec                   *tail = &stub;
+static QAtomicInt               live,
+                                inFlight,
+                                nPending,
+                                nDropped;
+static QThread                  *thread = 0;
+
+// Consumer-only state
+
+static QHash<QString,LogSite>   sites;
+static QFile                    binLog;
+static bool                     binFail = false;
+
+
+static void push( LogRec *R )
+{
+    R->next.store( 0 );
+
+    LogRec  *prev = head.fetchAndStoreOrdered( R );
+
+    prev->next.storeRelease( R );
+}
+
+
+// Return null if empty, or if a producer is mid-push
+// (its record is then taken next pass).
+//
+static LogRec *pop()
+{
+    LogRec  *t      = tail,
+            *next   = t->next.loadAcquire();
+
+    if( t == &stub ) {
+
+        if( !next )
+            return 0;
+
+        tail    = next;
+        t       = next;
+        next    = next->next.loadAcquire();
+    }
+
+    if( next ) {
+        tail = next;
+        return t;
+    }
+
+    if( t != head.loadAcquire() )
+        return 0;
+
+    push( &stub );
+
+    next = t->next.loadAcquire();
+
+    if( next ) {
+        tail = next;
+        return t;
+    }
+
+    return 0;
+}
+
+
+static QString format(
+    const QString   &str,
+    quint64         thd,
+    int             cpu,
+    qint64          msecs )
+{
+    return QString("[Thd %1 CPU %2 %3] %4")
+            .arg( thd )
+            .arg( cpu )
+            .arg( dateTime2Str(
+                    QDateTime::fromMSecsSinceEpoch( msecs ),
+                    "M/dd/yy hh:mm:ss.zzz" ) )
+            .arg( str );
+}
+
+
+// Messages from one call site differ only in their numbers.
+//
+static QString siteKey( const QString &str )
+{
+    QString key = str;
+    QChar   *K  = key.data();
+
+    for( int i = 0, n = key.size(); i < n; ++i ) {
+
+        if( K[i].isDigit() )
+            K[i] = '#';
+    }
+
+    return key;
+}
+
+
+static void deliver(
+    const QString   &text,
+    const QColor    &color,
+    bool            doeco,
+    bool            dodsk )
+{
+    MainApp *app = mainApp();
+
+    if( app ) {
+
+        app->msg.logMsg( text, doeco, color );
+
+        if( dodsk ) {
+            QMetaObject::invokeMethod(
+                app, "runLogErrorToDisk",
+                Qt::QueuedConnection,
+                Q_ARG(QString, text) );
+        }
+    }
+    else
+        std::cerr << STR2CHR( text ) << "\n";
+}
+
+
+// Return true if R may show; else tally it against its site.
+//
+static bool admit( const LogRec *R )
+{
+    if( R->level == LogQueue::lvlError )
+        return true;
+
+    LogSite &S = sites[siteKey( R->str )];
+
+    if( R->msecs - S.winStart >= SITE_WIN_MS && !S.nSupp ) {
+        S.winStart  = R->msecs;
+        S.n         = 0;
+    }
+
+    if( ++S.n <= LOGQ_SITE_BURST )
+        return true;
+
+    ++S.nSupp;
+    S.str   = R->str;
+    S.color = R->color;
+    S.doeco = R->doeco;
+
+    return false;
+}
+
+
+// Summarize sites whose window closed with suppressions;
+// forget sites idle for a while.
+//
+static void sweepSites( qint64 now )
+{
+    QHash<QString,LogSite>::iterator it = sites.begin();
+
+    while( it != sites.end() ) {
+
+        LogSite &S = it.value();
+
+        if( now - S.winStart < SITE_WIN_MS ) {
+            ++it;
+            continue;
+        }
+
+        if( S.nSupp ) {
+
+            deliver(
+                format(
+                    QString("(%1 more like this in %2 s) %3")
+                    .arg( S.nSupp )
+                    .arg( (now - S.winStart) / 1000.0, 0, 'f', 1 )
+                    .arg( S.str ),
+                    (quint64)QThread::currentThreadId(),
+                    getCurProcessorIdx(), now ),
+                S.color, S.doeco, false );
+
+            S.winStart  = now;
+            S.n         = 0;
+            S.nSupp     = 0;
+            ++it;
+        }
+        else if( now - S.winStart >= SITE_IDLE_MS )
+            it = sites.erase( it );
+        else
+            ++it;
+    }
+}
+
+
+static bool openBinLog()
+{
+    if( binLog.isOpen() )
+        return true;
+
+    if( binFail )
+        return false;
+
+    QString dir = QString("%1/_Logs").arg( appPath() );
+
+    QDir().mkpath( dir );
+    binLog.setFileName( QString("%1/SpikeGLX.log").arg( dir ) );
+
+    if( !binLog.open( QIODevice::WriteOnly | QIODevice::Append ) ) {
+        binFail = true;
+        Warning() << "Can't open binary log [" << binLog.fileName() << "].";
+        return false;
+    }
+
+    if( !binLog.size() )
+        binLog.write( "SGLXLOG1", 8 );
+
+    return true;
+}
+
+
+static void rollBinLog()
+{
+    QString name = binLog.fileName(),
+            old  = name + "1";
+
+    binLog.close();
+    QFile::remove( old );
+    QFile::rename( name, old );
+    openBinLog();
+}
+
+
+static void writeBin( const LogRec *R )
+{
+    if( !openBinLog() )
+        return;
+
+    QByteArray  txt = R->str.toUtf8();
+    char        hdr[24];
+    qint16      cpu = R->cpu;
+    quint8      lvl = R->level,
+                rsv = 0;
+    quint32     nB  = txt.size();
+
+    memcpy( hdr,      &R->msecs, 8 );
+    memcpy( hdr + 8,  &R->thd, 8 );
+    memcpy( hdr + 16, &cpu, 2 );
+    memcpy( hdr + 18, &lvl, 1 );
+    memcpy( hdr + 19, &rsv, 1 );
+    memcpy( hdr + 20, &nB, 4 );
+
+    binLog.write( hdr, 24 );
+    binLog.write( txt );
+
+    if( binLog.size() >= LOGQ_FILE_BYTES )
+        rollBinLog();
+}
+
+/* ---------------------------------------------------------------- */
+/* LogWorker ------------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+void LogWorker::run()
+{
+    while( live.load() ) {
+        LogQueue::drain();
+        QThread::msleep( LOGQ_PERIOD_MS );
+    }
+
+    LogQueue::drain();
+
+    emit finished();
+}
+
+/* ---------------------------------------------------------------- */
+/* LogQueue ------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Call from main thread once the console exists.
+//
+void LogQueue::start()
+{
+    if( thread )
+        return;
+
+    live.store( 1 );
+
+    thread = new QThread;
+
+    LogWorker   *worker = new LogWorker;
+
+    worker->moveToThread( thread );
+
+    Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
+    Connect( worker, SIGNAL(finished()), worker, SLOT(deleteLater()) );
+    Connect( worker, SIGNAL(destroyed()), thread, SLOT(quit()), Qt::DirectConnection );
+
+    thread->start();
+}
+
+
+// Flush everything queued, then revert to synchronous logging.
+//
+void LogQueue::stop()
+{
+    if( !thread )
+        return;
+
+    live.fetchAndStoreOrdered( 0 );
+
+    if( thread->isRunning() && !thread->wait( 10000 ) ) {
+
+        // Worker still draining: leak thread rather than
+        // destroy it running; skip our own drain (not
+        // reentrant with the worker's).
+
+        thread = 0;
+        std::cerr << "LogQueue: drain thread did not stop; abandoned.\n";
+        return;
+    }
+
+    delete thread;
+    thread = 0;
+
+// A producer that saw (live) set may still be pushing;
+// any later one sees it clear and logs synchronously.
+
+    while( inFlight.loadAcquire() )
+        QThread::yieldCurrentThread();
+
+    drain();
+    binLog.close();
+}
+
+
+// Return false if not started: caller logs synchronously.
+//
+bool LogQueue::post(
+    const QString   &str,
+    const QColor    &color,
+    int             level,
+    bool            doeco,
+    bool            dodsk )
+{
+// Ordered ops pair with stop(): either it sees us in
+// flight, or we see (live) clear.
+
+    inFlight.fetchAndAddOrdered( 1 );
+
+    if( !live.loadAcquire() ) {
+        inFlight.fetchAndAddRelease( -1 );
+        return false;
+    }
+
+    if( level != lvlError
+        && nPending.fetchAndAddRelaxed( 1 ) >= LOGQ_MAXPENDING ) {
+
+        nPending.fetchAndAddRelaxed( -1 );
+        nDropped.fetchAndAddRelaxed( 1 );
+        inFlight.fetchAndAddRelease( -1 );
+        return true;
+    }
+
+    if( level == lvlError )
+        nPending.fetchAndAddRelaxed( 1 );
+
+    LogRec  *R = new LogRec;
+
+    R->str      = str;
+    R->color    = color;
+    R->msecs    = QDateTime::currentMSecsSinceEpoch();
+    R->thd      = (quint64)QThread::currentThreadId();
+    R->cpu      = getCurProcessorIdx();
+    R->level    = level;
+    R->doeco    = doeco;
+    R->dodsk    = dodsk;
+
+    push( R );
+
+    inFlight.fetchAndAddRelease( -1 );
+
+    return true;
+}
+
+
+// Consumer side: runs of lines sharing color and echo
+// flags go to the console as one batch.
+//
+void LogQueue::drain()
+{
+    std::vector<LogRec*>    vR;
+    LogRec                  *R;
+
+    while( (R = pop()) )
+        vR.push_back( R );
+
+    nPending.fetchAndAddRelaxed( -int(vR.size()) );
+
+    QString batch;
+    QColor  bClr;
+    bool    bEco = false,
+            bDsk = false;
+
+    for( int i = 0, n = vR.size(); i < n; ++i ) {
+
+        R = vR[i];
+
+        writeBin( R );
+
+        if( admit( R ) ) {
+
+            if( !batch.isEmpty()
+                && (R->color != bClr
+                    || R->doeco != bEco
+                    || R->dodsk != bDsk) ) {
+
+                deliver( batch, bClr, bEco, bDsk );
+                batch.clear();
+            }
+
+            if( !batch.isEmpty() )
+                batch += "\n";
+
+            batch  += format( R->str, R->thd, R->cpu, R->msecs );
+            bClr    = R->color;
+            bEco    = R->doeco;
+            bDsk    = R->dodsk;
+        }
+
+        delete R;
+    }
+
+    if( !batch.isEmpty() )
+        deliver( batch, bClr, bEco, bDsk );
+
+    qint64  now     = QDateTime::currentMSecsSinceEpoch();
+    int     drop    = nDropped.fetchAndStoreRelaxed( 0 );
+
+    if( drop ) {
+        deliver(
+            format(
+                QString("Log queue full: %1 messages dropped.").arg( drop ),
+                (quint64)QThread::currentThreadId(),
+                getCurProcessorIdx(), now ),
+            Qt::darkMagenta, true, false );
+    }
+
+    sweepSites( now );
+
+    if( binLog.isOpen() )
+        binLog.flush();
+}
+
+
@@ -0,0 +1,97 @@
+#ifndef LOGQUEUE_H
+#define LOGQUEUE_H
+
+#include <QObject>
+#include <QColor>
+
+class QThread;
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+class LogWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    LogWorker() : QObject(0)    {}
+    virtual ~LogWorker()        {}
+
+signals:
+    void finished();
+
+public slots:
+    void run();
+};
+
+
+// Asynchronous delivery of Log/Debug/Warning/Error messages.
+//
+// post() links a record onto a lock-free multi-producer list
+// and returns; it never waits on a lock, the GUI event queue
+// or the disk, so acquisition and trigger threads can log
+// freely. If consumer falls LOGQ_MAXPENDING behind, further
+// records are dropped and tallied.
+//
+// One consumer thread wakes every LOGQ_PERIOD_MS and:
+// - formats the "[Thd CPU time]" prefix,
+// - rate-limits per call site: messages that differ only in
+//   digits share a site; beyond LOGQ_SITE_BURST per second the
+//   rest are counted and summarized once per second (errors
+//   are never suppressed),
+// - posts runs of same-color lines to the console (and the
+//   metrics and errors.txt echoes) as one batch,
+// - appends every record to a binary log (appPath/_Logs).
+//
+// Binary log: file magic "SGLXLOG1", then per record
+// (native endian):
+//
+//     0    i64     msecs since epoch
+//     8    u64     thread id
+//     16   i16     cpu index
+//     18   u8      level {0=log, 1=debug, 2=warning, 3=error}
+//     19   u8      reserved
+//     20   u32     nBytes
+//     24   utf8    text[nBytes]
+//
+// The file rolls over to SpikeGLX.log1 at LOGQ_FILE_BYTES.
+//
+// Before start() and after stop(), post() returns false and
+// callers deliver synchronously, as before.
+//
+#define LOGQ_PERIOD_MS      50
+#define LOGQ_MAXPENDING     20000
+#define LOGQ_SITE_BURST     10
+#define LOGQ_FILE_BYTES     (64*1024*1024)
+
+class LogQueue
+{
+    friend class LogWorker;
+
+public:
+    enum Level {
+        lvlLog      = 0,
+        lvlDebug    = 1,
+        lvlWarning  = 2,
+        lvlError    = 3
+    };
+
+public:
+    static void start();
+    static void stop();
+
+    static bool post(
+        const QString   &str,
+        const QColor    &color,
+        int             level,
+        bool            doeco,
+        bool            dodsk );
+
+private:
+    static void drain();
+};
+
+#endif  // LOGQUEUE_H
+
+
@@ -0,0 +1,238 @@
+
+#include "MXStats.h"
+#include "Util.h"
+
+#include <QMap>
+#include <QMutex>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Registry is locked only to create/list entries, never to record.
+
+static QMutex                   regMtx;
+static QMap<QString,MXHist*>    regHist;
+static QMap<QString,MXGauge*>   regGauge;
+
+
+static inline int msb64( quint64 v )
+{
+#ifdef _MSC_VER
+    unsigned long   i;
+#ifdef _WIN64
+    _BitScanReverse64( &i, v );
+#else
+    if( v >> 32 ) {
+        _BitScanReverse( &i, quint32(v >> 32) );
+        i += 32;
+    }
+    else
+        _BitScanReverse( &i, quint32(v) );
+#endif
+    return i;
+#else
+    return 63 - __builtin_clzll( v );
+#endif
+}
+
+
+static void atomicMax( QAtomicInteger<quint64> &M, quint64 v )
+{
+    quint64 cur = M.load();
+
+    while( v > cur && !M.testAndSetRelaxed( cur, v, cur ) )
+        ;
+}
+
+
+static void atomicMax( QAtomicInteger<qint64> &M, qint64 v )
+{
+    qint64  cur = M.load();
+
+    while( v > cur && !M.testAndSetRelaxed( cur, v, cur ) )
+        ;
+}
+
+/* ---------------------------------------------------------------- */
+/* MXHist --------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+void MXHist::record( quint64 v )
+{
+    bkt[bucket( v )].fetchAndAddRelaxed( 1 );
+    N.fetchAndAddRelaxed( 1 );
+    sum.fetchAndAddRelaxed( v );
+    atomicMax( vmax, v );
+}
+
+
+void MXHist::recordSince( double t0 )
+{
+    double  us = 1e6 * (getTime() - t0);
+
+    record( us > 0 ? quint64(us) : 0 );
+}
+
+
+// Not atomic as a whole; intended for run start.
+//
+void MXHist::reset()
+{
+    for( int i = 0; i < MXHIST_NBKT; ++i )
+        bkt[i].store( 0 );
+
+    N.store( 0 );
+    sum.store( 0 );
+    vmax.store( 0 );
+}
+
+
+// Percentiles are bucket midpoints; a concurrent record()
+// may skew one line slightly, which is fine for diagnostics.
+//
+QString MXHist::report( const QString &name ) const
+{
+    quint64 n = N.load();
+
+    if( !n )
+        return QString("%1 n=0").arg( name );
+
+    const double    pct[]   = {0.50, 0.90, 0.99, 0.999};
+    quint64         pv[4]   = {0, 0, 0, 0},
+                    cum     = 0;
+    int             ip      = 0;
+
+    for( int i = 0; i < MXHIST_NBKT && ip < 4; ++i ) {
+
+        cum += bkt[i].load();
+
+        while( ip < 4 && cum >= pct[ip] * n )
+            pv[ip++] = bucketMid( i );
+    }
+
+    return
+        QString("%1 n=%2 mean=%3 p50=%4 p90=%5 p99=%6 p999=%7 max=%8")
+        .arg( name )
+        .arg( n )
+        .arg( double(sum.load()) / n, 0, 'f', 1 )
+        .arg( pv[0] ).arg( pv[1] ).arg( pv[2] ).arg( pv[3] )
+        .arg( vmax.load() );
+}
+
+
+// Values below MXHIST_SUB get exact buckets; above that,
+// each octave [2^k, 2^(k+1)) has MXHIST_SUB equal buckets.
+//
+int MXHist::bucket( quint64 v )
+{
+    if( v < MXHIST_SUB )
+        return v;
+
+    if( v >> MXHIST_MAXBITS )
+        v = (quint64(1) << MXHIST_MAXBITS) - 1;
+
+    int shift = msb64( v ) - MXHIST_SUBBITS;
+
+    return MXHIST_SUB * (shift + 1) + int((v >> shift) & (MXHIST_SUB - 1));
+}
+
+
+quint64 MXHist::bucketMid( int i )
+{
+    if( i < MXHIST_SUB )
+        return i;
+
+    int     shift   = i / MXHIST_SUB - 1;
+    quint64 lo      = quint64(MXHIST_SUB + i % MXHIST_SUB) << shift;
+
+    return lo + (quint64(1) << shift) / 2;
+}
+
+/* ---------------------------------------------------------------- */
+/* MXGauge -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+void MXGauge::set( qint64 v )
+{
+    val.store( v );
+    atomicMax( vmax, v );
+}
+
+
+QString MXGauge::report( const QString &name ) const
+{
+    return QString("%1 last=%2 max=%3")
+            .arg( name )
+            .arg( val.load() )
+            .arg( vmax.load() );
+}
+
+/* ---------------------------------------------------------------- */
+/* MXStats -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+MXHist *MXStats::hist( const QString &name )
+{
+    QMutexLocker    ml( &regMtx );
+
+    MXHist  *H = regHist.value( name, 0 );
+
+    if( !H )
+        regHist[name] = H = new MXHist;
+
+    return H;
+}
+
+
+MXGauge *MXStats::gauge( const QString &name )
+{
+    QMutexLocker    ml( &regMtx );
+
+    MXGauge *G = regGauge.value( name, 0 );
+
+    if( !G )
+        regGauge[name] = G = new MXGauge;
+
+    return G;
+}
+
+
+void MXStats::resetAll()
+{
+    QMutexLocker    ml( &regMtx );
+
+    foreach( MXHist *H, regHist )
+        H->reset();
+
+    foreach( MXGauge *G, regGauge )
+        G->reset();
+}
+
+
+// One metric per line, sorted by name.
+//
+QString MXStats::report()
+{
+    QMutexLocker    ml( &regMtx );
+    QString         s;
+
+    QMap<QString,MXHist*>::const_iterator   ih, hEnd = regHist.end();
+
+    for( ih = regHist.begin(); ih != hEnd; ++ih )
+        s += ih.value()->report( ih.key() ) + "\n";
+
+    QMap<QString,MXGauge*>::const_iterator  ig, gEnd = regGauge.end();
+
+    for( ig = regGauge.begin(); ig != gEnd; ++ig )
+        s += ig.value()->report( ig.key() ) + "\n";
+
+    return s;
+}
+
+
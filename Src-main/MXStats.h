@@ -0,0 +1,85 @@
+#ifndef MXSTATS_H
+#define MXSTATS_H
+
+#include <QAtomicInteger>
+#include <QString>
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Always-on field metrics.
+//
+// Hot paths record into MXHist/MXGauge objects with a few relaxed
+// atomic ops and no locks. Objects are created once by name and
+// never deleted, so callers should cache the pointer, typically:
+//
+//     static MXHist *H = MXStats::hist( "imec.fetch_us" );
+//     H->record( us );
+//
+// MXStats::report() renders everything as text for the periodic
+// run dump and the CmdServer GETMETRICS query.
+
+// Log-linear ("HDR-style") histogram of non-negative integers:
+// each power of 2 is split into MXHIST_SUB linear sub-buckets,
+// so any recorded value is resolved to within 1/MXHIST_SUB.
+//
+#define MXHIST_SUBBITS  3
+#define MXHIST_SUB      (1 << MXHIST_SUBBITS)
+#define MXHIST_MAXBITS  40
+#define MXHIST_NBKT     (MXHIST_SUB * (MXHIST_MAXBITS - MXHIST_SUBBITS + 2))
+
+class MXHist
+{
+private:
+    QAtomicInteger<quint32> bkt[MXHIST_NBKT];
+    QAtomicInteger<quint64> N,
+                            sum,
+                            vmax;
+
+public:
+    MXHist()    {reset();}
+
+    void record( quint64 v );
+    void recordSince( double t0 );  // getTime() based, in us
+    void reset();
+
+    QString report( const QString &name ) const;
+
+private:
+    static int bucket( quint64 v );
+    static quint64 bucketMid( int i );
+};
+
+
+// Last value plus running max, e.g. queue depth.
+//
+class MXGauge
+{
+private:
+    QAtomicInteger<qint64>  val,
+                            vmax;
+
+public:
+    MXGauge()   {reset();}
+
+    void set( qint64 v );
+    void reset()    {val.store( 0 ); vmax.store( 0 );}
+
+    QString report( const QString &name ) const;
+};
+
+
+class MXStats
+{
+public:
+    static MXHist *hist( const QString &name );
+    static MXGauge *gauge( const QString &name );
+
+    static void resetAll();
+    static QString report();
+};
+
+#endif  // MXSTATS_H
+
+
@@ -0,0 +1,287 @@
+
+#include "MXTrace.h"
+#include "Util.h"
+
+#include <QFile>
+#include <QMutex>
+#include <QTextStream>
+#include <QVector>
+
+#include <string.h>
+
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+struct TrcEvent {
+    const char  *stage;
+    double      t;
+    TrcEvent() : stage(0), t(0)                                 {}
+    TrcEvent( const char *stage, double t ) : stage(stage), t(t)  {}
+};
+
+struct TrcTag {
+    QVector<TrcEvent>   ev;
+    quint64             ct;
+    double              tFetch;
+    int                 id,
+                        ip;
+    TrcTag() : ct(0), tFetch(0), id(-1), ip(0)  {}
+};
+
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Tags live in a ring indexed by (id % MXTRACE_MAXTAGS).
+// The live tag for each stream is published as (ct+1) so
+// that zero means none; hit() tests that without locking.
+
+static QMutex                   trcMtx;
+static TrcTag                   tags[MXTRACE_MAXTAGS];
+static QAtomicInteger<quint64>  liveCt1[MXTRACE_MAXSTREAMS];
+static int                      liveId[MXTRACE_MAXSTREAMS],
+                                nextId = 0;
+static double                   lastOrigin[MXTRACE_MAXSTREAMS];
+
+
+// Tag for id, or null if overwritten or never made.
+//
+static TrcTag *findTag( int id )
+{
+    if( id < 0 )
+        return 0;
+
+    TrcTag  &T = tags[id % MXTRACE_MAXTAGS];
+
+    return (T.id == id ? &T : 0);
+}
+
+
+// Record first arrival of each stage.
+//
+static void addEvent( TrcTag &T, const char *stage, double t )
+{
+    for( int i = 0, n = T.ev.size(); i < n; ++i ) {
+
+        if( !strcmp( T.ev[i].stage, stage ) )
+            return;
+    }
+
+    T.ev.push_back( TrcEvent( stage, t ) );
+}
+
+/* ---------------------------------------------------------------- */
+/* MXTrace -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Called by the stream's (single) producer thread right after
+// enqueuing [headCt, ...) into its AIQ.
+//
+void MXTrace::origin(
+    int     ip,
+    quint64 headCt,
+    double  tFetch,
+    double  tEnq )
+{
+    int is = ip + 1;
+
+    if( is < 0 || is >= MXTRACE_MAXSTREAMS )
+        return;
+
+    if( tEnq - lastOrigin[is] < MXTRACE_PERIOD_SECS )
+        return;
+
+    lastOrigin[is] = tEnq;
+
+    QMutexLocker    ml( &trcMtx );
+
+    TrcTag  &T = tags[nextId % MXTRACE_MAXTAGS];
+
+    T.ev.clear();
+    T.ct        = headCt;
+    T.tFetch    = tFetch;
+    T.id        = nextId;
+    T.ip        = ip;
+    addEvent( T, "aiq.enqueue", tEnq );
+
+    liveId[is] = nextId++;
+    liveCt1[is].store( headCt + 1 );
+}
+
+
+// If span [fromCt, fromCt+nCts) of stream ip holds the live tag,
+// record stage time and return the tag id, else return -1.
+//
+int MXTrace::hit(
+    int         ip,
+    quint64     fromCt,
+    quint64     nCts,
+    const char  *stage )
+{
+    int is = ip + 1;
+
+    if( is < 0 || is >= MXTRACE_MAXSTREAMS )
+        return -1;
+
+    quint64 ct1 = liveCt1[is].load();
+
+    if( !ct1 || ct1 <= fromCt || ct1 > fromCt + nCts )
+        return -1;
+
+    double          t = getTime();
+    QMutexLocker    ml( &trcMtx );
+    TrcTag          *T = findTag( liveId[is] );
+
+    if( !T || T->ct + 1 != ct1 )
+        return -1;
+
+    addEvent( *T, stage, t );
+
+    return T->id;
+}
+
+
+void MXTrace::mark( int id, const char *stage )
+{
+    if( id < 0 )
+        return;
+
+    double          t = getTime();
+    QMutexLocker    ml( &trcMtx );
+    TrcTag          *T = findTag( id );
+
+    if( T )
+        addEvent( *T, stage, t );
+}
+
+
+// Call before acquisition threads start.
+//
+void MXTrace::reset()
+{
+    QMutexLocker    ml( &trcMtx );
+
+    for( int i = 0; i < MXTRACE_MAXTAGS; ++i ) {
+        tags[i].id = -1;
+        tags[i].ev.clear();
+    }
+
+    for( int is = 0; is < MXTRACE_MAXSTREAMS; ++is ) {
+        liveCt1[is].store( 0 );
+        liveId[is]      = -1;
+        lastOrigin[is]  = 0;
+    }
+
+    nextId = 0;
+}
+
+
+// True if no tags since reset().
+//
+bool MXTrace::isEmpty()
+{
+    QMutexLocker    ml( &trcMtx );
+
+    return !nextId;
+}
+
+
+// Chrome trace-event format (JSON object form).
+// Times are microseconds on the getTime() clock.
+//
+bool MXTrace::writeJSON( const QString &path )
+{
+    QFile   f( path );
+
+    if( !f.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+        Warning() << "MXTrace: Can't open " << path;
+        return false;
+    }
+
+    QTextStream ts( &f );
+    QMutexLocker    ml( &trcMtx );
+
+    QVector<const char*>    stages;
+    QVector<bool>           seen( MXTRACE_MAXSTREAMS, false );
+    QString                 sep = "\n";
+
+    ts << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+// ------
+// Stages
+// ------
+
+    for( int id = qMax( 0, nextId - MXTRACE_MAXTAGS ); id < nextId; ++id ) {
+
+        const TrcTag    *T = findTag( id );
+
+        if( !T )
+            continue;
+
+        seen[T->ip + 1] = true;
+
+        for( int ie = 0, ne = T->ev.size(); ie < ne; ++ie ) {
+
+            const TrcEvent  &E = T->ev[ie];
+            int             tid;
+
+            for( tid = 0; tid < stages.size(); ++tid ) {
+                if( !strcmp( stages[tid], E.stage ) )
+                    break;
+            }
+
+            if( tid == stages.size() )
+                stages.push_back( E.stage );
+
+            ts << sep
+               << QString(
+                    "{\"name\":\"%1\",\"cat\":\"latency\",\"ph\":\"X\","
+                    "\"pid\":%2,\"tid\":%3,\"ts\":%4,\"dur\":%5,"
+                    "\"args\":{\"ct\":%6}}")
+                    .arg( E.stage )
+                    .arg( T->ip + 1 )
+                    .arg( tid )
+                    .arg( 1e6*T->tFetch, 0, 'f', 1 )
+                    .arg( 1e6*(E.t - T->tFetch), 0, 'f', 1 )
+                    .arg( T->ct );
+            sep = ",\n";
+        }
+    }
+
+// --------
+// Metadata
+// --------
+
+    for( int is = 0; is < MXTRACE_MAXSTREAMS; ++is ) {
+
+        if( !seen[is] )
+            continue;
+
+        ts << sep
+           << QString(
+                "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%1,"
+                "\"args\":{\"name\":\"%2\"}}")
+                .arg( is )
+                .arg( is ? QString("imec%1").arg( is - 1 ) : "nidq" );
+        sep = ",\n";
+
+        for( int tid = 0; tid < stages.size(); ++tid ) {
+
+            ts << sep
+               << QString(
+                    "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%1,"
+                    "\"tid\":%2,\"args\":{\"name\":\"%3\"}}")
+                    .arg( is )
+                    .arg( tid )
+                    .arg( stages[tid] );
+        }
+    }
+
+    ts << "\n]}\n";
+
+    return true;
+}
+
+
@@ -0,0 +1,55 @@
+#ifndef MXTRACE_H
+#define MXTRACE_H
+
+#include <QAtomicInteger>
+#include <QString>
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Sampled end-to-end sample latency tracing.
+//
+// About once per MXTRACE_PERIOD_SECS per stream, the acquisition
+// thread tags the first timepoint of a freshly enqueued block
+// (origin). Downstream consumers report the count spans they
+// handle (hit); a span containing the live tag records the time
+// at that stage. Misses cost one relaxed atomic load, so hit()
+// can sit on hot paths.
+//
+// Stages that lose the sample count (e.g. the DataFile writer
+// queue) carry the tag id returned by hit() and report it with
+// mark().
+//
+// writeJSON() emits Chrome trace-event format; open the file in
+// chrome://tracing or ui.perfetto.dev. Each stream is a process,
+// each stage a thread, and each stage event spans from hardware
+// fetch to that stage.
+//
+#define MXTRACE_PERIOD_SECS 1.0
+#define MXTRACE_MAXSTREAMS  64      // ip = {-1=NI, 0..62=imec}
+#define MXTRACE_MAXTAGS     4096
+
+class MXTrace
+{
+public:
+    static void origin(
+        int     ip,
+        quint64 headCt,
+        double  tFetch,
+        double  tEnq );
+    static int hit(
+        int         ip,
+        quint64     fromCt,
+        quint64     nCts,
+        const char  *stage );
+    static void mark( int id, const char *stage );
+
+    static void reset();
+    static bool isEmpty();
+    static bool writeJSON( const QString &path );
+};
+
+#endif  // MXTRACE_H
+
+
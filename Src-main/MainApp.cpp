@@ -8,8 +8,11 @@
 #include "MetricsWindow.h"
 #include "FileViewerWindow.h"
 #include "DFName.h"
+#include "DFJournal.h"
+#include "DFPlacer.h"
 #include "ConfigCtl.h"
 #include "DataDirCtl.h"
+#include "LogQueue.h"
 #include "AOCtl.h"
 #include "CmdSrvDlg.h"
 #include "RgtSrvDlg.h"
@@ -24,6 +27,7 @@
 
 #include <QDesktopWidget>
 #include <QDesktopServices>
+#include <QDirIterator>
 #include <QProgressDialog>
 #include <QMessageBox>
 #include <QAction>
@@ -89,6 +93,7 @@ MainApp::MainApp( int &argc, char **argv )
 // ------------
 
     msg.initMessenger( consoleWindow );
+    LogQueue::start();
 
     Log() << VERSION_STR;
     Log() << "Application started";
@@ -111,6 +116,8 @@ MainApp::MainApp( int &argc, char **argv )
     cmdSrv->startServer( true );
     rgtSrv->startServer( true );
 
+    DFPlacer::measureAsync();
+
 // ----
 // Done
 // ----
@@ -181,6 +188,12 @@ bool MainApp::isConsoleHidden() const
 }
 
 
+bool MainApp::isShmExport() const
+{
+    return cmdSrv->isShmExport();
+}
+
+
 bool MainApp::isShiftPressed() const
 {
     return (keyboardModifiers() & Qt::ShiftModifier);
@@ -196,6 +209,7 @@ void MainApp::dataDirCtlUpdate( QStringList &sl, bool isMD )
 
     saveSettings();
     act.ddExploreUpdate();
+    DFPlacer::measureAsync();
 }
 
 
@@ -206,6 +220,7 @@ void MainApp::remoteSetsMultiDriveEnable( bool enable )
     remoteMtx.unlock();
 
     act.ddExploreUpdate();
+    DFPlacer::measureAsync();
 }
 
 
@@ -225,6 +240,7 @@ bool MainApp::remoteSetsDataDir( const QString &path, int i )
     remoteMtx.unlock();
 
     act.ddExploreUpdate();
+    DFPlacer::measureAsync();
 
     Log() << QString("Remote client set data dir (%1): '%2'")
                 .arg( i ).arg( path );
@@ -679,6 +695,275 @@ static void test1()
 //=================================================================
 
 
+//=================================================================
+// Experiment to measure audio resampler CPU cost per stream.
+// Reports % of one core to resample 10 s of stereo audio in the
+// 256-frame chunks the audio feeder uses, for each AOCtl quality,
+// and frames consumed/produced (all input must be used).
+#if 0
+#include "samplerate.h"
+static void test1()
+{
+    const int       type[]  = {SRC_LINEAR, SRC_SINC_FASTEST,
+                                SRC_SINC_MEDIUM_QUALITY, SRC_SINC_BEST_QUALITY};
+    const char      *name[] = {"linear", "sinc fast", "sinc med", "sinc best"};
+    const double    srate[] = {30000.0, 25000.0, 2500.0};
+    const int       nC = 2, spc = 256, secs = 10;
+
+    std::vector<float>  in( spc * nC ), out;
+
+    for( int i = 0; i < spc * nC; ++i )
+        in[i] = 0.5f * sin( 0.01 * i );
+
+    for( int ir = 0; ir < 3; ++ir ) {
+
+        double  ratio   = 48000.0 / srate[ir];
+        int     outMax  = int(ceil( spc * ratio )) + 8;
+
+        out.resize( outMax * nC );
+
+        for( int iq = 0; iq < 4; ++iq ) {
+
+            int         err;
+            SRC_STATE   *S = src_new( type[iq], nC, &err );
+            SRC_DATA    D;
+
+            D.data_in       = &in[0];
+            D.data_out      = &out[0];
+            D.input_frames  = spc;
+            D.output_frames = outMax;
+            D.end_of_input  = 0;
+            D.src_ratio     = ratio;
+
+            qint64  nUsed   = 0,
+                    nGen    = 0;
+            int     nCalls  = secs * srate[ir] / spc;
+            double  t0      = getTime();
+
+            for( int ic = 0; ic < nCalls; ++ic ) {
+                src_process( S, &D );
+                nUsed  += D.input_frames_used;
+                nGen   += D.output_frames_gen;
+            }
+
+            double  dt = getTime() - t0;
+
+            Log() <<
+                QString("%1 -> 48000 %2: %3% of one core, in %4/%5 out %6")
+                .arg( srate[ir] ).arg( name[iq] )
+                .arg( 100.0 * dt / secs, 0, 'f', 3 )
+                .arg( nUsed ).arg( qint64(nCalls) * spc ).arg( nGen );
+
+            src_delete( S );
+        }
+    }
+}
+#endif
+//=================================================================
+
+
+//=================================================================
+// Experiment to time channel subsetting: the classic per-channel
+// gather vs SubsetPlan, on 1 s of NP AP data (385 chans) for
+// typical saved-channel maps. Also checks outputs are identical.
+#if 0
+#include "Subset.h"
+static void test1()
+{
+    const char  *name[] = {"all but ref", "range+SY", "every other",
+                            "tetrodes 4/4", "blocks 16/16", "blocks 64/64",
+                            "random 50%"};
+    const int   nC = 385, nT = 30000, nRep = 50;
+
+    vec_i16 src( nT * nC ), d0, d1;
+
+    for( int i = 0; i < nT * nC; ++i )
+        src[i] = i;
+
+    srand( 1 );
+
+    for( int im = 0; im < 7; ++im ) {
+
+        QVector<uint>   K;
+
+        for( int c = 0; c < nC - 1; ++c ) {
+
+            bool    keep;
+
+            switch( im ) {
+                case 0:  keep = (c != 191); break;
+                case 1:  keep = (c < 150); break;
+                case 2:  keep = !(c & 1); break;
+                case 3:  keep = !((c/4) & 1); break;
+                case 4:  keep = !((c/16) & 1); break;
+                case 5:  keep = !((c/64) & 1); break;
+                default: keep = rand() & 1; break;
+            }
+
+            if( keep )
+                K.push_back( c );
+        }
+
+        K.push_back( nC - 1 );
+
+        int nK = K.size();
+
+        d0.resize( nT * nK );
+
+        double  t0 = getTime();
+
+        for( int ir = 0; ir < nRep; ++ir ) {
+
+            const uint      *k = &K[0];
+            qint16          *D = &d0[0];
+            const qint16    *S = &src[0];
+
+            for( int it = 0; it < nT; ++it, S += nC ) {
+
+                for( int ik = 0; ik < nK; ++ik )
+                    *D++ = S[k[ik]];
+            }
+        }
+
+        double      tOld = (getTime() - t0) / nRep;
+        SubsetPlan  P( K, nC );
+
+        t0 = getTime();
+
+        for( int ir = 0; ir < nRep; ++ir )
+            P.apply( d1, src );
+
+        double  tNew = (getTime() - t0) / nRep;
+
+        t0 = getTime();
+
+        for( int ir = 0; ir < 1000; ++ir )
+            SubsetPlan Q( K, nC );
+
+        double  tCmp = (getTime() - t0) / 1000;
+
+        Log() <<
+            QString("%1 (%2 chans): old %3 ms, plan %4 ms,"
+                    " compile %5 us, same %6")
+            .arg( name[im] ).arg( nK )
+            .arg( 1000*tOld, 0, 'f', 2 )
+            .arg( 1000*tNew, 0, 'f', 2 )
+            .arg( 1e6*tCmp, 0, 'f', 2 )
+            .arg( d0 == d1 );
+    }
+}
+#endif
+//=================================================================
+
+//=================================================================
+// Experiment to time meta file parsing over a run folder tree.
+// Pass 1 reads every .meta (so the OS cache is equally warm),
+// pass 2 parses with the former QRegExp rules, pass 3 calls
+// fromMetaFile (parse cache cold), pass 4 repeats (cache warm).
+// Old and new maps are compared file by file.
+#if 0
+#include "KVParams.h"
+#include <QRegExp>
+static void oldParse( KVParams &kvp, const QString &s )
+{
+    QTextStream ts( (QString*)&s, QIODevice::ReadOnly | QIODevice::Text );
+    QString     line;
+    QRegExp     comment("(\\[|;|#|//).*"),
+                re("([^=]+)=(.*)");
+
+    kvp.clear();
+
+    while( !(line = ts.readLine()).isNull() ) {
+
+        line = line.trimmed();
+
+        if( !line.length() )
+            continue;
+
+        if( !line.contains( "notes", Qt::CaseInsensitive )
+            && !line.contains( "map", Qt::CaseInsensitive )
+            && line.contains( comment ) ) {
+
+            line.replace( comment, QString() );
+            line = line.trimmed();
+
+            if( !line.length() )
+                continue;
+        }
+
+        if( re.exactMatch( line ) )
+            kvp[re.cap(1).trimmed()] = re.cap(2).trimmed();
+    }
+}
+
+static void test1()
+{
+    QString dir = QFileDialog::getExistingDirectory(
+                    0, "Choose run folder", mainApp()->dataDir() );
+
+    if( dir.isEmpty() )
+        return;
+
+    QStringList     F;
+    QDirIterator    it( dir, QStringList() << "*.meta",
+                        QDir::Files, QDirIterator::Subdirectories );
+
+    while( it.hasNext() )
+        F.append( it.next() );
+
+    int                 nF = F.size(), bad = 0;
+    qint64              bytes = 0;
+    QVector<KVParams>   A( nF ), B( nF );
+    double              t0 = getTime(), tRd, tOld, tCold, tWarm;
+
+    for( int i = 0; i < nF; ++i ) {
+        QFile   f( F[i] );
+        f.open( QIODevice::ReadOnly );
+        bytes += f.readAll().size();
+    }
+
+    tRd = getTime() - t0;
+    t0  = getTime();
+
+    for( int i = 0; i < nF; ++i ) {
+        QFile   f( F[i] );
+        f.open( QIODevice::ReadOnly | QIODevice::Text );
+        oldParse( A[i], QTextStream( &f ).readAll() );
+    }
+
+    tOld    = getTime() - t0;
+    t0      = getTime();
+
+    for( int i = 0; i < nF; ++i )
+        B[i].fromMetaFile( F[i] );
+
+    tCold   = getTime() - t0;
+    t0      = getTime();
+
+    for( int i = 0; i < nF; ++i )
+        B[i].fromMetaFile( F[i] );
+
+    tWarm = getTime() - t0;
+
+    for( int i = 0; i < nF; ++i ) {
+
+        if( A[i] != B[i] ) {
+            Log() << "Maps differ: " << F[i];
+            ++bad;
+        }
+    }
+
+    Log() <<
+        QString("%1 files, %2 MB: read %3 ms, old %4 ms,"
+                " new cold %5 ms, new warm %6 ms, mismatched %7")
+        .arg( nF ).arg( bytes / (1024.0*1024.0), 0, 'f', 1 )
+        .arg( 1000*tRd, 0, 'f', 0 ).arg( 1000*tOld, 0, 'f', 0 )
+        .arg( 1000*tCold, 0, 'f', 0 ).arg( 1000*tWarm, 0, 'f', 0 )
+        .arg( bad );
+}
+#endif
+//=================================================================
+
 void MainApp::file_NewRun()
 {
 //test1();return;
@@ -730,6 +1015,7 @@ void MainApp::file_AskQuit()
         processEvents();
     }
 
+    LogQueue::stop();
     msg.appQuiting();
     win.closeAll();
 
@@ -803,6 +1089,65 @@ void MainApp::tools_ShowPar2Win()
 }
 
 
+// Rebuild meta tallies for every file in the chosen folder
+// that still has a recovery journal (was never finalized).
+//
+void MainApp::tools_RecoverRun()
+{
+    QString dir =
+        QFileDialog::getExistingDirectory(
+            consoleWindow,
+            "Select run folder to recover",
+            dataDir() );
+
+    if( dir.isEmpty() )
+        return;
+
+    QDirIterator    it(
+                        dir,
+                        QStringList() << "*.jnl",
+                        QDir::Files,
+                        QDirIterator::Subdirectories );
+    int             nOK = 0,
+                    nBad = 0;
+
+    while( it.hasNext() ) {
+
+        QString bin = DFName::chopExtension( it.next() ) + ".bin",
+                msg;
+
+        if( run->dfIsInUse( QFileInfo( bin ) ) )
+            continue;
+
+        if( DFJournal::recover( bin, msg ) ) {
+            Log() << QString("Recover '%1': %2").arg( bin ).arg( msg );
+            ++nOK;
+        }
+        else {
+            Warning() << QString("Recover '%1' failed: %2").arg( bin ).arg( msg );
+            ++nBad;
+        }
+    }
+
+    QString str =
+        QString("Recovered %1 file(s); %2 failed (see log).")
+        .arg( nOK ).arg( nBad );
+
+    if( nBad ) {
+        QMessageBox::warning(
+            consoleWindow,
+            "Recover Interrupted Run",
+            str );
+    }
+    else {
+        QMessageBox::information(
+            consoleWindow,
+            "Recover Interrupted Run",
+            str );
+    }
+}
+
+
 void MainApp::tools_CalSRate()
 {
     if( run->isRunning() ) {
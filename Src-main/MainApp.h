@@ -138,6 +138,7 @@ public:
     bool isDebugMode() const            {return appData.debug;}
     bool isConsoleHidden() const;
     bool isShiftPressed() const;
+    bool isShmExport() const;
     bool isLogEditable() const          {return appData.editLog;}
 
     void dataDirCtlUpdate( QStringList &sl, bool isMD );
@@ -177,6 +178,7 @@ public slots:
 // Tools
     void tools_VerifySha1();
     void tools_ShowPar2Win();
+    void tools_RecoverRun();
     void tools_CalSRate();
     void tools_ImClose();
     void tools_ImBist();
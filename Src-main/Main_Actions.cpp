@@ -70,6 +70,9 @@ void Main_Actions::initActions()
     par2Act = new QAction( "&PAR2 Redundancy Tool...", this );
     ConnectUI( par2Act, SIGNAL(triggered()), app, SLOT(tools_ShowPar2Win()) );
 
+    recoverAct = new QAction( "Recover &Interrupted Run...", this );
+    ConnectUI( recoverAct, SIGNAL(triggered()), app, SLOT(tools_RecoverRun()) );
+
     calSRateAct = new QAction( "Sample &Rates From Run...", this );
     ConnectUI( calSRateAct, SIGNAL(triggered()), app, SLOT(tools_CalSRate()) );
 
@@ -176,6 +179,7 @@ void Main_Actions::initMenus( QMainWindow *w )
     m = mb->addMenu( "&Tools" );
     m->addAction( sha1Act );
     m->addAction( par2Act );
+    m->addAction( recoverAct );
     m->addSeparator();
     m->addAction( calSRateAct );
     m->addSeparator();
@@ -37,6 +37,7 @@ public:
     // Tools
         *sha1Act,
         *par2Act,
+        *recoverAct,
         *calSRateAct,
         *imCloseAct,
         *imBistAct,
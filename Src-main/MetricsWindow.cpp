@@ -5,7 +5,11 @@
 #include "Util.h"
 #include "MainApp.h"
 #include "ConfigCtl.h"
+#include "DFPlacer.h"
+#include "MXStats.h"
+#include "MXTrace.h"
 
+#include <QDateTime>
 #include <QFileDialog>
 #include <QKeyEvent>
 #include <QScrollBar>
@@ -33,7 +37,7 @@ void MetricsWindow::MXDiskRec::init()
 /* ---------------------------------------------------------------- */
 
 MetricsWindow::MetricsWindow( QWidget *parent )
-    :   QWidget(parent), mxTimer( this ),
+    :   QWidget(parent), mxTimer( this ), dumpTimer( this ),
         erLines(0), erMaxLines(2000), isRun(false)
 {
     mxUI = new Ui::MetricsWindow;
@@ -45,6 +49,10 @@ MetricsWindow::MetricsWindow( QWidget *parent )
     mxTimer.setInterval( 2000 );
     ConnectUI( &mxTimer, SIGNAL(timeout()), this, SLOT(updateMx()) );
 
+    dumpTimer.setTimerType( Qt::CoarseTimer );
+    dumpTimer.setInterval( 10000 );
+    ConnectUI( &dumpTimer, SIGNAL(timeout()), this, SLOT(dumpStats()) );
+
 // Choices of monospaced fonts widely available:
 // Consolas
 // Lucida Console
@@ -78,6 +86,8 @@ void MetricsWindow::runInit()
     err.init();
     prf.init();
     dsk.init();
+    MXStats::resetAll();
+    MXTrace::reset();
 
     setWindowTitle(
         QString("Metrics: %1")
@@ -90,6 +100,8 @@ void MetricsWindow::runInit()
 
     if( isVisible() )
         mxTimer.start();
+
+    dumpTimer.start();
 }
 
 
@@ -104,6 +116,19 @@ void MetricsWindow::runEnd()
     isRun = false;
     mxTimer.stop();
     updateMx();
+
+    dumpTimer.stop();
+    dumpStats();
+
+// Like stats, trace only accompanies runs that wrote files
+
+    if( dsk.g < 0 || MXTrace::isEmpty() )
+        return;
+
+    MXTrace::writeJSON(
+        QString("%1/%2.trace.json")
+        .arg( mainApp()->dataDir() )
+        .arg( mainApp()->cfgCtl()->acceptedParams.sns.runName ) );
 }
 
 
@@ -357,6 +382,25 @@ void MetricsWindow::updateMx()
         te->setTextColor( defColor );
     }
 
+// Audio
+
+    if( prf.audFifoUnder >= 0 ) {
+
+        if( prf.audFifoUnder || prf.audDevUnder ) {
+            te->setTextColor( Qt::darkMagenta );
+            ledstate = qMax( ledstate, 1 );
+        }
+        else
+            te->setTextColor( Qt::darkGreen );
+
+        te->append(
+            QString("Audio underruns since audio start (fifo, device):  %1  %2")
+            .arg( prf.audFifoUnder )
+            .arg( prf.audDevUnder ) );
+
+        te->setTextColor( defColor );
+    }
+
 // ----
 // Disk
 // ----
@@ -381,6 +425,43 @@ void MetricsWindow::updateMx()
         .arg( dsk.wbps, 0, 'f', 1 )
         .arg( dsk.rbps, 0, 'f', 1 ) );
 
+// Per-drive rates
+
+    QVector<DFPlacer::Drive>    drv = DFPlacer::drives();
+
+    if( drv.size() > 1 ) {
+
+        for( int i = 0, n = drv.size(); i < n; ++i ) {
+
+            const DFPlacer::Drive   &D = drv[i];
+
+            if( !D.nFiles )
+                continue;
+
+            if( (D.capMBps > 0 && D.reqMBps > D.capMBps) || D.qFull >= 50 ) {
+                te->setTextColor( Qt::darkRed );
+                ledstate = qMax( ledstate, 2 );
+            }
+            else if( (D.capMBps > 0 && D.reqMBps > 0.8 * D.capMBps)
+                    || D.qFull >= 20 ) {
+
+                te->setTextColor( Qt::darkMagenta );
+                ledstate = qMax( ledstate, 1 );
+            }
+
+            te->append(
+                QString("  Drive %1 (%2): %3 (req %4, cap %5) MB/s, queue %6%")
+                .arg( i )
+                .arg( D.root )
+                .arg( D.actMBps, 0, 'f', 1 )
+                .arg( D.reqMBps, 0, 'f', 1 )
+                .arg( D.capMBps, 0, 'f', 0 )
+                .arg( D.qFull, 0, 'f', 1 ) );
+
+            te->setTextColor( defColor );
+        }
+    }
+
 // Lags
 
     if( dsk.lags.size() ) {
@@ -462,6 +543,37 @@ void MetricsWindow::updateMx()
 }
 
 
+// Overwrite <runName>.metrics.txt with current latency stats,
+// so the file is useful even if the run ends abnormally.
+// Written only once this run has opened data files (dsk.g),
+// so view-only runs leave nothing in the data directory.
+//
+void MetricsWindow::dumpStats()
+{
+    if( dsk.g < 0 )
+        return;
+
+    const QString   &runName =
+                        mainApp()->cfgCtl()->acceptedParams.sns.runName;
+
+    QFile   f( QString("%1/%2.metrics.txt")
+                .arg( mainApp()->dataDir() )
+                .arg( runName ) );
+
+    if( f.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
+
+        QTextStream ts( &f );
+
+        ts << "Run: " << runName << "\n";
+        ts << "Time: "
+           << QDateTime::currentDateTime().toString( Qt::ISODate )
+           << "\n";
+        ts << "Latency stats (us) --------\n";
+        ts << MXStats::report();
+    }
+}
+
+
 void MetricsWindow::help()
 {
     showHelp( "Metrics_Help" );
@@ -53,9 +53,18 @@ private:
     struct MXPrfRec {
         QMap<int,int>   fifoPct;
         QMap<int,int>   awakePct;
-        void init() {fifoPct.clear(); awakePct.clear();}
+        int             audFifoUnder,
+                        audDevUnder;
+        MXPrfRec()  {init();}
+        void init()
+            {
+                fifoPct.clear(); awakePct.clear();
+                audFifoUnder = -1; audDevUnder = -1;
+            }
         void setFifo( int ip, int maxFifo )
             {fifoPct[ip]=maxFifo;}
+        void setAudio( int fifoUnder, int devUnder )
+            {audFifoUnder=fifoUnder; audDevUnder=devUnder;}
         void setAwake( int ip0, int ipN, int pct )
             {
                 for( int ip = ip0; ip <= ipN; ++ip )
@@ -86,7 +95,8 @@ private:
 
 private:
     Ui::MetricsWindow   *mxUI;
-    QTimer              mxTimer;
+    QTimer              mxTimer,
+                        dumpTimer;
     MXErrRec            err;
     MXPrfRec            prf;
     MXDiskRec           dsk;
@@ -124,6 +134,8 @@ public slots:
         {prf.setFifo( ip, maxFifo );}
     void prfUpdateAwake( int ip0, int ipN, int pct )
         {prf.setAwake( ip0, ipN, pct );}
+    void prfUpdateAudio( int fifoUnder, int devUnder )
+        {prf.setAudio( fifoUnder, devUnder );}
 
     void dskUpdateGT( int g, int t )
         {dsk.setGT( g, t );}
@@ -140,6 +152,7 @@ public slots:
 
 private slots:
     void updateMx();
+    void dumpStats();
     void help();
     void save();
 
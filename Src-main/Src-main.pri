@@ -2,18 +2,22 @@
 HEADERS += \
     $$PWD/ConsoleWindow.h \
     $$PWD/DataDirCtl.h \
+    $$PWD/LogQueue.h \
     $$PWD/Main_Actions.h \
     $$PWD/Main_Msg.h \
     $$PWD/Main_WinMenu.h \
     $$PWD/MainApp.h \
     $$PWD/MetricsWindow.h \
     $$PWD/MXLEDWidget.h \
+    $$PWD/MXStats.h \
+    $$PWD/MXTrace.h \
     $$PWD/Util.h \
     $$PWD/Version.h
 
 SOURCES += \
     $$PWD/ConsoleWindow.cpp \
     $$PWD/DataDirCtl.cpp \
+    $$PWD/LogQueue.cpp \
     $$PWD/main.cpp \
     $$PWD/Main_Actions.cpp \
     $$PWD/Main_Msg.cpp \
@@ -21,6 +25,8 @@ SOURCES += \
     $$PWD/MainApp.cpp \
     $$PWD/MetricsWindow.cpp \
     $$PWD/MXLEDWidget.cpp \
+    $$PWD/MXStats.cpp \
+    $$PWD/MXTrace.cpp \
     $$PWD/Util.cpp \
     $$PWD/Util_osdep.cpp
 
@@ -2,6 +2,7 @@
 #include "Util.h"
 #include "MainApp.h"
 #include "ConsoleWindow.h"
+#include "LogQueue.h"
 
 #include <ctime>
 #include <iostream>
@@ -14,6 +15,13 @@
 #include <QNetworkInterface>
 #include <QUrl>
 
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 /* ---------------------------------------------------------------- */
 /* Internal macros ------------------------------------------------ */
 /* ---------------------------------------------------------------- */
@@ -40,15 +48,22 @@ namespace Util {
 
 Log::Log()
     :   stream( &str, QIODevice::WriteOnly ),
+        level(LogQueue::lvlLog),
         doprt(true), doeco(false), dodsk(false)
 {
 }
 
 
+// Normally handed to the LogQueue thread;
+// synchronous before its start and after its stop.
+//
 Log::~Log()
 {
     if( doprt ) {
 
+        if( LogQueue::post( str, color, level, doeco, dodsk ) )
+            return;
+
         QString msg =
             QString("[Thd %1 CPU %2 %3] %4")
                 .arg( (quint64)QThread::currentThreadId() )
@@ -80,6 +95,7 @@ Log::~Log()
 Debug::~Debug()
 {
     color = Qt::darkBlue;
+    level = LogQueue::lvlDebug;
 
     MainApp *app = mainApp();
 
@@ -95,6 +111,7 @@ Debug::~Debug()
 Error::~Error()
 {
     color = Qt::darkRed;
+    level = LogQueue::lvlError;
 
     MainApp *app = mainApp();
 
@@ -118,6 +135,7 @@ Error::~Error()
 Warning::~Warning()
 {
     color = Qt::darkMagenta;
+    level = LogQueue::lvlWarning;
 
     MainApp *app = mainApp();
 
@@ -620,6 +638,19 @@ qint64 writeChunky( QFile &f, const void *src, qint64 bytes )
 }
 
 
+bool syncFile( QFile &f )
+{
+    if( !f.flush() )
+        return false;
+
+#ifdef Q_OS_WIN
+    return FlushFileBuffers( (HANDLE)_get_osfhandle( f.handle() ) );
+#else
+    return !fsync( f.handle() );
+#endif
+}
+
+
 // BK: I've retained the temp-file stuff for future reference.
 //
 // Remove all SpikeGL temp files
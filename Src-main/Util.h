@@ -49,6 +49,7 @@ private:
 protected:
     QString     str;
     QColor      color;
+    int         level;  // LogQueue::Level
     bool        doprt,  // debug() silent unless verbose mode
                 doeco,  // echo errors and warnings to metrics
                 dodsk;  // also record errors in runDir
@@ -241,6 +242,9 @@ qint64 readChunky( const QFile &f, void *dst, qint64 bytes );
 // Efficient version of QIODevice::write
 qint64 writeChunky( QFile &f, const void *src, qint64 bytes );
 
+// Flush f through OS cache to device
+bool syncFile( QFile &f );
+
 // Amount of space available on disk
 quint64 availableDiskSpace( int iDataDir = 0 );
 
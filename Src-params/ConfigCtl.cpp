@@ -33,6 +33,7 @@
 #include "ChanMapCtl.h"
 #include "ShankMapCtl.h"
 #include "ColorTTLCtl.h"
+#include "DFPlacer.h"
 #include "Subset.h"
 #include "SignalBlocker.h"
 #include "Version.h"
@@ -1952,7 +1953,10 @@ void ConfigCtl::diskButClicked()
         return;
     }
 
-    MainApp *app = mainApp();
+    MainApp         *app    = mainApp();
+    QVector<int>    prb2dir = DFPlacer::place( q );
+
+    DFPlacer::measureAsync();   // retry any failed volumes
 
     for( int idir = 0, ndir = app->nDataDirs(); idir < ndir; ++idir ) {
 
@@ -1964,7 +1968,7 @@ void ConfigCtl::diskButClicked()
 
             for( int ip = 0, np = q.im.get_nProbes(); ip < np; ++ip ) {
 
-                if( ip % ndir != idir )
+                if( prb2dir[ip] != idir )
                     continue;
 
                 const CimCfg::AttrEach  &E = q.im.each[ip];
@@ -3392,6 +3396,7 @@ void ConfigCtl::setupSnsTab( const DAQ::Params &p )
     snsTabUI->runNameLE->setText( p.sns.runName );
     snsTabUI->fldChk->setChecked( p.sns.fldPerPrb );
     snsTabUI->fldChk->setEnabled( imecOK );
+    snsTabUI->cmpChk->setChecked( p.sns.compress );
 
     snsTabUI->diskSB->setValue( p.sns.reqMins );
 
@@ -3757,6 +3762,7 @@ void ConfigCtl::paramsFromDialog(
     q.sns.notes             = snsTabUI->notesTE->toPlainText().trimmed();
     q.sns.runName           = snsTabUI->runNameLE->text().trimmed();
     q.sns.fldPerPrb         = snsTabUI->fldChk->isChecked();
+    q.sns.compress          = snsTabUI->cmpChk->isChecked();
     q.sns.reqMins           = snsTabUI->diskSB->value();
 }
 
@@ -4938,7 +4944,8 @@ bool ConfigCtl::validDiskAvail( QString &err, DAQ::Params &q ) const
     if( q.sns.reqMins <= 0 )
         return true;
 
-    MainApp *app = mainApp();
+    MainApp         *app    = mainApp();
+    QVector<int>    prb2dir = DFPlacer::place( q );
 
     for( int idir = 0, ndir = app->nDataDirs(); idir < ndir; ++idir ) {
 
@@ -4948,7 +4955,7 @@ bool ConfigCtl::validDiskAvail( QString &err, DAQ::Params &q ) const
 
             for( int ip = 0, np = q.im.get_nProbes(); ip < np; ++ip ) {
 
-                if( ip % ndir != idir )
+                if( prb2dir[ip] != idir )
                     continue;
 
                 const CimCfg::AttrEach  &E = q.im.each[ip];
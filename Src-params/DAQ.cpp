@@ -299,6 +299,9 @@ void Params::loadSettings( bool remote )
     sns.fldPerPrb =
     settings.value( "snsFldPerProbe", true ).toBool();
 
+    sns.compress =
+    settings.value( "snsCompress", false ).toBool();
+
     settings.endGroup();
 
 // ----
@@ -404,6 +407,7 @@ void Params::saveSettings( bool remote ) const
     settings.setValue( "snsReqMins", sns.reqMins );
     settings.setValue( "snsPairChk", sns.pairChk );
     settings.setValue( "snsFldPerProbe", sns.fldPerPrb );
+    settings.setValue( "snsCompress", sns.compress );
 
     settings.endGroup();
 
@@ -114,7 +114,8 @@ struct SeeNSave {
                     runName;
     int             reqMins;
     bool            pairChk,
-                    fldPerPrb;
+                    fldPerPrb,
+                    compress;   // lossless dbp1 .bin
 };
 
 struct Params {
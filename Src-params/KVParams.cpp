@@ -2,66 +2,100 @@
 #include "KVParams.h"
 #include "Util.h"
 
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
 
 
+#define MAX_CACHED  1024
 
-bool KVParams::parseOneLine( QString &line )
-{
-    line = line.trimmed();
 
-    if( !line.length() )
-        return true;
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
 
-/* ------------------------------------------ */
-/* Delete comments and ini-file group headers */
-/* ------------------------------------------ */
+struct MetaEntry {
+    QDateTime   mtime;
+    qint64      size;
+    KVParams    kvp;
 
-// Semicolons are a popular comment character. However,
-// ChanMap strings might include them, so exception is
-// made for anything called 'map'.
+    MetaEntry() : size(0)   {}
+};
 
-    QRegExp comment("(\\[|;|#|//).*");
+static QMutex                   cacheMtx;
+static QHash<QString,MetaEntry> metaCache;
 
-    if( !line.contains( "notes", Qt::CaseInsensitive )
-        && !line.contains( "map", Qt::CaseInsensitive )
-        && line.contains( comment ) ) {
 
-        Debug() << "Params comment skipped: '" << comment.cap(0) << "'";
-        line.replace( comment, QString() );
-        line = line.trimmed();
+static bool cacheGet( KVParams &kvp, const QFileInfo &fi )
+{
+    QMutexLocker    ml( &cacheMtx );
 
-        if( !line.length() )
-            return true;
+    QHash<QString,MetaEntry>::const_iterator
+        it = metaCache.find( fi.absoluteFilePath() );
+
+    if( it == metaCache.end()
+        || it->size != fi.size()
+        || it->mtime != fi.lastModified() ) {
+
+        return false;
     }
 
-/* -------------------------- */
-/* Capture (name)=(val) pairs */
-/* -------------------------- */
+    kvp = it->kvp;
+    return true;
+}
 
-    QRegExp re("([^=]+)=(.*)");
 
-    if( re.exactMatch( line ) ) {
+static void cachePut( const KVParams &kvp, const QFileInfo &fi )
+{
+    QMutexLocker    ml( &cacheMtx );
 
-        (*this)[re.cap(1).trimmed()] = re.cap(2).trimmed();
-        return true;
-    }
-    else {
-        Error() << "Bad params line [" << line << "].";
-        return false;
-    }
+    if( metaCache.size() >= MAX_CACHED )
+        metaCache.clear();
+
+    MetaEntry   &E = metaCache[fi.absoluteFilePath()];
+
+    E.mtime = fi.lastModified();
+    E.size  = fi.size();
+    E.kvp   = kvp;
+}
+
+
+static void cacheDrop( const QString &metaFile )
+{
+    QMutexLocker    ml( &cacheMtx );
+
+    metaCache.remove( QFileInfo( metaFile ).absoluteFilePath() );
+}
+
+/* ---------------------------------------------------------------- */
+/* KVParams ------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+bool KVParams::parseOneLine( const QString &line )
+{
+    return parseRef( QStringRef( &line ) );
 }
 
 
 bool KVParams::fromString( const QString &s )
 {
-    QTextStream ts( (QString*)&s, QIODevice::ReadOnly | QIODevice::Text );
-    QString     line;
-    bool        ok = true;
+    int     n   = s.size(),
+            i0  = 0;
+    bool    ok  = true;
 
     clear();
 
-    while( !(line = ts.readLine()).isNull() )
-        ok &= parseOneLine( line );
+    while( i0 < n ) {
+
+        int i1 = s.indexOf( QChar('\n'), i0 );
+
+        if( i1 < 0 )
+            i1 = n;
+
+        ok &= parseRef( s.midRef( i0, i1 - i0 ) );
+        i0  = i1 + 1;
+    }
 
     return ok;
 }
@@ -81,6 +115,11 @@ QString KVParams::toString() const
 
 bool KVParams::fromMetaFile( const QString &metaFile )
 {
+    QFileInfo   fi( metaFile );
+
+    if( cacheGet( *this, fi ) )
+        return true;
+
     QFile   f( metaFile );
 
     if( f.open( QIODevice::ReadOnly | QIODevice::Text ) ) {
@@ -90,8 +129,10 @@ bool KVParams::fromMetaFile( const QString &metaFile )
 
         if( ts.status() == QTextStream::Ok ) {
 
-            if( fromString( s ) )
+            if( fromString( s ) ) {
+                cachePut( *this, fi );
                 return true;
+            }
         }
         else {
             Error()
@@ -117,6 +158,8 @@ bool KVParams::fromMetaFile( const QString &metaFile )
 
 bool KVParams::toMetaFile( const QString &metaFile ) const
 {
+    cacheDrop( metaFile );
+
     QFile   f( metaFile );
 
     if( f.open( QIODevice::WriteOnly | QIODevice::Text ) ) {
@@ -147,3 +190,66 @@ bool KVParams::toMetaFile( const QString &metaFile ) const
 }
 
 
+// Return true unless line is malformed.
+//
+bool KVParams::parseRef( const QStringRef &_line )
+{
+    QStringRef  line = _line.trimmed();
+
+    if( !line.length() )
+        return true;
+
+/* ------------------------------------------ */
+/* Delete comments and ini-file group headers */
+/* ------------------------------------------ */
+
+// Semicolons are a popular comment character. However,
+// ChanMap strings might include them, so exception is
+// made for anything called 'map'.
+
+    if( !line.contains( QLatin1String("notes"), Qt::CaseInsensitive )
+        && !line.contains( QLatin1String("map"), Qt::CaseInsensitive ) ) {
+
+        const QChar *L = line.constData();
+        int         n  = line.length();
+
+        for( int i = 0; i < n; ++i ) {
+
+            ushort  c = L[i].unicode();
+
+            if( c == '[' || c == ';' || c == '#'
+                || (c == '/' && i + 1 < n && L[i+1] == QChar('/')) ) {
+
+                Debug()
+                    << "Params comment skipped: '"
+                    << line.mid( i ).toString() << "'";
+
+                line = line.left( i ).trimmed();
+
+                if( !line.length() )
+                    return true;
+
+                break;
+            }
+        }
+    }
+
+/* -------------------------- */
+/* Capture (name)=(val) pairs */
+/* -------------------------- */
+
+    int eq = line.indexOf( QChar('=') );
+
+    if( eq > 0 ) {
+
+        (*this)[line.left( eq ).trimmed().toString()] =
+            line.mid( eq + 1 ).trimmed().toString();
+        return true;
+    }
+    else {
+        Error() << "Bad params line [" << line.toString() << "].";
+        return false;
+    }
+}
+
+
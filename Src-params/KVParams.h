@@ -16,6 +16,11 @@ typedef QMap<QString,QVariant>  KeyValMap;
 // ('key=value' pairs) between an in-memory QMap
 // and QString or disk-file versions.
 //
+// Parsing is a single scan per line without regexps.
+// Parsed meta files are cached by path, and reused
+// while file size and modification time match, so
+// browsing a folder reads each file just once.
+//
 class KVParams : public KeyValMap
 {
 public:
@@ -24,13 +29,16 @@ public:
     KVParams( const QString &s ) : QMap()       {fromString( s );}
     virtual ~KVParams()                         {}
 
-    bool parseOneLine( QString &line );
+    bool parseOneLine( const QString &line );
 
     bool fromString( const QString &s );
     QString toString() const;
 
     bool fromMetaFile( const QString &metaFile );
     bool toMetaFile( const QString &metaFile ) const;
+
+private:
+    bool parseRef( const QStringRef &line );
 };
 
 #endif  // KVPARAMS_H
@@ -5,6 +5,91 @@
 #include <QTextStream>
 
 
+/* ---------------------------------------------------------------- */
+/* SubsetPlan ----------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+void SubsetPlan::compile( const QVector<uint> &iKeep, int nchans )
+{
+    runs.clear();
+    idx.clear();
+    this->nchans    = nchans;
+    nkeep           = iKeep.size();
+
+    for( int ik = 0; ik < nkeep; ++ik ) {
+
+        int c = iKeep[ik];
+
+        if( runs.size() && runs.back().src + runs.back().len == c )
+            ++runs.back().len;
+        else
+            runs.push_back( Run( c, 1 ) );
+    }
+
+    if( runs.size() > 1 && nkeep < SUBSET_MINRUN * (int)runs.size() )
+        idx.assign( iKeep.begin(), iKeep.end() );
+}
+
+
+// Given (nchans) src channels per timepoint, create
+// dst vector keeping only the planned channels.
+//
+// In-place operation (dst == src) is allowed.
+//
+void SubsetPlan::apply( vec_i16 &dst, vec_i16 &src ) const
+{
+    if( isAll() ) {
+
+        if( &dst != &src )
+            dst = src;
+
+        return;
+    }
+
+    int ntpts = (int)src.size() / nchans;
+
+    if( &dst != &src )
+        dst.resize( ntpts * nkeep );
+
+    if( ntpts && nkeep ) {
+
+        qint16          *D = &dst[0];
+        const qint16    *S = &src[0];
+
+        if( runs.size() == 1 ) {
+
+            // single run: one move per timepoint
+
+            int     c0      = runs[0].src,
+                    ncpy    = nkeep * sizeof(qint16);
+
+            for( int it = 0; it < ntpts; ++it, D += nkeep, S += nchans )
+                memmove( D, S + c0, ncpy );
+        }
+        else if( idx.size() ) {
+
+            // short runs: gather
+
+            const int   *K  = &idx[0];
+            int         nk  = nkeep,
+                        nc  = nchans;
+
+            for( int it = 0; it < ntpts; ++it, S += nc ) {
+
+                for( int ik = 0; ik < nk; ++ik )
+                    *D++ = S[K[ik]];
+            }
+        }
+        else {
+            for( int it = 0; it < ntpts; ++it, S += nchans )
+                D = applyTp( D, S );
+        }
+    }
+
+    if( &dst == &src )
+        dst.resize( ntpts * nkeep );
+}
+
 /* ---------------------------------------------------------------- */
 /* bits2Vec ------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
@@ -353,6 +438,10 @@ bool Subset::rngStr2Vec( QVector<uint> &v, const QString &s )
 //
 // In-place operation (dst == src) is allowed.
 //
+// Compiling a plan allocates; it is done only when the block
+// is long enough to repay it. Repeat callers should keep their
+// own SubsetPlan.
+//
 void Subset::subset(
     vec_i16             &dst,
     vec_i16             &src,
@@ -371,17 +460,25 @@ void Subset::subset(
 
     int ntpts = (int)src.size() / nchans;
 
+    if( ntpts >= SUBSET_PLANTPTS ) {
+        SubsetPlan( iKeep, nchans ).apply( dst, src );
+        return;
+    }
+
     if( &dst != &src )
         dst.resize( ntpts * nk );
 
-    const uint  *K = &iKeep[0];
-    qint16      *D = &dst[0],
-                *S = &src[0];
+    if( ntpts && nk ) {
 
-    for( int it = 0; it < ntpts; ++it, S += nchans ) {
+        const uint      *K = &iKeep[0];
+        qint16          *D = &dst[0];
+        const qint16    *S = &src[0];
 
-        for( int ik = 0; ik < nk; ++ik )
-            *D++ = S[K[ik]];
+        for( int it = 0; it < ntpts; ++it, S += nchans ) {
+
+            for( int ik = 0; ik < nk; ++ik )
+                *D++ = S[K[ik]];
+        }
     }
 
     if( &dst == &src )
@@ -430,6 +527,64 @@ void Subset::subsetBlock(
         dst.resize( ntpts * nk );
 }
 
+/* ---------------------------------------------------------------- */
+/* subsetAPLF ----------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// One pass over an imec block producing both saved streams:
+// - src is replaced by its AP-file subset (plan ap),
+// - lfDst gets the LF-file subset (plan lf) of every 12th
+//   timepoint, starting at src timepoint lf0.
+//
+// If xtra is non-null it is a full (nchans) timepoint emitted
+// to lfDst ahead of the X12 timepoints.
+//
+// An empty (or identity) ap plan leaves src as is.
+//
+void Subset::subsetAPLF(
+    vec_i16             &src,
+    vec_i16             &lfDst,
+    const SubsetPlan    &ap,
+    const SubsetPlan    &lf,
+    int                 lf0,
+    const qint16        *xtra )
+{
+    int nchans  = lf.nChans(),
+        ntpts   = (int)src.size() / nchans,
+        nl      = lf.nKeep(),
+        nx      = (lf0 < ntpts ? (ntpts - lf0 + 11) / 12 : 0);
+    bool    doAP = ap.nKeep() && !ap.isAll();
+
+    lfDst.resize( ((xtra ? 1 : 0) + nx) * nl );
+
+    if( !ntpts )
+        return;
+
+    qint16  *DA = &src[0],
+            *DL = (lfDst.size() ? &lfDst[0] : 0),
+            *S  = &src[0];
+
+    if( xtra )
+        DL = lf.applyTp( DL, xtra );
+
+// LF reads timepoint (it) before AP overwrites it in place;
+// AP writes for earlier timepoints all land below S.
+
+    for( int it = 0, nxt = lf0; it < ntpts; ++it, S += nchans ) {
+
+        if( it == nxt ) {
+            DL   = lf.applyTp( DL, S );
+            nxt += 12;
+        }
+
+        if( doAP )
+            DA = ap.applyTp( DA, S );
+    }
+
+    if( doAP )
+        src.resize( ntpts * ap.nKeep() );
+}
+
 /* ---------------------------------------------------------------- */
 /* downsample ----------------------------------------------------- */
 /* ---------------------------------------------------------------- */
@@ -7,10 +7,90 @@
 #include <QString>
 #include <QVector>
 
+#include <string.h>
+
+/* ---------------------------------------------------------------- */
+/* Macros --------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Plans whose runs average fewer channels than this gather by
+// index: per-run dispatch costs more than it saves (MainApp
+// test1 measures the crossover near 16).
+#define SUBSET_MINRUN       16
+
+// Subset::subset() compiles a plan only for blocks at least this
+// long (timepoints); shorter ones use the plain gather.
+#define SUBSET_PLANTPTS     1024
+
 /* ---------------------------------------------------------------- */
 /* Types ---------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
+// Channel subset compiled once per {iKeep[], nchans}.
+//
+// Kept indices are grouped into contiguous runs. If runs are
+// long (SUBSET_MINRUN), each timepoint copies run by run with
+// memmove; else it gathers channel by channel. iKeep[] must be
+// ascending (canonical) for in-place use.
+//
+class SubsetPlan
+{
+private:
+    struct Run {
+        int src,    // first src chan
+            len;    // chan count
+        Run( int src, int len ) : src(src), len(len)    {}
+    };
+
+private:
+    std::vector<Run>    runs;
+    std::vector<int>    idx;    // non-empty: gather mode
+    int                 nchans,
+                        nkeep;
+
+public:
+    SubsetPlan() : nchans(0), nkeep(0)  {}
+    SubsetPlan( const QVector<uint> &iKeep, int nchans )
+        {compile( iKeep, nchans );}
+
+    void compile( const QVector<uint> &iKeep, int nchans );
+
+    int nChans() const  {return nchans;}
+    int nKeep() const   {return nkeep;}
+    bool isAll() const  {return nkeep >= nchans;}
+
+    void apply( vec_i16 &dst, vec_i16 &src ) const;
+
+    // Gather one timepoint; returns D advanced by nKeep().
+    qint16 *applyTp( qint16 *D, const qint16 *S ) const
+    {
+        if( !idx.empty() ) {
+
+            const int   *K = &idx[0];
+
+            for( int ik = 0; ik < nkeep; ++ik )
+                D[ik] = S[K[ik]];
+
+            return D + nkeep;
+        }
+
+        for( int ir = 0, nr = runs.size(); ir < nr; ++ir ) {
+
+            const Run   &R = runs[ir];
+
+            if( R.len == 1 )
+                *D = S[R.src];
+            else
+                memmove( D, S + R.src, R.len * sizeof(qint16) );
+
+            D += R.len;
+        }
+
+        return D;
+    }
+};
+
+
 class Subset
 {
 public:
@@ -50,6 +130,14 @@ public:
         int                 cLim,
         int                 nchans );
 
+    static void subsetAPLF(
+        vec_i16             &src,
+        vec_i16             &lfDst,
+        const SubsetPlan    &ap,
+        const SubsetPlan    &lf,
+        int                 lf0,
+        const qint16        *xtra );
+
     static uint downsample(
         vec_i16         &dst,
         vec_i16         &src,
@@ -7,8 +7,12 @@
 #include "AOCtl.h"
 #include "AIQ.h"
 #include "Run.h"
+#include "MXStats.h"
+#include "MXTrace.h"
 #include "Sync.h"
 #include "Subset.h"
+#include "FetchFilter.h"
+#include "StreamSubscriber.h"
 #include "Sha1Verifier.h"
 #include "Par2Window.h"
 
@@ -26,6 +30,26 @@ static bool     allstop = false;
 static void     stopAll()   {QMutexLocker ml(&kilMtx); allstop=true;}
 static bool     allStop()   {QMutexLocker ml(&kilMtx); return allstop;}
 
+
+// Count of leading (ascending) iKeep entries that are neural
+// or analog; FIRDecim filters these, the rest are picked.
+//
+static int nAnalogKept(
+    const QVector<uint> &iKeep,
+    int                 ip,
+    const DAQ::Params   &p )
+{
+    int lim = (ip >= 0 ?
+                p.im.each[ip].imCumTypCnt[CimCfg::imSumNeural] :
+                p.ni.niCumTypCnt[CniCfg::niSumAnalog]),
+        n   = 0;
+
+    while( n < iKeep.size() && (int)iKeep[n] < lim )
+        ++n;
+
+    return n;
+}
+
 /* ---------------------------------------------------------------- */
 /* class CmdServer ------------------------------------------------ */
 /* ---------------------------------------------------------------- */
@@ -104,6 +128,15 @@ CmdWorker::~CmdWorker()
         par2 = 0;
     }
 
+    qDeleteAll( fetchFlt );
+    fetchFlt.clear();
+
+    qDeleteAll( fetchDec );
+    fetchDec.clear();
+
+    qDeleteAll( multiDec );
+    multiDec.clear();
+
     SockUtil::shutdown( sock );
 
     if( sock ) {
@@ -900,10 +933,20 @@ void CmdWorker::setDigOut( const QStringList &toks )
 // 2) scan count
 // 3) <channel subset pattern "id1#id2#...">
 // 4) <integer downsample factor>
+// 5) <filter spec "hp=300,lp=6000,car">
 //
 // Send( 'BINARY_DATA %d %d uint64(%ld)'\n", nChans, nScans, headCt ).
 // Write binary data stream.
 //
+// With a filter spec, the subset is filtered server-side before
+// downsampling (see FetchFilter.h). Downsampling is a streaming
+// anti-alias FIR (see FIRDecim.h) whose output k is centered on
+// scan (headCt + k*dnsmp). Filter and decimator state persist on
+// this connection, so a client reading contiguous spans gets
+// seamless output, but downsampled output trails the request by
+// 8*dnsmp scans (released by the next contiguous fetch), and a
+// reply may hold zero scans. A skip or rewind restarts the state.
+//
 void CmdWorker::fetch( const QStringList &toks )
 {
     if( toks.size() >= 3 ) {
@@ -969,6 +1012,23 @@ void CmdWorker::fetch( const QStringList &toks )
             if( toks.size() >= 5 )
                 dnsmp = toks.at( 4 ).toUInt();
 
+            // ------
+            // Filter
+            // ------
+
+            FetchFltSpec    flt;
+
+            if( toks.size() >= 6 ) {
+
+                QString err = flt.parse( toks.at( 5 ) );
+
+                if( !err.isEmpty() ) {
+                    errMsg = err;
+                    Warning() << err;
+                    return;
+                }
+            }
+
             // ---------------------------------
             // Fetch whole timepoints from queue
             // ---------------------------------
@@ -1007,21 +1067,50 @@ void CmdWorker::fetch( const QStringList &toks )
                 // Requested subset
                 // ----------------
 
-                if( chanBits.count( true ) < nChans ) {
+                QVector<uint>   iKeep;
+
+                Subset::bits2Vec( iKeep, chanBits );
 
-                    QVector<uint>   iKeep;
+                if( iKeep.size() < nChans ) {
 
-                    Subset::bits2Vec( iKeep, chanBits );
                     Subset::subset( data, data, iKeep, nChans );
                     nChans = iKeep.size();
                 }
 
+                int nIn = data.size() / nChans;
+
+                // ------
+                // Filter
+                // ------
+
+                if( toks.size() >= 6 && !flt.isNull() ) {
+
+                    FetchFilter *F = fetchFlt.value( ip, 0 );
+
+                    if( !F )
+                        fetchFlt[ip] = F = new FetchFilter;
+
+                    F->apply(
+                        data, fromCt, iKeep, flt, aiQ->sRate(), ip, p );
+                }
+
                 // ----------
                 // Downsample
                 // ----------
 
-                if( dnsmp > 1 )
-                    Subset::downsample( data, data, nChans, dnsmp );
+                quint64 headCt = fromCt;
+
+                if( dnsmp > 1 ) {
+
+                    FetchDecim  *D = fetchDec.value( ip, 0 );
+
+                    if( !D )
+                        fetchDec[ip] = D = new FetchDecim;
+
+                    D->apply(
+                        data, headCt, fromCt, iKeep,
+                        nAnalogKept( iKeep, ip, p ), dnsmp );
+                }
 
                 // ----
                 // Send
@@ -1033,10 +1122,13 @@ void CmdWorker::fetch( const QStringList &toks )
                     QString("BINARY_DATA %1 %2 uint64(%3)\n")
                     .arg( nChans )
                     .arg( size / nChans )
-                    .arg( fromCt ),
+                    .arg( headCt ),
                     true );
 
-                SU.sendBinary( &data[0], size*sizeof(qint16) );
+                if( size )
+                    SU.sendBinary( &data[0], size*sizeof(qint16) );
+
+                MXTrace::hit( ip, fromCt, nIn, "cmdsrv.send" );
             }
             else
                 Warning() << (errMsg = "FETCH: No data read from queue.");
@@ -1047,6 +1139,393 @@ void CmdWorker::fetch( const QStringList &toks )
 }
 
 
+// Expected tok params:
+// 0) source streamID
+// 1) starting scan index in source stream
+// 2) source scan count
+// 3) streamID list pattern "id1#id2#..."
+// 4) <integer downsample factor>
+//
+// The source span [fromCt, fromCt+scanCt) defines a time window;
+// fromCt must still be in the source queue. All listed streams'
+// starts are mapped together with syncDstTAbsMult (as triggers
+// do), and every stream is clipped to the duration all of them
+// can supply right now. All blocks are read from the queues
+// before any is sent, so one bad stream fails the whole request
+// and nothing partial goes out. Downsampling uses a per-stream
+// streaming decimator on this connection, as in FETCH: headCt is
+// the center of each block's first output, and a block may be
+// empty while the decimator awaits lookahead.
+//
+// For each listed stream, in order...
+// Send( 'BINARY_DATA %d %d uint64(%ld) %d %d'\n",
+//        nChans, nScans, headCt, streamID, bySync ).
+// Write binary data stream.
+//
+// Channels are each stream's save-channel subset.
+//
+void CmdWorker::fetchMulti( const QStringList &toks )
+{
+    if( toks.size() < 4 ) {
+        Warning() << (errMsg = "FETCHMULTI: Requires at least 4 params.");
+        return;
+    }
+
+    MainApp             *app    = mainApp();
+    const DAQ::Params   &p      = app->cfgCtl()->acceptedParams;
+    Run                 *run    = app->getRun();
+
+    quint64 srcCt   = toks.at( 1 ).toLongLong();
+    int     srcip   = toks.at( 0 ).toInt(),
+            srcN    = toks.at( 2 ).toInt(),
+            np      = p.im.get_nProbes(),
+            dnsmp   = (toks.size() >= 5 ? toks.at( 4 ).toInt() : 1);
+
+    if( srcN <= 0 ) {
+        Warning() << (errMsg = "FETCHMULTI: Scan count must be positive.");
+        return;
+    }
+
+    // ---------------
+    // Resolve streams
+    // ---------------
+
+    // vS[0] is the source; listed streams follow.
+
+    QStringList             sl  = toks.at( 3 ).split(
+                                    "#", QString::SkipEmptyParts );
+    int                     ns  = sl.size();
+    std::vector<SyncStream> vS( ns + 1 );
+
+    if( !ns ) {
+        Warning() << (errMsg = "FETCHMULTI: Empty stream list.");
+        return;
+    }
+
+    for( int is = 0; is <= ns; ++is ) {
+
+        int ip = (!is ? srcip : sl[is - 1].toInt());
+
+        if( ip < -1 || ip >= np ) {
+            errMsg =
+            QString("FETCHMULTI: StreamID must be in range [-1..%1].")
+            .arg( np - 1 );
+            Warning() << errMsg;
+            return;
+        }
+
+        const AIQ*  aiQ = (ip >= 0 ? run->getImQ( ip ) : run->getNiQ());
+
+        if( !aiQ ) {
+            errMsg =
+            QString("FETCHMULTI: Stream %1 not enabled.").arg( ip );
+            Warning() << errMsg;
+            return;
+        }
+
+        vS[is].init( aiQ, ip, p );
+    }
+
+    // ------------------------------
+    // Source count must be in queue
+    // ------------------------------
+
+    const SyncStream    &srcS = vS[0];
+
+    quint64 headCt  = srcS.Q->qHeadCt(),
+            endCt   = srcS.Q->endCount();
+
+    if( srcCt < headCt || srcCt >= endCt ) {
+        errMsg =
+        QString("FETCHMULTI: Source scan %1 outside queued range [%2..%3).")
+        .arg( srcCt ).arg( headCt ).arg( endCt );
+        Warning() << errMsg;
+        return;
+    }
+
+    // -----------------------------------------
+    // Map window start; clip to common duration
+    // -----------------------------------------
+
+    syncDstTAbsMult( srcCt, 0, vS, p );
+
+    std::vector<quint64>    vCt( ns );
+    double                  span = srcN / srcS.Q->sRate();
+
+    for( int is = 0; is < ns; ++is ) {
+
+        const SyncStream    &S = vS[is + 1];
+
+        if( S.ip == srcip ) {
+            S.tAbs      = srcS.tAbs;
+            S.bySync    = true;
+            vCt[is]     = srcCt;
+        }
+        else
+            vCt[is] = S.TAbs2Ct( S.tAbs );
+
+        endCt = S.Q->endCount();
+
+        if( vCt[is] >= endCt ) {
+            Warning() << (errMsg = "FETCHMULTI: Too early.");
+            return;
+        }
+
+        span = qMin( span, (endCt - vCt[is]) / S.Q->sRate() );
+    }
+
+    // -----------------------
+    // Read all before sending
+    // -----------------------
+
+    std::vector<vec_i16>    vD( ns );
+    std::vector<int>        vC( ns );
+
+    for( int is = 0; is < ns; ++is ) {
+
+        const SyncStream    &S      = vS[is + 1];
+        int                 nChans  = S.Q->nChans(),
+                            nMax    = qMax( int(span * S.Q->sRate()), 1 ),
+                            ret;
+
+        try {
+            vD[is].reserve( nChans * nMax );
+        }
+        catch( const std::exception& ) {
+            Warning() << (errMsg = "FETCHMULTI: Low mem.");
+            return;
+        }
+
+        ret = S.Q->getNScansFromCt( vD[is], vCt[is], nMax );
+
+        if( ret < 0 ) {
+            Warning() << (errMsg = "FETCHMULTI: Too late.");
+            return;
+        }
+
+        if( ret == 0 || vD[is].empty() ) {
+            Warning() << (errMsg = "FETCHMULTI: No data read from queue.");
+            return;
+        }
+
+        const QBitArray &saveBits =
+                (S.ip >= 0 ?
+                p.im.each[S.ip].sns.saveBits :
+                p.ni.sns.saveBits);
+
+        QVector<uint>   iKeep;
+
+        Subset::bits2Vec( iKeep, saveBits );
+
+        if( iKeep.size() < nChans ) {
+
+            Subset::subset( vD[is], vD[is], iKeep, nChans );
+            nChans = iKeep.size();
+        }
+
+        if( dnsmp > 1 ) {
+
+            FetchDecim  *D = multiDec.value( S.ip, 0 );
+
+            if( !D )
+                multiDec[S.ip] = D = new FetchDecim;
+
+            quint64 inCt = vCt[is];
+
+            D->apply(
+                vD[is], vCt[is], inCt, iKeep,
+                nAnalogKept( iKeep, S.ip, p ), dnsmp );
+        }
+
+        vC[is] = nChans;
+    }
+
+    // ----
+    // Send
+    // ----
+
+    for( int is = 0; is < ns; ++is ) {
+
+        int size = vD[is].size();
+
+        SU.send(
+            QString("BINARY_DATA %1 %2 uint64(%3) %4 %5\n")
+            .arg( vC[is] )
+            .arg( size / vC[is] )
+            .arg( vCt[is] )
+            .arg( vS[is + 1].ip )
+            .arg( vS[is + 1].bySync ),
+            true );
+
+        if( size )
+            SU.sendBinary( &vD[is][0], size*sizeof(qint16) );
+    }
+}
+
+
+// Expected tok params:
+// 0) streamID
+// 1) starting scan index (-1 = newest)
+// 2) <channel subset pattern "id1#id2#...">
+// 3) <integer downsample factor>
+// 4) <max queued blocks>
+//
+// Until client sends "UNSUBSCRIBE", repeatedly...
+// Send( 'BINARY_DATA %d %d uint64(%ld) uint64(%ld)'\n",
+//        nChans, nScans, headCt, nDropped ).
+// Write binary data stream.
+//
+// nDropped counts source scans lost just ahead of headCt
+// because the client's queue overflowed, or fell off the
+// stream's left edge (including scans the decimator held
+// awaiting lookahead).
+//
+void CmdWorker::subscribe( const QStringList &toks )
+{
+    if( toks.size() < 2 ) {
+        Warning() << (errMsg = "SUBSCRIBE: Requires at least 2 params.");
+        return;
+    }
+
+    MainApp             *app    = mainApp();
+    const DAQ::Params   &p      = app->cfgCtl()->acceptedParams;
+
+    int ip = toks.at( 0 ).toInt();
+
+    if( ip >= 0 ) {
+
+        int np = p.im.get_nProbes();
+
+        if( ip >= np ) {
+            errMsg =
+            QString("SUBSCRIBE: StreamID must be in range [-1..%1].")
+            .arg( np - 1 );
+            Warning() << errMsg;
+            return;
+        }
+    }
+
+    const AIQ*  aiQ =
+            (ip >= 0 ?
+            app->getRun()->getImQ( ip ) :
+            app->getRun()->getNiQ());
+
+    if( !aiQ ) {
+        Warning() << (errMsg = "SUBSCRIBE: Not running.");
+        return;
+    }
+
+// -----
+// Chans
+// -----
+
+    const QBitArray &allBits =
+            (ip >= 0 ?
+            p.im.each[ip].sns.saveBits :
+            p.ni.sns.saveBits);
+
+    QBitArray       chanBits;
+    QVector<uint>   iKeep;
+    int             nChans = aiQ->nChans();
+
+    if( toks.size() >= 3 ) {
+
+        QString err =
+            Subset::cmdStr2Bits(
+                chanBits, allBits, toks.at( 2 ), nChans );
+
+        if( !err.isEmpty() ) {
+            errMsg = err;
+            Warning() << err;
+            return;
+        }
+    }
+    else
+        chanBits = allBits;
+
+    Subset::bits2Vec( iKeep, chanBits );
+
+    if( iKeep.isEmpty() ) {
+        Warning() << (errMsg = "SUBSCRIBE: Channel subset is empty.");
+        return;
+    }
+
+// ------------------------
+// Downsample, queue bounds
+// ------------------------
+
+    qint64  fromCt      = toks.at( 1 ).toLongLong();
+    int     dnsmp       = 1,
+            maxBlocks   = 64;
+
+    if( toks.size() >= 4 )
+        dnsmp = qMax( toks.at( 3 ).toInt(), 1 );
+
+    if( toks.size() >= 5 )
+        maxBlocks = qMax( toks.at( 4 ).toInt(), 1 );
+
+// ----
+// Push
+// ----
+
+    StreamSubscriber    sub(
+                            aiQ, iKeep, fromCt,
+                            nAnalogKept( iKeep, ip, p ),
+                            dnsmp, maxBlocks );
+    SubscrBlock         B;
+    int                 nk = iKeep.size();
+
+    Debug()
+        << "Sub " << SU.tag() << SU.addr()
+        << " [stream " << ip << ", " << nk << " chans]";
+
+    while( !allStop() && SU.sockValid() ) {
+
+        if( sub.dequeue( B, 10 ) ) {
+
+            int size = B.data.size();
+
+            if( !SU.send(
+                    QString("BINARY_DATA %1 %2 uint64(%3) uint64(%4)\n")
+                    .arg( nk )
+                    .arg( size / nk )
+                    .arg( B.headCt )
+                    .arg( B.nDropped ) )
+                || !SU.sendBinary( &B.data[0], size*sizeof(qint16) ) ) {
+
+                return;
+            }
+        }
+        else if( sub.isStopped() ) {
+            errMsg = "SUBSCRIBE: Run stopped.";
+            break;
+        }
+
+        // Client ends session with a line (UNSUBSCRIBE).
+
+        if( sock->canReadLine() || sock->waitForReadyRead( 0 ) ) {
+
+            if( sock->canReadLine() ) {
+
+                QString line = SU.readLine().toUpper();
+
+                if( line.startsWith( "UNSUBSCRIBE" ) )
+                    break;
+
+                Warning()
+                    << "SUBSCRIBE: Ignoring [" << line
+                    << "] from " << SU.addr();
+            }
+        }
+    }
+
+    if( sub.droppedScans() ) {
+        Warning()
+            << "SUBSCRIBE: Client " << SU.addr()
+            << " dropped " << sub.droppedScans() << " scans.";
+    }
+}
+
 void CmdWorker::consoleShow( bool show )
 {
     QMetaObject::invokeMethod(
@@ -1261,6 +1740,15 @@ bool CmdWorker::doQuery( const QString &cmd, const QStringList &toks )
         isConsoleHidden( resp );
     else if( cmd == "MAPSAMPLE" )
         mapSample( resp, toks );
+    else if( cmd == "GETMETRICS" ) {
+
+        // Empty (not null) if nothing recorded yet
+
+        resp = MXStats::report();
+
+        if( resp.isNull() )
+            resp = "";
+    }
     else
         handled = false;
 
@@ -1331,6 +1819,10 @@ bool CmdWorker::doCommand( const QString &cmd, const QStringList &toks )
         setDigOut( toks );
     else if( cmd == "FETCH" )
         fetch( toks );
+    else if( cmd == "FETCHMULTI" )
+        fetchMulti( toks );
+    else if( cmd == "SUBSCRIBE" )
+        subscribe( toks );
     else if( cmd == "CONSOLEHIDE" )
         consoleShow( false );
     else if( cmd == "CONSOLESHOW" )
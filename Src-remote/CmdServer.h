@@ -3,10 +3,13 @@
 
 #include "SockUtil.h"
 
+#include <QMap>
 #include <QTcpServer>
 #include <QStringList>
 
 class Par2Worker;
+class FetchFilter;
+class FetchDecim;
 class MainApp;
 class ConfigCtl;
 class Run;
@@ -53,12 +56,15 @@ class CmdWorker : public QObject
     Q_OBJECT
 
 private:
-    QString     errMsg;
-    Par2Worker  *par2;
-    QTcpSocket  *sock;
-    SockUtil    SU;
-    qintptr     sockFd,     // socket 'file descriptor'
-                timeout;
+    QString                 errMsg;
+    QMap<int,FetchFilter*>  fetchFlt;   // streamID -> FETCH filter state
+    QMap<int,FetchDecim*>   fetchDec,   // streamID -> FETCH decimator
+                            multiDec;   // streamID -> FETCHMULTI decimator
+    Par2Worker              *par2;
+    QTcpSocket              *sock;
+    SockUtil                SU;
+    qintptr                 sockFd,     // socket 'file descriptor'
+                            timeout;
 
 public:
     CmdWorker( qintptr sockFd, int timeout )
@@ -109,6 +115,8 @@ private:
     void stopRun();
     void setDigOut( const QStringList &toks );
     void fetch( const QStringList &toks );
+    void fetchMulti( const QStringList &toks );
+    void subscribe( const QStringList &toks );
     void consoleShow( bool show );
     void verifySha1( QString file );
     void par2Start( QStringList toks );
@@ -39,6 +39,7 @@ void CmdSrvDlg::loadSettings( QSettings &S )
     p.port          = S.value( "port", CMD_DEF_PORT ).toUInt();
     p.timeout_ms    = S.value( "timeoutMS", CMD_TOUT_MS ).toInt();
     p.enabled       = S.value( "enabled", false ).toBool();
+    p.shmExport     = S.value( "shmExport", false ).toBool();
 
     S.endGroup();
 }
@@ -52,6 +53,7 @@ void CmdSrvDlg::saveSettings( QSettings &S ) const
     S.setValue( "port",  p.port );
     S.setValue( "timeoutMS", p.timeout_ms );
     S.setValue( "enabled", p.enabled );
+    S.setValue( "shmExport", p.shmExport );
 
     S.endGroup();
 }
@@ -134,6 +136,7 @@ void CmdSrvDlg::showOptionsDlg()
     cmdUI->portSB->setValue( p.port );
     cmdUI->toSB->setValue( p.timeout_ms );
     cmdUI->enabledGB->setChecked( p.enabled );
+    cmdUI->shmChk->setChecked( p.shmExport );
     ConnectUI( cmdUI->ipBut, SIGNAL(clicked()), this, SLOT(ipBut()) );
     ConnectUI( cmdUI->buttonBox, SIGNAL(accepted()), this, SLOT(okBut()) );
 
@@ -162,6 +165,7 @@ void CmdSrvDlg::okBut()
     p.port          = cmdUI->portSB->value();
     p.timeout_ms    = cmdUI->toSB->value();
     p.enabled       = cmdUI->enabledGB->isChecked();
+    p.shmExport     = cmdUI->shmChk->isChecked();
 
     if( startServer() ) {
         mainApp()->saveSettings();
@@ -26,7 +26,8 @@ private:
         QString iface;
         int     timeout_ms;
         quint16 port;
-        bool    enabled;
+        bool    enabled,
+                shmExport;
     };
 // Data
     CmdSrvParams        p;
@@ -40,6 +41,8 @@ public:
     void loadSettings( QSettings &S );
     void saveSettings( QSettings &S ) const;
 
+    bool isShmExport() const    {return p.shmExport;}
+
     bool startServer( bool isAppStartup = false );
     void showStartupMessage();
 
@@ -0,0 +1,260 @@
+
+#include "FetchFilter.h"
+#include "DAQ.h"
+#include "Biquad.h"
+
+
+// Sections of a 4th-order Butterworth lowpass.
+#define BW4_Q1      0.5412
+#define BW4_Q2      1.3066
+
+
+/* ---------------------------------------------------------------- */
+/* FetchFltSpec --------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Return error string, or empty if OK.
+//
+QString FetchFltSpec::parse( const QString &s )
+{
+    *this = FetchFltSpec();
+
+    foreach( const QString &item, s.split( ",", QString::SkipEmptyParts ) ) {
+
+        QStringList kv  = item.split( "=" );
+        QString     key = kv[0].trimmed().toLower();
+        bool        ok  = true;
+
+        if( key == "aa" )
+            ;
+        else if( key == "car" )
+            car = true;
+        else if( key == "hp" && kv.size() == 2 )
+            hp = kv[1].toDouble( &ok );
+        else if( key == "lp" && kv.size() == 2 )
+            lp = kv[1].toDouble( &ok );
+        else
+            ok = false;
+
+        if( !ok || hp < 0 || lp < 0 )
+            return QString("FETCH: Bad filter item '%1'.").arg( item );
+    }
+
+    return QString();
+}
+
+/* ---------------------------------------------------------------- */
+/* FetchFilter ---------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Filter (data) in-place. Data are already subsetted to iKeep
+// and not yet downsampled; iKeep must be ascending (as from
+// Subset::bits2Vec) so each channel group stays contiguous.
+//
+void FetchFilter::apply(
+    vec_i16             &data,
+    quint64             fromCt,
+    const QVector<uint> &iKeep,
+    const FetchFltSpec  &S,
+    double              srate,
+    int                 ip,
+    const DAQ::Params   &p )
+{
+    if( fromCt != nextCt
+        || S != spec
+        || iKeep != this->iKeep ) {
+
+        rebuild( iKeep, S, srate, ip, p );
+    }
+
+    int nC      = iKeep.size(),
+        ntpts   = (int)data.size() / nC;
+
+    nextCt = fromCt + ntpts;
+
+    if( !ntpts )
+        return;
+
+    qint16  *d = &data[0];
+
+    for( int ig = 0, ng = vG.size(); ig < ng; ++ig ) {
+
+        const Group &G = vG[ig];
+
+        if( G.hp )
+            G.hp->applyBlockwiseMem( d, maxInt, ntpts, nC, G.c0, G.cLim );
+
+        if( G.car )
+            applyCAR( d, ntpts, nC, G.c0, G.cLim );
+
+        if( G.lp1 ) {
+            G.lp1->applyBlockwiseMem( d, maxInt, ntpts, nC, G.c0, G.cLim );
+            G.lp2->applyBlockwiseMem( d, maxInt, ntpts, nC, G.c0, G.cLim );
+        }
+    }
+}
+
+
+void FetchFilter::clear()
+{
+    for( int ig = 0, ng = vG.size(); ig < ng; ++ig ) {
+
+        Group   &G = vG[ig];
+
+        if( G.hp )
+            delete G.hp;
+
+        if( G.lp1 ) {
+            delete G.lp1;
+            delete G.lp2;
+        }
+    }
+
+    vG.clear();
+}
+
+
+void FetchFilter::rebuild(
+    const QVector<uint> &iKeep,
+    const FetchFltSpec  &S,
+    double              srate,
+    int                 ip,
+    const DAQ::Params   &p )
+{
+    clear();
+
+    this->spec  = S;
+    this->iKeep = iKeep;
+
+// ------------------------------
+// Group bounds in source indices
+// ------------------------------
+
+    std::vector<int>    lim;    // cumulative bounds
+    std::vector<bool>   car;
+
+    if( ip >= 0 ) {
+
+        const CimCfg::AttrEach  &E = p.im.each[ip];
+
+        maxInt = E.roTbl->maxInt();
+
+        lim.push_back( E.imCumTypCnt[CimCfg::imSumAP] );
+        lim.push_back( E.imCumTypCnt[CimCfg::imSumNeural] );
+        car.push_back( true );
+        car.push_back( true );
+    }
+    else {
+
+        maxInt = 32768;
+
+        lim.push_back( p.ni.niCumTypCnt[CniCfg::niSumNeural] );
+        lim.push_back( p.ni.niCumTypCnt[CniCfg::niTypeMA] );
+        lim.push_back( p.ni.niCumTypCnt[CniCfg::niSumAnalog] );
+        car.push_back( true );
+        car.push_back( true );
+        car.push_back( false );
+    }
+
+// ----------------------------------
+// Map to contiguous subset positions
+// ----------------------------------
+
+    int nC = iKeep.size(),
+        k  = 0;
+
+    for( int ig = 0, ng = lim.size(); ig < ng; ++ig ) {
+
+        int c0 = k;
+
+        while( k < nC && (int)iKeep[k] < lim[ig] )
+            ++k;
+
+        if( k > c0 )
+            addGroup( c0, k, S.car && car[ig], srate );
+    }
+}
+
+
+void FetchFilter::addGroup(
+    int                 c0,
+    int                 cLim,
+    bool                car,
+    double              srate )
+{
+    Group   G;
+    double  lp = spec.lp;
+
+    G.c0    = c0;
+    G.cLim  = cLim;
+    G.car   = car;
+
+    if( spec.hp > 0 && spec.hp < 0.5 * srate )
+        G.hp = new Biquad( bq_type_highpass, spec.hp / srate );
+
+    if( lp > 0 && lp < 0.5 * srate ) {
+        G.lp1 = new Biquad( bq_type_lowpass, lp / srate, BW4_Q1 );
+        G.lp2 = new Biquad( bq_type_lowpass, lp / srate, BW4_Q2 );
+    }
+
+    vG.push_back( G );
+}
+
+
+// Subtract per-timepoint mean of channels [c0,cLim).
+//
+void FetchFilter::applyCAR( qint16 *d, int ntpts, int nC, int c0, int cLim )
+{
+    int n = cLim - c0;
+
+    if( n <= 1 )
+        return;
+
+    for( int it = 0; it < ntpts; ++it, d += nC ) {
+
+        int S = 0;
+
+        for( int ic = c0; ic < cLim; ++ic )
+            S += d[ic];
+
+        int A = S / n;
+
+        for( int ic = c0; ic < cLim; ++ic )
+            d[ic] = qBound( -32768, d[ic] - A, 32767 );
+    }
+}
+
+/* ---------------------------------------------------------------- */
+/* FetchDecim ----------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Replace (data), already subsetted to iKeep, with the outputs
+// released by this call; dstCt gets the input ct on which the
+// first is centered. Return output count (may be zero).
+//
+uint FetchDecim::apply(
+    vec_i16             &data,
+    quint64             &dstCt,
+    quint64             fromCt,
+    const QVector<uint> &iKeep,
+    int                 nAnalog,
+    int                 dnsmp )
+{
+    if( iKeep != this->iKeep
+        || dnsmp != dec.dnsmp()
+        || nAnalog != dec.nAnalog() ) {
+
+        this->iKeep = iKeep;
+        dec.init( iKeep.size(), nAnalog, dnsmp );
+    }
+
+    vec_i16 out;
+    int     nC = iKeep.size();
+    uint    n  = dec.feed( out, dstCt, &data[0], data.size() / nC, fromCt );
+
+    data.swap( out );
+
+    return n;
+}
+
+
@@ -0,0 +1,137 @@
+#ifndef FETCHFILTER_H
+#define FETCHFILTER_H
+
+#include "SGLTypes.h"
+#include "FIRDecim.h"
+
+#include <QString>
+#include <QVector>
+
+namespace DAQ {
+struct Params;
+}
+
+class Biquad;
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Optional FETCH processing, parsed from a comma-separated
+// spec like "hp=300,lp=6000,car".
+//
+// hp:  highpass corner (Hz); 0 = off.
+// lp:  lowpass corner (Hz); 0 = off.
+// car: common average reference.
+// aa:  no-op; accepted for older clients (FETCH decimation is
+//      always anti-aliased, see FIRDecim.h).
+//
+struct FetchFltSpec
+{
+    double  hp,
+            lp;
+    bool    car;
+
+    FetchFltSpec() : hp(0), lp(0), car(false)   {}
+
+    bool isNull() const {return !hp && !lp && !car;}
+    bool operator==( const FetchFltSpec &rhs ) const
+        {return hp == rhs.hp && lp == rhs.lp && car == rhs.car;}
+    bool operator!=( const FetchFltSpec &rhs ) const
+        {return !(*this == rhs);}
+
+    QString parse( const QString &s );
+};
+
+
+// Per-connection, per-stream filter state for FETCH.
+//
+// Biquads keep state across calls, so successive fetches of
+// contiguous spans are filtered seamlessly. If the client skips
+// or rewinds, or changes spec or subset, state is
+// rebuilt and the first BIQUAD_TRANS_WIDE output timepoints
+// will carry the usual start-up transient.
+//
+// Filters act on neural/analog channel groups (imec {AP, LF},
+// NI {MN, MA, XA}), each group independently. CAR is applied
+// within imec AP, imec LF, NI MN and NI MA. Sync and digital
+// channels pass untouched.
+//
+class FetchFilter
+{
+private:
+    struct Group {
+        Biquad  *hp,
+                *lp1,
+                *lp2;
+        int     c0,
+                cLim;
+        bool    car;
+
+        Group() : hp(0), lp1(0), lp2(0), c0(0), cLim(0), car(false)    {}
+    };
+
+private:
+    FetchFltSpec        spec;
+    QVector<uint>       iKeep;
+    std::vector<Group>  vG;
+    quint64             nextCt;
+    int                 maxInt;
+
+public:
+    FetchFilter() : nextCt(0), maxInt(0)    {}
+    virtual ~FetchFilter()  {clear();}
+
+    void apply(
+        vec_i16             &data,
+        quint64             fromCt,
+        const QVector<uint> &iKeep,
+        const FetchFltSpec  &S,
+        double              srate,
+        int                 ip,
+        const DAQ::Params   &p );
+
+private:
+    void clear();
+    void rebuild(
+        const QVector<uint> &iKeep,
+        const FetchFltSpec  &S,
+        double              srate,
+        int                 ip,
+        const DAQ::Params   &p );
+    void addGroup(
+        int                 c0,
+        int                 cLim,
+        bool                car,
+        double              srate );
+    void applyCAR( qint16 *d, int ntpts, int nC, int c0, int cLim );
+};
+
+
+// Per-connection, per-stream decimation state for FETCH.
+//
+// Wraps a streaming FIRDecim so successive fetches of contiguous
+// spans are downsampled seamlessly. Outputs trail the input by
+// 8 x dnsmp scans of filter lookahead; the rest are released by
+// the next contiguous fetch. If the client skips or rewinds, or
+// changes subset or dnsmp, the decimator restarts (edge-extended).
+//
+class FetchDecim
+{
+private:
+    FIRDecim        dec;
+    QVector<uint>   iKeep;
+
+public:
+    uint apply(
+        vec_i16             &data,
+        quint64             &dstCt,
+        quint64             fromCt,
+        const QVector<uint> &iKeep,
+        int                 nAnalog,
+        int                 dnsmp );
+};
+
+#endif  // FETCHFILTER_H
+
+
@@ -1,9 +1,11 @@
 
 #include "RgtServer.h"
 #include "Util.h"
+#include "MXStats.h"
 #include "SockUtil.h"
 
-#include <QHostAddress>
+#include <QThread>
+#include <QUdpSocket>
 
 
 #define GREETING    "XOXO"
@@ -12,6 +14,8 @@
 #define SETTRIGHI   "SETTRIG 1"
 #define SETTRIGLO   "SETTRIG 0"
 #define SETMETA     "SETMETA"
+#define SESSION     "SESSION"
+#define BYE         "BYE"
 #define METAEND     "METAEND"
 #define OK          "OK"
 
@@ -190,20 +194,333 @@ bool rgtSetMetaData(
     return epilogue( SETMETA, err, SU );
 }
 
+/* ---------------------------------------------------------------- */
+/* RgtStreamWorker ------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+void RgtStreamWorker::run()
+{
+    if( tcp )
+        runTCP();
+    else
+        runUDP();
+
+    emit finished();
+}
+
+
+void RgtStreamWorker::runTCP()
+{
+    SockUtil    SU( tcp, 0, "RgtSession" );
+    QString     who = SU.addr();
+    bool        bye = false;
+
+    SU.setLowLatency();
+
+    Log() << QString("RgtSrv session opened %1.").arg( who );
+
+    while( !bye && !isStopped()
+        && tcp->state() == QAbstractSocket::ConnectedState ) {
+
+        if( !tcp->canReadLine() && !tcp->waitForReadyRead( RGT_LOOP_MS ) )
+            continue;
+
+        double  tRecv = getTime();
+
+        while( tcp->canReadLine() ) {
+
+            QString line = QString::fromUtf8( tcp->readLine() ).trimmed();
+
+            if( line.startsWith( BYE ) ) {
+                bye = true;
+                break;
+            }
+
+            if( line.length() )
+                tcp->write( exec( line, who, tRecv ).toUtf8() );
+        }
+
+        tcp->flush();
+    }
+
+    report( who, peers[who] );
+
+    SockUtil::shutdown( tcp );
+    delete tcp;
+    tcp = 0;
+}
+
+
+void RgtStreamWorker::runUDP()
+{
+    QUdpSocket  udp;
+
+    if( !udp.bind( addr, port ) ) {
+        Error() << QString("Gate/Trigger UDP could not bind (%1:%2) [%3].")
+                    .arg( addr.toString() )
+                    .arg( port )
+                    .arg( udp.errorString() );
+        return;
+    }
+
+    Log() << QString("Gate/Trigger server listening on UDP (%1:%2).")
+                .arg( addr.toString() )
+                .arg( port );
+
+    QByteArray  dg;
+
+    while( !isStopped() ) {
+
+        if( !udp.hasPendingDatagrams() && !udp.waitForReadyRead( RGT_LOOP_MS ) )
+            continue;
+
+        double  tRecv = getTime();
+
+        while( udp.hasPendingDatagrams() ) {
+
+            QHostAddress    from;
+            quint16         fport;
+
+            dg.resize( qMax( udp.pendingDatagramSize(), qint64(1) ) );
+
+            qint64  n = udp.readDatagram( dg.data(), dg.size(), &from, &fport );
+
+            if( n <= 0 )
+                continue;
+
+            QString who = QString("(%1:%2)").arg( from.toString() ).arg( fport ),
+                    reply;
+
+            foreach( const QString &line,
+                QString::fromUtf8( dg.constData(), n )
+                .split( '\n', QString::SkipEmptyParts ) ) {
+
+                QString cmd = line.trimmed();
+
+                if( cmd.length() )
+                    reply += exec( cmd, who, tRecv );
+            }
+
+            if( reply.length() )
+                udp.writeDatagram( reply.toUtf8(), from, fport );
+        }
+    }
+
+    QMap<QString,Peer>::const_iterator  it, end = peers.end();
+
+    for( it = peers.begin(); it != end; ++it )
+        report( it.key(), it.value() );
+}
+
+
+// Apply one command; return reply line.
+//
+QString RgtStreamWorker::exec(
+    const QString   &line,
+    const QString   &who,
+    double          tRecv )
+{
+    static MXHist   *mxCmd = MXStats::hist( "rgt.cmd_us" );
+    static MXHist   *mxJit = MXStats::hist( "rgt.jitter_us" );
+
+    QStringList s = line.split( QRegExp("\\s+"), QString::SkipEmptyParts );
+    bool        ok;
+    quint64     seq = s[0].toULongLong( &ok );
+
+    if( !ok || s.size() < 3 )
+        return QString("ERR %1 bad format\n").arg( s[0] );
+
+// Parse fully before the command counts against seq
+
+    bool    isTrig = s[1] == "SETTRIG";
+
+    if( !isTrig && s[1] != "SETGATE" )
+        return QString("ERR %1 unknown cmd\n").arg( seq );
+
+    if( s[2] != "0" && s[2] != "1" )
+        return QString("ERR %1 bad level '%2'\n").arg( seq ).arg( s[2] );
+
+    bool    hi = s[2] == "1";
+
+// Stamps (SETTRIG only), then optional trailing send time
+
+    KeyValMap   kvm;
+    double      tSend = -1;
+
+    for( int i = 3, n = s.size(); i < n; ++i ) {
+
+        int     eq  = s[i].indexOf( '=' );
+
+        if( eq > 0 ) {
+
+            QString key = s[i].left( eq );
+
+            if( !isTrig
+                || (key != "ip" && key != "ct"
+                    && key != "t" && key != "pre") ) {
+
+                return QString("ERR %1 unknown key '%2'\n")
+                        .arg( seq ).arg( key );
+            }
+
+            kvm[key] = s[i].mid( eq + 1 );
+        }
+        else if( i == n - 1 ) {
+
+            tSend = s[i].toDouble( &ok );
+
+            if( !ok ) {
+                return QString("ERR %1 bad token '%2'\n")
+                        .arg( seq ).arg( s[i] );
+            }
+        }
+        else {
+            return QString("ERR %1 bad token '%2'\n")
+                    .arg( seq ).arg( s[i] );
+        }
+    }
+
+    Peer    &P = peers[who];
+
+// Repeats: ack only
+
+    if( P.nCmd && seq <= P.lastSeq ) {
+        ++P.nRep;
+        return QString(OK " %1\n").arg( seq );
+    }
+
+    if( P.nCmd && seq > P.lastSeq + 1 ) {
+
+        P.nGap += seq - P.lastSeq - 1;
+
+        Warning() << QString("RgtSrv %1 missed seq %2..%3.")
+                        .arg( who ).arg( P.lastSeq + 1 ).arg( seq - 1 );
+    }
+
+    P.lastSeq = seq;
+    ++P.nCmd;
+
+// Apply
+
+    if( isTrig ) {
+
+        if( kvm.isEmpty() )
+            emit rgtSetTrig( hi );
+        else {
+
+            QString err;
+
+            emit rgtSetTrigAt( hi, kvm, &err );
+
+            if( !err.isEmpty() )
+                return QString("ERR %1 %2\n").arg( seq ).arg( err );
+        }
+    }
+    else
+        emit rgtSetGate( hi );
+
+    mxCmd->recordSince( tRecv );
+
+// Jitter: delivery delay relative to the fastest seen,
+// which cancels the unknown client clock offset.
+
+    if( tSend >= 0 ) {
+
+        double  dly = tRecv - tSend;
+
+        if( !P.nStamp++ || dly < P.minDelay )
+            P.minDelay = dly;
+
+        mxJit->record( quint64(1e6 * (dly - P.minDelay)) );
+    }
+
+    return QString(OK " %1\n").arg( seq );
+}
+
+
+void RgtStreamWorker::report( const QString &who, const Peer &P )
+{
+    Log() <<
+        QString("RgtSrv stream %1 closed: %2 cmds, %3 missed, %4 repeats.")
+        .arg( who ).arg( P.nCmd ).arg( P.nGap ).arg( P.nRep );
+}
+
+/* ---------------------------------------------------------------- */
+/* RgtStream ------------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+// Stream commands reach RgtServer signals (and their Run
+// slots) by direct connection, on the stream thread.
+//
+RgtStream::RgtStream(
+    RgtServer           *srv,
+    QTcpSocket          *tcp,
+    const QHostAddress  &addr,
+    quint16             port )
+{
+    thread  = new QThread;
+    worker  = new RgtStreamWorker( tcp, addr, port );
+
+    worker->moveToThread( thread );
+
+    if( tcp )
+        tcp->moveToThread( thread );
+
+    Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
+    Connect( worker, SIGNAL(finished()), thread, SLOT(quit()), Qt::DirectConnection );
+    Connect( worker, SIGNAL(rgtSetGate(bool)), srv, SIGNAL(rgtSetGate(bool)), Qt::DirectConnection );
+    Connect( worker, SIGNAL(rgtSetTrig(bool)), srv, SIGNAL(rgtSetTrig(bool)), Qt::DirectConnection );
+    Connect( worker, SIGNAL(rgtSetTrigAt(bool,KeyValMap,QString*)), srv, SIGNAL(rgtSetTrigAt(bool,KeyValMap,QString*)), Qt::DirectConnection );
+
+    thread->start();
+}
+
+
+RgtStream::~RgtStream()
+{
+    if( thread->isRunning() ) {
+
+        worker->stop();
+        thread->wait();
+    }
+
+    delete thread;
+    delete worker;
+}
+
+
+bool RgtStream::isFinished() const
+{
+    return thread->isFinished();
+}
+
 /* ---------------------------------------------------------------- */
 /* Server-side message handling ----------------------------------- */
 /* ---------------------------------------------------------------- */
 
 RgtServer::RgtServer( QObject *parent )
-    :   QTcpServer(parent), timeout_msecs(RGT_TOUT_MS)
+    :   QTcpServer(parent), udp(0), timeout_msecs(RGT_TOUT_MS)
 {
 }
 
 
+RgtServer::~RgtServer()
+{
+    qDeleteAll( sessions );
+    sessions.clear();
+
+    if( udp ) {
+        delete udp;
+        udp = 0;
+    }
+}
+
+
 bool RgtServer::beginListening(
     const QString   &iface,
     ushort          port,
-    int             timeout_ms )
+    int             timeout_ms,
+    bool            withUDP )
 {
     QHostAddress    haddr;
 
@@ -228,21 +545,46 @@ bool RgtServer::beginListening(
                 .arg( haddr.toString() )
                 .arg( port );
 
+    if( withUDP )
+        udp = new RgtStream( this, 0, haddr, port );
+
     return true;
 }
 
 
-void RgtServer::incomingConnection( int sockFd )
+// Single commands are handled here on the GUI thread;
+// a SESSION hands the socket to its own stream thread.
+//
+void RgtServer::incomingConnection( qintptr sockFd )
 {
-    QTcpSocket  sock;
+    static MXHist   *mxConn = MXStats::hist( "rgt.conn_us" );
+
+    double      t0      = getTime();
+    QTcpSocket  *sock   = new QTcpSocket;
+
+    sock->setSocketDescriptor( sockFd );
 
-    sock.setSocketDescriptor( sockFd );
+    if( processConnection( *sock ) ) {
 
-    processConnection( sock );
+        for( int i = sessions.size() - 1; i >= 0; --i ) {
+
+            if( sessions[i]->isFinished() )
+                delete sessions.takeAt( i );
+        }
+
+        sessions.append( new RgtStream( this, sock, QHostAddress(), 0 ) );
+        return;
+    }
+
+    mxConn->recordSince( t0 );
+
+    delete sock;
 }
 
 
-void RgtServer::processConnection( QTcpSocket &sock )
+// Return true if client requested a SESSION.
+//
+bool RgtServer::processConnection( QTcpSocket &sock )
 {
     QString     line, cmd, err;
     SockUtil    SU( &sock, timeout_msecs, "RgtSrv", &err );
@@ -255,7 +597,7 @@ void RgtServer::processConnection( QTcpSocket &sock )
 
         Error() << QString("RgtSrv test err %1%2 [%3]")
                     .arg( SU.tag() ).arg( SU.addr() ).arg( err );
-        return;
+        return false;
     }
 
 // -------------
@@ -266,7 +608,7 @@ void RgtServer::processConnection( QTcpSocket &sock )
 
         Error() << QString("RgtSrv send greeting err %1%2 [%3]")
                     .arg( SU.tag() ).arg( SU.addr() ).arg( err );
-        return;
+        return false;
     }
 
 // -------------
@@ -279,15 +621,46 @@ void RgtServer::processConnection( QTcpSocket &sock )
 
         Error() << QString("RgtSrv empty cmd err %1%2 [%3]")
                     .arg( SU.tag() ).arg( SU.addr() ).arg( err );
-        return;
+        return false;
     }
 
     cmd = line.trimmed();
 
-    if( cmd.startsWith( "SETGATE" ) )
+    if( cmd.startsWith( SESSION ) ) {
+
+        return SU.send( OK "\n" );
+    }
+    else if( cmd.startsWith( "SETGATE" ) )
         emit rgtSetGate( cmd.startsWith( SETGATEHI ) );
-    else if( cmd.startsWith( "SETTRIG" ) )
-        emit rgtSetTrig( cmd.startsWith( SETTRIGHI ) );
+    else if( cmd.startsWith( "SETTRIG" ) ) {
+
+        // Optional stamp: SETTRIG 0|1 key=val ...
+
+        QStringList s = cmd.split( QRegExp("\\s+"), QString::SkipEmptyParts );
+        KeyValMap   kvm;
+
+        for( int i = 2, n = s.size(); i < n; ++i ) {
+
+            int eq = s[i].indexOf( '=' );
+
+            if( eq > 0 )
+                kvm[s[i].left( eq )] = s[i].mid( eq + 1 );
+        }
+
+        if( kvm.isEmpty() )
+            emit rgtSetTrig( cmd.startsWith( SETTRIGHI ) );
+        else {
+
+            QString rej;
+
+            emit rgtSetTrigAt( cmd.startsWith( SETTRIGHI ), kvm, &rej );
+
+            if( !rej.isEmpty() ) {
+                SU.send( QString("ERR %1\n").arg( rej ) );
+                return false;
+            }
+        }
+    }
     else if( cmd.startsWith( "SETMETA" ) ) {
 
         KVParams    kvp;
@@ -300,7 +673,7 @@ void RgtServer::processConnection( QTcpSocket &sock )
     else {
         Error() << QString("RgtSrv unknown cmd err %1%2 [%3]")
                     .arg( SU.tag() ).arg( SU.addr() ).arg( cmd );
-        return;
+        return false;
     }
 
 // -----------
@@ -311,7 +684,7 @@ void RgtServer::processConnection( QTcpSocket &sock )
 
         Error() << QString("RgtSrv send OK err %1%2 [%3]")
                     .arg( SU.tag() ).arg( SU.addr() ).arg( err );
-        return;
+        return false;
     }
 
 // ----
@@ -320,6 +693,8 @@ void RgtServer::processConnection( QTcpSocket &sock )
 
     Debug() << QString("RgtSrv processed %1%2 [%3]")
                 .arg( SU.tag() ).arg( SU.addr() ).arg( cmd );
+
+    return false;
 }
 
 }   // namespace ns_RgtServer
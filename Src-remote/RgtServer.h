@@ -3,8 +3,13 @@
 
 #include "KVParams.h"
 
+#include <QHostAddress>
+#include <QMap>
+#include <QMutex>
 #include <QTcpServer>
 
+class QTcpSocket;
+
 /* ---------------------------------------------------------------- */
 /* Types ---------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
@@ -14,6 +19,7 @@ namespace ns_RgtServer
 
 #define RGT_DEF_PORT    52521
 #define RGT_TOUT_MS     1000
+#define RGT_LOOP_MS     100
 
 /* ---------------------------------------------------------------- */
 /* Remote messages to server app ---------------------------------- */
@@ -56,31 +62,128 @@ bool rgtSetMetaData(
 /* Server-side message handling ----------------------------------- */
 /* ---------------------------------------------------------------- */
 
+// Low-latency command stream, either a persistent TCP session
+// (client sends SESSION instead of a single command) or UDP
+// datagrams to the server port. Each line (or datagram) is:
+//
+//     <seq> SETGATE|SETTRIG 0|1 [key=val ...] [<tsend>]
+//
+// seq is the client's increasing command number; optional tsend
+// (client clock, seconds) is used only to measure delivery jitter.
+// SETTRIG key=val stamps (ip, ct or t, pre) place the edge at an
+// exact stream sample (see TrigTCP::rgtSetTrigAt); a stamp that
+// can't be applied is answered ERR with the reason.
+// Each command is answered "OK <seq>" or "ERR <seq> <reason>".
+// A malformed line (unknown command, level other than 0|1, unknown
+// key, or any other stray token) is rejected without advancing seq.
+// A repeated (or older) seq is acknowledged but not re-applied,
+// so UDP clients may resend until acked. TCP clients end the
+// session with BYE or by closing the socket.
+//
+// Commands execute directly on the stream thread (the GUI event
+// loop is not involved); command latency and jitter are recorded
+// as MXStats rgt.cmd_us and rgt.jitter_us.
+//
+class RgtStreamWorker : public QObject
+{
+    Q_OBJECT
+
+private:
+    struct Peer {
+        quint64 lastSeq;
+        double  minDelay;
+        quint32 nCmd,
+                nGap,
+                nRep,
+                nStamp;
+        Peer() : lastSeq(0), minDelay(0), nCmd(0), nGap(0), nRep(0), nStamp(0) {}
+    };
+
+    QMap<QString,Peer>  peers;
+    QTcpSocket          *tcp;       // null for UDP
+    QHostAddress        addr;
+    quint16             port;
+    mutable QMutex      runMtx;
+    volatile bool       pleaseStop;
+
+public:
+    RgtStreamWorker(
+        QTcpSocket          *tcp,
+        const QHostAddress  &addr,
+        quint16             port )
+    :   QObject(0), tcp(tcp), addr(addr), port(port), pleaseStop(false)   {}
+    virtual ~RgtStreamWorker()  {}
+
+    void stop()             {QMutexLocker ml( &runMtx ); pleaseStop = true;}
+    bool isStopped() const  {QMutexLocker ml( &runMtx ); return pleaseStop;}
+
+signals:
+    void rgtSetGate( bool hi );
+    void rgtSetTrig( bool hi );
+    void rgtSetTrigAt( bool hi, const KeyValMap &kvm, QString *err );
+    void finished();
+
+public slots:
+    void run();
+
+private:
+    void runTCP();
+    void runUDP();
+    QString exec( const QString &line, const QString &who, double tRecv );
+    void report( const QString &who, const Peer &P );
+};
+
+
+class RgtServer;
+
+class RgtStream
+{
+private:
+    QThread         *thread;
+    RgtStreamWorker *worker;
+
+public:
+    RgtStream(
+        RgtServer           *srv,
+        QTcpSocket          *tcp,
+        const QHostAddress  &addr,
+        quint16             port );
+    virtual ~RgtStream();
+
+    bool isFinished() const;
+};
+
+
 class RgtServer : public QTcpServer
 {
     Q_OBJECT
 
 private:
-    int timeout_msecs;
+    QList<RgtStream*>   sessions;
+    RgtStream           *udp;
+    int                 timeout_msecs;
 
 public:
     RgtServer( QObject *parent );
+    virtual ~RgtServer();
 
     bool beginListening(
         const QString   &iface = "127.0.0.1",
         ushort          port = RGT_DEF_PORT,
-        int             timeout_ms = RGT_TOUT_MS );
+        int             timeout_ms = RGT_TOUT_MS,
+        bool            withUDP = false );
 
 signals:
     void rgtSetGate( bool hi );
     void rgtSetTrig( bool hi );
+    void rgtSetTrigAt( bool hi, const KeyValMap &kvm, QString *err );
     void rgtSetMetaData( const KeyValMap &kvm );
 
 protected:
-    void incomingConnection( int sockFd ); // from QTcpServer
+    virtual void incomingConnection( qintptr sockFd );  // from QTcpServer
 
 private:
-    void processConnection( QTcpSocket &sock );
+    bool processConnection( QTcpSocket &sock );
 };
 
 }   // namespace ns_RgtServer
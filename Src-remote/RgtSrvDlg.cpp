@@ -38,6 +38,7 @@ void RgtSrvDlg::loadSettings( QSettings &S )
     p.port          = S.value( "port", RGT_DEF_PORT ).toUInt();
     p.timeout_ms    = S.value( "timeoutMS", RGT_TOUT_MS ).toInt();
     p.enabled       = S.value( "enabled", false ).toBool();
+    p.udp           = S.value( "udp", false ).toBool();
 
     S.endGroup();
 }
@@ -51,6 +52,7 @@ void RgtSrvDlg::saveSettings( QSettings &S ) const
     S.setValue( "port",  p.port );
     S.setValue( "timeoutMS", p.timeout_ms );
     S.setValue( "enabled", p.enabled );
+    S.setValue( "udp", p.udp );
 
     S.endGroup();
 }
@@ -70,7 +72,7 @@ bool RgtSrvDlg::startServer( bool isAppStrtup )
 
         rgtServer = new ns_RgtServer::RgtServer( app );
 
-        if( !rgtServer->beginListening( p.iface, p.port, p.timeout_ms ) ) {
+        if( !rgtServer->beginListening( p.iface, p.port, p.timeout_ms, p.udp ) ) {
 
             if( !isAppStrtup ) {
 
@@ -89,8 +91,11 @@ bool RgtSrvDlg::startServer( bool isAppStrtup )
             return false;
         }
 
-        Connect( rgtServer, SIGNAL(rgtSetGate(bool)), run, SLOT(rgtSetGate(bool)) );
-        Connect( rgtServer, SIGNAL(rgtSetTrig(bool)), run, SLOT(rgtSetTrig(bool)) );
+        // Direct: session/UDP commands apply on their own thread
+
+        Connect( rgtServer, SIGNAL(rgtSetGate(bool)), run, SLOT(rgtSetGate(bool)), Qt::DirectConnection );
+        Connect( rgtServer, SIGNAL(rgtSetTrig(bool)), run, SLOT(rgtSetTrig(bool)), Qt::DirectConnection );
+        Connect( rgtServer, SIGNAL(rgtSetTrigAt(bool,KeyValMap,QString*)), run, SLOT(rgtSetTrigAt(bool,KeyValMap,QString*)), Qt::DirectConnection );
         Connect( rgtServer, SIGNAL(rgtSetMetaData(KeyValMap)), run, SLOT(rgtSetMetaData(KeyValMap)) );
     }
     else
@@ -138,6 +143,7 @@ void RgtSrvDlg::showOptionsDlg()
     rgtUI->portSB->setValue( p.port );
     rgtUI->toSB->setValue( p.timeout_ms );
     rgtUI->enabledGB->setChecked( p.enabled );
+    rgtUI->udpChk->setChecked( p.udp );
     ConnectUI( rgtUI->ipBut, SIGNAL(clicked()), this, SLOT(ipBut()) );
     ConnectUI( rgtUI->buttonBox, SIGNAL(accepted()), this, SLOT(okBut()) );
 
@@ -166,6 +172,7 @@ void RgtSrvDlg::okBut()
     p.port          = rgtUI->portSB->value();
     p.timeout_ms    = rgtUI->toSB->value();
     p.enabled       = rgtUI->enabledGB->isChecked();
+    p.udp           = rgtUI->udpChk->isChecked();
 
     if( startServer() ) {
         mainApp()->saveSettings();
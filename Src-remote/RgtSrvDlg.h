@@ -28,7 +28,8 @@ private:
         QString iface;
         int     timeout_ms;
         quint16 port;
-        bool    enabled;
+        bool    enabled,
+                udp;
     };
 // Data
     RgtSrvParams            p;
@@ -2,15 +2,19 @@
 HEADERS += \
     $$PWD/CmdSrvDlg.h \
     $$PWD/CmdServer.h \
+    $$PWD/FetchFilter.h \
     $$PWD/RgtServer.h \
     $$PWD/RgtSrvDlg.h \
-    $$PWD/SockUtil.h
+    $$PWD/SockUtil.h \
+    $$PWD/StreamSubscriber.h
 
 SOURCES += \
     $$PWD/CmdSrvDlg.cpp \
     $$PWD/CmdServer.cpp \
+    $$PWD/FetchFilter.cpp \
     $$PWD/RgtServer.cpp \
     $$PWD/RgtSrvDlg.cpp \
-    $$PWD/SockUtil.cpp
+    $$PWD/SockUtil.cpp \
+    $$PWD/StreamSubscriber.cpp
 
 
@@ -0,0 +1,277 @@
+
+#include "StreamSubscriber.h"
+#include "Util.h"
+#include "AIQ.h"
+#include "Subset.h"
+
+#include <QThread>
+
+
+#define MAXBLOCK_SECS   0.1
+
+
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Registry lets Run::stopRun() halt all producers
+// before the AIQs they read are deleted.
+
+static QMutex                   regMtx;
+static QList<StreamSubscriber*> regList;
+
+/* ---------------------------------------------------------------- */
+/* SubscrWorker --------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+SubscrWorker::SubscrWorker(
+    const AIQ           *aiQ,
+    const QVector<uint> &iKeep,
+    qint64              fromCt,
+    int                 nAnalog,
+    int                 dnsmp,
+    int                 maxBlocks )
+    :   QObject(0), aiQ(aiQ), iKeep(iKeep),
+        nextCt(fromCt >= 0 ? fromCt : UNSET64),
+        pendDrop(0), totDrop(0), nChans(aiQ->nChans()),
+        dnsmp(qMax( dnsmp, 1 )), maxBlocks(qMax( maxBlocks, 1 )),
+        pleaseStop(false)
+{
+    plan.compile( iKeep, nChans );
+    dec.init( iKeep.size(), nAnalog, this->dnsmp );
+
+    maxScans = qMax( int(MAXBLOCK_SECS * aiQ->sRate()), this->dnsmp );
+    maxScans -= maxScans % this->dnsmp;
+}
+
+
+// Return true if block B was filled.
+//
+bool SubscrWorker::dequeue( SubscrBlock &B, int waitMs )
+{
+    QMutexLocker    ml( &qMtx );
+
+    if( Q.empty() && !isStopped() )
+        condQ.wait( &qMtx, waitMs );
+
+    if( Q.empty() )
+        return false;
+
+    B = Q.front();
+    Q.pop_front();
+
+    return true;
+}
+
+
+quint64 SubscrWorker::droppedScans() const
+{
+    QMutexLocker    ml( &qMtx );
+
+    return totDrop;
+}
+
+
+void SubscrWorker::stop()
+{
+    runMtx.lock();
+    pleaseStop = true;
+    runMtx.unlock();
+
+    QMutexLocker    ml( &qMtx );
+    condQ.wakeAll();
+}
+
+
+void SubscrWorker::run()
+{
+    const int   loopPeriod_us = 1000 * daqAIFetchPeriodMillis();
+
+    while( !isStopped() ) {
+
+        double  loopT = getTime();
+
+        fetch();
+
+        // Fetch no more often than every loopPeriod_us
+
+        loopT = 1e6*(getTime() - loopT);    // microsec
+
+        if( loopT < loopPeriod_us )
+            QThread::usleep( loopPeriod_us - loopT );
+        else
+            QThread::usleep( 1000 );
+    }
+
+    emit finished();
+}
+
+
+void SubscrWorker::fetch()
+{
+    quint64 endCt = aiQ->endCount();
+
+// First pass: start at newest if requested
+
+    if( nextCt == (quint64)UNSET64 )
+        nextCt = endCt;
+
+    if( nextCt >= endCt )
+        return;
+
+// Skip ahead if stream has overwritten our position
+
+    quint64 headCt = aiQ->qHeadCt();
+
+    if( nextCt < headCt ) {
+        pendDrop    += headCt - nextCt + dec.pendingScans();
+        nextCt      = headCt;
+    }
+
+    int nMax = qMin( endCt - nextCt, (quint64)maxScans );
+
+    SubscrBlock B;
+
+    try {
+        B.data.reserve( nMax * nChans );
+    }
+    catch( const std::exception& ) {
+        Warning() << "SUBSCRIBE low mem; will retry.";
+        return;
+    }
+
+    if( 1 != aiQ->getNScansFromCt( B.data, nextCt, nMax ) )
+        return;
+
+    int ntpts = B.data.size() / nChans;
+
+    if( !ntpts )
+        return;
+
+    quint64 srcCt = nextCt;
+
+    nextCt += ntpts;
+
+    if( !plan.isAll() )
+        plan.apply( B.data, B.data );
+
+// Decimator restarts itself if we skipped ahead (its pending
+// scans were counted above); otherwise outputs still awaiting
+// lookahead come next pass.
+
+    if( dnsmp > 1 ) {
+
+        vec_i16 raw;
+
+        raw.swap( B.data );
+
+        uint    nOut = dec.feed( B.data, B.headCt, &raw[0], ntpts, srcCt );
+
+        if( !nOut )
+            return;
+
+        B.nSrcScans = nOut * dnsmp;
+    }
+    else {
+        B.headCt    = srcCt;
+        B.nSrcScans = ntpts;
+    }
+
+    B.nDropped  = pendDrop;
+    pendDrop    = 0;
+
+    push( B );
+}
+
+
+// Bounded enqueue: discard oldest blocks,
+// charging their scans to the new front block.
+//
+void SubscrWorker::push( SubscrBlock &B )
+{
+    QMutexLocker    ml( &qMtx );
+
+    totDrop += B.nDropped;
+
+    while( (int)Q.size() >= maxBlocks ) {
+
+        quint64 lost = Q.front().nDropped + Q.front().nSrcScans;
+
+        totDrop += Q.front().nSrcScans;
+        Q.pop_front();
+
+        if( Q.empty() )
+            B.nDropped += lost;
+        else
+            Q.front().nDropped += lost;
+    }
+
+    Q.push_back( B );
+    condQ.wakeAll();
+}
+
+/* ---------------------------------------------------------------- */
+/* StreamSubscriber ----------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+StreamSubscriber::StreamSubscriber(
+    const AIQ           *aiQ,
+    const QVector<uint> &iKeep,
+    qint64              fromCt,
+    int                 nAnalog,
+    int                 dnsmp,
+    int                 maxBlocks )
+{
+    thread  = new QThread;
+    worker  = new SubscrWorker(
+                aiQ, iKeep, fromCt, nAnalog, dnsmp, maxBlocks );
+
+    worker->moveToThread( thread );
+
+    Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
+    Connect( worker, SIGNAL(finished()), thread, SLOT(quit()), Qt::DirectConnection );
+
+    regMtx.lock();
+    regList.append( this );
+    regMtx.unlock();
+
+    thread->start();
+}
+
+
+// Unlike GraphFetcher, the worker is not auto-deleted:
+// the socket thread may still be draining its queue
+// after the producer has stopped.
+//
+StreamSubscriber::~StreamSubscriber()
+{
+    regMtx.lock();
+    regList.removeOne( this );
+    regMtx.unlock();
+
+    stopAndWait();
+
+    delete thread;
+    delete worker;
+}
+
+
+void StreamSubscriber::stopAll()
+{
+    QMutexLocker    ml( &regMtx );
+
+    foreach( StreamSubscriber *S, regList )
+        S->stopAndWait();
+}
+
+
+void StreamSubscriber::stopAndWait()
+{
+    if( thread->isRunning() ) {
+
+        worker->stop();
+        thread->wait();
+    }
+}
+
+
@@ -0,0 +1,123 @@
+#ifndef STREAMSUBSCRIBER_H
+#define STREAMSUBSCRIBER_H
+
+#include "Subset.h"
+#include "FIRDecim.h"
+
+#include <QObject>
+#include <QMutex>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <deque>
+
+class AIQ;
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// One contiguous span of subsetted, downsampled timepoints.
+//
+struct SubscrBlock {
+    vec_i16 data;
+    quint64 headCt,     // src index of first timepoint
+            nSrcScans,  // src timepoints spanned by block
+            nDropped;   // src timepoints lost just before block
+
+    SubscrBlock() : headCt(0), nSrcScans(0), nDropped(0)  {}
+};
+
+// Producer side of a CmdServer SUBSCRIBE session.
+//
+// Polls the AIQ at the acquisition fetch rate, applies the channel
+// subset and downsampling once per new block, and queues the result
+// for the socket thread. Downsampling is a streaming anti-alias FIR
+// (FIRDecim), so blocks join seamlessly, but each block trails the
+// stream by 8 x dnsmp scans of filter lookahead. The queue is
+// bounded: if the client can't keep up, the oldest blocks are
+// discarded and their scans tallied in the nDropped field of the
+// next block delivered. If the stream overwrites our position, the
+// skipped scans, and those the decimator held awaiting lookahead,
+// are tallied the same way.
+//
+class SubscrWorker : public QObject
+{
+    Q_OBJECT
+
+private:
+    const AIQ               *aiQ;
+    QVector<uint>           iKeep;
+    SubsetPlan              plan;
+    FIRDecim                dec;
+    std::deque<SubscrBlock> Q;
+    mutable QMutex          qMtx,
+                            runMtx;
+    QWaitCondition          condQ;
+    quint64                 nextCt,
+                            pendDrop,
+                            totDrop;
+    int                     nChans,
+                            dnsmp,
+                            maxBlocks,
+                            maxScans;
+    volatile bool           pleaseStop;
+
+public:
+    SubscrWorker(
+        const AIQ           *aiQ,
+        const QVector<uint> &iKeep,
+        qint64              fromCt,
+        int                 nAnalog,
+        int                 dnsmp,
+        int                 maxBlocks );
+    virtual ~SubscrWorker() {}
+
+    bool dequeue( SubscrBlock &B, int waitMs );
+    quint64 droppedScans() const;
+
+    void stop();
+    bool isStopped() const  {QMutexLocker ml( &runMtx ); return pleaseStop;}
+
+signals:
+    void finished();
+
+public slots:
+    void run();
+
+private:
+    void fetch();
+    void push( SubscrBlock &B );
+};
+
+
+class StreamSubscriber
+{
+private:
+    QThread         *thread;
+    SubscrWorker    *worker;
+
+public:
+    StreamSubscriber(
+        const AIQ           *aiQ,
+        const QVector<uint> &iKeep,
+        qint64              fromCt,
+        int                 nAnalog,
+        int                 dnsmp,
+        int                 maxBlocks );
+    virtual ~StreamSubscriber();
+
+    bool dequeue( SubscrBlock &B, int waitMs )
+        {return worker->dequeue( B, waitMs );}
+    quint64 droppedScans() const    {return worker->droppedScans();}
+    bool isStopped() const          {return worker->isStopped();}
+
+    static void stopAll();
+
+private:
+    void stopAndWait();
+};
+
+#endif  // STREAMSUBSCRIBER_H
+
+
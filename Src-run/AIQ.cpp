@@ -1,5 +1,7 @@
 
 #include "AIQ.h"
+#include "AIQShm.h"
+#include "MXStats.h"
 #include "Util.h"
 
 
@@ -191,18 +193,57 @@ void RingFltWalker::filter()
 
 AIQ::AIQ( double srate, int nchans, int capacitySecs )
     :   srate(srate), nchans(nchans), bufmax(capacitySecs * srate),
-        tzero(0), endCt(0), bufhead(0), buflen(0)
+        shm(0), tzero(0), endCt(0), bufhead(0), buflen(0)
 {
     buf.resize( SAMPS(bufmax) );
 }
 
 
+AIQ::~AIQ()
+{
+    if( shm ) {
+        delete shm;
+        shm = 0;
+    }
+}
+
+
+void AIQ::setTZero( double t0 )
+{
+    tzero = t0;
+
+    if( shm )
+        shm->setTZero( t0 );
+}
+
+
+// Mirror all subsequent enqueues into a shared-memory ring
+// spanning ringSecs (capped at this queue's own span), for
+// same-host clients. Call before acquisition starts.
+//
+bool AIQ::shmExport( int ip, int ringSecs )
+{
+    shm = new AIQShm;
+
+    if( !shm->create( ip, srate, nchans, qMin( int(ringSecs * srate), bufmax ) ) ) {
+        delete shm;
+        shm = 0;
+        return false;
+    }
+
+    return true;
+}
+
+
 // Fill with (tLim-t0)*srate zero samples.
 //
 void AIQ::enqueueZero( double t0, double tLim )
 {
     int nCts = (tLim - t0) * srate;
 
+    if( shm )
+        shm->writeZero( nCts );
+
     QMutexLocker    ml( &QMtx );
 
     endCt += nCts;
@@ -233,8 +274,17 @@ void AIQ::enqueueZero( double t0, double tLim )
 
 void AIQ::enqueue( const qint16 *src, int nCts )
 {
+    static MXHist   *mxLock = MXStats::hist( "aiq.lockwait_us" );
+
+    if( shm )
+        shm->write( src, nCts );
+
+    double  t0 = getTime();
+
     QMutexLocker    ml( &QMtx );
 
+    mxLock->recordSince( t0 );
+
     endCt += nCts;
 
     if( nCts >= bufmax ) {
@@ -267,6 +317,9 @@ void AIQ::enqueueProfile(
     const qint16    *src,
     int             nCts )
 {
+    if( shm )
+        shm->write( src, nCts );
+
     double  t, t0 = getTime();
 
     QMutexLocker    ml( &QMtx );
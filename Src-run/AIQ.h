@@ -9,6 +9,8 @@
 
 #include <QMutex>
 
+class AIQShm;
+
 /* ---------------------------------------------------------------- */
 /* Types ---------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
@@ -43,6 +45,7 @@ private:
                     bufmax;
     vec_i16         buf;
     mutable QMutex  QMtx;
+    AIQShm          *shm;
     double          tzero;
     quint64         endCt;
     int             bufhead,
@@ -54,14 +57,17 @@ private:
 
 public:
     AIQ( double srate, int nchans, int capacitySecs );
+    virtual ~AIQ();
 
     double sRate() const        {return srate;}
     double chanRate() const     {return nchans * srate;}
     int nChans() const          {return nchans;}
 
-    void setTZero( double t0 )  {tzero = t0;}
+    void setTZero( double t0 );
     double tZero() const        {return tzero;}
 
+    bool shmExport( int ip, int ringSecs );
+
     void enqueueZero( double t0, double tLim );
 
     void enqueue( const qint16 *src, int nCts );
@@ -0,0 +1,335 @@
+
+#include "AIQShm.h"
+#include "Util.h"
+#include "SGLTypes.h"
+
+#include <QMutex>
+
+#include <new>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// The directory stays mapped for the life of the process;
+// its content persists while any client holds it.
+
+static QMutex       dirMtx;
+static ShmRingDir   *dir = 0;
+
+
+static ShmRingDir *openDir()
+{
+    if( dir )
+        return dir;
+
+    char    cname[64];
+    void    *base = 0;
+
+    shmDirName( cname );
+
+#ifdef Q_OS_WIN
+    HANDLE  h = CreateFileMappingA(
+                INVALID_HANDLE_VALUE,
+                NULL,
+                PAGE_READWRITE,
+                0,
+                sizeof(ShmRingDir),
+                cname );
+
+    if( h )
+        base = MapViewOfFile( h, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(ShmRingDir) );
+#else
+    int fd = shm_open( cname, O_CREAT | O_RDWR, 0644 );
+
+    if( fd >= 0 ) {
+
+        struct stat st;
+
+        if( !fstat( fd, &st )
+            && (st.st_size >= (off_t)sizeof(ShmRingDir)
+                || !ftruncate( fd, sizeof(ShmRingDir) )) ) {
+
+            base = mmap( 0, sizeof(ShmRingDir),
+                    PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+            if( base == MAP_FAILED )
+                base = 0;
+        }
+
+        ::close( fd );
+    }
+#endif
+
+    if( !base )
+        return 0;
+
+// New mappings are zero-filled: every gen = 0
+
+    dir = (ShmRingDir*)base;
+
+    if( memcmp( dir->magic, SHMDIR_MAGIC, sizeof(dir->magic) ) )
+        memcpy( dir->magic, SHMDIR_MAGIC, sizeof(dir->magic) );
+
+    return dir;
+}
+
+/* ---------------------------------------------------------------- */
+/* AIQShm --------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+AIQShm::AIQShm()
+    :   hdr(0), ring(0), ringScans(0), mapBytes(0), nchans(0),
+#ifdef Q_OS_WIN
+        hMap(0)
+#else
+        fd(-1)
+#endif
+{
+}
+
+
+// Each run maps a fresh generation of the stream's ring, so
+// clients still holding an older one never block us. Names
+// still held (Windows) are skipped.
+//
+bool AIQShm::create( int ip, double srate, int nchans, int ringScans )
+{
+    close();
+
+    QMutexLocker    ml( &dirMtx );
+
+    ShmRingDir  *D      = openDir();
+    int         slot    = shmDirSlot( ip );
+
+    if( !D || slot < 0 ) {
+        Warning() << "ShmExport: Can't open stream directory.";
+        return false;
+    }
+
+    this->nchans    = nchans;
+    this->ringScans = ringScans;
+    mapBytes        = shmRingBytes( ringScans, nchans );
+
+// ---------------
+// Map new segment
+// ---------------
+
+    char        cname[64];
+    void        *base   = 0;
+    uint32_t    gen     = D->gen[slot].load( std::memory_order_acquire );
+    bool        busy    = true;
+
+    for( int tries = 0; !base && busy && tries < 16; ++tries ) {
+
+        if( !++gen )
+            ++gen;
+
+        shmRingName( cname, ip, gen );
+        base = mapNew( cname, busy );
+    }
+
+    name = cname;
+
+    if( !base ) {
+        Warning() << "ShmExport: Can't create " << name << ".";
+        close();
+        return false;
+    }
+
+// -----------
+// Fill header
+// -----------
+
+    hdr = new (base) ShmRingHdr;
+    memset( hdr->rsv, 0, sizeof(hdr->rsv) );
+    memcpy( hdr->magic, SHMRING_MAGIC, sizeof(hdr->magic) );
+    hdr->version    = SHMRING_VERSION;
+    hdr->hdrBytes   = sizeof(ShmRingHdr);
+    hdr->ip         = ip;
+    hdr->nChans     = nchans;
+    hdr->ringScans  = ringScans;
+    hdr->srate      = srate;
+    hdr->tZero.store( 0, std::memory_order_relaxed );
+    hdr->wrEndCt.store( 0, std::memory_order_relaxed );
+    hdr->endCt.store( 0, std::memory_order_relaxed );
+
+// Publish: header complete before alive, alive before gen
+
+    hdr->alive.store( 1, std::memory_order_release );
+    D->gen[slot].store( gen, std::memory_order_release );
+
+    ring = (qint16*)((char*)base + sizeof(ShmRingHdr));
+
+    Log()
+        << "ShmExport: " << name << " ["
+        << ringScans / srate << " s, "
+        << mapBytes / (1024*1024) << " MB].";
+
+    return true;
+}
+
+
+// Map a new segment named cname; return base or null.
+// Set busy if the name is still held by a client.
+//
+void *AIQShm::mapNew( const char *cname, bool &busy )
+{
+    busy = false;
+
+#ifdef Q_OS_WIN
+    hMap = CreateFileMappingA(
+            INVALID_HANDLE_VALUE,
+            NULL,
+            PAGE_READWRITE,
+            DWORD(mapBytes >> 32),
+            DWORD(mapBytes & 0xFFFFFFFF),
+            cname );
+
+    if( !hMap )
+        return 0;
+
+    if( GetLastError() == ERROR_ALREADY_EXISTS ) {
+        CloseHandle( hMap );
+        hMap    = 0;
+        busy    = true;
+        return 0;
+    }
+
+    return MapViewOfFile( hMap, FILE_MAP_ALL_ACCESS, 0, 0, mapBytes );
+#else
+    shm_unlink( cname );
+
+    fd = shm_open( cname, O_CREAT | O_EXCL | O_RDWR, 0644 );
+
+    if( fd < 0 ) {
+        busy = (errno == EEXIST);
+        return 0;
+    }
+
+    void    *base = 0;
+
+    if( ftruncate( fd, mapBytes ) == 0 ) {
+
+        base = mmap( 0, mapBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+
+        if( base == MAP_FAILED )
+            base = 0;
+    }
+
+    return base;
+#endif
+}
+
+
+void AIQShm::close()
+{
+    if( hdr ) {
+
+        hdr->alive.store( 0, std::memory_order_release );
+
+#ifdef Q_OS_WIN
+        UnmapViewOfFile( hdr );
+#else
+        munmap( hdr, mapBytes );
+#endif
+
+        hdr     = 0;
+        ring    = 0;
+    }
+
+#ifdef Q_OS_WIN
+    if( hMap ) {
+        CloseHandle( hMap );
+        hMap = 0;
+    }
+#else
+    if( fd >= 0 ) {
+        ::close( fd );
+        fd = -1;
+        shm_unlink( STR2CHR( name ) );
+    }
+#endif
+}
+
+
+void AIQShm::setTZero( double t0 )
+{
+    if( hdr )
+        hdr->tZero.store( t0, std::memory_order_release );
+}
+
+
+void AIQShm::write( const qint16 *src, int nCts )
+{
+    if( !hdr )
+        return;
+
+    if( (quint64)nCts > ringScans ) {
+        // Keep only newest ringScans-worth.
+        quint64 skip = nCts - ringScans;
+        quint64 end  = hdr->endCt.load( std::memory_order_relaxed ) + skip;
+        hdr->wrEndCt.store( end, std::memory_order_relaxed );
+        hdr->endCt.store( end, std::memory_order_release );
+        src  += skip * nchans;
+        nCts  = ringScans;
+    }
+
+    put( src, nCts );
+}
+
+
+void AIQShm::writeZero( int nCts )
+{
+    if( !hdr )
+        return;
+
+    vec_i16 zero( qMin( (quint64)nCts, ringScans ) * nchans, 0 );
+    quint64 end = hdr->endCt.load( std::memory_order_relaxed );
+
+    if( (quint64)nCts > ringScans ) {
+        end += nCts - ringScans;
+        hdr->wrEndCt.store( end, std::memory_order_relaxed );
+        hdr->endCt.store( end, std::memory_order_release );
+        nCts = ringScans;
+    }
+
+    put( &zero[0], nCts );
+}
+
+
+void AIQShm::put( const qint16 *src, int nCts )
+{
+    quint64 end     = hdr->endCt.load( std::memory_order_relaxed );
+    int     slot    = end % ringScans,
+            ncpy1   = qMin( (quint64)nCts, ringScans - slot );
+
+// Announce the slots about to be overwritten
+
+    hdr->wrEndCt.store( end + nCts, std::memory_order_relaxed );
+    std::atomic_thread_fence( std::memory_order_release );
+
+    memcpy( &ring[slot * nchans], src, ncpy1 * nchans * sizeof(qint16) );
+
+    if( nCts > ncpy1 ) {
+        memcpy( &ring[0], &src[ncpy1 * nchans],
+            (nCts - ncpy1) * nchans * sizeof(qint16) );
+    }
+
+// Publish
+
+    hdr->endCt.store( end + nCts, std::memory_order_release );
+}
+
+
@@ -0,0 +1,64 @@
+#ifndef AIQSHM_H
+#define AIQSHM_H
+
+#include "ShmRingFmt.h"
+
+#include <QString>
+
+/* ---------------------------------------------------------------- */
+/* Macros --------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Ring span; independent of (usually longer) AIQ span.
+#define SHMEXPORT_SECS  4
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Writer side of the shared-memory stream export (see ShmRingFmt.h).
+//
+// An AIQ owns one of these when export is enabled and mirrors each
+// enqueue into it. Same-host clients map the ring read-only and copy
+// straight from it: no socket, no server-side copy per client.
+//
+// Single producer: write() and writeZero() must only be called
+// from the thread that enqueues to the owning AIQ.
+//
+class AIQShm
+{
+private:
+    QString     name;
+    ShmRingHdr  *hdr;
+    qint16      *ring;
+    quint64     ringScans,
+                mapBytes;
+    int         nchans;
+#ifdef Q_OS_WIN
+    void        *hMap;
+#else
+    int         fd;
+#endif
+
+public:
+    AIQShm();
+    virtual ~AIQShm()   {close();}
+
+    bool create( int ip, double srate, int nchans, int ringScans );
+    void close();
+
+    bool isOpen() const {return hdr != 0;}
+
+    void setTZero( double t0 );
+
+    void write( const qint16 *src, int nCts );
+    void writeZero( int nCts );
+
+private:
+    void *mapNew( const char *cname, bool &busy );
+    void put( const qint16 *src, int nCts );
+};
+
+#endif  // AIQSHM_H
+
+
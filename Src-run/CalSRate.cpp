@@ -12,59 +12,175 @@
 
 #include <math.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CALSR_SSE2
+#include <emmintrin.h>
+#endif
+
 
 //#define EDGEFILES
 
 
 
 
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Append to E each offset i in [0,n) where the sync level goes
+// from low to high. Level is (x & mask) if mask, else (x > thresh).
+// isHi carries the level across successive blocks.
+//
+static void risingEdges(
+    std::vector<int>    &E,
+    const qint16        *x,
+    int                 n,
+    int                 mask,
+    int                 thresh,
+    bool                &isHi )
+{
+    int i = 0;
+
+#ifdef CALSR_SSE2
+    const __m128i   Z = _mm_setzero_si128(),
+                    M = _mm_set1_epi16( mask ),
+                    T = _mm_set1_epi16( thresh );
+
+    int prev = isHi;
+
+    for( ; i + 16 <= n; i += 16 ) {
+
+        __m128i a = _mm_loadu_si128( (const __m128i*)&x[i] ),
+                b = _mm_loadu_si128( (const __m128i*)&x[i+8] );
+
+        if( mask ) {
+            a = _mm_xor_si128( _mm_cmpeq_epi16( _mm_and_si128( a, M ), Z ),
+                    _mm_cmpeq_epi16( Z, Z ) );
+            b = _mm_xor_si128( _mm_cmpeq_epi16( _mm_and_si128( b, M ), Z ),
+                    _mm_cmpeq_epi16( Z, Z ) );
+        }
+        else {
+            a = _mm_cmpgt_epi16( a, T );
+            b = _mm_cmpgt_epi16( b, T );
+        }
+
+        // Bit k of L = level of sample i+k
+
+        int L   = _mm_movemask_epi8( _mm_packs_epi16( a, b ) ),
+            up  = L & ~((L << 1) | prev);
+
+        while( up ) {
+
+            int k = 0;
+
+            while( !(up & (1 << k)) )
+                ++k;
+
+            E.push_back( i + k );
+            up &= up - 1;
+        }
+
+        prev = (L >> 15) & 1;
+    }
+
+    isHi = prev;
+#endif
+
+    for( ; i < n; ++i ) {
+
+        bool hi = (mask ? (x[i] & mask) != 0 : x[i] > thresh);
+
+        if( hi && !isHi )
+            E.push_back( i );
+
+        isHi = hi;
+    }
+}
+
+/* ---------------------------------------------------------------- */
+/* CalSRTask ------------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+void CalSRTask::run()
+{
+    if( isNI )
+        owner->calcRateNI( S );
+    else
+        owner->calcRateIM( S );
+
+    owner->reportTenths( S, 10 );
+
+    emit finished();
+}
+
 /* ---------------------------------------------------------------- */
 /* CalSRWorker ---------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
+// Streams are independent files, so each gets its own
+// scanning thread; total time is that of the longest file
+// rather than the sum.
+//
 void CalSRWorker::run()
 {
-    int nIM = vIM.size(),
-        nNI = vNI.size();
+    std::vector<QThread*>   vT;
+    std::vector<CalSRTask*> vW;
+    int                     nIM = vIM.size(),
+                            nNI = vNI.size();
 
     pctCum = 0;
     pctMax = 10*(nIM + nNI);
     pctRpt = 0;
 
-    for( int is = 0; is < nIM; ++is ) {
+    for( int is = 0; is < nIM + nNI; ++is ) {
 
-        calcRateIM( vIM[is] );
+        QThread     *T = new QThread;
+        CalSRTask   *W;
 
-        if( isCanceled() )
-            goto exit;
+        if( is < nIM )
+            W = new CalSRTask( this, vIM[is], false );
+        else
+            W = new CalSRTask( this, vNI[is-nIM], true );
 
-        reportTenth( 10 );
-        pctCum += 10;
-    }
+        W->moveToThread( T );
 
-    if( isCanceled() )
-        goto exit;
+        Connect( T, SIGNAL(started()), W, SLOT(run()) );
+        Connect( W, SIGNAL(finished()), T, SLOT(quit()), Qt::DirectConnection );
 
-    for( int is = 0; is < nNI; ++is ) {
+        T->start();
 
-        calcRateNI( vNI[is] );
+        vT.push_back( T );
+        vW.push_back( W );
+    }
 
-        if( isCanceled() )
-            goto exit;
+    for( int is = 0, ns = vT.size(); is < ns; ++is ) {
 
-        reportTenth( 10 );
-        pctCum += 10;
+        vT[is]->wait();
+        delete vT[is];
+        delete vW[is];
     }
 
-exit:
-    reportTenth( pctMax );
+    emit percent( 100 );
     emit finished();
 }
 
 
-void CalSRWorker::reportTenth( int tenth )
+// Credit stream S with progress up to tenths (of 10).
+// Called concurrently from the stream tasks.
+//
+void CalSRWorker::reportTenths( CalSRStream &S, int tenths )
 {
-    int pct = qMin( 100.0, 100.0 * (pctCum + tenth) / pctMax );
+    tenths = qMin( tenths, 10 );
+
+    if( tenths <= S.tenths )
+        return;
+
+    QMutexLocker    ml( &pctMtx );
+
+    pctCum  += tenths - S.tenths;
+    S.tenths = tenths;
+
+    int pct = qMin( 100.0, 100.0 * pctCum / qMax( pctMax, 1 ) );
 
     if( pct > pctRpt ) {
 
@@ -215,38 +331,7 @@ void CalSRWorker::scanDigital(
     int             syncChan,
     int             dword )
 {
-#ifdef EDGEFILES
-QFile f( QString("%1/%2_edges.txt")
-        .arg( mainApp()->dataDir() )
-        .arg( df->fileLblFromObj() ) );
-f.open( QIODevice::WriteOnly | QIODevice::Text );
-QTextStream ts( &f );
-#endif
-
-// We set statN to the statistical sample size we want for averaging.
-// Given statN and the pulser period, we next see how wide a counting
-// window (nthEdge = n pulser periods) we can use given the time span
-// of the file. Wider counting windows are better because the count
-// error tends to be order(1) for a good clock no matter how wide the
-// window. Wider windows give better standard error estimators.
-
-    const int statN = 10;
-
-    std::vector<Bin>    vB;
-    int                 nb = 0;
-
-    double  srate   = df->samplingRateHz();
-    qint64  nRem    = df->scanCount(),
-            xpos    = 0,
-            lastX   = 0;
-    int     nC      = df->numChans(),
-            nthEdge = (quint64(nRem / (srate * syncPer)) - 1) / statN,
-            iEdge   = nthEdge - 1,
-            tenth   = 0;
-    bool    isHi    = false;
-
-    int iword   = df->channelIDs().indexOf( dword ),
-        mask    = 1 << (syncChan % 16);
+    int iword = df->channelIDs().indexOf( dword );
 
     if( iword < 0 ) {
         S.err =
@@ -256,153 +341,42 @@ QTextStream ts( &f );
         return;
     }
 
-// --------------------------
-// Collect and bin the counts
-// --------------------------
-
-    for(;;) {
-
-        if( isCanceled() ) {
-            S.err = "canceled";
-            return;
-        }
-
-        vec_i16 data;
-        qint64  ntpts,
-                chunk = srate,
-                nthis = qMin( chunk, nRem );
-
-        ntpts = df->readScans( data, xpos, nthis, QBitArray() );
-
-        if( ntpts <= 0 )
-            break;
-
-        // Init high/low flag
-
-        if( !xpos )
-            isHi = (data[iword] & mask) > 0;
-
-        // Scan block for edges
-
-        for( int i = 0; i < ntpts; ++i ) {
-
-            if( isHi ) {
-
-                if( (data[i*nC + iword] & mask) < 1 )
-                    isHi = false;
-            }
-            else {
-
-                if( (data[i*nC + iword] & mask) > 0 ) {
-
-                    if( ++iEdge >= nthEdge ) {
-
-                        if( lastX > 0 ) {
-
-                            qint64  c = xpos + i - lastX;
-
-#ifdef EDGEFILES
-ts << c << "\n";
-#endif
-
-                            for( int ib = 0; ib < nb; ++ib ) {
-
-                                if( vB[ib].isIn( c ) )
-                                    goto binned;
-                            }
-
-                            vB.push_back( Bin( c ) );
-                            ++nb;
-                        }
-
-binned:
-                        lastX = xpos + i;
-                        iEdge = 0;
-                        reportTenth( ++tenth );
-                    }
-
-                    isHi = true;
-                }
-            }
-        }
-
-        // Advance for next block
-
-        xpos    += ntpts;
-        nRem    -= ntpts;
-    }
-
-// ---------------
-// Remove outliers
-// ---------------
-
-    if( nb ) {
-
-        for( int ib = nb - 1; ib >= 0; --ib ) {
-
-            if( vB[ib].n <= 1 ) {
-                vB.erase( vB.begin() + ib );
-                --nb;
-            }
-        }
-    }
-    else
-        S.err = QString("%1 no edges found").arg( df->fileLblFromObj() );
-
-// -----------------
-// Collect stat sums
-// -----------------
-
-    double  s1 = 0,
-            s2 = 0;
-    int     N  = 0;
-
-    for( int ib = 0; ib < nb; ++ib ) {
-
-        const Bin   &b = vB[ib];
-
-        for( int ic = 0; ic < b.n; ++ic ) {
-
-            double  c = b.C[ic];
-
-            s1 += c;
-            s2 += c*c;
-        }
-
-        N += b.n;
-    }
-
-// ----------------------------
-// Stats (tolerate one outlier)
-// ----------------------------
-
-    if( N >= statN - 1 ) {
+    scanEdges( S, df, syncPer, iword, 1 << (syncChan % 16), 0 );
+}
 
-        double  var = (s2 - s1*s1/N) / (N - 1);
-        double  per = nthEdge * syncPer;
 
-        if( var > 0.0 )
-            S.se = sqrt( var / N ) / per;
+void CalSRWorker::scanAnalog(
+    CalSRStream     &S,
+    DataFile        *df,
+    double          syncPer,
+    double          syncThresh,
+    int             syncChan )
+{
+    int iword = df->channelIDs().indexOf( syncChan );
 
-        S.av = s1 / (N * per);
-    }
-    else {
-        S.err = QString("%1 too many outliers")
-                .arg( df->fileLblFromObj() );
+    if( iword < 0 ) {
+        S.err =
+        QString("%1 sync chan [%2] not included in saved channels")
+        .arg( df->streamFromObj() )
+        .arg( syncChan );
+        return;
     }
 
-#ifdef EDGEFILES
-Log() << df->fileLblFromObj() << " win N " << nthEdge << " " << N;
-#endif
+    scanEdges(
+        S, df, syncPer, iword, 0,
+        syncThresh / df->vRange().rmax * 32768 );
 }
 
 
-void CalSRWorker::scanAnalog(
+// Sync level is (word & mask) if mask, else (word > thresh).
+//
+void CalSRWorker::scanEdges(
     CalSRStream     &S,
     DataFile        *df,
     double          syncPer,
-    double          syncThresh,
-    int             syncChan )
+    int             iword,
+    int             mask,
+    int             thresh )
 {
 #ifdef EDGEFILES
 QFile f( QString("%1/%2_edges.txt")
@@ -422,29 +396,18 @@ QTextStream ts( &f );
     const int statN = 10;
 
     std::vector<Bin>    vB;
+    std::vector<int>    vE;
     int                 nb = 0;
 
     double  srate   = df->samplingRateHz();
     qint64  nRem    = df->scanCount(),
             xpos    = 0,
             lastX   = 0;
-    int     nC      = df->numChans(),
-            nthEdge = (quint64(nRem / (srate * syncPer)) - 1) / statN,
+    int     nthEdge = (quint64(nRem / (srate * syncPer)) - 1) / statN,
             iEdge   = nthEdge - 1,
             tenth   = 0;
     bool    isHi    = false;
 
-    int iword   = df->channelIDs().indexOf( syncChan ),
-        T       = syncThresh / df->vRange().rmax * 32768;
-
-    if( iword < 0 ) {
-        S.err =
-        QString("%1 sync chan [%2] not included in saved channels")
-        .arg( df->streamFromObj() )
-        .arg( syncChan );
-        return;
-    }
-
 // --------------------------
 // Collect and bin the counts
 // --------------------------
@@ -461,7 +424,7 @@ QTextStream ts( &f );
                 chunk = srate,
                 nthis = qMin( chunk, nRem );
 
-        ntpts = df->readScans( data, xpos, nthis, QBitArray() );
+        ntpts = df->readChannel( data, xpos, nthis, iword );
 
         if( ntpts <= 0 )
             break;
@@ -469,49 +432,39 @@ QTextStream ts( &f );
         // Init high/low flag
 
         if( !xpos )
-            isHi = data[iword] > T;
-
-        // Scan block for edges
-
-        for( int i = 0; i < ntpts; ++i ) {
+            isHi = (mask ? (data[0] & mask) != 0 : data[0] > thresh);
 
-            if( isHi ) {
+        // Find edges, then take every nthEdge
 
-                if( data[i*nC + iword] <= T )
-                    isHi = false;
-            }
-            else {
+        vE.clear();
+        risingEdges( vE, &data[0], ntpts, mask, thresh, isHi );
 
-                if( data[i*nC + iword] > T ) {
+        for( int ie = 0, ne = vE.size(); ie < ne; ++ie ) {
 
-                    if( ++iEdge >= nthEdge ) {
+            if( ++iEdge >= nthEdge ) {
 
-                        if( lastX > 0 ) {
+                if( lastX > 0 ) {
 
-                            qint64  c = xpos + i - lastX;
+                    qint64  c = xpos + vE[ie] - lastX;
 
 #ifdef EDGEFILES
 ts << c << "\n";
 #endif
 
-                            for( int ib = 0; ib < nb; ++ib ) {
-
-                                if( vB[ib].isIn( c ) )
-                                    goto binned;
-                            }
-
-                            vB.push_back( Bin( c ) );
-                            ++nb;
-                        }
+                    for( int ib = 0; ib < nb; ++ib ) {
 
-binned:
-                        lastX = xpos + i;
-                        iEdge = 0;
-                        reportTenth( ++tenth );
+                        if( vB[ib].isIn( c ) )
+                            goto binned;
                     }
 
-                    isHi = true;
+                    vB.push_back( Bin( c ) );
+                    ++nb;
                 }
+
+binned:
+                lastX = xpos + vE[ie];
+                iEdge = 0;
+                reportTenths( S, ++tenth );
             }
         }
 
@@ -685,6 +638,7 @@ void CalSRRun::initRun()
         QString("CalSRate_%1")
         .arg( dateTime2Str( tCreate, Qt::ISODate ).replace( ":", "." ) );
     p.sns.fldPerPrb = false;
+    p.sns.compress  = false;
 
     cfg->setParams( p, false );
 }
@@ -19,10 +19,37 @@ struct CalSRStream {
             av,
             se;
     QString err;
-    int     ip;
+    int     ip,
+            tenths; // progress credited, [0..10]
 
-    CalSRStream() : srate(0), av(0), se(0), ip(0)           {}
-    CalSRStream( int ip ) : srate(0), av(0), se(0), ip(ip)  {}
+    CalSRStream() : srate(0), av(0), se(0), ip(0), tenths(0)            {}
+    CalSRStream( int ip ) : srate(0), av(0), se(0), ip(ip), tenths(0)   {}
+};
+
+
+class CalSRWorker;
+
+// Scans one stream's file on its own thread.
+//
+class CalSRTask : public QObject
+{
+    Q_OBJECT
+
+private:
+    CalSRWorker *owner;
+    CalSRStream &S;
+    bool        isNI;
+
+public:
+    CalSRTask( CalSRWorker *owner, CalSRStream &S, bool isNI )
+    :   QObject(0), owner(owner), S(S), isNI(isNI)  {}
+    virtual ~CalSRTask()                            {}
+
+signals:
+    void finished();
+
+public slots:
+    void run();
 };
 
 
@@ -30,6 +57,8 @@ class CalSRWorker : public QObject
 {
     Q_OBJECT
 
+    friend class CalSRTask;
+
 private:
     struct Bin {
         std::vector<double> C;
@@ -58,7 +87,8 @@ private:
     DFRunTag                    &runTag;
     std::vector<CalSRStream>    &vIM,
                                 &vNI;
-    mutable QMutex              runMtx;
+    mutable QMutex              runMtx,
+                                pctMtx;
     int                         pctCum,
                                 pctMax,
                                 pctRpt;
@@ -84,7 +114,7 @@ public slots:
 
 private:
     bool isCanceled()   {QMutexLocker ml( &runMtx ); return _cancel;}
-    void reportTenth( int tenth );
+    void reportTenths( CalSRStream &S, int tenths );
     void calcRateIM( CalSRStream &S );
     void calcRateNI( CalSRStream &S );
 
@@ -101,6 +131,14 @@ private:
         double          syncPer,
         double          syncThresh,
         int             syncChan );
+
+    void scanEdges(
+        CalSRStream     &S,
+        DataFile        *df,
+        double          syncPer,
+        int             iword,
+        int             mask,
+        int             thresh );
 };
 
 
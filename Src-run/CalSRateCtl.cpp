@@ -13,6 +13,20 @@
 #include <QMessageBox>
 
 
+/* ---------------------------------------------------------------- */
+/* Statics -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Uncompressed data size; compressed files record it separately.
+//
+static qint64 rawBytes( KVParams &kvp )
+{
+    if( kvp.contains( "fileCompression" ) )
+        return kvp["fileSizeRawBytes"].toLongLong();
+
+    return kvp["fileSizeBytes"].toLongLong();
+}
+
 /* ---------------------------------------------------------------- */
 /* ctor/dtor ------------------------------------------------------ */
 /* ---------------------------------------------------------------- */
@@ -268,7 +282,7 @@ void CalSRateCtl::apply()
                 kvp["imSampRate"] = S.av;
 
                 kvp["fileTimeSecs"] =
-                    kvp["fileSizeBytes"].toLongLong()
+                    rawBytes( kvp )
                     / (2 * kvp["nSavedChans"].toInt())
                     / S.av;
 
@@ -291,7 +305,7 @@ void CalSRateCtl::apply()
                         kvp["imSampRate"] = S.av / 12.0;
 
                         kvp["fileTimeSecs"] =
-                            kvp["fileSizeBytes"].toLongLong()
+                            rawBytes( kvp )
                             / kvp["nSavedChans"].toInt()
                             * 6
                             / S.av;
@@ -333,7 +347,7 @@ void CalSRateCtl::apply()
                 kvp["niSampRate"] = S.av;
 
                 kvp["fileTimeSecs"] =
-                    kvp["fileSizeBytes"].toLongLong()
+                    rawBytes( kvp )
                     / (2 * kvp["nSavedChans"].toInt())
                     / S.av;
 
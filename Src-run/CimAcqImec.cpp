@@ -7,6 +7,8 @@
 #include "ConfigCtl.h"
 #include "Run.h"
 #include "MetricsWindow.h"
+#include "MXStats.h"
+#include "MXTrace.h"
 
 #include <QDir>
 #include <QThread>
@@ -528,9 +530,11 @@ bool ImAcqWorker::doProbe_T0(
     vec_i16             &dst1D,
     const ImAcqProbe    &P )
 {
-#ifdef PROFILE
+    static MXHist   *mxGet = MXStats::hist( "imec.fetch_us" ),
+                    *mxScl = MXStats::hist( "imec.scale_us" ),
+                    *mxEnq = MXStats::hist( "imec.enqueue_us" );
+
     double  prbT0 = getTime();
-#endif
 
     electrodePacket*    E   = (electrodePacket*)&D[0];
     qint16*             dst = &dst1D[0];
@@ -559,6 +563,8 @@ bool ImAcqWorker::doProbe_T0(
         return true;
     }
 
+    mxGet->recordSince( prbT0 );
+
 #ifdef PROFILE
     P.sumGet += getTime() - prbT0;
 #endif
@@ -586,9 +592,7 @@ P.tStampLastFetch = E[nE-1].timestamp[11];
 #endif
 //------------------------------------------------------------------
 
-#ifdef PROFILE
     double  dtScl = getTime();
-#endif
 
     for( int ie = 0; ie < nE; ++ie ) {
 
@@ -659,6 +663,8 @@ dst[16] = count[P.ip] % 8000 - 4000;
             lfLast[ic] = srcLF[ic];
     }   // ie
 
+    mxScl->recordSince( dtScl );
+
 #ifdef PROFILE
     P.sumScl += getTime() - dtScl;
 #endif
@@ -678,6 +684,11 @@ dst[16] = count[P.ip] % 8000 - 4000;
     P.tPostEnq = getTime();
     P.totPts  += TPNTPERFETCH * nE;
 
+    mxEnq->record( 1e6*(P.tPostEnq - P.tPreEnq) );
+    MXTrace::origin(
+        P.ip, imQ[P.ip]->endCount() - TPNTPERFETCH * nE,
+        prbT0, P.tPostEnq );
+
 #ifdef PROFILE
     P.sumLag += mainApp()->getRun()->getStreamTime() -
                 (imQ[P.ip]->tZero() + P.totPts / imQ[P.ip]->sRate());
@@ -692,9 +703,11 @@ bool ImAcqWorker::doProbe_T2(
     vec_i16             &dst1D,
     const ImAcqProbe    &P )
 {
-#ifdef PROFILE
+    static MXHist   *mxGet = MXStats::hist( "imec.fetch_us" ),
+                    *mxScl = MXStats::hist( "imec.scale_us" ),
+                    *mxEnq = MXStats::hist( "imec.enqueue_us" );
+
     double  prbT0 = getTime();
-#endif
 
     qint16  *src = (qint16*)&D[0],
             *dst = &dst1D[0];
@@ -723,6 +736,8 @@ bool ImAcqWorker::doProbe_T2(
         return true;
     }
 
+    mxGet->recordSince( prbT0 );
+
 #ifdef PROFILE
     P.sumGet += getTime() - prbT0;
 #endif
@@ -788,9 +803,7 @@ P.tStampLastFetch = H[nT-1].Timestamp;
 #endif
 //------------------------------------------------------------------
 
-#ifdef PROFILE
     double  dtScl = getTime();
-#endif
 
     for( int it = 0; it < nT; ++it ) {
 
@@ -839,6 +852,8 @@ dst[16] = count[P.ip] % 8000 - 4000;
 
     }   // it
 
+    mxScl->recordSince( dtScl );
+
 #ifdef PROFILE
     P.sumScl += getTime() - dtScl;
 #endif
@@ -858,6 +873,9 @@ dst[16] = count[P.ip] % 8000 - 4000;
     P.tPostEnq = getTime();
     P.totPts  += nT;
 
+    mxEnq->record( 1e6*(P.tPostEnq - P.tPreEnq) );
+    MXTrace::origin( P.ip, imQ[P.ip]->endCount() - nT, prbT0, P.tPostEnq );
+
 #ifdef PROFILE
     P.sumLag += mainApp()->getRun()->getStreamTime() -
                 (imQ[P.ip]->tZero() + P.totPts / imQ[P.ip]->sRate());
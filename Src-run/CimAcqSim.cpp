@@ -3,6 +3,8 @@
 #include "Util.h"
 #include "MainApp.h"
 #include "ConfigCtl.h"
+#include "MXStats.h"
+#include "MXTrace.h"
 
 #include <QThread>
 
@@ -171,9 +173,10 @@ exit:
 
 bool ImSimWorker::doProbe( vec_i16 &dst1D, ImSimProbe &P )
 {
-#ifdef PROFILE
+    static MXHist   *mxGet = MXStats::hist( "imsim.fetch_us" ),
+                    *mxEnq = MXStats::hist( "imsim.enqueue_us" );
+
     double  prbT0 = getTime();
-#endif
 
     qint16* dst = &dst1D[0];
     int     nS;
@@ -191,6 +194,8 @@ bool ImSimWorker::doProbe( vec_i16 &dst1D, ImSimProbe &P )
     if( !nS )
         return true;
 
+    mxGet->recordSince( prbT0 );
+
 #ifdef PROFILE
     P.sumGet += getTime() - prbT0;
 #endif
@@ -199,15 +204,17 @@ bool ImSimWorker::doProbe( vec_i16 &dst1D, ImSimProbe &P )
 // Enqueue
 // -------
 
-#ifdef PROFILE
     double  dtEnq = getTime();
-#endif
 
     double  tLock, tWork;
 
     imQ[P.ip]->enqueueProfile( tLock, tWork, dst, nS );
     P.totPts += nS;
 
+    MXTrace::origin( P.ip, P.totPts - nS, prbT0, getTime() );
+
+    mxEnq->recordSince( dtEnq );
+
 #ifdef PROFILE
     P.sumEnq += getTime() - dtEnq;
     P.sumLok += tLock;
@@ -3,6 +3,8 @@
 
 #include "CniAcqDmx.h"
 #include "Util.h"
+#include "MXStats.h"
+#include "MXTrace.h"
 #include "Subset.h"
 
 #include <QThread>
@@ -16,6 +18,11 @@
 
 #define DAQ_TIMEOUT_SEC     2.5
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DMX_SSE2
+#include <emmintrin.h>
+#endif
+
 #define DAQmxErrChk(functionCall)                           \
     do {                                                    \
     if( DAQmxFailed(dmxErrNum = (functionCall)) )           \
@@ -124,6 +131,108 @@ static void diChanString(
     }
 }
 
+/* ---------------------------------------------------------------- */
+/* NIDmxWorker ---------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Wait until no buffer is being demuxed.
+//
+void NIDmxWorker::waitIdle()
+{
+    QMutexLocker    ml( &bufMtx );
+
+    while( iPost >= 0 )
+        condDone.wait( &bufMtx );
+}
+
+
+// Caller must waitIdle() first.
+//
+void NIDmxWorker::post( int ibuf, int nwhole, double tFetch )
+{
+    QMutexLocker    ml( &bufMtx );
+
+    iPost           = ibuf;
+    nPost           = nwhole;
+    this->tFetch    = tFetch;
+
+    condPost.wakeAll();
+}
+
+
+void NIDmxWorker::stop()
+{
+    QMutexLocker    ml( &bufMtx );
+
+    pleaseStop = true;
+    condPost.wakeAll();
+}
+
+
+// A posted buffer is always published, even if stopping.
+//
+void NIDmxWorker::run()
+{
+    for(;;) {
+
+        bufMtx.lock();
+
+        while( iPost < 0 && !pleaseStop )
+            condPost.wait( &bufMtx );
+
+        int     ib  = iPost,
+                n   = nPost;
+        double  t   = tFetch;
+
+        bufMtx.unlock();
+
+        if( ib < 0 )
+            break;
+
+        acq->publish( ib, n, t );
+
+        bufMtx.lock();
+        iPost = -1;
+        condDone.wakeAll();
+        bufMtx.unlock();
+    }
+
+    emit finished();
+}
+
+/* ---------------------------------------------------------------- */
+/* NIDmxThread ---------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+NIDmxThread::NIDmxThread( CniAcqDmx *acq )
+{
+    thread  = new QThread;
+    worker  = new NIDmxWorker( acq );
+
+    worker->moveToThread( thread );
+
+    Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
+    Connect( worker, SIGNAL(finished()), worker, SLOT(deleteLater()) );
+    Connect( worker, SIGNAL(destroyed()), thread, SLOT(quit()), Qt::DirectConnection );
+
+    thread->start();
+}
+
+
+NIDmxThread::~NIDmxThread()
+{
+// worker object auto-deleted asynchronously
+// thread object manually deleted synchronously (so we can call wait())
+
+    if( thread->isRunning() ) {
+
+        worker->stop();
+        thread->wait();
+    }
+
+    delete thread;
+}
+
 /* ---------------------------------------------------------------- */
 /* ~CniAcqDmx ----------------------------------------------------- */
 /* ---------------------------------------------------------------- */
@@ -239,6 +348,11 @@ void CniAcqDmx::run()
 // for the USB-6366 (slower than PCI/PXI) shows typical
 // loop processing time without digital lines is ~0.1 ms
 // and 1 to 2 ms with digital.
+//
+// This thread only fetches. Whole timepoints are handed to
+// the NIDmxThread for demux/merge/enqueue, which runs while
+// we fetch into the other buffer. Any partial timepoint is
+// copied to the head of that other buffer first.
 
     const int loopPeriod_us =
         1000
@@ -250,36 +364,29 @@ void CniAcqDmx::run()
     int     peak_nWhole = 0,
             nWhole      = 0,
             rem         = 0,
-            remFront    = true,
+            cur         = 0,
             nTries      = 0;
 
+    NIDmxThread dmx( this );
+
+    static MXHist   *mxGet = MXStats::hist( "ni.fetch_us" );
+
     while( !isStopped() ) {
 
         double  loopT = getTime();
 
         nWhole = 0;
 
-        // Slide partial timepoint forward.
-        //
-        // The purpose of remFront is to prevent sliding again
-        // next time, just in case we got no samples this time.
-        // In reality, if we actually had any rem (meaning acq
-        // is in progress) and we got no samples, then we have
-        // much bigger problems than that.
-
-        if( rem && !remFront ) {
-
-            slideRemForward( rem, nFetched );
-            remFront = true;
-        }
-
         // -----
         // Fetch
         // -----
 
-        if( !fetch( nFetched, rem ) )
+        if( !fetch( buf[cur], nFetched, rem ) )
             goto Error_Out;
 
+        if( nFetched )
+            mxGet->recordSince( loopT );
+
 // Experiment to report fetched sample count vs time.
 #if 0
 {
@@ -308,15 +415,7 @@ void CniAcqDmx::run()
 
         nFetched += rem;
         nWhole    = nFetched / kmux;
-
-        if( nWhole ) {
-            rem         = nFetched - kmux * nWhole;
-            remFront    = false;
-        }
-        else {
-            rem         = nFetched;
-            remFront    = true;
-        }
+        rem       = nFetched - kmux * nWhole;
 
         // ---------
         // MEM usage
@@ -346,21 +445,17 @@ void CniAcqDmx::run()
             if( nWhole > peak_nWhole )
                 peak_nWhole = nWhole;
 
-            // ---------------
-            // Demux and merge
-            // ---------------
+            // --------
+            // Hand off
+            // --------
 
-            demuxMerge( nWhole );
+            dmx.waitIdle();
 
-            // -------
-            // Publish
-            // -------
+            if( rem )
+                slideRemForward( buf[1-cur], buf[cur], rem, nFetched );
 
-            if( !totPts )
-                owner->niQ->setTZero( loopT );
-
-            owner->niQ->enqueue( &merged[0], nWhole );
-            totPts += nWhole;
+            dmx.post( cur, nWhole, loopT );
+            cur = 1 - cur;
         }
 
         // ------------------
@@ -918,11 +1013,19 @@ bool CniAcqDmx::configure()
             + (1 + kxd1+kxd2)/2
         ) );
 
-    rawAI1.resize( (maxMuxedSampPerChan + kmux)*KAI1 );
-    rawAI2.resize( (maxMuxedSampPerChan + kmux)*KAI2 );
+    for( int ib = 0; ib < 2; ++ib ) {
+
+        NIDmxBuf    &B = buf[ib];
+
+        B.rawAI1.resize( (maxMuxedSampPerChan + kmux)*KAI1 );
+        B.rawAI2.resize( (maxMuxedSampPerChan + kmux)*KAI2 );
+
+        B.rawDI1.resize( maxMuxedSampPerChan + kmux );
+        B.rawDI2.resize( maxMuxedSampPerChan + kmux );
+    }
 
-    rawDI1.resize( maxMuxedSampPerChan + kmux );
-    rawDI2.resize( maxMuxedSampPerChan + kmux );
+    vtmp.resize( kmux*(kmn1+kmn2+kma1+kma2) );
+    sumxa.resize( kxa1+kxa2 );
 
     return true;
 }
@@ -999,33 +1102,39 @@ void CniAcqDmx::setDO( bool onoff )
 /* slideRemForward ------------------------------------------------ */
 /* ---------------------------------------------------------------- */
 
-void CniAcqDmx::slideRemForward( int rem, int nFetched )
+// Copy partial timepoint at tail of src to head of dst.
+//
+void CniAcqDmx::slideRemForward(
+    NIDmxBuf        &dst,
+    const NIDmxBuf  &src,
+    int             rem,
+    int             nFetched )
 {
     if( KAI1 ) {
         memcpy(
-            &rawAI1[0],
-            &rawAI1[(nFetched-rem)*KAI1],
+            &dst.rawAI1[0],
+            &src.rawAI1[(nFetched-rem)*KAI1],
             rem*KAI1*sizeof(qint16) );
     }
 
     if( kxd1 ) {
         memcpy(
-            &rawDI1[0],
-            &rawDI1[nFetched-rem],
+            &dst.rawDI1[0],
+            &src.rawDI1[nFetched-rem],
             rem*sizeof(uInt32) );
     }
 
     if( KAI2 ) {
         memcpy(
-            &rawAI2[0],
-            &rawAI2[(nFetched-rem)*KAI2],
+            &dst.rawAI2[0],
+            &src.rawAI2[(nFetched-rem)*KAI2],
             rem*KAI2*sizeof(qint16) );
     }
 
     if( kxd2 ) {
         memcpy(
-            &rawDI2[0],
-            &rawDI2[nFetched-rem],
+            &dst.rawDI2[0],
+            &src.rawDI2[nFetched-rem],
             rem*sizeof(uInt32) );
     }
 }
@@ -1040,7 +1149,7 @@ void CniAcqDmx::slideRemForward( int rem, int nFetched )
 //
 // Return ok.
 //
-bool CniAcqDmx::fetch( int32 &nFetched, int rem )
+bool CniAcqDmx::fetch( NIDmxBuf &B, int32 &nFetched, int rem )
 {
     nFetched = 0;
 
@@ -1052,7 +1161,7 @@ bool CniAcqDmx::fetch( int32 &nFetched, int rem )
                 DAQmx_Val_Auto,
                 DAQ_TIMEOUT_SEC,
                 DAQmx_Val_GroupByScanNumber,
-                &rawAI1[rem*KAI1],
+                &B.rawAI1[rem*KAI1],
                 (maxMuxedSampPerChan+kmux-rem)*KAI1,
                 &nFetched,
                 NULL ) );
@@ -1069,7 +1178,7 @@ bool CniAcqDmx::fetch( int32 &nFetched, int rem )
                 (nFetched ? nFetched : DAQmx_Val_Auto),
                 DAQ_TIMEOUT_SEC,
                 DAQmx_Val_GroupByScanNumber,
-                &rawDI1[rem],
+                &B.rawDI1[rem],
                 (maxMuxedSampPerChan+kmux-rem),
                 &nFetched,
                 NULL ) );
@@ -1093,7 +1202,7 @@ bool CniAcqDmx::fetch( int32 &nFetched, int rem )
                     nFetched,
                     DAQ_TIMEOUT_SEC,
                     DAQmx_Val_GroupByScanNumber,
-                    &rawAI2[rem*KAI2],
+                    &B.rawAI2[rem*KAI2],
                     (maxMuxedSampPerChan+kmux-rem)*KAI2,
                     &nFetched2,
                     NULL ) );
@@ -1110,7 +1219,7 @@ bool CniAcqDmx::fetch( int32 &nFetched, int rem )
                     nFetched,
                     DAQ_TIMEOUT_SEC,
                     DAQmx_Val_GroupByScanNumber,
-                    &rawDI2[rem],
+                    &B.rawDI2[rem],
                     (maxMuxedSampPerChan+kmux-rem),
                     &nFetched2,
                     NULL ) );
@@ -1131,19 +1240,194 @@ Error_Out:
 /* demuxMerge ----------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
+// Pack one timepoint of digital lines: the low kxd1 bytes of
+// the dev1 word, then the low kxd2 bytes of the dev2 word, as
+// consecutive 16-bit words (nw of them), zero-filling the last.
+//
+static inline qint16 *packXD(
+    qint16          *dst,
+    const uInt32    *sD1,
+    const uInt32    *sD2,
+    quint32         m1,
+    quint32         m2,
+    int             sh,
+    int             nw )
+{
+    quint64 bits = 0;
+
+    if( sD1 )
+        bits = *sD1 & m1;
+
+    if( sD2 )
+        bits |= quint64(*sD2 & m2) << sh;
+
+    for( int iw = 0; iw < nw; ++iw, bits >>= 16 )
+        *dst++ = qint16(bits);
+
+    return dst;
+}
+
+
+// Timepoints are XD only, one word each: do 8 at a time.
+//
+static void packXD1Word(
+    qint16          *dst,
+    const uInt32    *sD1,
+    const uInt32    *sD2,
+    quint32         m1,
+    quint32         m2,
+    int             sh,
+    int             nwhole )
+{
+    int w = 0;
+
+#ifdef DMX_SSE2
+    __m128i M1  = _mm_set1_epi32( m1 ),
+            M2  = _mm_set1_epi32( m2 ),
+            SH  = _mm_cvtsi32_si128( sh );
+
+    for( ; w + 8 <= nwhole; w += 8 ) {
+
+        __m128i lo = _mm_setzero_si128(),
+                hi = _mm_setzero_si128();
+
+        if( sD1 ) {
+            lo = _mm_and_si128( M1, _mm_loadu_si128( (__m128i*)&sD1[w] ) );
+            hi = _mm_and_si128( M1, _mm_loadu_si128( (__m128i*)&sD1[w+4] ) );
+        }
+
+        if( sD2 ) {
+            lo = _mm_or_si128( lo, _mm_sll_epi32( _mm_and_si128( M2,
+                    _mm_loadu_si128( (__m128i*)&sD2[w] ) ), SH ) );
+            hi = _mm_or_si128( hi, _mm_sll_epi32( _mm_and_si128( M2,
+                    _mm_loadu_si128( (__m128i*)&sD2[w+4] ) ), SH ) );
+        }
+
+        // Keep low 16 bits of each: sign-extend then saturating pack
+
+        lo = _mm_srai_epi32( _mm_slli_epi32( lo, 16 ), 16 );
+        hi = _mm_srai_epi32( _mm_slli_epi32( hi, 16 ), 16 );
+
+        _mm_storeu_si128( (__m128i*)&dst[w], _mm_packs_epi32( lo, hi ) );
+    }
+#endif
+
+    for( ; w < nwhole; ++w ) {
+        packXD(
+            &dst[w], (sD1 ? &sD1[w] : 0), (sD2 ? &sD2[w] : 0),
+            m1, m2, sh, 1 );
+    }
+}
+
+
+// Sum n int16 into int32 accumulators.
+//
+static inline void accumXA( int *sum, const qint16 *src, int n )
+{
+    int x = 0;
+
+#ifdef DMX_SSE2
+    for( ; x + 8 <= n; x += 8 ) {
+
+        __m128i v   = _mm_loadu_si128( (__m128i*)&src[x] ),
+                lo  = _mm_srai_epi32( _mm_unpacklo_epi16( v, v ), 16 ),
+                hi  = _mm_srai_epi32( _mm_unpackhi_epi16( v, v ), 16 );
+
+        _mm_storeu_si128( (__m128i*)&sum[x],
+            _mm_add_epi32( _mm_loadu_si128( (__m128i*)&sum[x] ), lo ) );
+        _mm_storeu_si128( (__m128i*)&sum[x+4],
+            _mm_add_epi32( _mm_loadu_si128( (__m128i*)&sum[x+4] ), hi ) );
+    }
+#endif
+
+    for( ; x < n; ++x )
+        sum[x] += src[x];
+}
+
+
+// dst[ncol][nrow] = transpose of src[nrow][ncol].
+//
+static void transposeMux( qint16 *dst, const qint16 *src, int nrow, int ncol )
+{
+    int r0 = 0;
+
+#ifdef DMX_SSE2
+    // 8x8 blocks: 3 rounds of interleaves
+
+    for( ; r0 + 8 <= nrow; r0 += 8 ) {
+
+        int c0;
+
+        for( c0 = 0; c0 + 8 <= ncol; c0 += 8 ) {
+
+            const qint16    *S = &src[r0*ncol + c0];
+            __m128i         a[8], b[8], c[8];
+
+            for( int i = 0; i < 8; ++i )
+                a[i] = _mm_loadu_si128( (__m128i*)&S[i*ncol] );
+
+            for( int i = 0; i < 8; i += 2 ) {
+                b[i]    = _mm_unpacklo_epi16( a[i], a[i+1] );
+                b[i+1]  = _mm_unpackhi_epi16( a[i], a[i+1] );
+            }
+
+            c[0] = _mm_unpacklo_epi32( b[0], b[2] );
+            c[1] = _mm_unpackhi_epi32( b[0], b[2] );
+            c[2] = _mm_unpacklo_epi32( b[1], b[3] );
+            c[3] = _mm_unpackhi_epi32( b[1], b[3] );
+            c[4] = _mm_unpacklo_epi32( b[4], b[6] );
+            c[5] = _mm_unpackhi_epi32( b[4], b[6] );
+            c[6] = _mm_unpacklo_epi32( b[5], b[7] );
+            c[7] = _mm_unpackhi_epi32( b[5], b[7] );
+
+            qint16  *D = &dst[c0*nrow + r0];
+
+            for( int j = 0; j < 4; ++j ) {
+                _mm_storeu_si128( (__m128i*)&D[(2*j)*nrow],
+                    _mm_unpacklo_epi64( c[j], c[j+4] ) );
+                _mm_storeu_si128( (__m128i*)&D[(2*j+1)*nrow],
+                    _mm_unpackhi_epi64( c[j], c[j+4] ) );
+            }
+        }
+
+        // Right edge of this band
+
+        for( int r = r0; r < r0 + 8; ++r ) {
+            for( int c = c0; c < ncol; ++c )
+                dst[c*nrow + r] = src[r*ncol + c];
+        }
+    }
+#endif
+
+    // Remaining rows
+
+    for( int r = r0; r < nrow; ++r ) {
+        for( int c = 0; c < ncol; ++c )
+            dst[c*nrow + r] = src[r*ncol + c];
+    }
+}
+
+
 // - Merge data from 2 devices.
 // - Group by whole timepoints.
 // - Subgroup (mn0 | mn1 |...| ma0 | ma1 |...| xa | xd).
 // - Average oversampled xa chans.
 // - Downsample oversampled xd and pack bytes into low-order bits.
 //
-void CniAcqDmx::demuxMerge( int nwhole )
+void CniAcqDmx::demuxMerge( const NIDmxBuf &B, int nwhole )
 {
     qint16          *dst    = &merged[0];
-    const qint16    *sA1    = (rawAI1.size() ? &rawAI1[0] : 0),
-                    *sA2    = (rawAI2.size() ? &rawAI2[0] : 0);
-    const uInt32    *sD1    = (kxd1 ? &rawDI1[0] : 0),
-                    *sD2    = (kxd2 ? &rawDI2[0] : 0);
+    const qint16    *sA1    = (B.rawAI1.size() ? &B.rawAI1[0] : 0),
+                    *sA2    = (B.rawAI2.size() ? &B.rawAI2[0] : 0);
+    const uInt32    *sD1    = (kxd1 ? &B.rawDI1[0] : 0),
+                    *sD2    = (kxd2 ? &B.rawDI2[0] : 0);
+
+// XD packing constants
+
+    quint32 m1  = (kxd1 >= 4 ? 0xFFFFFFFF : (1U << 8*kxd1) - 1),
+            m2  = (kxd2 >= 4 ? 0xFFFFFFFF : (1U << 8*kxd2) - 1);
+    int     sh  = 8 * kxd1,
+            nw  = (1 + kxd1 + kxd2) / 2;
 
 // ----------
 // Not muxing
@@ -1151,6 +1435,30 @@ void CniAcqDmx::demuxMerge( int nwhole )
 
     if( kmux == 1 ) {
 
+        // Digital only
+
+        if( !kxa1 && !kxa2 ) {
+
+            if( nw == 1 )
+                packXD1Word( dst, sD1, sD2, m1, m2, sh, nwhole );
+            else {
+                for( int w = 0; w < nwhole; ++w ) {
+                    dst = packXD(
+                            dst, (sD1 ? sD1++ : 0), (sD2 ? sD2++ : 0),
+                            m1, m2, sh, nw );
+                }
+            }
+
+            return;
+        }
+
+        // Analog only, one device
+
+        if( !nw && !kxa2 ) {
+            memcpy( dst, sA1, nwhole*kxa1*sizeof(qint16) );
+            return;
+        }
+
         for( int w = 0; w < nwhole; ++w ) {
 
             // Copy XA
@@ -1169,79 +1477,10 @@ void CniAcqDmx::demuxMerge( int nwhole )
 
             // Copy XD
 
-            if( kxd1 + kxd2 == 0 )
-                continue;
-
-            quint16 W = 0;
-            bool    F = 0;   // filling F: {0=empty,1=lsb,2=full}
-
-            if( kxd1 == 4 ) {
-                *dst++ = *sD1;
-                *dst++ = *sD1 >> 16;
-                ++sD1;
-            }
-            if( kxd1 == 3 ) {
-                *dst++ = *sD1;
-                W = (*sD1 >> 16) & 0xFF;
-                F = 1;
-                ++sD1;
-            }
-            else if( kxd1 == 2 ) {
-                *dst++ = *sD1++;
-            }
-            else if( kxd1 == 1 ) {
-                W = *sD1++ & 0xFF;
-                F = 1;
-            }
-
-            if( kxd2 == 0 ) {
-
-                if( F > 0 )
-                    *dst++ = W;
-            }
-            else if( kxd2 == 1 ) {
-
-                if( F == 0 )
-                    *dst++ = *sD2++ & 0xFF;
-                else
-                    *dst++ = W + (*sD2++ << 8);
-            }
-            else if( kxd2 == 2 ) {
-
-                if( F == 0 )
-                    *dst++ = *sD2++;
-                else {
-                    *dst++ = W + (*sD2 << 8);
-                    *dst++ = (*sD2 >> 8) & 0xFF;
-                    ++sD2;
-                }
-            }
-            else if( kxd2 == 3 ) {
-
-                if( F == 0 ) {
-                    *dst++ = *sD2;
-                    *dst++ = (*sD2 >> 16) & 0xFF;
-                    ++sD2;
-                }
-                else {
-                    *dst++ = W + (*sD2 << 8);
-                    *dst++ = *sD2 >> 8;
-                    ++sD2;
-                }
-            }
-            else if( kxd2 == 4 ) {
-
-                if( F == 0 ) {
-                    *dst++ = *sD2;
-                    *dst++ = *sD2 >> 16;
-                    ++sD2;
-                }
-                else {
-                    *dst++ = W + (*sD2 << 8);
-                    *dst++ = *sD2 >> 8;
-                    *dst++ = *sD2 >> 24;
-                    ++sD2;
-                }
+            if( nw ) {
+                dst = packXD(
+                        dst, (sD1 ? sD1++ : 0), (sD2 ? sD2++ : 0),
+                        m1, m2, sh, nw );
             }
         }
 
@@ -1260,14 +1499,17 @@ void CniAcqDmx::demuxMerge( int nwhole )
 
     int     ncol    = kmn1 + kmn2 + kma1 + kma2,
             nrow    = kmux,
-            ntmp    = nrow * ncol;
-    vec_i16 vtmp( ntmp );
+            ntmp    = nrow * ncol,
+            kxa     = kxa1 + kxa2;
+    int     *sum1   = (kxa ? &sumxa[0] : 0),
+            *sum2   = sum1 + kxa1;
 
     for( int w = 0; w < nwhole; ++w ) {
 
-        std::vector<long>   sumxa1( kxa1, 0 ),
-                            sumxa2( kxa2, 0 );
-        qint16              *tmp = &vtmp[0];
+        qint16  *tmp = &vtmp[0];
+
+        if( kxa )
+            memset( sum1, 0, kxa*sizeof(int) );
 
         for( int s = 0; s < kmux; ++s ) {
 
@@ -1299,118 +1541,73 @@ void CniAcqDmx::demuxMerge( int nwhole )
 
             // Sum XA
 
-            for( int x = 0; x < kxa1; ++x )
-                sumxa1[x] += *sA1++;
+            if( kxa1 ) {
+                accumXA( sum1, sA1, kxa1 );
+                sA1 += kxa1;
+            }
 
-            for( int x = 0; x < kxa2; ++x )
-                sumxa2[x] += *sA2++;
+            if( kxa2 ) {
+                accumXA( sum2, sA2, kxa2 );
+                sA2 += kxa2;
+            }
         }
 
-        // Transpose and store MN, MA:
-        // Original element address is [ncol*Y + X].
-        // Swap roles X <-> Y and row <-> col.
+        // Transpose and store MN, MA
 
-        for( int iacq = 0; iacq < ntmp; ++iacq ) {
-
-            int Y = iacq / ncol,
-                X = iacq - ncol * Y;
-
-            dst[nrow*X + Y] = vtmp[iacq];
+        if( ntmp ) {
+            transposeMux( dst, &vtmp[0], nrow, ncol );
+            dst += ntmp;
         }
 
-        dst += ntmp;
-
         // Copy XA averages
 
-        for( int x = 0; x < kxa1; ++x )
-            *dst++ = sumxa1[x] / kmux;
+        for( int x = 0; x < kxa; ++x )
+            *dst++ = sum1[x] / kmux;
 
-        for( int x = 0; x < kxa2; ++x )
-            *dst++ = sumxa2[x] / kmux;
+        // Copy XD (first of each kmux samples)
 
-        // Copy XD
+        if( nw ) {
 
-        if( kxd1 + kxd2 == 0 )
-            continue;
+            dst = packXD( dst, sD1, sD2, m1, m2, sh, nw );
 
-        quint16 W = 0;
-        bool    F = 0;   // filling F: {0=empty,1=lsb,2=full}
+            if( sD1 )
+                sD1 += kmux;
 
-        if( kxd1 == 4 ) {
-            *dst++ = *sD1;
-            *dst++ = *sD1 >> 16;
-            ++sD1;
-        }
-        if( kxd1 == 3 ) {
-            *dst++ = *sD1;
-            W = (*sD1 >> 16) & 0xFF;
-            F = 1;
-            ++sD1;
-        }
-        else if( kxd1 == 2 ) {
-            *dst++ = *sD1++;
-        }
-        else if( kxd1 == 1 ) {
-            W = *sD1++ & 0xFF;
-            F = 1;
+            if( sD2 )
+                sD2 += kmux;
         }
+    }
+}
 
-        if( kxd2 == 0 ) {
+/* ---------------------------------------------------------------- */
+/* publish -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
 
-            if( F > 0 )
-                *dst++ = W;
-        }
-        else if( kxd2 == 1 ) {
+// Called on NIDmxThread.
+//
+void CniAcqDmx::publish( int ibuf, int nwhole, double tFetch )
+{
+    static MXHist   *mxDmx = MXStats::hist( "ni.demux_us" ),
+                    *mxEnq = MXStats::hist( "ni.enqueue_us" );
 
-            if( F == 0 )
-                *dst++ = *sD2++ & 0xFF;
-            else
-                *dst++ = W + (*sD2++ << 8);
-        }
-        else if( kxd2 == 2 ) {
+    double  t0 = getTime();
 
-            if( F == 0 )
-                *dst++ = *sD2++;
-            else {
-                *dst++ = W + (*sD2 << 8);
-                *dst++ = (*sD2 >> 8) & 0xFF;
-                ++sD2;
-            }
-        }
-        else if( kxd2 == 3 ) {
+    demuxMerge( buf[ibuf], nwhole );
 
-            if( F == 0 ) {
-                *dst++ = *sD2;
-                *dst++ = (*sD2 >> 16) & 0xFF;
-                ++sD2;
-            }
-            else {
-                *dst++ = W + (*sD2 << 8);
-                *dst++ = *sD2 >> 8;
-                ++sD2;
-            }
-        }
-        else if( kxd2 == 4 ) {
+    mxDmx->recordSince( t0 );
 
-            if( F == 0 ) {
-                *dst++ = *sD2;
-                *dst++ = *sD2 >> 16;
-                ++sD2;
-            }
-            else {
-                *dst++ = W + (*sD2 << 8);
-                *dst++ = *sD2 >> 8;
-                *dst++ = *sD2 >> 24;
-                ++sD2;
-            }
-        }
+    if( !totPts )
+        owner->niQ->setTZero( tFetch );
 
-        if( kxd1 )
-            sD1 += (kmux - 1);
+    t0 = getTime();
 
-        if( kxd2 )
-            sD2 += (kmux - 1);
-    }
+    owner->niQ->enqueue( &merged[0], nwhole );
+    totPts += nwhole;
+
+    mxEnq->recordSince( t0 );
+
+    MXTrace::origin(
+        -1, owner->niQ->endCount() - nwhole, tFetch, getTime() );
 }
 
 /* ---------------------------------------------------------------- */
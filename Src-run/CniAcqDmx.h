@@ -6,18 +6,86 @@
 #include "CniAcq.h"
 #include "NI/NIDAQmx.h"
 
+#include <QMutex>
+#include <QWaitCondition>
+
 /* ---------------------------------------------------------------- */
 /* Types ---------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
+class CniAcqDmx;
+
+// Raw fetch buffers. Two of these are used in alternation:
+// the fetch thread fills one while the demux thread drains
+// the other.
+//
+struct NIDmxBuf {
+    vec_i16             rawAI1,     rawAI2;
+    std::vector<uInt32> rawDI1,     rawDI2;
+};
+
+
+// Demux/merge/publish stage of the NI pipeline.
+//
+class NIDmxWorker : public QObject
+{
+    Q_OBJECT
+
+private:
+    CniAcqDmx       *acq;
+    QMutex          bufMtx;
+    QWaitCondition  condPost,
+                    condDone;
+    double          tFetch;
+    int             iPost,      // posted buffer or -1
+                    nPost;      // its whole timepoints
+    bool            pleaseStop;
+
+public:
+    NIDmxWorker( CniAcqDmx *acq )
+    :   QObject(0), acq(acq), tFetch(0),
+        iPost(-1), nPost(0), pleaseStop(false)  {}
+    virtual ~NIDmxWorker()                      {}
+
+    void waitIdle();
+    void post( int ibuf, int nwhole, double tFetch );
+    void stop();
+
+signals:
+    void finished();
+
+public slots:
+    void run();
+};
+
+
+class NIDmxThread
+{
+private:
+    QThread     *thread;
+    NIDmxWorker *worker;
+
+public:
+    NIDmxThread( CniAcqDmx *acq );
+    virtual ~NIDmxThread();
+
+    void waitIdle()                                 {worker->waitIdle();}
+    void post( int ibuf, int nwhole, double tFetch )
+        {worker->post( ibuf, nwhole, tFetch );}
+};
+
+
 // Dmx NI-DAQ input
 //
 class CniAcqDmx : public CniAcq
 {
+    friend class NIDmxWorker;
+
 private:
     vec_i16             merged,
-                        rawAI1,     rawAI2;
-    std::vector<uInt32> rawDI1,     rawDI2;
+                        vtmp;
+    std::vector<int>    sumxa;
+    NIDmxBuf            buf[2];
     TaskHandle          taskAI1,    taskAI2,
                         taskDI1,    taskDI2,
                         taskIntCTR, taskSyncPls;
@@ -54,9 +122,14 @@ private:
     bool startTasks();
     void destroyTasks();
     void setDO( bool onoff );
-    void slideRemForward( int rem, int nFetched );
-    bool fetch( int32 &nFetched, int rem );
-    void demuxMerge( int nwhole );
+    void slideRemForward(
+        NIDmxBuf        &dst,
+        const NIDmxBuf  &src,
+        int             rem,
+        int             nFetched );
+    bool fetch( NIDmxBuf &B, int32 &nFetched, int rem );
+    void demuxMerge( const NIDmxBuf &B, int nwhole );
+    void publish( int ibuf, int nwhole, double tFetch );
     void runError( const QString &err = "" );
 };
 
@@ -1,7 +1,10 @@
 
 #include "CniAcqSim.h"
 #include "Util.h"
+#include "MXStats.h"
+#include "MXTrace.h"
 
+#include <QSettings>
 #include <QThread>
 
 #define _USE_MATH_DEFINES
@@ -12,71 +15,103 @@
 
 
 #define MAX16BIT    32768
+#define SPIKE_MS    2.0
+#define SIN_ANCHOR  1024    // sine recomputed exactly every N samples
 //#define PROFILE
 
 
 /* ---------------------------------------------------------------- */
-/* Generator functions -------------------------------------------- */
+/* Statics -------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
-// Give each analog channel a sin wave of period T.
-// Neu amp = 100 uV.
-// Aux amp = 2.2 V.
-// Digital words/channels get zeros.
+// Counter-based RNG (splitmix64 finalizer): the value depends
+// only on the key, so any sample can be regenerated in isolation.
 //
-static void genNPts(
-    vec_i16             &data,
-    const DAQ::Params   &p,
-    const double        *gain,
-    int                 nPts,
-    quint64             cumSamp )
+static inline quint64 mix64( quint64 x )
 {
-    const double    Tsec        = 1.0,
-                    sampPerT    = Tsec * p.ni.srate,
-                    f           = 2*M_PI/sampPerT,
-                    An          = MAX16BIT*100e-6/p.ni.range.rmax,
-                    Ax          = MAX16BIT*2.2/p.ni.range.rmax;
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
 
-    int n16     = p.ni.niCumTypCnt[CniCfg::niSumAll],
-        nNeu    = p.ni.niCumTypCnt[CniCfg::niSumNeural],
-        nAna    = p.ni.niCumTypCnt[CniCfg::niSumAnalog];
 
-    data.resize( n16 * nPts );
+// Uniform [0,1) from key.
+//
+static inline double unif( quint64 key )
+{
+    return (mix64( key ) >> 11) * (1.0 / 9007199254740992.0);
+}
 
-    qint16  *dst = &data[0];
 
-    for( int s = 0; s < nPts; ++s ) {
+static inline quint64 key3( quint64 seed, quint64 a, quint64 b )
+{
+    return mix64( seed ^ mix64( (a << 40) ^ b ) );
+}
 
-        double  S = sin( f * (cumSamp + s) );
 
-        for( int c = 0; c < nNeu; ++c ) {
+// Biphasic unit spike shape at t ms after onset.
+//
+static inline double spikeShape( double t )
+{
+    if( t < 0.5 )
+        return -sin( M_PI * t / 0.5 );
 
-            dst[c + s*n16] =
-                qBound( -MAX16BIT, int(gain[c] * An * S), MAX16BIT-1 );
-        }
+    return 0.4 * sin( M_PI * (t - 0.5) / (SPIKE_MS - 0.5) );
+}
 
-        for( int c = nNeu; c < nAna; ++c ) {
 
-            dst[c + s*n16] =
-                qBound( -MAX16BIT, int(gain[c] * Ax * S), MAX16BIT-1 );
+// Fill timepoints [i0,i1) of one channel (analog) or bit (digital).
+//
+static void setLevel(
+    qint16  *dst,
+    int     n16,
+    int     i0,
+    int     i1,
+    int     word,
+    int     bit,
+    bool    isAnalog,
+    qint16  hi,
+    bool    high )
+{
+    qint16  *d = dst + i0*n16 + word;
 
-//----------------------------------------------------------------------
-// Force 1-sec pulse; amplitude 3.1V; when [10..11)-sec; chans {0,192}.
-// Useful for testing TTL trigger.
-#if 0
-if( c == 192 ) {
-if( cumSamp+s >= 10*p.ni.srate && cumSamp+s < 11*p.ni.srate )
-    dst[s*n16] = dst[c + s*n16] = int(gain[c] * MAX16BIT*3.1/p.ni.range.rmax);
-else
-    dst[s*n16] = dst[c + s*n16] = 0;
-}
-#endif
-//----------------------------------------------------------------------
-        }
+    if( isAnalog ) {
 
-        for( int c = nAna; c < n16; ++c )
-            dst[c + s*n16] = 0;
+        qint16  v = (high ? hi : 0);
+
+        for( int i = i0; i < i1; ++i, d += n16 )
+            *d = v;
     }
+    else if( high ) {
+
+        for( int i = i0; i < i1; ++i, d += n16 )
+            *d |= (1 << bit);
+    }
+    else {
+
+        for( int i = i0; i < i1; ++i, d += n16 )
+            *d &= ~(1 << bit);
+    }
+}
+
+/* ---------------------------------------------------------------- */
+/* SimCfg --------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+void CniAcqSim::SimCfg::loadSettings()
+{
+    STDSETTINGS( settings, "nisim" );
+    settings.beginGroup( "NISim" );
+
+    speed       = qMax( 0.01, settings.value( "speed", 1.0 ).toDouble() );
+    seed        = settings.value( "seed", 1 ).toULongLong();
+    noiseuV     = settings.value( "noiseuV", 10.0 ).toDouble();
+    spikeRateHz = settings.value( "spikeRateHz", 10.0 ).toDouble();
+    spikeuV     = settings.value( "spikeuV", 150.0 ).toDouble();
+    ttlPeriod   = settings.value( "ttlPeriod", 5.0 ).toDouble();
+    ttlJitter   = settings.value( "ttlJitter", 0.5 ).toDouble();
+    ttlWidth    = settings.value( "ttlWidth", 0.5 ).toDouble();
 }
 
 /* ---------------------------------------------------------------- */
@@ -84,7 +119,7 @@ else
 /* ---------------------------------------------------------------- */
 
 // Alternately:
-// (1) Generate pts at the sample rate.
+// (1) Generate pts at (speed x) the sample rate.
 // (2) Sleep balance of time, up to loopSecs.
 //
 void CniAcqSim::run()
@@ -93,13 +128,7 @@ void CniAcqSim::run()
 // Configure
 // ---------
 
-// Init gain table
-
-    int                 nAna = p.ni.niCumTypCnt[CniCfg::niSumAnalog];
-    std::vector<double> gain( nAna );
-
-    for( int c = 0; c < nAna; ++c )
-        gain[c] = p.ni.chanGain( c );
+    configure();
 
 // -----
 // Start
@@ -116,8 +145,12 @@ void CniAcqSim::run()
 // counts or in debug mode where everything is running slowly.
 // The penalty is a reduction in actual sample rate.
 
-    const double    loopSecs    = 0.02;
-    const quint64   maxPts      = 10 * loopSecs * p.ni.srate;
+    const double    loopSecs    = 0.02,
+                    genRate     = cfg.speed * p.ni.srate;
+    const quint64   maxPts      = 10 * loopSecs * genRate;
+
+    static MXHist   *mxGen = MXStats::hist( "nisim.gen_us" ),
+                    *mxEnq = MXStats::hist( "ni.enqueue_us" );
 
     double  t0 = getTime();
 
@@ -128,7 +161,7 @@ void CniAcqSim::run()
         double  tGen,
                 t           = getTime(),
                 tElapse     = t + loopSecs - t0;
-        quint64 targetCt    = tElapse * p.ni.srate;
+        quint64 targetCt    = tElapse * genRate;
 
         // Make some more pts?
 
@@ -137,10 +170,18 @@ void CniAcqSim::run()
             vec_i16 data;
             int     nPts = qMin( targetCt - totPts, maxPts );
 
-            genNPts( data, p, &gain[0], nPts, totPts );
+            genNPts( data, nPts, totPts );
+
+            mxGen->recordSince( t );
+
+            double  tEnq = getTime();
 
             owner->niQ->enqueue( &data[0], nPts );
             totPts += nPts;
+
+            mxEnq->recordSince( tEnq );
+
+            MXTrace::origin( -1, totPts - nPts, t, getTime() );
         }
 
         tGen = getTime() - t;
@@ -150,7 +191,7 @@ void CniAcqSim::run()
         if( t - tLastReport > 1.0 ) {
 
 #ifdef PROFILE
-// The actual rate should be ~p.ni.srate = [[ 19737 ]].
+// The actual rate should be ~speed * p.ni.srate = [[ 19737 ]].
 // The generator T should be <= loopSecs = [[ 20.00 ]] ms.
 
             static quint64  lastPts = 0;
@@ -172,4 +213,310 @@ void CniAcqSim::run()
     }
 }
 
+/* ---------------------------------------------------------------- */
+/* configure ------------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+void CniAcqSim::configure()
+{
+    cfg.loadSettings();
+
+    n16     = p.ni.niCumTypCnt[CniCfg::niSumAll];
+    nNeu    = p.ni.niCumTypCnt[CniCfg::niSumNeural];
+    nAna    = p.ni.niCumTypCnt[CniCfg::niSumAnalog];
+
+// Triangular noise from two 16-bit uniforms has SD = range/sqrt(6)
+
+    noiseA.assign( nAna, 0 );
+
+    for( int c = 0; c < nAna; ++c ) {
+
+        if( c < p.ni.niCumTypCnt[CniCfg::niTypeMA] ) {
+            noiseA[c] =
+                p.ni.vToInt16( cfg.noiseuV * 1e-6 * sqrt( 6.0 ), c );
+        }
+    }
+
+    spikeA  = p.ni.vToInt16( cfg.spikeuV * 1e-6, -1 );
+    hiV     = qMin( 3.3, 0.9 * p.ni.range.rmax );
+
+// Mux row r (of kmux) is sampled r/kmux of a period late
+
+    int kmux = (p.ni.isMuxingMode() ? p.ni.muxFactor : 1);
+
+    skew.assign( nNeu, 0.0 );
+
+    for( int c = 0; c < nNeu; ++c )
+        skew[c] = double(c % kmux) / kmux;
+}
+
+/* ---------------------------------------------------------------- */
+/* genNPts -------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Analog fill is split into passes the compiler can vectorize:
+// - Sine column by rotation, re-anchored exactly every SIN_ANCHOR
+//   absolute samples, so values still depend only on the count.
+// - Noise: one hash per channel pair (four 16-bit uniforms make
+//   two triangular deviates).
+// - Float scale, add and clamp over the channel row.
+//
+void CniAcqSim::genNPts( vec_i16 &data, int nPts, quint64 cumSamp )
+{
+    const double    f   = 2*M_PI/p.ni.srate,    // 1 Hz
+                    Ax  = MAX16BIT*2.2/p.ni.range.rmax,
+                    cr  = cos( f ),
+                    sr  = sin( f );
+    const quint64   sd  = cfg.seed;
+
+    data.resize( n16 * nPts );
+
+    qint16  *dst = &data[0];
+
+// --------------
+// Analog, digital
+// --------------
+
+    std::vector<float>  sinA( nAna, 0.0f ),
+                        nzA( nAna, 0.0f ),
+                        sinS( nPts );
+    std::vector<int>    tri( nAna + 1 );
+
+    for( int c = 0; c < nAna; ++c ) {
+
+        if( c >= nNeu )
+            sinA[c] = p.ni.chanGain( c ) * Ax;
+
+        nzA[c] = noiseA[c] / 65535.0f;
+    }
+
+    double  C = 1,
+            S = 0;
+
+    for( int s = 0; s < nPts; ++s ) {
+
+        quint64 ct = cumSamp + s;
+
+        if( !s || !(ct % SIN_ANCHOR) ) {
+
+            quint64 a = ct - ct % SIN_ANCHOR;
+
+            C = cos( f * a );
+            S = sin( f * a );
+
+            for( ; a < ct; ++a ) {
+                double  t = C*cr - S*sr;
+                S = S*cr + C*sr;
+                C = t;
+            }
+        }
+
+        sinS[s] = S;
+
+        double  t = C*cr - S*sr;
+        S = S*cr + C*sr;
+        C = t;
+    }
+
+    for( int s = 0; s < nPts; ++s ) {
+
+        quint64 k0  = mix64( sd ^ (cumSamp + s) );
+        float   sn  = sinS[s];
+        qint16  *d  = dst + s*n16;
+
+        for( int c = 0; c < nAna; c += 2 ) {
+
+            quint64 h = mix64( k0 + c );
+
+            tri[c]   = int(h & 0xFFFF) + int((h >> 16) & 0xFFFF) - 65535;
+            tri[c+1] = int((h >> 32) & 0xFFFF) + int(h >> 48) - 65535;
+        }
+
+        for( int c = 0; c < nAna; ++c ) {
+
+            int v = int(sinA[c] * sn + nzA[c] * tri[c]);
+
+            d[c] = qBound( -MAX16BIT, v, MAX16BIT-1 );
+        }
+
+        for( int c = nAna; c < n16; ++c )
+            d[c] = 0;
+    }
+
+// ------
+// Spikes
+// ------
+
+    if( cfg.spikeRateHz > 0 && nNeu )
+        genSpikes( dst, nPts, cumSamp );
+
+// ----
+// Sync
+// ----
+
+    if( p.sync.sourceIdx != DAQ::eSyncSourceNone && p.sync.sourcePeriod > 0 ) {
+
+        bool    isAnalog = (p.sync.niChanType == 1);
+        int     word, bit;
+
+        if( isAnalog ) {
+            word    = p.sync.niChan;
+            bit     = 0;
+        }
+        else {
+            word    = nAna + p.sync.niChan / 16;
+            bit     = p.sync.niChan % 16;
+        }
+
+        if( word >= 0 && word < n16 ) {
+            genSquare(
+                dst, nPts, cumSamp, word, bit,
+                isAnalog, p.sync.sourcePeriod );
+        }
+    }
+
+// ---
+// TTL
+// ---
+
+    if( cfg.ttlPeriod > 0 && p.trgTTL.stream == "nidq" ) {
+
+        bool    isAnalog = p.trgTTL.isAnalog;
+        int     word, bit;
+
+        if( isAnalog ) {
+            word    = p.trgTTL.chan;
+            bit     = 0;
+        }
+        else {
+            word    = nAna + p.trgTTL.bit / 16;
+            bit     = p.trgTTL.bit % 16;
+        }
+
+        if( word >= 0 && word < n16 )
+            genTTL( dst, nPts, cumSamp, word, bit, isAnalog );
+    }
+}
+
+/* ---------------------------------------------------------------- */
+/* genSpikes ------------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+// Each MN channel gets one spike in each slot of 1/spikeRateHz,
+// at a random position, with amplitude in [0.5, 1.5] x spikeuV.
+//
+void CniAcqSim::genSpikes( qint16 *dst, int nPts, quint64 cumSamp )
+{
+    const double    srate   = p.ni.srate,
+                    slot    = srate / cfg.spikeRateHz,
+                    L       = SPIKE_MS * 1e-3 * srate,
+                    msPer   = 1e3 / srate;
+    const double    b0      = double(cumSamp),
+                    b1      = b0 + nPts;
+    const quint64   sd      = cfg.seed;
+
+    for( int c = 0; c < nNeu; ++c ) {
+
+        double  A   = spikeA * p.ni.chanGain( c );
+        qint64  k0  = qMax( 0.0, floor( (b0 - L - 1) / slot ) - 1 ),
+                k1  = qint64(b1 / slot) + 1;
+
+        for( qint64 k = k0; k <= k1; ++k ) {
+
+            quint64 key = key3( sd, c + 1, k );
+            double  T   = (k + unif( key )) * slot + skew[c];
+
+            if( T + L < b0 || T >= b1 )
+                continue;
+
+            double  a   = A * (0.5 + unif( key + 1 ));
+            int     i0  = qMax( 0, int(ceil( T - b0 )) ),
+                    i1  = qMin( nPts, int(ceil( T + L - b0 )) );
+            qint16  *d  = dst + i0*n16 + c;
+
+            for( int i = i0; i < i1; ++i, d += n16 ) {
+
+                int v = *d + int(a * spikeShape( (b0 + i - T) * msPer ));
+
+                *d = qBound( -MAX16BIT, v, MAX16BIT-1 );
+            }
+        }
+    }
+}
+
+/* ---------------------------------------------------------------- */
+/* genSquare ------------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+// 50% duty square wave, high first, phase locked to sample 0.
+//
+void CniAcqSim::genSquare(
+    qint16  *dst,
+    int     nPts,
+    quint64 cumSamp,
+    int     word,
+    int     bit,
+    bool    isAnalog,
+    double  period )
+{
+    const double    half    = 0.5 * period * p.ni.srate;
+    const qint16    hi      = p.ni.vToInt16( hiV, word );
+
+    for( qint64 j = qint64(cumSamp / half); ; ++j ) {
+
+        qint64  s0 = qint64(ceil( j * half )) - cumSamp,
+                s1 = qint64(ceil( (j + 1) * half )) - cumSamp;
+
+        if( s0 >= nPts )
+            break;
+
+        setLevel(
+            dst, n16, qMax( s0, qint64(0) ), qMin( s1, qint64(nPts) ),
+            word, bit, isAnalog, hi, !(j & 1) );
+    }
+}
+
+/* ---------------------------------------------------------------- */
+/* genTTL --------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+// Event k (k >= 1) starts at k*ttlPeriod +/- ttlJitter seconds.
+//
+void CniAcqSim::genTTL(
+    qint16  *dst,
+    int     nPts,
+    quint64 cumSamp,
+    int     word,
+    int     bit,
+    bool    isAnalog )
+{
+    const double    srate   = p.ni.srate,
+                    P       = cfg.ttlPeriod,
+                    J       = qMin( cfg.ttlJitter, 0.49 * P ),
+                    W       = qMin( cfg.ttlWidth, P - 2 * J ),
+                    t0      = cumSamp / srate,
+                    t1      = (cumSamp + nPts) / srate;
+    const qint16    hi      = p.ni.vToInt16( hiV, word );
+
+    setLevel( dst, n16, 0, nPts, word, bit, isAnalog, hi, false );
+
+    qint64  k0 = qMax( qint64(1), qint64(floor( (t0 - W - J) / P )) ),
+            k1 = qint64(ceil( (t1 + J) / P ));
+
+    for( qint64 k = k0; k <= k1; ++k ) {
+
+        double  T = k * P + J * (2 * unif( key3( cfg.seed, 0, k ) ) - 1);
+
+        qint64  s0 = qint64(ceil( T * srate )) - cumSamp,
+                s1 = qint64(ceil( (T + W) * srate )) - cumSamp;
+
+        if( s1 <= 0 || s0 >= nPts )
+            continue;
+
+        setLevel(
+            dst, n16, qMax( s0, qint64(0) ), qMin( s1, qint64(nPts) ),
+            word, bit, isAnalog, hi, true );
+    }
+}
+
 
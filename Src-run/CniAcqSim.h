@@ -9,13 +9,77 @@
 
 // Simulated NI-DAQ input
 //
+// Signals are pure functions of (seed, channel, sample index), so a
+// given configuration replays identically whatever the fetch timing
+// or speed. Settings come from configs/nisim.ini [NISim]:
+//
+// speed        multiple of real time to generate (default 1)
+// seed         random seed (default 1)
+// noiseuV      MN/MA RMS noise (default 10)
+// spikeRateHz  mean spike rate per MN chan; 0=none (default 10)
+// spikeuV      peak spike amplitude (default 150)
+// ttlPeriod    mean seconds between TTL events; 0=none (default 5)
+// ttlJitter    +/- seconds on each event time (default 0.5)
+// ttlWidth     seconds high (default 0.5)
+//
+// Models:
+// - MN: noise + biphasic spikes. In muxing mode each MN channel is
+//   offset by its mux row's share of the sample period, as seen in
+//   demuxed whisper data.
+// - MA, XA: 1 Hz sine (2.2 V) + noise on MA.
+// - Sync: square wave at sync.sourcePeriod on sync.niChan(Type).
+// - TTL: jittered pulses on trgTTL chan/bit if trgTTL.stream=nidq.
+//
 class CniAcqSim : public CniAcq
 {
+private:
+    struct SimCfg {
+        double  speed,
+                noiseuV,
+                spikeRateHz,
+                spikeuV,
+                ttlPeriod,
+                ttlJitter,
+                ttlWidth;
+        quint64 seed;
+
+        void loadSettings();
+    };
+
+    SimCfg              cfg;
+    std::vector<int>    noiseA;     // per analog chan, counts/65535
+    std::vector<double> skew;       // per MN chan, samples
+    double              spikeA,     // counts at unit gain
+                        hiV;        // TTL/sync high level (V)
+    int                 n16,
+                        nNeu,
+                        nAna;
+
 public:
     CniAcqSim( NIReaderWorker *owner, const DAQ::Params &p )
     :   CniAcq( owner, p )  {}
 
     virtual void run();
+
+private:
+    void configure();
+    void genNPts( vec_i16 &data, int nPts, quint64 cumSamp );
+    void genSpikes( qint16 *dst, int nPts, quint64 cumSamp );
+    void genSquare(
+        qint16  *dst,
+        int     nPts,
+        quint64 cumSamp,
+        int     word,
+        int     bit,
+        bool    isAnalog,
+        double  period );
+    void genTTL(
+        qint16  *dst,
+        int     nPts,
+        quint64 cumSamp,
+        int     word,
+        int     bit,
+        bool    isAnalog );
 };
 
 #endif  // CNIACQSIM_H
@@ -10,6 +10,10 @@
 #include "GraphsWindow.h"
 #include "GraphFetcher.h"
 #include "AOCtl.h"
+#include "AIQShm.h"
+#include "DFPlacer.h"
+#include "StreamSubscriber.h"
+#include "TTLEvents.h"
 #include "Version.h"
 
 #include <QAction>
@@ -538,6 +542,9 @@ bool Run::startRun( QString &errTitle, QString &errMsg )
                     E.srate,
                     E.imCumTypCnt[CimCfg::imSumAll],
                     streamSecs ) );
+
+            if( app->isShmExport() )
+                imQ[ip]->shmExport( ip, SHMEXPORT_SECS );
         }
 
         imReader = new IMReader( p, imQ );
@@ -557,6 +564,9 @@ bool Run::startRun( QString &errTitle, QString &errMsg )
                 p.ni.niCumTypCnt[CniCfg::niSumAll],
                 streamSecs );
 
+        if( app->isShmExport() )
+            niQ->shmExport( -1, SHMEXPORT_SECS );
+
         niReader = new NIReader( p, niQ );
         ConnectUI( niReader->worker, SIGNAL(daqError(QString)), app, SLOT(runDaqError(QString)) );
         ConnectUI( niReader->worker, SIGNAL(finished()), this, SLOT(workerStopsRun()) );
@@ -566,6 +576,8 @@ bool Run::startRun( QString &errTitle, QString &errMsg )
 // Trigger
 // -------
 
+    DFPlacer::plan( p );
+
     trg = new Trigger( p, vGW[0].gw, imQ, niQ );
     ConnectUI( trg->worker, SIGNAL(daqError(QString)), app, SLOT(runDaqError(QString)) );
     ConnectUI( trg->worker, SIGNAL(finished()), this, SLOT(workerStopsRun()) );
@@ -611,6 +623,9 @@ void Run::stopRun()
     for( int igw = 0, ngw = vGW.size(); igw < ngw; ++igw )
         vGW[igw].stopFetching();
 
+    StreamSubscriber::stopAll();
+    TTLEvents::clearAll();
+
 // Note: gate sends messages to trg, so must delete gate before trg.
 
     if( gate ) {
@@ -881,6 +896,32 @@ void Run::rgtSetTrig( bool hi )
 }
 
 
+// On rejection, err (if given) receives the reason for the client.
+//
+void Run::rgtSetTrigAt( bool hi, const KeyValMap &kvm, QString *err )
+{
+    QMutexLocker    ml( &runMtx );
+
+    if( trg ) {
+
+        DAQ::Params &p = app->cfgCtl()->acceptedParams;
+
+        if( p.mode.mTrig == DAQ::eTrigTCP ) {
+
+            QString e;
+
+            if( !dynamic_cast<TrigTCP*>(trg->worker)->rgtSetTrigAt( hi, kvm, e ) ) {
+
+                Error() << "Stamped SetTrig ignored: " << e;
+
+                if( err )
+                    *err = e;
+            }
+        }
+    }
+}
+
+
 void Run::rgtSetMetaData( const KeyValMap &kvm )
 {
     QMutexLocker    ml( &runMtx );
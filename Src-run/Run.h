@@ -111,6 +111,7 @@ public slots:
 // Owned gate and trigger ops
     void rgtSetGate( bool hi );
     void rgtSetTrig( bool hi );
+    void rgtSetTrigAt( bool hi, const KeyValMap &kvm, QString *err );
     void rgtSetMetaData( const KeyValMap &kvm );
 
 // Audio ops
@@ -0,0 +1,132 @@
+#ifndef SHMRINGFMT_H
+#define SHMRINGFMT_H
+
+// Layout of the shared-memory stream export.
+//
+// This header is deliberately free of Qt so that client code
+// (e.g. MATLAB-SDK/CalinsNetMex) can include it directly.
+//
+// Each exported stream is one named mapping per run:
+//
+//     [ShmRingHdr][ring of ringScans x nChans int16]
+//
+// Ring names carry a generation number, so a client still holding
+// last run's ring never blocks creation of the next. The current
+// generation of each stream is published in a small fixed-name
+// directory mapping (ShmRingDir). To attach:
+//
+//     gen = dir.gen[shmDirSlot( ip )];    (acquire; 0 = none yet)
+//     map shmRingName( ip, gen );
+//     check alive (acquire), then magic, version and size.
+//
+// The writer fills the whole header before storing (alive) and
+// then (gen), both with release, so an attached reader never
+// sees a partial header. Only tZero changes later; it is atomic.
+//
+// Timepoint (ct) lives in ring slot (ct % ringScans).
+//
+// Writer (single producer, SpikeGLX):
+//     wrEndCt = endCt + n;        (then release fence)
+//     copy n timepoints;
+//     endCt   = endCt + n;        (release)
+//
+// Reader (any number):
+//     end = endCt;                (acquire)
+//     copy [fromCt, fromCt+n) with fromCt >= end - ringScans;
+//     acquire fence;
+//     if fromCt < wrEndCt - ringScans, data were overwritten
+//     during the copy: discard and retry from a newer count.
+//
+// (alive == 0) means SpikeGLX has closed the stream: detach and
+// re-attach (re-reading the directory) when the next run starts.
+
+#include <atomic>
+#include <stdint.h>
+#include <stdio.h>
+
+/* ---------------------------------------------------------------- */
+/* Macros --------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+#define SHMRING_MAGIC       "SGLXAIQ"
+#define SHMRING_VERSION     2
+#define SHMDIR_MAGIC        "SGLXDIR"
+#define SHMDIR_NSTREAMS     64      // slot 0 = NI, 1+ip = imec ip
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+struct ShmRingHdr {
+    char                    magic[8];   // SHMRING_MAGIC
+    uint32_t                version,    // SHMRING_VERSION
+                            hdrBytes;   // offset of ring from base
+    int32_t                 ip,         // -1=NI, else imec probe
+                            nChans;     // int16 words per timepoint
+    uint64_t                ringScans;  // capacity in timepoints
+    double                  srate;      // samples/s
+    std::atomic<double>     tZero;      // wall time of ct=0
+    std::atomic<uint64_t>   wrEndCt,    // endCt after write completes
+                            endCt;      // timepoints since run start
+    std::atomic<uint32_t>   alive;      // 0 after writer closes
+    uint32_t                rsv[15];
+};
+
+
+struct ShmRingDir {
+    char                    magic[8];   // SHMDIR_MAGIC
+    std::atomic<uint32_t>   gen[SHMDIR_NSTREAMS];   // current ring
+};
+
+/* ---------------------------------------------------------------- */
+/* Functions ------------------------------------------------------ */
+/* ---------------------------------------------------------------- */
+
+// Directory mapping name.
+// Linux: POSIX shm_open() name; Windows: file mapping name.
+//
+inline void shmDirName( char name[64] )
+{
+#ifdef _WIN32
+    snprintf( name, 64, "Local\\SpikeGLX_shmdir" );
+#else
+    snprintf( name, 64, "/SpikeGLX_shmdir" );
+#endif
+}
+
+
+// Directory slot for stream ip {-1=NI, else imec probe},
+// or -1 if out of range.
+//
+inline int shmDirSlot( int ip )
+{
+    return (ip >= -1 && ip + 1 < SHMDIR_NSTREAMS ? ip + 1 : -1);
+}
+
+
+// Ring mapping name for stream ip, generation gen.
+//
+inline void shmRingName( char name[64], int ip, uint32_t gen )
+{
+#ifdef _WIN32
+    if( ip >= 0 )
+        snprintf( name, 64, "Local\\SpikeGLX_imec%d_g%u", ip, gen );
+    else
+        snprintf( name, 64, "Local\\SpikeGLX_nidq_g%u", gen );
+#else
+    if( ip >= 0 )
+        snprintf( name, 64, "/SpikeGLX_imec%d_g%u", ip, gen );
+    else
+        snprintf( name, 64, "/SpikeGLX_nidq_g%u", gen );
+#endif
+}
+
+
+inline uint64_t shmRingBytes( uint64_t ringScans, int nChans )
+{
+    return sizeof(ShmRingHdr) + ringScans * nChans * sizeof(int16_t);
+}
+
+#endif  // SHMRINGFMT_H
+
+
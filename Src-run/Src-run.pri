@@ -1,6 +1,7 @@
 
 HEADERS += \
     $$PWD/AIQ.h \
+    $$PWD/AIQShm.h \
     $$PWD/CalSRate.h \
     $$PWD/CalSRateCtl.h \
     $$PWD/CimAcq.h \
@@ -15,10 +16,12 @@ HEADERS += \
     $$PWD/IMReader.h \
     $$PWD/NIReader.h \
     $$PWD/Run.h \
+    $$PWD/ShmRingFmt.h \
     $$PWD/Sync.h
 
 SOURCES += \
     $$PWD/AIQ.cpp \
+    $$PWD/AIQShm.cpp \
     $$PWD/CalSRate.cpp \
     $$PWD/CalSRateCtl.cpp \
     $$PWD/CimAcqImec.cpp \
@@ -2,6 +2,7 @@
 HEADERS += \
     $$PWD/TrigBase.h \
     $$PWD/TrigImmed.h \
+    $$PWD/TrigIOPool.h \
     $$PWD/TrigSpike.h \
     $$PWD/TrigTCP.h \
     $$PWD/TrigTimed.h \
@@ -10,6 +11,7 @@ HEADERS += \
 SOURCES += \
     $$PWD/TrigBase.cpp \
     $$PWD/TrigImmed.cpp \
+    $$PWD/TrigIOPool.cpp \
     $$PWD/TrigSpike.cpp \
     $$PWD/TrigTCP.cpp \
     $$PWD/TrigTimed.cpp \
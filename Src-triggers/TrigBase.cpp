@@ -8,6 +8,10 @@
 #include "MainApp.h"
 #include "GraphsWindow.h"
 #include "MetricsWindow.h"
+#include "DFPlacer.h"
+#include "SampleBufQ.h"
+#include "Subset.h"
+#include "MXTrace.h"
 
 #include <QDir>
 #include <QFileInfo>
@@ -401,6 +405,9 @@ bool TrigBase::nScansFromCt(
         nMax = 4.0 * 0.001 * -nMax * Q->sRate();
     }
 
+    if( data.capacity() < uint(nMax * Q->nChans()) )
+        SampleBufQ::reuse( data );
+
     try {
         data.reserve( nMax * Q->nChans() );
     }
@@ -450,10 +457,37 @@ bool TrigBase::writeAndInvalData(
     vec_i16     &data,
     quint64     headCt )
 {
-    if( dst == DstImec )
+    if( dst == DstImec ) {
+
+        if( ip < (uint)firstCtIm.size() ) {
+
+            int trcID = MXTrace::hit(
+                            ip, headCt, data.size() / imQ[ip]->nChans(),
+                            "trig.dequeue" );
+
+            if( trcID >= 0 ) {
+
+                if( dfImAp[ip] )
+                    dfImAp[ip]->setTraceID( trcID );
+                else if( dfImLf[ip] )
+                    dfImLf[ip]->setTraceID( trcID );
+            }
+        }
+
         return writeDataIM( data, headCt, ip );
-    else
+    }
+    else {
+
+        if( dfNi ) {
+
+            dfNi->setTraceID(
+                MXTrace::hit(
+                    -1, headCt, data.size() / niQ->nChans(),
+                    "trig.dequeue" ) );
+        }
+
         return writeDataNI( data, headCt );
+    }
 }
 
 
@@ -741,24 +775,17 @@ void TrigBase::statusWrPerf( QString &s )
 
         for( int ip = 0; ip < np; ++ip ) {
 
-            if( dfImAp[ip] ) {
-                imFull   = qMax( imFull, dfImAp[ip]->percentFull() );
-                wbps    += dfImAp[ip]->writtenBytes();
-                rbps    += dfImAp[ip]->requiredBps();
-            }
+            if( dfImAp[ip] )
+                tallyWrPerf( dfImAp[ip], imFull, wbps, rbps );
 
-            if( dfImLf[ip] ) {
-                imFull  = qMax( imFull, dfImLf[ip]->percentFull() );
-                wbps   += dfImLf[ip]->writtenBytes();
-                rbps   += dfImLf[ip]->requiredBps();
-            }
+            if( dfImLf[ip] )
+                tallyWrPerf( dfImLf[ip], imFull, wbps, rbps );
         }
 
-        if( dfNi ) {
-            niFull  = dfNi->percentFull();
-            wbps   += dfNi->writtenBytes();
-            rbps   += dfNi->requiredBps();
-        }
+        if( dfNi )
+            tallyWrPerf( dfNi, niFull, wbps, rbps );
+
+        DFPlacer::liveCommit( tReport - tLastReport );
 
         wbps /= (tReport - tLastReport);
         wbps /= 1024*1024;
@@ -785,6 +812,26 @@ void TrigBase::statusWrPerf( QString &s )
 }
 
 
+// Accumulate df into stream totals and its drive's tally.
+//
+void TrigBase::tallyWrPerf(
+    const DataFile  *df,
+    double          &full,
+    double          &wbps,
+    double          &rbps )
+{
+    double  f = df->percentFull(),
+            w = df->writtenBytes(),
+            r = df->requiredBps();
+
+    full  = qMax( full, f );
+    wbps += w;
+    rbps += r;
+
+    DFPlacer::liveTally( df->dirIndex(), w, r, f );
+}
+
+
 void TrigBase::setYieldPeriod_ms( int loopPeriod_ms )
 {
     if( loopPeriod_ms > 0 )
@@ -836,99 +883,15 @@ bool TrigBase::openFile( DataFile *df, int ig, int it )
 }
 
 
-// Write LF samples on X12 boundaries (sample%12==0).
-//
-// - inplace true means data param will not be used
-// for AP, so we can write the X12 samples into it.
-// Otherwise we allocate an alternate dst.
-//
-// - xtra true means that the first sample in the file
-// is not an X12, so we will need to construct the prior
-// X12 LF data by extrapolating from the nearest forward
-// X12 and the timepoint preceding it. The constructed
-// sync data are a copy of the first timepoint values.
-//
-bool TrigBase::writeDataLF(
-    vec_i16     &data,
-    quint64     headCt,
-    uint        ip,
-    bool        inplace,
-    bool        xtra )
-{
-    vec_i16 dstAlt;
-    vec_i16 *dst;
-    qint16  *D, *S;
-    int     R       = headCt % 12,
-            nCh     = p.im.each[ip].imCumTypCnt[CimCfg::imSumAll],
-            nAP     = p.im.each[ip].imCumTypCnt[CimCfg::imSumAP],
-            nLF     = p.im.each[ip].imCumTypCnt[CimCfg::imSumNeural] - nAP,
-            size    = (int)data.size(),
-            nTp     = size / nCh;
-
-// Set up dst = destination workspace
-// D points to first destination for X12 copies
-
-    if( inplace )
-        dst = &data;
-    else {
-        dstAlt.resize( ((xtra ? 2 : 1) + nTp) * nCh );
-        dst = &dstAlt;
-    }
-
-    D = &dst->front();
-
-// S points to first source timepoint
-
-    if( R )
-        R = 12 - R;
-
-    S = &data[R*nCh];
-
-// Extrapolate extra first timepoint if needed
-
-    if( xtra ) {
-
-        // Point p2 to the LF data for the first X12 timepoint.
-        // Point p1 to the LF data for the previous timepoint.
-
-        qint16  *p2 = S  + nAP,
-                *p1 = p2 - nCh;
-
-        D += nAP;   // D offset temporarily to LF channels
-
-        for( int lf = 0; lf < nLF; ++lf )
-            D[lf] = p2[lf] - (p2[lf] - p1[lf]) * 12;
-
-        D -= nAP;   // D normalized
-
-        // sync channels
-
-        for( int is = nAP + nLF; is < nCh; ++is )
-            D[is] = data[is];
-
-        D += nCh;
-    }
-
-// S to D X12 copies
-
-    for( int it = R; it < nTp; it += 12, D += nCh, S += 12*nCh )
-        memcpy( D + nAP, S + nAP, (nCh - nAP) * sizeof(qint16) );
-
-    dst->resize( D - &dst->front() );
-
-    if( dst->size() && !dfImLf[ip]->writeAndInvalSubset( p, *dst ) )
-        return false;
-
-    return true;
-}
-
-
 // Split the data into (AP+SY) and (LF+SY) components,
 // directing each to the appropriate data file.
 //
 // Here, all AP data are written, but only LF samples
 // on X12-boundary (sample%12==0) are written.
 //
+// Both subsets come from one pass over the block
+// (Subset::subsetAPLF), the AP part in place.
+//
 bool TrigBase::writeDataIM( vec_i16 &data, quint64 headCt, uint ip )
 {
     uint    np      = firstCtIm.size();
@@ -939,7 +902,10 @@ bool TrigBase::writeDataIM( vec_i16 &data, quint64 headCt, uint ip )
     if( !(isAP || isLF) )
         return true;
 
-    int size = (int)data.size();
+    const CimCfg::AttrEach  &E = p.im.each[ip];
+
+    int nCh     = E.imCumTypCnt[CimCfg::imSumAll],
+        size    = (int)data.size();
 
     if( size && !firstCtIm[ip] ) {
 
@@ -954,9 +920,7 @@ bool TrigBase::writeDataIM( vec_i16 &data, quint64 headCt, uint ip )
 
                 // need enough data to extrapolate
 
-                int nCh = p.im.each[ip].imCumTypCnt[CimCfg::imSumAll];
-
-                if( data.size() / nCh > 12 - (headCt % 12) )
+                if( size / nCh > 12 - (headCt % 12) )
                     xtra = true;
             }
 
@@ -964,10 +928,57 @@ bool TrigBase::writeDataIM( vec_i16 &data, quint64 headCt, uint ip )
         }
     }
 
-    if( isLF && !writeDataLF( data, headCt, ip, !isAP, xtra ) )
+    if( !isLF )
+        return dfImAp[ip]->writeAndInvalSubset( p, data );
+
+// R = first X12 timepoint in data
+
+    int R = headCt % 12;
+
+    if( R )
+        R = 12 - R;
+
+// If the first file sample is not an X12, construct the prior
+// X12 LF data by extrapolating from the nearest forward X12 and
+// the timepoint preceding it. The constructed sync data are a
+// copy of the first timepoint values.
+
+    vec_i16 xrow;
+
+    if( xtra ) {
+
+        // Point p2 to the LF data for the first X12 timepoint.
+        // Point p1 to the LF data for the previous timepoint.
+
+        int             nAP = E.imCumTypCnt[CimCfg::imSumAP],
+                        nLF = E.imCumTypCnt[CimCfg::imSumNeural] - nAP;
+        const qint16    *p2 = &data[R*nCh + nAP],
+                        *p1 = p2 - nCh;
+
+        xrow.assign( data.begin(), data.begin() + nCh );    // sync chans
+
+        for( int lf = 0; lf < nLF; ++lf )
+            xrow[nAP + lf] = p2[lf] - (p2[lf] - p1[lf]) * 12;
+    }
+
+// Fused subset
+
+    static SubsetPlan   noAP;
+
+    vec_i16 lf;
+
+    SampleBufQ::reuse( lf );
+
+    Subset::subsetAPLF(
+        data, lf,
+        (isAP ? dfImAp[ip]->writePlan( p ) : noAP),
+        dfImLf[ip]->writePlan( p ),
+        R, (xtra ? &xrow[0] : 0) );
+
+    if( lf.size() && !dfImLf[ip]->writeAndInvalScans( lf ) )
         return false;
 
-    if( isAP && !dfImAp[ip]->writeAndInvalSubset( p, data ) )
+    if( isAP && !dfImAp[ip]->writeAndInvalScans( data ) )
         return false;
 
     return true;
@@ -1032,6 +1043,8 @@ Trigger::~Trigger()
     }
 
     delete thread;
+
+    SampleBufQ::freePool();
 }
 
 
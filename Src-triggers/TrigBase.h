@@ -18,6 +18,8 @@ class TrigBase : public QObject
 {
     Q_OBJECT
 
+    friend class TrigIOPool;
+
 private:
     struct ManOvr {
         int             usrG,
@@ -157,14 +159,16 @@ protected:
     void setYieldPeriod_ms( int loopPeriod_ms );
     void yield( double loopT );
 
+    // Per-probe transfer step run by TrigIOPool
+    virtual bool xferIm( int ip ) = 0;
+
 private:
+    void tallyWrPerf(
+        const DataFile  *df,
+        double          &full,
+        double          &wbps,
+        double          &rbps );
     bool openFile( DataFile *df, int ig, int it );
-    bool writeDataLF(
-        vec_i16     &data,
-        quint64     headCt,
-        uint        ip,
-        bool        inplace,
-        bool        xtra );
     bool writeDataIM( vec_i16 &data, quint64 headCt, uint ip );
     bool writeDataNI( vec_i16 &data, quint64 headCt );
 };
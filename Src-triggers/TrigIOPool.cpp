@@ -0,0 +1,159 @@
+
+#include "TrigIOPool.h"
+#include "TrigBase.h"
+#include "Util.h"
+#include "MXStats.h"
+
+#include <QThread>
+
+
+#define PRB_PER_THD     2
+
+
+/* ---------------------------------------------------------------- */
+/* TrigIOWorker --------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+void TrigIOWorker::run()
+{
+    quint32 seen = 0;
+
+    while( pool.waitPass( seen ) )
+        pool.drain();
+
+    emit finished();
+}
+
+/* ---------------------------------------------------------------- */
+/* TrigIOPool ----------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+TrigIOPool::TrigIOPool( TrigBase *trg, int nIP )
+    :   trg(trg), tBeg(0), pass(0), nIP(nIP),
+        nextIP(nIP), pending(0), errors(0), stop(false)
+{
+    int nThd = qMin(
+                (nIP + PRB_PER_THD - 1) / PRB_PER_THD,
+                qMax( QThread::idealThreadCount(), 1 ) );
+
+    for( int iThd = 0; iThd < nThd; ++iThd ) {
+
+        QThread         *thread = new QThread;
+        TrigIOWorker    *worker = new TrigIOWorker( *this );
+
+        worker->moveToThread( thread );
+
+        Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
+        Connect( worker, SIGNAL(finished()), worker, SLOT(deleteLater()) );
+        Connect( worker, SIGNAL(destroyed()), thread, SLOT(quit()), Qt::DirectConnection );
+
+        thread->start();
+        vT.push_back( thread );
+    }
+}
+
+
+// worker objects auto-deleted asynchronously
+// thread objects manually deleted synchronously (so we can call wait())
+//
+TrigIOPool::~TrigIOPool()
+{
+    runMtx.lock();
+        stop = true;
+    runMtx.unlock();
+    condWake.wakeAll();
+
+    for( int iThd = 0, nThd = vT.size(); iThd < nThd; ++iThd ) {
+
+        if( vT[iThd]->isRunning() )
+            vT[iThd]->wait( 10000/nThd );
+
+        delete vT[iThd];
+    }
+}
+
+
+// Open a pass over all probes.
+//
+void TrigIOPool::begin()
+{
+    if( !nIP )
+        return;
+
+    runMtx.lock();
+        tBeg    = getTime();
+        nextIP  = 0;
+        pending = nIP;
+        errors  = 0;
+        ++pass;
+    runMtx.unlock();
+    condWake.wakeAll();
+}
+
+
+// Help finish the pass, then wait for stragglers.
+//
+// Return true if no errors.
+//
+bool TrigIOPool::end()
+{
+    static MXHist   *mxPass = MXStats::hist( "trig.pass_us" );
+
+    if( !nIP )
+        return true;
+
+    drain();
+
+    QMutexLocker    ml( &runMtx );
+
+    while( pending )
+        condDone.wait( &runMtx );
+
+    mxPass->recordSince( tBeg );
+
+    return !errors;
+}
+
+
+// Return false if stopping.
+//
+bool TrigIOPool::waitPass( quint32 &seen )
+{
+    QMutexLocker    ml( &runMtx );
+
+    while( !stop && pass == seen )
+        condWake.wait( &runMtx );
+
+    seen = pass;
+
+    return !stop;
+}
+
+
+// Claim and transfer probes until none left this pass.
+//
+void TrigIOPool::drain()
+{
+    for(;;) {
+
+        int ip;
+
+        runMtx.lock();
+            ip = (nextIP < nIP ? nextIP++ : -1);
+        runMtx.unlock();
+
+        if( ip < 0 )
+            return;
+
+        bool    ok = trg->xferIm( ip );
+
+        runMtx.lock();
+            errors += !ok;
+
+            if( !--pending )
+                condDone.wakeAll();
+        runMtx.unlock();
+    }
+}
+
+
@@ -0,0 +1,79 @@
+#ifndef TRIGIOPOOL_H
+#define TRIGIOPOOL_H
+
+#include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <vector>
+
+class TrigBase;
+class TrigIOPool;
+
+class QThread;
+
+/* ---------------------------------------------------------------- */
+/* Types ---------------------------------------------------------- */
+/* ---------------------------------------------------------------- */
+
+class TrigIOWorker : public QObject
+{
+    Q_OBJECT
+
+private:
+    TrigIOPool  &pool;
+
+public:
+    TrigIOWorker( TrigIOPool &pool ) : QObject(0), pool(pool)   {}
+    virtual ~TrigIOWorker()                                     {}
+
+signals:
+    void finished();
+
+public slots:
+    void run();
+};
+
+
+// Imec transfer scheduler shared by all trigger modes.
+//
+// Per pass, the trigger thread calls begin(), does its nidq
+// work, then end(). Pool threads (and the trigger thread, inside
+// end()) claim probes one at a time from a common cursor and call
+// TrigBase::xferIm(ip) for each. Every probe's ready range moves
+// in the same pass without a fixed probe-to-thread binding, and
+// end() sleeps on a completion condition rather than polling.
+//
+class TrigIOPool
+{
+    friend class TrigIOWorker;
+
+private:
+    TrigBase                *trg;
+    std::vector<QThread*>   vT;
+    QMutex                  runMtx;
+    QWaitCondition          condWake,
+                            condDone;
+    double                  tBeg;
+    quint32                 pass;
+    int                     nIP,
+                            nextIP,
+                            pending,
+                            errors;
+    bool                    stop;
+
+public:
+    TrigIOPool( TrigBase *trg, int nIP );
+    virtual ~TrigIOPool();
+
+    void begin();
+    bool end();
+
+private:
+    bool waitPass( quint32 &seen );
+    void drain();
+};
+
+#endif  // TRIGIOPOOL_H
+
+
@@ -1,93 +1,13 @@
 
 #include "TrigImmed.h"
 #include "Util.h"
+#include "TrigIOPool.h"
 #include "DataFile.h"
 
-#include <QThread>
-
 
 #define LOOP_MS     100
 
 
-static TrigImmed    *ME;
-
-
-/* ---------------------------------------------------------------- */
-/* TrImmWorker ---------------------------------------------------- */
-/* ---------------------------------------------------------------- */
-
-void TrImmWorker::run()
-{
-    const int   nID = vID.size();
-    bool        ok  = true;
-
-    for(;;) {
-
-        if( !shr.wake( ok ) )
-            break;
-
-        for( int iID = 0; iID < nID; ++iID ) {
-
-            if( !(ok = writeSomeIM( vID[iID] )) )
-                break;
-        }
-    }
-
-    emit finished();
-}
-
-
-bool TrImmWorker::writeSomeIM( int ip )
-{
-    vec_i16 data;
-    quint64 headCt = shr.imNextCt[ip];
-
-    if( !ME->nScansFromCt( data, headCt, -LOOP_MS, ip ) )
-        return false;
-
-    uint    size = data.size();
-
-    if( !size )
-        return true;
-
-    shr.imNextCt[ip] += size / imQ[ip]->nChans();
-
-    return ME->writeAndInvalData( ME->DstImec, ip, data, headCt );
-}
-
-/* ---------------------------------------------------------------- */
-/* TrImmThread ---------------------------------------------------- */
-/* ---------------------------------------------------------------- */
-
-TrImmThread::TrImmThread(
-    TrImmShared         &shr,
-    const QVector<AIQ*> &imQ,
-    std::vector<int>    &vID )
-{
-    thread  = new QThread;
-    worker  = new TrImmWorker( shr, imQ, vID );
-
-    worker->moveToThread( thread );
-
-    Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
-    Connect( worker, SIGNAL(finished()), worker, SLOT(deleteLater()) );
-    Connect( worker, SIGNAL(destroyed()), thread, SLOT(quit()), Qt::DirectConnection );
-
-    thread->start();
-}
-
-
-TrImmThread::~TrImmThread()
-{
-// worker object auto-deleted asynchronously
-// thread object manually deleted synchronously (so we can call wait())
-
-    if( thread->isRunning() )
-        thread->wait();
-
-    delete thread;
-}
-
 /* ---------------------------------------------------------------- */
 /* TrigImmed ------------------------------------------------------ */
 /* ---------------------------------------------------------------- */
@@ -103,45 +23,10 @@ void TrigImmed::run()
 // Configure
 // ---------
 
-    ME = this;
-
     QString err;
     quint64 niNextCt = 0;
 
-// Create worker threads
-
-    const int                   nPrbPerThd = 2;
-
-    std::vector<TrImmThread*>   trT;
-    TrImmShared                 shr( p );
-
-    nThd = 0;
-
-    for( int ip0 = 0; ip0 < nImQ; ip0 += nPrbPerThd ) {
-
-        std::vector<int>    vID;
-
-        for( int id = 0; id < nPrbPerThd; ++id ) {
-
-            if( ip0 + id < nImQ )
-                vID.push_back( ip0 + id );
-            else
-                break;
-        }
-
-        trT.push_back( new TrImmThread( shr, imQ, vID ) );
-        ++nThd;
-    }
-
-// Wait for threads to reach ready (sleep) state
-
-    shr.runMtx.lock();
-        while( shr.asleep < nThd ) {
-            shr.runMtx.unlock();
-                QThread::usleep( 10 );
-            shr.runMtx.lock();
-        }
-    shr.runMtx.unlock();
+    TrigIOPool  io( this, nImQ );
 
 // -----
 // Start
@@ -163,7 +48,7 @@ void TrigImmed::run()
             goto next_loop;
         }
 
-        if( !allWriteSome( shr, niNextCt, err ) )
+        if( !allWriteSome( io, niNextCt, err ) )
             break;
 
         // ------
@@ -190,15 +75,6 @@ next_loop:
         yield( loopT );
     }
 
-// Kill all threads
-
-    shr.kill();
-
-    for( int iThd = 0; iThd < nThd; ++iThd ) {
-        trT[iThd]->thread->wait( 10000/nThd );
-        delete trT[iThd];
-    }
-
 // Done
 
     endRun( err );
@@ -254,6 +130,27 @@ bool TrigImmed::alignFiles(
 }
 
 
+// Return true if no errors.
+//
+bool TrigImmed::xferIm( int ip )
+{
+    vec_i16 data;
+    quint64 headCt = imNextCt[ip];
+
+    if( !nScansFromCt( data, headCt, -LOOP_MS, ip ) )
+        return false;
+
+    uint    size = data.size();
+
+    if( !size )
+        return true;
+
+    imNextCt[ip] += size / imQ[ip]->nChans();
+
+    return writeAndInvalData( DstImec, ip, data, headCt );
+}
+
+
 // Return true if no errors.
 //
 bool TrigImmed::writeSomeNI( quint64 &nextCt )
@@ -281,37 +178,23 @@ bool TrigImmed::writeSomeNI( quint64 &nextCt )
 // Return true if no errors.
 //
 bool TrigImmed::xferAll(
-    TrImmShared &shr,
+    TrigIOPool  &io,
     quint64     &niNextCt,
     QString     &err )
 {
     bool    niOK;
 
-    shr.awake   = 0;
-    shr.asleep  = 0;
-    shr.errors  = 0;
-
-// Wake all imec threads
+// Start imec pass
 
-    shr.condWake.wakeAll();
+    io.begin();
 
 // Do nidq locally
 
     niOK = writeSomeNI( niNextCt );
 
-// Wait all threads started, and all done
-
-    shr.runMtx.lock();
-        while( shr.awake  < nThd
-            || shr.asleep < nThd ) {
-
-            shr.runMtx.unlock();
-                QThread::msleep( LOOP_MS/8 );
-            shr.runMtx.lock();
-        }
-    shr.runMtx.unlock();
+// Finish imec pass
 
-    if( niOK && !shr.errors )
+    if( io.end() && niOK )
         return true;
 
     err = "write failed";
@@ -322,7 +205,7 @@ bool TrigImmed::xferAll(
 // Return true if no errors.
 //
 bool TrigImmed::allWriteSome(
-    TrImmShared &shr,
+    TrigIOPool  &io,
     quint64     &niNextCt,
     QString     &err )
 {
@@ -335,7 +218,7 @@ bool TrigImmed::allWriteSome(
         int ig, it;
 
         // reset tracking
-        shr.imNextCt.clear();
+        imNextCt.clear();
         niNextCt = 0;
 
         if( !newTrig( ig, it ) ) {
@@ -348,14 +231,14 @@ bool TrigImmed::allWriteSome(
 // Seek common sync time
 // ---------------------
 
-    if( !alignFiles( shr.imNextCt, niNextCt, err ) )
+    if( !alignFiles( imNextCt, niNextCt, err ) )
         return err.isEmpty();
 
 // ----------------------
 // Fetch from all streams
 // ----------------------
 
-    return xferAll( shr, niNextCt, err );
+    return xferAll( io, niNextCt, err );
 }
 
 
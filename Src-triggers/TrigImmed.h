@@ -3,99 +3,18 @@
 
 #include "TrigBase.h"
 
-#include <QWaitCondition>
+class TrigIOPool;
 
 /* ---------------------------------------------------------------- */
 /* Types ---------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
-struct TrImmShared {
-    const DAQ::Params       &p;
-    std::vector<quint64>    imNextCt;
-    QMutex                  runMtx;
-    QWaitCondition          condWake;
-    int                     awake,
-                            asleep,
-                            errors;
-    bool                    stop;
-
-    TrImmShared( const DAQ::Params &p )
-    :   p(p), awake(0), asleep(0), stop(false)  {}
-
-    bool wake( bool ok )
-    {
-        bool    run;
-        runMtx.lock();
-            errors += !ok;
-            ++asleep;
-            condWake.wait( &runMtx );
-            ++awake;
-            run = !stop;
-        runMtx.unlock();
-        return run;
-    }
-
-    void kill()
-    {
-        runMtx.lock();
-            stop = true;
-        runMtx.unlock();
-        condWake.wakeAll();
-    }
-};
-
-
-class TrImmWorker : public QObject
-{
-    Q_OBJECT
-
-private:
-    TrImmShared         &shr;
-    const QVector<AIQ*> &imQ;
-    std::vector<int>    vID;
-
-public:
-    TrImmWorker(
-        TrImmShared         &shr,
-        const QVector<AIQ*> &imQ,
-        std::vector<int>    &vID )
-    :   shr(shr), imQ(imQ), vID(vID)    {}
-    virtual ~TrImmWorker()              {}
-
-signals:
-    void finished();
-
-public slots:
-    void run();
-
-private:
-    bool writeSomeIM( int ip );
-};
-
-
-class TrImmThread
-{
-public:
-    QThread     *thread;
-    TrImmWorker *worker;
-
-public:
-    TrImmThread(
-        TrImmShared         &shr,
-        const QVector<AIQ*> &imQ,
-        std::vector<int>    &vID );
-    virtual ~TrImmThread();
-};
-
-
 class TrigImmed : public TrigBase
 {
     Q_OBJECT
 
-    friend class TrImmWorker;
-
 private:
-    int nThd;
+    std::vector<quint64>    imNextCt;
 
 public:
     TrigImmed(
@@ -108,6 +27,9 @@ public:
 public slots:
     virtual void run();
 
+protected:
+    virtual bool xferIm( int ip );
+
 private:
     bool alignFiles(
         std::vector<quint64>    &imNextCt,
@@ -117,11 +39,11 @@ private:
     bool writeSomeNI( quint64 &nextCt );
 
     bool xferAll(
-        TrImmShared &shr,
+        TrigIOPool  &io,
         quint64     &niNextCt,
         QString     &err );
     bool allWriteSome(
-        TrImmShared &shr,
+        TrigIOPool  &io,
         quint64     &niNextCt,
         QString     &err );
 };
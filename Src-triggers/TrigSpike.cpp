@@ -1,108 +1,17 @@
 
 #include "TrigSpike.h"
 #include "Util.h"
+#include "TrigIOPool.h"
 #include "Biquad.h"
 #include "MainApp.h"
 #include "Run.h"
 #include "GraphsWindow.h"
 
 #include <QTimer>
-#include <QThread>
-
 
 #define LOOP_MS     100
 
 
-static TrigSpike    *ME;
-
-
-/* ---------------------------------------------------------------- */
-/* TrSpkWorker ---------------------------------------------------- */
-/* ---------------------------------------------------------------- */
-
-void TrSpkWorker::run()
-{
-    const int   nID = vID.size();
-    bool        ok  = true;
-
-    for(;;) {
-
-        if( !shr.wake( ok ) )
-            break;
-
-        for( int iID = 0; iID < nID; ++iID ) {
-
-            if( !(ok = writeSomeIM( vID[iID] )) )
-                break;
-        }
-    }
-
-    emit finished();
-}
-
-
-bool TrSpkWorker::writeSomeIM( int ip )
-{
-    TrigSpike::CountsIm &C      = ME->imCnt;
-    vec_i16             data;
-    quint64             headCt  = C.nextCt[ip];
-    int                 nMax    = C.remCt[ip];
-
-    if( !ME->nScansFromCt( data, headCt, nMax, ip ) )
-        return false;
-
-    uint    size = data.size();
-
-    if( !size )
-        return true;
-
-// ---------------
-// Update tracking
-// ---------------
-
-    C.nextCt[ip]    += size / imQ[ip]->nChans();
-    C.remCt[ip]     -= C.nextCt[ip] - headCt;
-
-// -----
-// Write
-// -----
-
-    return ME->writeAndInvalData( ME->DstImec, ip, data, headCt );
-}
-
-/* ---------------------------------------------------------------- */
-/* TrSpkThread ---------------------------------------------------- */
-/* ---------------------------------------------------------------- */
-
-TrSpkThread::TrSpkThread(
-    TrSpkShared         &shr,
-    const QVector<AIQ*> &imQ,
-    std::vector<int>    &vID )
-{
-    thread  = new QThread;
-    worker  = new TrSpkWorker( shr, imQ, vID );
-
-    worker->moveToThread( thread );
-
-    Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
-    Connect( worker, SIGNAL(finished()), worker, SLOT(deleteLater()) );
-    Connect( worker, SIGNAL(destroyed()), thread, SLOT(quit()), Qt::DirectConnection );
-
-    thread->start();
-}
-
-
-TrSpkThread::~TrSpkThread()
-{
-// worker object auto-deleted asynchronously
-// thread object manually deleted synchronously (so we can call wait())
-
-    if( thread->isRunning() )
-        thread->wait();
-
-    delete thread;
-}
-
 /* ---------------------------------------------------------------- */
 /* struct HiPassFnctr --------------------------------------------- */
 /* ---------------------------------------------------------------- */
@@ -299,42 +208,7 @@ void TrigSpike::run()
 // Configure
 // ---------
 
-    ME = this;
-
-// Create worker threads
-
-    const int                   nPrbPerThd = 2;
-
-    std::vector<TrSpkThread*>   trT;
-    TrSpkShared                 shr( p );
-
-    nThd = 0;
-
-    for( int ip0 = 0; ip0 < nImQ; ip0 += nPrbPerThd ) {
-
-        std::vector<int>    vID;
-
-        for( int id = 0; id < nPrbPerThd; ++id ) {
-
-            if( ip0 + id < nImQ )
-                vID.push_back( ip0 + id );
-            else
-                break;
-        }
-
-        trT.push_back( new TrSpkThread( shr, imQ, vID ) );
-        ++nThd;
-    }
-
-// Wait for threads to reach ready (sleep) state
-
-    shr.runMtx.lock();
-        while( shr.asleep < nThd ) {
-            shr.runMtx.unlock();
-                QThread::usleep( 10 );
-            shr.runMtx.lock();
-        }
-    shr.runMtx.unlock();
+    TrigIOPool  io( this, nImQ );
 
 // -----
 // Start
@@ -410,7 +284,7 @@ void TrigSpike::run()
 
         if( ISSTATE_Write ) {
 
-            if( !xferAll( shr, err ) )
+            if( !xferAll( io, err ) )
                 break;
 
             // -----
@@ -464,15 +338,6 @@ next_loop:
         yield( loopT );
     }
 
-// Kill all threads
-
-    shr.kill();
-
-    for( int iThd = 0; iThd < nThd; ++iThd ) {
-        trT[iThd]->thread->wait( 10000/nThd );
-        delete trT[iThd];
-    }
-
 // Done
 
     endRun( err );
@@ -583,6 +448,36 @@ bool TrigSpike::getEdge( int iSrc )
 }
 
 
+bool TrigSpike::writeSomeIM( int ip )
+{
+    CountsIm            &C      = imCnt;
+    vec_i16             data;
+    quint64             headCt  = C.nextCt[ip];
+    int                 nMax    = C.remCt[ip];
+
+    if( !nScansFromCt( data, headCt, nMax, ip ) )
+        return false;
+
+    uint    size = data.size();
+
+    if( !size )
+        return true;
+
+// ---------------
+// Update tracking
+// ---------------
+
+    C.nextCt[ip]    += size / imQ[ip]->nChans();
+    C.remCt[ip]     -= C.nextCt[ip] - headCt;
+
+// -----
+// Write
+// -----
+
+    return writeAndInvalData( DstImec, ip, data, headCt );
+}
+
+
 bool TrigSpike::writeSomeNI()
 {
     if( !niQ )
@@ -617,35 +512,21 @@ bool TrigSpike::writeSomeNI()
 
 // Return true if no errors.
 //
-bool TrigSpike::xferAll( TrSpkShared &shr, QString &err )
+bool TrigSpike::xferAll( TrigIOPool &io, QString &err )
 {
     bool    niOK;
 
-    shr.awake   = 0;
-    shr.asleep  = 0;
-    shr.errors  = 0;
-
-// Wake all imec threads
+// Start imec pass
 
-    shr.condWake.wakeAll();
+    io.begin();
 
 // Do nidq locally
 
     niOK = writeSomeNI();
 
-// Wait all threads started, and all done
-
-    shr.runMtx.lock();
-        while( shr.awake  < nThd
-            || shr.asleep < nThd ) {
-
-            shr.runMtx.unlock();
-                QThread::msleep( LOOP_MS/8 );
-            shr.runMtx.lock();
-        }
-    shr.runMtx.unlock();
+// Finish imec pass
 
-    if( niOK && !shr.errors )
+    if( io.end() && niOK )
         return true;
 
     err = "write failed";
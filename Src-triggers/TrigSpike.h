@@ -3,7 +3,7 @@
 
 #include "TrigBase.h"
 
-#include <QWaitCondition>
+class TrigIOPool;
 
 class Biquad;
 
@@ -11,90 +11,10 @@ class Biquad;
 /* Types ---------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
-struct TrSpkShared {
-    const DAQ::Params   &p;
-    QMutex              runMtx;
-    QWaitCondition      condWake;
-    int                 awake,
-                        asleep,
-                        errors;
-    bool                stop;
-
-    TrSpkShared( const DAQ::Params &p )
-    :   p(p), awake(0), asleep(0), stop(false)  {}
-
-    bool wake( bool ok )
-    {
-        bool    run;
-        runMtx.lock();
-            errors += !ok;
-            ++asleep;
-            condWake.wait( &runMtx );
-            ++awake;
-            run = !stop;
-        runMtx.unlock();
-        return run;
-    }
-
-    void kill()
-    {
-        runMtx.lock();
-            stop = true;
-        runMtx.unlock();
-        condWake.wakeAll();
-    }
-};
-
-
-class TrSpkWorker : public QObject
-{
-    Q_OBJECT
-
-private:
-    TrSpkShared         &shr;
-    const QVector<AIQ*> &imQ;
-    std::vector<int>    vID;
-
-public:
-    TrSpkWorker(
-        TrSpkShared         &shr,
-        const QVector<AIQ*> &imQ,
-        std::vector<int>    &vID )
-    :   shr(shr), imQ(imQ), vID(vID)    {}
-    virtual ~TrSpkWorker()              {}
-
-signals:
-    void finished();
-
-public slots:
-    void run();
-
-private:
-    bool writeSomeIM( int ip );
-};
-
-
-class TrSpkThread
-{
-public:
-    QThread     *thread;
-    TrSpkWorker *worker;
-
-public:
-    TrSpkThread(
-        TrSpkShared         &shr,
-        const QVector<AIQ*> &imQ,
-        std::vector<int>    &vID );
-    virtual ~TrSpkThread();
-};
-
-
 class TrigSpike : public TrigBase
 {
     Q_OBJECT
 
-    friend class TrSpkWorker;
-
 private:
     struct HiPassFnctr : public AIQ::T_AIQFilter {
         Biquad  *flt;
@@ -151,8 +71,7 @@ private:
     const qint64            spikesMax;
     quint64                 aEdgeCtNext;
     const int               thresh;
-    int                     nThd,
-                            nSpikes,
+    int                     nSpikes,
                             state;
 
 public:
@@ -166,6 +85,9 @@ public:
 public slots:
     virtual void run();
 
+protected:
+    virtual bool xferIm( int ip )   {return writeSomeIM( ip );}
+
 private:
     void SETSTATE_GetEdge();
     void SETSTATE_Write();
@@ -174,9 +96,10 @@ private:
 
     bool getEdge( int iSrc );
 
+    bool writeSomeIM( int ip );
     bool writeSomeNI();
 
-    bool xferAll( TrSpkShared &shr, QString &err );
+    bool xferAll( TrigIOPool &io, QString &err );
 };
 
 #endif  // TRIGSPIKE_H
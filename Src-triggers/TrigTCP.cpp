@@ -1,148 +1,233 @@
 
 #include "TrigTCP.h"
 #include "Util.h"
-
-#include <QThread>
+#include "TrigIOPool.h"
+#include "Sync.h"
 
 
 #define LOOP_MS     100
 
-
-static TrigTCP      *ME;
+// Stamped starts keep this far (s) from the oldest queued data,
+// so eviction can't overtake them before writing starts.
+#define STAMP_MARGIN_SECS   0.5
 
 
 /* ---------------------------------------------------------------- */
-/* TrTCPWorker ---------------------------------------------------- */
+/* TrigTCP -------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
-void TrTCPWorker::run()
+void TrigTCP::rgtSetTrig( bool hi )
 {
-    const int   nID = vID.size();
-    bool        ok  = true;
+    runMtx.lock();
 
-    for(;;) {
+    if( hi ) {
 
-        if( !shr.wake( ok ) )
-            break;
+        if( _trigHi )
+            Error() << "SetTrig(HI) twice in a row...ignoring second.";
+        else
+            _trigHiT = nowCalibrated();
+    }
+    else {
+        _trigLoT = nowCalibrated();
 
-        for( int iID = 0; iID < nID; ++iID ) {
+        if( !_trigHi )
+            Error() << "SetTrig(LO) twice in a row.";
+    }
 
-            if( shr.tRem > 0 )
-                ok = writeRemIM( vID[iID], shr.tRem );
-            else
-                ok = writeSomeIM( vID[iID] );
+    _trigHi = hi;
 
-            if( !ok )
-                break;
-        }
-    }
+    if( hi )
+        _hiIS = -1;
+    else
+        _loIS = -1;
 
-    emit finished();
+    runMtx.unlock();
 }
 
 
-// Return true if no errors.
+// Trigger edge placed at a given stream sample rather than
+// at command arrival. Keys:
 //
-bool TrTCPWorker::writeSomeIM( int ip )
+//     ip   = {-1=nidq, 0=imec0, ...}   (default: first stream)
+//     ct   = sample count in that stream, or
+//     t    = stream time (s) since that stream's ct=0
+//     pre  = pre-roll (s), hi only: file opens this much earlier
+//
+// A hi edge in the future opens files now but writing begins
+// at the stamp; a lo edge takes effect once its sample arrives.
+// Edges are then cut exactly on the stamped sample in its own
+// stream; other streams are aligned through SyncStream.
+//
+// A hi stamp older than the data every queue still holds is
+// rejected; if only its pre-roll reaches back that far, the
+// pre-roll is shortened.
+//
+// Return false if the stamp can't be applied (err says why).
+//
+bool TrigTCP::rgtSetTrigAt( bool hi, const KeyValMap &kvm, QString &err )
 {
-    vec_i16 data;
-    quint64 headCt = shr.imNextCt[ip];
+    int is = 0;
+
+    if( kvm.contains( "ip" ) ) {
 
-    if( !ME->nScansFromCt( data, headCt, -LOOP_MS, ip ) )
+        int ip = kvm["ip"].toInt();
+
+        for( is = 0; is < int(vS.size()); ++is ) {
+
+            if( vS[is].ip == ip )
+                break;
+        }
+
+        if( is >= int(vS.size()) ) {
+            err = QString("stream ip=%1 not running").arg( ip );
+            return false;
+        }
+    }
+
+    const SyncStream    &S = vS[is];
+    quint64             ct;
+
+    if( kvm.contains( "ct" ) )
+        ct = kvm["ct"].toULongLong();
+    else if( kvm.contains( "t" ) )
+        ct = S.TRel2Ct( kvm["t"].toDouble() );
+    else {
+        err = "missing ct or t";
         return false;
+    }
 
-    uint    size = data.size();
+    double  tMin = retainedT();
 
-    if( !size )
-        return true;
+    if( hi && S.Ct2TAbs( ct ) < tMin ) {
+        err = QString("stamp ct=%1 no longer queued").arg( ct );
+        return false;
+    }
 
-    shr.imNextCt[ip] += size / imQ[ip]->nChans();
+    QMutexLocker    ml( &runMtx );
 
-    return ME->writeAndInvalData( ME->DstImec, ip, data, headCt );
+    if( hi ) {
+
+        if( _trigHi ) {
+            err = "SetTrig(HI) twice in a row...ignoring second";
+            return false;
+        }
+
+        quint64 preCt = S.TRel2Ct( qMax( kvm["pre"].toDouble(), 0.0 ) );
+
+        _hiIS       = is;
+        _hiCt       = (ct > preCt ? ct - preCt : 0);
+        _trigHiT    = S.Ct2TAbs( _hiCt );
+        _loIS       = -1;
+        _trigHi     = true;
+
+        if( _trigHiT < tMin ) {
+            _hiCt       = S.TAbs2Ct( tMin ) + 1;
+            _trigHiT    = S.Ct2TAbs( _hiCt );
+            Warning() << "Stamped SetTrig pre-roll shortened to queued data.";
+        }
+    }
+    else {
+
+        if( !_trigHi ) {
+            err = "SetTrig(LO) while not high";
+            return false;
+        }
+
+        _loIS   = is;
+        _loCt   = ct;
+    }
+
+    return true;
 }
 
 
-// Return true if no errors.
+// Earliest absolute time every stream queue still holds, plus
+// a margin once a queue has begun discarding.
 //
-bool TrTCPWorker::writeRemIM( int ip, double tlo )
+double TrigTCP::retainedT() const
 {
-    quint64 spnCt = tlo * imQ[ip]->sRate(),
-            curCt = ME->scanCount( ME->DstImec );
+    double  t = 0;
 
-    if( curCt >= spnCt )
-        return true;
+    for( int is = 0, ns = vS.size(); is < ns; ++is ) {
 
-    vec_i16 data;
-    quint64 headCt  = shr.imNextCt[ip];
-    int     nMax    = spnCt - curCt;
+        const SyncStream    &S  = vS[is];
+        quint64             hd  = S.Q->qHeadCt();
 
-    if( !ME->nScansFromCt( data, headCt, nMax, ip ) )
-        return false;
-
-    if( !data.size() )
-        return true;
+        t = qMax( t, S.Ct2TAbs( hd ) + (hd ? STAMP_MARGIN_SECS : 0) );
+    }
 
-    return ME->writeAndInvalData( ME->DstImec, ip, data, headCt );
+    return t;
 }
 
-/* ---------------------------------------------------------------- */
-/* TrTCPThread ---------------------------------------------------- */
-/* ---------------------------------------------------------------- */
 
-TrTCPThread::TrTCPThread(
-    TrTCPShared         &shr,
-    const QVector<AIQ*> &imQ,
-    std::vector<int>    &vID )
+// If the stamped start has aged out of a queue, move it up to
+// the oldest retained data. Return true if moved.
+//
+bool TrigTCP::clampStampHi()
 {
-    thread  = new QThread;
-    worker  = new TrTCPWorker( shr, imQ, vID );
+    double          tMin = retainedT();
+    QMutexLocker    ml( &runMtx );
+
+    if( _hiIS < 0 || _trigHiT >= tMin )
+        return false;
 
-    worker->moveToThread( thread );
+    const SyncStream    &S = vS[_hiIS];
 
-    Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
-    Connect( worker, SIGNAL(finished()), worker, SLOT(deleteLater()) );
-    Connect( worker, SIGNAL(destroyed()), thread, SLOT(quit()), Qt::DirectConnection );
+    _hiCt       = S.TAbs2Ct( tMin ) + 1;
+    _trigHiT    = S.Ct2TAbs( _hiCt );
 
-    thread->start();
+    return true;
 }
 
 
-TrTCPThread::~TrTCPThread()
+// Drop trigger once stamped lo sample has arrived.
+//
+void TrigTCP::applyStampLo()
 {
-// worker object auto-deleted asynchronously
-// thread object manually deleted synchronously (so we can call wait())
+    QMutexLocker    ml( &runMtx );
+
+    if( _loIS < 0 || !_trigHi )
+        return;
 
-    if( thread->isRunning() )
-        thread->wait();
+    const SyncStream    &S = vS[_loIS];
 
-    delete thread;
+    if( S.Q->endCount() <= _loCt )
+        return;
+
+    _trigLoT    = S.Ct2TAbs( _loCt );
+    _trigHi     = false;
 }
 
-/* ---------------------------------------------------------------- */
-/* TrigTCP -------------------------------------------------------- */
-/* ---------------------------------------------------------------- */
 
-void TrigTCP::rgtSetTrig( bool hi )
+// If both edges are stamped, return the file span (s) so that
+// floor(span * srate) lands exactly on the lo sample in the hi
+// edge's stream. Else return -1.
+//
+double TrigTCP::stampedSpan()
 {
+    int     hiIS, loIS;
+    quint64 hiCt, loCt;
+
     runMtx.lock();
+        hiIS    = _hiIS;
+        hiCt    = _hiCt;
+        loIS    = _loIS;
+        loCt    = _loCt;
+    runMtx.unlock();
 
-    if( hi ) {
+    if( hiIS < 0 || loIS < 0 )
+        return -1;
 
-        if( _trigHi )
-            Error() << "SetTrig(HI) twice in a row...ignoring second.";
-        else
-            _trigHiT = nowCalibrated();
-    }
-    else {
-        _trigLoT = nowCalibrated();
+    const SyncStream    &H = vS[hiIS];
 
-        if( !_trigHi )
-            Error() << "SetTrig(LO) twice in a row.";
-    }
+    if( loIS != hiIS ) {
 
-    _trigHi = hi;
+        double  tAbs = syncDstTAbs( loCt, &vS[loIS], &H, p );
 
-    runMtx.unlock();
+        loCt = H.TAbs2Ct( tAbs + 0.5 / H.Q->sRate() );
+    }
+
+    return ((loCt > hiCt ? loCt - hiCt : 0) + 0.5) / H.Q->sRate();
 }
 
 
@@ -156,44 +241,9 @@ void TrigTCP::run()
 // Configure
 // ---------
 
-    ME = this;
-
     quint64 niNextCt = 0;
 
-// Create worker threads
-
-    const int                   nPrbPerThd = 2;
-
-    std::vector<TrTCPThread*>   trT;
-    TrTCPShared                 shr( p );
-
-    nThd = 0;
-
-    for( int ip0 = 0; ip0 < nImQ; ip0 += nPrbPerThd ) {
-
-        std::vector<int>    vID;
-
-        for( int id = 0; id < nPrbPerThd; ++id ) {
-
-            if( ip0 + id < nImQ )
-                vID.push_back( ip0 + id );
-            else
-                break;
-        }
-
-        trT.push_back( new TrTCPThread( shr, imQ, vID ) );
-        ++nThd;
-    }
-
-// Wait for threads to reach ready (sleep) state
-
-    shr.runMtx.lock();
-        while( shr.asleep < nThd ) {
-            shr.runMtx.unlock();
-                QThread::usleep( 10 );
-            shr.runMtx.lock();
-        }
-    shr.runMtx.unlock();
+    TrigIOPool  io( this, nImQ );
 
 // -----
 // Start
@@ -207,6 +257,8 @@ void TrigTCP::run()
 
         double  loopT = getTime();
 
+        applyStampLo();
+
         // ---------------
         // If finishing up
         // ---------------
@@ -216,10 +268,16 @@ void TrigTCP::run()
             if( allFilesClosed() )
                 goto next_loop;
 
-            if( !allFinalWrite( shr, niNextCt, err ) )
+            if( !allFinalWrite( io, niNextCt, err ) )
                 break;
 
             endTrig();
+
+            runMtx.lock();
+                _hiIS = -1;
+                _loIS = -1;
+            runMtx.unlock();
+
             goto next_loop;
         }
 
@@ -227,7 +285,7 @@ void TrigTCP::run()
         // If trigger ON
         // -------------
 
-        if( !allWriteSome( shr, niNextCt, err ) )
+        if( !allWriteSome( io, niNextCt, err ) )
             break;
 
         // ------
@@ -254,15 +312,6 @@ next_loop:
         yield( loopT );
     }
 
-// Kill all threads
-
-    shr.kill();
-
-    for( int iThd = 0; iThd < nThd; ++iThd ) {
-        trT[iThd]->thread->wait( 10000/nThd );
-        delete trT[iThd];
-    }
-
 // Done
 
     endRun( err );
@@ -281,12 +330,29 @@ bool TrigTCP::alignFiles(
     if( (nImQ && !imNextCt.size()) || (niQ && !niNextCt) ) {
 
         double                  trigT   = getTrigHiT();
+        quint64                 srcCt;
         int                     ns      = vS.size(),
+                                iSrc,
                                 offset  = 0;
         std::vector<quint64>    nextCt( ns );
 
+        // Stamped edge: that stream's sample is the source
+
+        getStampHi( iSrc, srcCt );
+
         for( int is = 0; is < ns; ++is ) {
             int where = vS[is].Q->mapTime2Ct( nextCt[is], trigT );
+            if( is == iSrc && !where ) {
+                double  t;
+                where = vS[is].Q->mapCt2Time( t, srcCt );
+            }
+            if( where < 0 && iSrc >= 0 && clampStampHi() ) {
+                // A stale remote stamp must not end the run
+                Warning() <<
+                    "Stamped SetTrig start no longer queued;"
+                    " starting at oldest data.";
+                return false;
+            }
             if( where < 0 ) {
                 err = "writing started late; samples lost"
                       " (disk busy or large files overwritten)";
@@ -295,8 +361,18 @@ bool TrigTCP::alignFiles(
                 return false;
         }
 
+        if( iSrc < 0 ) {
+            iSrc    = 0;
+            srcCt   = nextCt[0];
+        }
+
         // set everybody's tAbs
-        syncDstTAbsMult( nextCt[0], 0, vS, p );
+        syncDstTAbsMult( srcCt, iSrc, vS, p );
+
+        for( int is = 0; is < ns; ++is ) {
+            const SyncStream    &S = vS[is];
+            nextCt[is] = (is == iSrc ? srcCt : S.TAbs2Ct( S.tAbs ));
+        }
 
         if( niQ ) {
            niNextCt = nextCt[0];
@@ -307,10 +383,8 @@ bool TrigTCP::alignFiles(
 
             imNextCt.resize( nImQ );
 
-            for( int ip = 0; ip < nImQ; ++ip ) {
-                const SyncStream    &S = vS[offset+ip];
-                imNextCt[ip] = S.TAbs2Ct( S.tAbs );
-            }
+            for( int ip = 0; ip < nImQ; ++ip )
+                imNextCt[ip] = nextCt[offset+ip];
         }
     }
 
@@ -318,6 +392,62 @@ bool TrigTCP::alignFiles(
 }
 
 
+// Return true if no errors.
+//
+bool TrigTCP::xferIm( int ip )
+{
+    if( remT > 0 )
+        return writeRemIM( ip, remT );
+
+    return writeSomeIM( ip );
+}
+
+
+// Return true if no errors.
+//
+bool TrigTCP::writeSomeIM( int ip )
+{
+    vec_i16 data;
+    quint64 headCt = imNextCt[ip];
+
+    if( !nScansFromCt( data, headCt, -LOOP_MS, ip ) )
+        return false;
+
+    uint    size = data.size();
+
+    if( !size )
+        return true;
+
+    imNextCt[ip] += size / imQ[ip]->nChans();
+
+    return writeAndInvalData( DstImec, ip, data, headCt );
+}
+
+
+// Return true if no errors.
+//
+bool TrigTCP::writeRemIM( int ip, double tlo )
+{
+    quint64 spnCt = tlo * imQ[ip]->sRate(),
+            curCt = scanCount( DstImec );
+
+    if( curCt >= spnCt )
+        return true;
+
+    vec_i16 data;
+    quint64 headCt  = imNextCt[ip];
+    int     nMax    = spnCt - curCt;
+
+    if( !nScansFromCt( data, headCt, nMax, ip ) )
+        return false;
+
+    if( !data.size() )
+        return true;
+
+    return writeAndInvalData( DstImec, ip, data, headCt );
+}
+
+
 // Return true if no errors.
 //
 bool TrigTCP::writeSomeNI( quint64 &nextCt )
@@ -371,21 +501,18 @@ bool TrigTCP::writeRemNI( quint64 &nextCt, double tlo )
 // Return true if no errors.
 //
 bool TrigTCP::xferAll(
-    TrTCPShared &shr,
+    TrigIOPool  &io,
     quint64     &niNextCt,
     double      tRem,
     QString     &err )
 {
     bool    niOK;
 
-    shr.tRem    = tRem;
-    shr.awake   = 0;
-    shr.asleep  = 0;
-    shr.errors  = 0;
+    remT = tRem;
 
-// Wake all imec threads
+// Start imec pass
 
-    shr.condWake.wakeAll();
+    io.begin();
 
 // Do nidq locally
 
@@ -394,19 +521,9 @@ bool TrigTCP::xferAll(
     else
         niOK = writeSomeNI( niNextCt );
 
-// Wait all threads started, and all done
-
-    shr.runMtx.lock();
-        while( shr.awake  < nThd
-            || shr.asleep < nThd ) {
+// Finish imec pass
 
-            shr.runMtx.unlock();
-                QThread::msleep( LOOP_MS/8 );
-            shr.runMtx.lock();
-        }
-    shr.runMtx.unlock();
-
-    if( niOK && !shr.errors )
+    if( io.end() && niOK )
         return true;
 
     err = "write failed";
@@ -417,7 +534,7 @@ bool TrigTCP::xferAll(
 // Return true if no errors.
 //
 bool TrigTCP::allWriteSome(
-    TrTCPShared &shr,
+    TrigIOPool  &io,
     quint64     &niNextCt,
     QString     &err )
 {
@@ -430,7 +547,7 @@ bool TrigTCP::allWriteSome(
         int ig, it;
 
         // reset tracking
-        shr.imNextCt.clear();
+        imNextCt.clear();
         niNextCt = 0;
 
         if( !newTrig( ig, it ) ) {
@@ -443,21 +560,21 @@ bool TrigTCP::allWriteSome(
 // Seek common sync time
 // ---------------------
 
-    if( !alignFiles( shr.imNextCt, niNextCt, err ) )
+    if( !alignFiles( imNextCt, niNextCt, err ) )
         return err.isEmpty();
 
 // ----------------------
 // Fetch from all streams
 // ----------------------
 
-    return xferAll( shr, niNextCt, -1, err );
+    return xferAll( io, niNextCt, -1, err );
 }
 
 
 // Return true if no errors.
 //
 bool TrigTCP::allFinalWrite(
-    TrTCPShared &shr,
+    TrigIOPool  &io,
     quint64     &niNextCt,
     QString     &err )
 {
@@ -481,9 +598,16 @@ bool TrigTCP::allFinalWrite(
     if( tlo > glo )
         tlo = glo;
 
+// Both edges stamped: exact span, unless gate closed first.
+
+    double  span = stampedSpan();
+
+    if( span >= 0 && span <= glo )
+        tlo = span;
+
 // If our current count is short, fetch remainder.
 
-    return xferAll( shr, niNextCt, tlo, err );
+    return xferAll( io, niNextCt, tlo, err );
 }
 
 
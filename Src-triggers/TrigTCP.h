@@ -3,104 +3,26 @@
 
 #include "TrigBase.h"
 
-#include <QWaitCondition>
+class TrigIOPool;
 
 /* ---------------------------------------------------------------- */
 /* Types ---------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
-struct TrTCPShared {
-    const DAQ::Params       &p;
-    std::vector<quint64>    imNextCt;
-    double                  tRem;
-    QMutex                  runMtx;
-    QWaitCondition          condWake;
-    int                     awake,
-                            asleep,
-                            errors;
-    bool                    stop;
-
-    TrTCPShared( const DAQ::Params &p )
-    :   p(p), tRem(-1), awake(0), asleep(0), stop(false)    {}
-
-    bool wake( bool ok )
-    {
-        bool    run;
-        runMtx.lock();
-            errors += !ok;
-            ++asleep;
-            condWake.wait( &runMtx );
-            ++awake;
-            run = !stop;
-        runMtx.unlock();
-        return run;
-    }
-
-    void kill()
-    {
-        runMtx.lock();
-            stop = true;
-        runMtx.unlock();
-        condWake.wakeAll();
-    }
-};
-
-
-class TrTCPWorker : public QObject
-{
-    Q_OBJECT
-
-private:
-    TrTCPShared         &shr;
-    const QVector<AIQ*> &imQ;
-    std::vector<int>    vID;
-
-public:
-    TrTCPWorker(
-        TrTCPShared         &shr,
-        const QVector<AIQ*> &imQ,
-        std::vector<int>    &vID )
-    :   shr(shr), imQ(imQ), vID(vID)    {}
-    virtual ~TrTCPWorker()              {}
-
-signals:
-    void finished();
-
-public slots:
-    void run();
-
-private:
-    bool writeSomeIM( int ip );
-    bool writeRemIM( int ip, double tlo );
-};
-
-
-class TrTCPThread
-{
-public:
-    QThread     *thread;
-    TrTCPWorker *worker;
-
-public:
-    TrTCPThread(
-        TrTCPShared         &shr,
-        const QVector<AIQ*> &imQ,
-        std::vector<int>    &vID );
-    virtual ~TrTCPThread();
-};
-
-
 class TrigTCP : public TrigBase
 {
     Q_OBJECT
 
-    friend class TrTCPWorker;
-
 private:
-    double          _trigHiT,
-                    _trigLoT;
-    volatile bool   _trigHi;
-    int             nThd;
+    std::vector<quint64>    imNextCt;
+    double                  remT,       // xferIm() span, -1 if none
+                            _trigHiT,
+                            _trigLoT;
+    quint64                 _hiCt,      // stamped file start (vS[_hiIS])
+                            _loCt;      // stamped end (vS[_loIS])
+    int                     _hiIS,      // -1 if wall-clock edge
+                            _loIS;      // -1 if none pending
+    volatile bool           _trigHi;
 
 public:
     TrigTCP(
@@ -108,37 +30,51 @@ public:
         GraphsWindow        *gw,
         const QVector<AIQ*> &imQ,
         const AIQ           *niQ )
-    :   TrigBase( p, gw, imQ, niQ ), _trigHiT(-1), _trigHi(false) {}
+    :   TrigBase( p, gw, imQ, niQ ), remT(-1), _trigHiT(-1),
+        _hiCt(0), _loCt(0), _hiIS(-1), _loIS(-1), _trigHi(false)   {}
 
     void rgtSetTrig( bool hi );
+    bool rgtSetTrigAt( bool hi, const KeyValMap &kvm, QString &err );
 
 public slots:
     virtual void run();
 
+protected:
+    virtual bool xferIm( int ip );
+
 private:
     bool isTrigHi() const       {QMutexLocker ml( &runMtx ); return _trigHi;}
     double getTrigHiT() const   {QMutexLocker ml( &runMtx ); return _trigHiT;}
     double getTrigLoT() const   {QMutexLocker ml( &runMtx ); return _trigLoT;}
+    void getStampHi( int &is, quint64 &ct ) const
+        {QMutexLocker ml( &runMtx ); is = _hiIS; ct = _hiCt;}
+
+    double retainedT() const;
+    bool clampStampHi();
+    void applyStampLo();
+    double stampedSpan();
 
     bool alignFiles(
         std::vector<quint64>    &imNextCt,
         quint64                 &niNextCt,
         QString                 &err );
 
+    bool writeSomeIM( int ip );
+    bool writeRemIM( int ip, double tlo );
     bool writeSomeNI( quint64 &nextCt );
     bool writeRemNI( quint64 &nextCt, double tlo );
 
     bool xferAll(
-        TrTCPShared &shr,
+        TrigIOPool  &io,
         quint64     &niNextCt,
         double      tRem,
         QString     &err );
     bool allWriteSome(
-        TrTCPShared &shr,
+        TrigIOPool  &io,
         quint64     &niNextCt,
         QString     &err );
     bool allFinalWrite(
-        TrTCPShared &shr,
+        TrigIOPool  &io,
         quint64     &niNextCt,
         QString     &err );
 };
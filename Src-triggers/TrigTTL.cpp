@@ -1,199 +1,14 @@
 
 #include "TrigTTL.h"
 #include "Util.h"
+#include "TrigIOPool.h"
 #include "MainApp.h"
 #include "Run.h"
 
-#include <QThread>
-
 
 #define LOOP_MS     100
 
 
-static TrigTTL      *ME;
-
-
-/* ---------------------------------------------------------------- */
-/* TrTTLWorker ---------------------------------------------------- */
-/* ---------------------------------------------------------------- */
-
-void TrTTLWorker::run()
-{
-    const int   nID = vID.size();
-    bool        ok  = true;
-
-    for(;;) {
-
-        if( !shr.wake( ok ) )
-            break;
-
-        for( int iID = 0; iID < nID; ++iID ) {
-
-            if( shr.preMidPost == -1 )
-                ok = writePreMarginIm( vID[iID] );
-            else if( !shr.preMidPost )
-                ok = doSomeHIm( vID[iID] );
-            else
-                ok = writePostMarginIm( vID[iID] );
-
-            if( !ok )
-                break;
-        }
-    }
-
-    emit finished();
-}
-
-
-// Write margin up to but not including rising edge.
-//
-// Return true if no errors.
-//
-bool TrTTLWorker::writePreMarginIm( int ip )
-{
-    TrigTTL::CountsIm   &C = ME->imCnt;
-
-    if( C.remCt[ip] <= 0 )
-        return true;
-
-    vec_i16 data;
-    quint64 headCt  = C.nextCt[ip];
-    int     nMax    = (C.remCt[ip] <= C.maxFetch[ip] ?
-                        C.remCt[ip] : C.maxFetch[ip]);
-
-    if( !ME->nScansFromCt( data, headCt, nMax, ip ) )
-        return false;
-
-    uint    size = data.size();
-
-    if( !size )
-        return true;
-
-// Status in this state should be what's done: +(margin - rem).
-// If next = edge - rem, then status = +(margin + next - edge).
-//
-// When rem falls to zero, (next = edge) sets us up for state H.
-
-    C.remCt[ip] -= size / imQ[ip]->nChans();
-    C.nextCt[ip] = C.edgeCt[ip] - C.remCt[ip];
-
-    return ME->writeAndInvalData( ME->DstImec, ip, data, headCt );
-}
-
-
-// Write margin, including falling edge.
-//
-// Return true if no errors.
-//
-bool TrTTLWorker::writePostMarginIm( int ip )
-{
-    TrigTTL::CountsIm   &C = ME->imCnt;
-
-    if( C.remCt[ip] <= 0 )
-        return true;
-
-    vec_i16 data;
-    quint64 headCt  = C.nextCt[ip];
-    int     nMax    = (C.remCt[ip] <= C.maxFetch[ip] ?
-                        C.remCt[ip] : C.maxFetch[ip]);
-
-    if( !ME->nScansFromCt( data, headCt, nMax, ip ) )
-        return false;
-
-    uint    size = data.size();
-
-    if( !size )
-        return true;
-
-// Status in this state should be: +(margin + H + margin - rem).
-// With next defined as below, status = +(margin + next - edge)
-// = margin + (fall-edge) + margin - rem = correct.
-
-    C.remCt[ip] -= size / imQ[ip]->nChans();
-    C.nextCt[ip] = C.fallCt[ip] + C.marginCt[ip] - C.remCt[ip];
-
-    return ME->writeAndInvalData( ME->DstImec, ip, data, headCt );
-}
-
-
-// Write from rising edge up to but not including falling edge.
-//
-// Return true if no errors.
-//
-bool TrTTLWorker::doSomeHIm( int ip )
-{
-    TrigTTL::CountsIm   &C      = ME->imCnt;
-    vec_i16             data;
-    quint64             headCt  = C.nextCt[ip];
-    bool                ok;
-
-// ---------------
-// Fetch a la mode
-// ---------------
-
-    if( shr.p.trgTTL.mode == DAQ::TrgTTLLatch )
-        ok = ME->nScansFromCt( data, headCt, -LOOP_MS, ip );
-    else if( C.remCt[ip] <= 0 )
-        return true;
-    else {
-
-        int nMax = (C.remCt[ip] <= C.maxFetch[ip] ?
-                    C.remCt[ip] : C.maxFetch[ip]);
-
-        ok = ME->nScansFromCt( data, headCt, nMax, ip );
-    }
-
-    if( !ok )
-        return false;
-
-    uint    size = data.size();
-
-    if( !size )
-        return true;
-
-// ------------------------
-// Write/update all H cases
-// ------------------------
-
-    C.nextCt[ip]    += size / imQ[ip]->nChans();
-    C.remCt[ip]     -= C.nextCt[ip] - headCt;
-
-    return ME->writeAndInvalData( ME->DstImec, ip, data, headCt );
-}
-
-/* ---------------------------------------------------------------- */
-/* TrTTLThread ---------------------------------------------------- */
-/* ---------------------------------------------------------------- */
-
-TrTTLThread::TrTTLThread(
-    TrTTLShared         &shr,
-    const QVector<AIQ*> &imQ,
-    std::vector<int>    &vID )
-{
-    thread  = new QThread;
-    worker  = new TrTTLWorker( shr, imQ, vID );
-
-    worker->moveToThread( thread );
-
-    Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
-    Connect( worker, SIGNAL(finished()), worker, SLOT(deleteLater()) );
-    Connect( worker, SIGNAL(destroyed()), thread, SLOT(quit()), Qt::DirectConnection );
-
-    thread->start();
-}
-
-
-TrTTLThread::~TrTTLThread()
-{
-// worker object auto-deleted asynchronously
-// thread object manually deleted synchronously (so we can call wait())
-
-    if( thread->isRunning() )
-        thread->wait();
-
-    delete thread;
-}
-
 /* ---------------------------------------------------------------- */
 /* CountsIm ------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
@@ -456,7 +271,8 @@ TrigTTL::TrigTTL(
         highsMax(p.trgTTL.isNInf ? UNSET64 : p.trgTTL.nH),
         aEdgeCtNext(0),
         thresh(p.trigThreshAsInt()),
-        digChan(p.trgTTL.isAnalog ? -1 : p.trigChan())
+        digChan(p.trgTTL.isAnalog ? -1 : p.trigChan()),
+        imPMP(0)
 {
     vEdge.resize( vS.size() );
 }
@@ -490,42 +306,7 @@ void TrigTTL::run()
 // Configure
 // ---------
 
-    ME = this;
-
-// Create worker threads
-
-    const int                   nPrbPerThd = 2;
-
-    std::vector<TrTTLThread*>   trT;
-    TrTTLShared                 shr( p );
-
-    nThd = 0;
-
-    for( int ip0 = 0; ip0 < nImQ; ip0 += nPrbPerThd ) {
-
-        std::vector<int>    vID;
-
-        for( int id = 0; id < nPrbPerThd; ++id ) {
-
-            if( ip0 + id < nImQ )
-                vID.push_back( ip0 + id );
-            else
-                break;
-        }
-
-        trT.push_back( new TrTTLThread( shr, imQ, vID ) );
-        ++nThd;
-    }
-
-// Wait for threads to reach ready (sleep) state
-
-    shr.runMtx.lock();
-        while( shr.asleep < nThd ) {
-            shr.runMtx.unlock();
-                QThread::usleep( 10 );
-            shr.runMtx.lock();
-        }
-    shr.runMtx.unlock();
+    TrigIOPool  io( this, nImQ );
 
 // -----
 // Start
@@ -589,7 +370,7 @@ void TrigTTL::run()
 
         if( ISSTATE_PreMarg ) {
 
-            if( !xferAll( shr, -1, err ) )
+            if( !xferAll( io, -1, err ) )
                 break;
 
             if( ZEROREM )
@@ -620,7 +401,7 @@ void TrigTTL::run()
 
             // Write
 
-            if( !xferAll( shr, 0, err ) )
+            if( !xferAll( io, 0, err ) )
                 break;
 
             // Done?
@@ -661,7 +442,7 @@ void TrigTTL::run()
 
         if( ISSTATE_PostMarg ) {
 
-            if( !xferAll( shr, 1, err ) )
+            if( !xferAll( io, 1, err ) )
                 break;
 
             // Done?
@@ -720,15 +501,6 @@ next_loop:
         yield( loopT );
     }
 
-// Kill all threads
-
-    shr.kill();
-
-    for( int iThd = 0; iThd < nThd; ++iThd ) {
-        trT[iThd]->thread->wait( 10000/nThd );
-        delete trT[iThd];
-    }
-
 // Done
 
     endRun( err );
@@ -993,6 +765,136 @@ void TrigTTL::getFallEdge()
 }
 
 
+// Return true if no errors.
+//
+bool TrigTTL::xferIm( int ip )
+{
+    if( imPMP == -1 )
+        return writePreMarginIm( ip );
+    else if( !imPMP )
+        return doSomeHIm( ip );
+    else
+        return writePostMarginIm( ip );
+}
+
+
+// Write margin up to but not including rising edge.
+//
+// Return true if no errors.
+//
+bool TrigTTL::writePreMarginIm( int ip )
+{
+    CountsIm    &C = imCnt;
+
+    if( C.remCt[ip] <= 0 )
+        return true;
+
+    vec_i16 data;
+    quint64 headCt  = C.nextCt[ip];
+    int     nMax    = (C.remCt[ip] <= C.maxFetch[ip] ?
+                        C.remCt[ip] : C.maxFetch[ip]);
+
+    if( !nScansFromCt( data, headCt, nMax, ip ) )
+        return false;
+
+    uint    size = data.size();
+
+    if( !size )
+        return true;
+
+// Status in this state should be what's done: +(margin - rem).
+// If next = edge - rem, then status = +(margin + next - edge).
+//
+// When rem falls to zero, (next = edge) sets us up for state H.
+
+    C.remCt[ip] -= size / imQ[ip]->nChans();
+    C.nextCt[ip] = C.edgeCt[ip] - C.remCt[ip];
+
+    return writeAndInvalData( DstImec, ip, data, headCt );
+}
+
+
+// Write margin, including falling edge.
+//
+// Return true if no errors.
+//
+bool TrigTTL::writePostMarginIm( int ip )
+{
+    CountsIm    &C = imCnt;
+
+    if( C.remCt[ip] <= 0 )
+        return true;
+
+    vec_i16 data;
+    quint64 headCt  = C.nextCt[ip];
+    int     nMax    = (C.remCt[ip] <= C.maxFetch[ip] ?
+                        C.remCt[ip] : C.maxFetch[ip]);
+
+    if( !nScansFromCt( data, headCt, nMax, ip ) )
+        return false;
+
+    uint    size = data.size();
+
+    if( !size )
+        return true;
+
+// Status in this state should be: +(margin + H + margin - rem).
+// With next defined as below, status = +(margin + next - edge)
+// = margin + (fall-edge) + margin - rem = correct.
+
+    C.remCt[ip] -= size / imQ[ip]->nChans();
+    C.nextCt[ip] = C.fallCt[ip] + C.marginCt[ip] - C.remCt[ip];
+
+    return writeAndInvalData( DstImec, ip, data, headCt );
+}
+
+
+// Write from rising edge up to but not including falling edge.
+//
+// Return true if no errors.
+//
+bool TrigTTL::doSomeHIm( int ip )
+{
+    CountsIm            &C      = imCnt;
+    vec_i16             data;
+    quint64             headCt  = C.nextCt[ip];
+    bool                ok;
+
+// ---------------
+// Fetch a la mode
+// ---------------
+
+    if( p.trgTTL.mode == DAQ::TrgTTLLatch )
+        ok = nScansFromCt( data, headCt, -LOOP_MS, ip );
+    else if( C.remCt[ip] <= 0 )
+        return true;
+    else {
+
+        int nMax = (C.remCt[ip] <= C.maxFetch[ip] ?
+                    C.remCt[ip] : C.maxFetch[ip]);
+
+        ok = nScansFromCt( data, headCt, nMax, ip );
+    }
+
+    if( !ok )
+        return false;
+
+    uint    size = data.size();
+
+    if( !size )
+        return true;
+
+// ------------------------
+// Write/update all H cases
+// ------------------------
+
+    C.nextCt[ip]    += size / imQ[ip]->nChans();
+    C.remCt[ip]     -= C.nextCt[ip] - headCt;
+
+    return writeAndInvalData( DstImec, ip, data, headCt );
+}
+
+
 // Write margin up to but not including rising edge.
 //
 // Return true if no errors.
@@ -1114,18 +1016,15 @@ bool TrigTTL::doSomeHNi()
 //
 // Return true if no errors.
 //
-bool TrigTTL::xferAll( TrTTLShared &shr, int preMidPost, QString &err )
+bool TrigTTL::xferAll( TrigIOPool &io, int preMidPost, QString &err )
 {
     bool    niOK;
 
-    shr.preMidPost  = preMidPost;
-    shr.awake       = 0;
-    shr.asleep      = 0;
-    shr.errors      = 0;
+    imPMP = preMidPost;
 
-// Wake all imec threads
+// Start imec pass
 
-    shr.condWake.wakeAll();
+    io.begin();
 
 // Do nidq locally
 
@@ -1136,19 +1035,9 @@ bool TrigTTL::xferAll( TrTTLShared &shr, int preMidPost, QString &err )
     else
         niOK = writePostMarginNi();
 
-// Wait all threads started, and all done
-
-    shr.runMtx.lock();
-        while( shr.awake  < nThd
-            || shr.asleep < nThd ) {
-
-            shr.runMtx.unlock();
-                QThread::msleep( LOOP_MS/8 );
-            shr.runMtx.lock();
-        }
-    shr.runMtx.unlock();
+// Finish imec pass
 
-    if( niOK && !shr.errors )
+    if( io.end() && niOK )
         return true;
 
     err = "write failed";
@@ -3,99 +3,16 @@
 
 #include "TrigBase.h"
 
-#include <QWaitCondition>
+class TrigIOPool;
 
 /* ---------------------------------------------------------------- */
 /* Types ---------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
-struct TrTTLShared {
-    const DAQ::Params   &p;
-    QMutex              runMtx;
-    QWaitCondition      condWake;
-    int                 preMidPost, // {-1,0,+1}
-                        awake,
-                        asleep,
-                        errors;
-    bool                stop;
-
-    TrTTLShared( const DAQ::Params &p )
-    :   p(p), awake(0), asleep(0), stop(false)  {}
-
-    bool wake( bool ok )
-    {
-        bool    run;
-        runMtx.lock();
-            errors += !ok;
-            ++asleep;
-            condWake.wait( &runMtx );
-            ++awake;
-            run = !stop;
-        runMtx.unlock();
-        return run;
-    }
-
-    void kill()
-    {
-        runMtx.lock();
-            stop = true;
-        runMtx.unlock();
-        condWake.wakeAll();
-    }
-};
-
-
-class TrTTLWorker : public QObject
-{
-    Q_OBJECT
-
-private:
-    TrTTLShared         &shr;
-    const QVector<AIQ*> &imQ;
-    std::vector<int>    vID;
-
-public:
-    TrTTLWorker(
-        TrTTLShared         &shr,
-        const QVector<AIQ*> &imQ,
-        std::vector<int>    &vID )
-    :   shr(shr), imQ(imQ), vID(vID)    {}
-    virtual ~TrTTLWorker()              {}
-
-signals:
-    void finished();
-
-public slots:
-    void run();
-
-private:
-    bool writePreMarginIm( int ip );
-    bool writePostMarginIm( int ip );
-    bool doSomeHIm( int ip );
-};
-
-
-class TrTTLThread
-{
-public:
-    QThread     *thread;
-    TrTTLWorker *worker;
-
-public:
-    TrTTLThread(
-        TrTTLShared         &shr,
-        const QVector<AIQ*> &imQ,
-        std::vector<int>    &vID );
-    virtual ~TrTTLThread();
-};
-
-
 class TrigTTL : public TrigBase
 {
     Q_OBJECT
 
-    friend class TrTTLWorker;
-
 private:
     struct CountsIm {
         // variable -------------------
@@ -160,7 +77,7 @@ private:
                             aFallCtNext;
     const int               thresh,
                             digChan;
-    int                     nThd,
+    int                     imPMP,      // xferIm() {-1,0,+1}
                             nHighs,
                             state;
 
@@ -174,6 +91,9 @@ public:
 public slots:
     virtual void run();
 
+protected:
+    virtual bool xferIm( int ip );
+
 private:
     void SETSTATE_L();
     void SETSTATE_PreMarg();
@@ -188,11 +108,14 @@ private:
     bool getRiseEdge();
     void getFallEdge();
 
+    bool writePreMarginIm( int ip );
+    bool writePostMarginIm( int ip );
+    bool doSomeHIm( int ip );
     bool writePreMarginNi();
     bool writePostMarginNi();
     bool doSomeHNi();
 
-    bool xferAll( TrTTLShared &shr, int preMidPost, QString &err );
+    bool xferAll( TrigIOPool &io, int preMidPost, QString &err );
 
     void statusProcess( QString &sT, bool inactive );
 };
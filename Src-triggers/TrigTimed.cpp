@@ -1,108 +1,14 @@
 
 #include "TrigTimed.h"
 #include "Util.h"
+#include "TrigIOPool.h"
 #include "MainApp.h"
 #include "Run.h"
 
-#include <QThread>
-
 
 #define LOOP_MS     100
 
 
-static TrigTimed    *ME;
-
-
-/* ---------------------------------------------------------------- */
-/* TrTimWorker ---------------------------------------------------- */
-/* ---------------------------------------------------------------- */
-
-void TrTimWorker::run()
-{
-    const int   nID = vID.size();
-    bool        ok  = true;
-
-    for(;;) {
-
-        if( !shr.wake( ok ) )
-            break;
-
-        for( int iID = 0; iID < nID; ++iID ) {
-
-            if( !(ok = doSomeHIm( vID[iID] )) )
-                break;
-        }
-    }
-
-    emit finished();
-}
-
-
-// Return true if no errors.
-//
-bool TrTimWorker::doSomeHIm( int ip )
-{
-    TrigTimed::CountsIm &C = ME->imCnt;
-    vec_i16 data;
-    quint64 headCt  = C.nextCt[ip],
-            remCt   = C.hiCtMax[ip] - C.hiCtCur[ip];
-    uint    nMax    = (remCt <= C.maxFetch[ip] ? remCt : C.maxFetch[ip]);
-
-    if( !ME->nScansFromCt( data, headCt, nMax, ip ) )
-        return false;
-
-    uint    size = data.size();
-
-    if( !size )
-        return true;
-
-// ---------------
-// Update tracking
-// ---------------
-
-    C.nextCt[ip]    += size / imQ[ip]->nChans();
-    C.hiCtCur[ip]   += C.nextCt[ip] - headCt;
-
-// -----
-// Write
-// -----
-
-    return ME->writeAndInvalData( ME->DstImec, ip, data, headCt );
-}
-
-/* ---------------------------------------------------------------- */
-/* TrTimThread ---------------------------------------------------- */
-/* ---------------------------------------------------------------- */
-
-TrTimThread::TrTimThread(
-    TrTimShared         &shr,
-    const QVector<AIQ*> &imQ,
-    std::vector<int>    &vID )
-{
-    thread  = new QThread;
-    worker  = new TrTimWorker( shr, imQ, vID );
-
-    worker->moveToThread( thread );
-
-    Connect( thread, SIGNAL(started()), worker, SLOT(run()) );
-    Connect( worker, SIGNAL(finished()), worker, SLOT(deleteLater()) );
-    Connect( worker, SIGNAL(destroyed()), thread, SLOT(quit()), Qt::DirectConnection );
-
-    thread->start();
-}
-
-
-TrTimThread::~TrTimThread()
-{
-// worker object auto-deleted asynchronously
-// thread object manually deleted synchronously (so we can call wait())
-
-    if( thread->isRunning() )
-        thread->wait();
-
-    delete thread;
-}
-
 /* ---------------------------------------------------------------- */
 /* CountsIm ------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
@@ -228,42 +134,7 @@ void TrigTimed::run()
 // Configure
 // ---------
 
-    ME = this;
-
-// Create worker threads
-
-    const int                   nPrbPerThd = 2;
-
-    std::vector<TrTimThread*>   trT;
-    TrTimShared                 shr( p );
-
-    nThd = 0;
-
-    for( int ip0 = 0; ip0 < nImQ; ip0 += nPrbPerThd ) {
-
-        std::vector<int>    vID;
-
-        for( int id = 0; id < nPrbPerThd; ++id ) {
-
-            if( ip0 + id < nImQ )
-                vID.push_back( ip0 + id );
-            else
-                break;
-        }
-
-        trT.push_back( new TrTimThread( shr, imQ, vID ) );
-        ++nThd;
-    }
-
-// Wait for threads to reach ready (sleep) state
-
-    shr.runMtx.lock();
-        while( shr.asleep < nThd ) {
-            shr.runMtx.unlock();
-                QThread::usleep( 10 );
-            shr.runMtx.lock();
-        }
-    shr.runMtx.unlock();
+    TrigIOPool  io( this, nImQ );
 
 // -----
 // Start
@@ -314,7 +185,7 @@ void TrigTimed::run()
 
         if( ISSTATE_H ) {
 
-            if( !allDoSomeH( shr, gHiT, err ) )
+            if( !allDoSomeH( io, gHiT, err ) )
                 break;
 
             // Done?
@@ -386,15 +257,6 @@ next_loop:
         yield( loopT );
     }
 
-// Kill all threads
-
-    shr.kill();
-
-    for( int iThd = 0; iThd < nThd; ++iThd ) {
-        trT[iThd]->thread->wait( 10000/nThd );
-        delete trT[iThd];
-    }
-
 // Done
 
     endRun( err );
@@ -530,6 +392,39 @@ void TrigTimed::advanceNext()
 }
 
 
+// Return true if no errors.
+//
+bool TrigTimed::doSomeHIm( int ip )
+{
+    CountsIm    &C = imCnt;
+    vec_i16     data;
+    quint64 headCt  = C.nextCt[ip],
+            remCt   = C.hiCtMax[ip] - C.hiCtCur[ip];
+    uint    nMax    = (remCt <= C.maxFetch[ip] ? remCt : C.maxFetch[ip]);
+
+    if( !nScansFromCt( data, headCt, nMax, ip ) )
+        return false;
+
+    uint    size = data.size();
+
+    if( !size )
+        return true;
+
+// ---------------
+// Update tracking
+// ---------------
+
+    C.nextCt[ip]    += size / imQ[ip]->nChans();
+    C.hiCtCur[ip]   += C.nextCt[ip] - headCt;
+
+// -----
+// Write
+// -----
+
+    return writeAndInvalData( DstImec, ip, data, headCt );
+}
+
+
 // Return true if no errors.
 //
 bool TrigTimed::doSomeHNi()
@@ -568,35 +463,21 @@ bool TrigTimed::doSomeHNi()
 
 // Return true if no errors.
 //
-bool TrigTimed::xferAll( TrTimShared &shr, QString &err )
+bool TrigTimed::xferAll( TrigIOPool &io, QString &err )
 {
     bool    niOK;
 
-    shr.awake   = 0;
-    shr.asleep  = 0;
-    shr.errors  = 0;
-
-// Wake all imec threads
+// Start imec pass
 
-    shr.condWake.wakeAll();
+    io.begin();
 
 // Do nidq locally
 
     niOK = doSomeHNi();
 
-// Wait all threads started, and all done
-
-    shr.runMtx.lock();
-        while( shr.awake  < nThd
-            || shr.asleep < nThd ) {
-
-            shr.runMtx.unlock();
-                QThread::msleep( LOOP_MS/8 );
-            shr.runMtx.lock();
-        }
-    shr.runMtx.unlock();
+// Finish imec pass
 
-    if( niOK && !shr.errors )
+    if( io.end() && niOK )
         return true;
 
     err = "write failed";
@@ -606,7 +487,7 @@ bool TrigTimed::xferAll( TrTimShared &shr, QString &err )
 
 // Return true if no errors.
 //
-bool TrigTimed::allDoSomeH( TrTimShared &shr, double gHiT, QString &err )
+bool TrigTimed::allDoSomeH( TrigIOPool &io, double gHiT, QString &err )
 {
 // -------------------
 // Open files together
@@ -637,7 +518,7 @@ bool TrigTimed::allDoSomeH( TrTimShared &shr, double gHiT, QString &err )
 // Fetch from all streams
 // ----------------------
 
-    return xferAll( shr, err );
+    return xferAll( io, err );
 }
 
 
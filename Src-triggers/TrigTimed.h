@@ -3,96 +3,16 @@
 
 #include "TrigBase.h"
 
-#include <QWaitCondition>
+class TrigIOPool;
 
 /* ---------------------------------------------------------------- */
 /* Types ---------------------------------------------------------- */
 /* ---------------------------------------------------------------- */
 
-struct TrTimShared {
-    const DAQ::Params   &p;
-    QMutex              runMtx;
-    QWaitCondition      condWake;
-    int                 awake,
-                        asleep,
-                        errors;
-    bool                stop;
-
-    TrTimShared( const DAQ::Params &p )
-    :   p(p), awake(0), asleep(0), stop(false)  {}
-
-    bool wake( bool ok )
-    {
-        bool    run;
-        runMtx.lock();
-            errors += !ok;
-            ++asleep;
-            condWake.wait( &runMtx );
-            ++awake;
-            run = !stop;
-        runMtx.unlock();
-        return run;
-    }
-
-    void kill()
-    {
-        runMtx.lock();
-            stop = true;
-        runMtx.unlock();
-        condWake.wakeAll();
-    }
-};
-
-
-class TrTimWorker : public QObject
-{
-    Q_OBJECT
-
-private:
-    TrTimShared         &shr;
-    const QVector<AIQ*> &imQ;
-    std::vector<int>    vID;
-
-public:
-    TrTimWorker(
-        TrTimShared         &shr,
-        const QVector<AIQ*> &imQ,
-        std::vector<int>    &vID )
-    :   shr(shr), imQ(imQ), vID(vID)    {}
-    virtual ~TrTimWorker()              {}
-
-signals:
-    void finished();
-
-public slots:
-    void run();
-
-private:
-    bool doSomeHIm( int ip );
-};
-
-
-class TrTimThread
-{
-public:
-    QThread     *thread;
-    TrTimWorker *worker;
-
-public:
-    TrTimThread(
-        TrTimShared         &shr,
-        const QVector<AIQ*> &imQ,
-        std::vector<int>    &vID );
-    virtual ~TrTimThread();
-};
-
-
 class TrigTimed : public TrigBase
 {
     Q_OBJECT
 
-    friend class TrTimWorker;
-
 private:
     struct CountsIm {
         // variable -------------------
@@ -132,8 +52,7 @@ private:
     CountsIm        imCnt;
     CountsNi        niCnt;
     const qint64    nCycMax;
-    int             nThd,
-                    nH,
+    int             nH,
                     state;
 
 public:
@@ -146,6 +65,9 @@ public:
 public slots:
     virtual void run();
 
+protected:
+    virtual bool xferIm( int ip )   {return doSomeHIm( ip );}
+
 private:
     void SETSTATE_Done();
     void initState();
@@ -156,10 +78,11 @@ private:
     bool alignFiles( double gHiT, QString &err );
     void advanceNext();
 
+    bool doSomeHIm( int ip );
     bool doSomeHNi();
 
-    bool xferAll( TrTimShared &shr, QString &err );
-    bool allDoSomeH( TrTimShared &shr, double gHiT, QString &err );
+    bool xferAll( TrigIOPool &io, QString &err );
+    bool allDoSomeH( TrigIOPool &io, double gHiT, QString &err );
 };
 
 #endif  // TRIGTIMED_H
@@ -257,6 +257,20 @@ bool CSHA1::GetHash(UINT_8* pbDest20) const
     return true;
 }
 
+void CSHA1::GetState(SHA1_STATE& st) const
+{
+    memcpy(st.state, m_state, 20);
+    memcpy(st.count, m_count, 8);
+    memcpy(st.buffer, m_buffer, 64);
+}
+
+void CSHA1::SetState(const SHA1_STATE& st)
+{
+    memcpy(m_state, st.state, 20);
+    memcpy(m_count, st.count, 8);
+    memcpy(m_buffer, st.buffer, 64);
+}
+
 #ifdef _MSC_VER
 #pragma warning(pop)
 #endif
@@ -218,6 +218,15 @@ typedef union
 	UINT_32 l[16];
 } SHA1_WORKSPACE_BLOCK;
 
+// Running hash state (for checkpoint and resume)
+
+typedef struct
+{
+	UINT_32 state[5];
+	UINT_32 count[2];
+	UINT_8 buffer[64];
+} SHA1_STATE;
+
 class CSHA1
 {
 public:
@@ -263,6 +272,10 @@ public:
 	// Get the raw message digest (20 bytes)
 	bool GetHash(UINT_8* pbDest20) const;
 
+	// Save/restore running state; resume hashing with Update()
+	void GetState(SHA1_STATE& st) const;
+	void SetState(const SHA1_STATE& st);
+
 private:
 	// Private SHA-1 transformation
 	void Transform(UINT_32* pState, const UINT_8* pBuffer);